@@ -95,6 +95,10 @@ unsigned BasicHashTable::numEntries() const {
   return fNumEntries;
 }
 
+HashTable::Iterator* BasicHashTable::createIterator() const {
+  return new Iterator(*this);
+}
+
 BasicHashTable::Iterator::Iterator(BasicHashTable const& table)
   : fTable(table), fNextIndex(0), fNextEntry(NULL) {
 }
@@ -113,17 +117,6 @@ void* BasicHashTable::Iterator::next(char const*& key) {
   return entry->value;
 }
 
-////////// Implementation of HashTable creation functions //////////
-
-HashTable* HashTable::create(int keyType) {
-  return new BasicHashTable(keyType);
-}
-
-HashTable::Iterator* HashTable::Iterator::create(HashTable const& hashTable) {
-  // "hashTable" is assumed to be a BasicHashTable
-  return new BasicHashTable::Iterator((BasicHashTable const&)hashTable);
-}
-
 ////////// Implementation of internal member functions //////////
 
 BasicHashTable::TableEntry* BasicHashTable
@@ -19,6 +19,15 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "BasicUsageEnvironment0.hh"
 #include "HandlerSet.hh"
+#include <atomic>
+#if defined(__WIN32__) || defined(_WIN32)
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+#endif
 
 ////////// A subclass of DelayQueueEntry,
 //////////     used to implement BasicTaskScheduler0::scheduleDelayedTask()
@@ -41,19 +50,172 @@ private:
 };
 
 
+////////// EventTriggerQueue //////////
+//////////     used to implement BasicTaskScheduler0::triggerEvent()
+
+// Each call to "triggerEvent()" adds one of these to the queue.  (Note that "eventTriggerId" includes the
+// trigger's generation at the time that the event was triggered.)
+class TriggeredEvent {
+public:
+  TriggeredEvent(EventTriggerId eventTriggerId = 0, void* clientData = NULL)
+    : next(NULL), eventTriggerId(eventTriggerId), clientData(clientData) {
+  }
+
+  std::atomic<TriggeredEvent*> next;
+  EventTriggerId eventTriggerId;
+  void* clientData;
+};
+
+// A lock-free queue that any number of threads can add to, but that only the event loop removes from.
+// (Adding swaps the new event into "fHead" - so producers never wait for each other - and then links it
+//  behind the previous head.  The event loop removes from "fTail".  A dummy "fStub" event keeps the list
+//  non-empty.)
+// Adding an event to the queue also makes our 'wakeup' file descriptor (an "eventfd", or else a pipe) readable,
+// so that the event loop - if it's blocked in "select()" (or "epoll_wait()") - handles the event immediately.
+class EventTriggerQueue {
+public:
+  EventTriggerQueue();
+  virtual ~EventTriggerQueue();
+
+  void enqueue(EventTriggerId eventTriggerId, void* clientData); // may be called from any thread
+  TriggeredEvent* dequeue();
+      // called only from the event loop; returns NULL if there's no (completely added) event.
+      // The caller is responsible for deleting the result.
+
+  int wakeupFd() const { return fWakeupReadFd; } // -1 if we couldn't create one
+  void signal(); // makes "wakeupFd()" readable, unless it's already been made so
+  void noteWakeup(); // called (from the event loop) when "wakeupFd()" is readable
+
+private:
+  void push(TriggeredEvent* event);
+
+private:
+  std::atomic<TriggeredEvent*> fHead; // the most recently added event
+  TriggeredEvent* fTail; // the next event to be removed (or "&fStub")
+  TriggeredEvent fStub;
+  std::atomic<bool> fWakeupIsPending;
+  int fWakeupReadFd, fWakeupWriteFd; // the same, for an "eventfd"
+};
+
+EventTriggerQueue::EventTriggerQueue()
+  : fHead(&fStub), fTail(&fStub), fWakeupIsPending(false),
+    fWakeupReadFd(-1), fWakeupWriteFd(-1) {
+#if defined(__WIN32__) || defined(_WIN32)
+  // Windoze's "select()" works only on sockets, so there's no 'wakeup' file descriptor; instead, triggered
+  // events get handled the next time that the event loop wakes up for some other reason.
+#else
+#if defined(__linux__)
+  fWakeupReadFd = fWakeupWriteFd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+#endif
+  if (fWakeupReadFd < 0) {
+    int fds[2];
+    if (pipe(fds) == 0) {
+      fWakeupReadFd = fds[0];
+      fWakeupWriteFd = fds[1];
+      fcntl(fWakeupReadFd, F_SETFL, fcntl(fWakeupReadFd, F_GETFL)|O_NONBLOCK);
+      fcntl(fWakeupWriteFd, F_SETFL, fcntl(fWakeupWriteFd, F_GETFL)|O_NONBLOCK);
+    }
+  }
+#endif
+}
+
+EventTriggerQueue::~EventTriggerQueue() {
+  TriggeredEvent* event;
+  while ((event = dequeue()) != NULL) delete event;
+
+#if defined(__WIN32__) || defined(_WIN32)
+#else
+  if (fWakeupWriteFd != fWakeupReadFd) close(fWakeupWriteFd);
+  if (fWakeupReadFd >= 0) close(fWakeupReadFd);
+#endif
+}
+
+void EventTriggerQueue::enqueue(EventTriggerId eventTriggerId, void* clientData) {
+  push(new TriggeredEvent(eventTriggerId, clientData));
+  signal();
+}
+
+void EventTriggerQueue::push(TriggeredEvent* event) {
+  event->next.store(NULL, std::memory_order_relaxed);
+  TriggeredEvent* prev = fHead.exchange(event, std::memory_order_acq_rel);
+  // (Until the next statement is done, the event loop can't see "event" (or any later event).)
+  prev->next.store(event, std::memory_order_release);
+}
+
+TriggeredEvent* EventTriggerQueue::dequeue() {
+  TriggeredEvent* tail = fTail;
+  TriggeredEvent* next = tail->next.load(std::memory_order_acquire);
+  if (tail == &fStub) {
+    if (next == NULL) return NULL; // the queue is empty
+    // Skip over the stub:
+    fTail = tail = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+
+  if (next != NULL) {
+    fTail = next;
+    return tail;
+  }
+
+  // "tail" is the last event that we can see.  Unless another thread is in the middle of adding an event
+  // (in which case we'll get to "tail" later), put the stub back behind it, so that we can remove it:
+  if (tail != fHead.load(std::memory_order_acquire)) return NULL;
+  push(&fStub);
+  next = tail->next.load(std::memory_order_acquire);
+  if (next != NULL) {
+    fTail = next;
+    return tail;
+  }
+
+  return NULL;
+}
+
+void EventTriggerQueue::signal() {
+  // Write to our 'wakeup' file descriptor only if it hasn't already been written to (since the event loop
+  // last read it).  This saves a system call for events that are triggered close together:
+  if (fWakeupWriteFd < 0 || fWakeupIsPending.exchange(true, std::memory_order_acq_rel)) return;
+
+#if defined(__WIN32__) || defined(_WIN32)
+#else
+  u_int64_t one = 1; // (an "eventfd" requires an 8-byte write; for a pipe, it doesn't matter)
+  if (write(fWakeupWriteFd, &one, sizeof one) < 0) {} // (the only likely failure - a full pipe - is harmless)
+#endif
+}
+
+void EventTriggerQueue::noteWakeup() {
+#if defined(__WIN32__) || defined(_WIN32)
+#else
+  u_int64_t buf[16];
+  while (read(fWakeupReadFd, buf, sizeof buf) > 0 && fWakeupReadFd != fWakeupWriteFd) {}
+#endif
+
+  // Note that we clear "fWakeupIsPending" *after* reading, so that it can't remain set while the file descriptor
+  // is not readable.  (Any event added after this will write again.)
+  fWakeupIsPending.exchange(false, std::memory_order_acq_rel);
+}
+
+
 ////////// BasicTaskScheduler0 //////////
 
 BasicTaskScheduler0::BasicTaskScheduler0()
-  : fLastHandledSocketNum(-1), fTriggersAwaitingHandling(0), fLastUsedTriggerMask(1), fLastUsedTriggerNum(MAX_NUM_EVENT_TRIGGERS-1) {
+  : fLastHandledSocketNum(-1),
+    fTriggeredEventHandlersSize(EVENT_TRIGGER_TABLE_INITIAL_SIZE), fLastUsedTriggerNum(EVENT_TRIGGER_TABLE_INITIAL_SIZE-1),
+    fHaveSetUpTriggerWakeup(False) {
   fHandlers = new HandlerSet;
-  for (unsigned i = 0; i < MAX_NUM_EVENT_TRIGGERS; ++i) {
+  fTriggeredEvents = new EventTriggerQueue;
+  fTriggeredEventHandlers = new TaskFunc*[fTriggeredEventHandlersSize];
+  fTriggerGenerations = new u_int16_t[fTriggeredEventHandlersSize];
+  for (unsigned i = 0; i < fTriggeredEventHandlersSize; ++i) {
     fTriggeredEventHandlers[i] = NULL;
-    fTriggeredEventClientDatas[i] = NULL;
+    fTriggerGenerations[i] = 0;
   }
 }
 
 BasicTaskScheduler0::~BasicTaskScheduler0() {
   delete fHandlers;
+  delete fTriggeredEvents;
+  delete[] fTriggeredEventHandlers;
+  delete[] fTriggerGenerations;
 }
 
 TaskToken BasicTaskScheduler0::scheduleDelayedTask(int64_t microseconds,
@@ -82,64 +244,94 @@ void BasicTaskScheduler0::doEventLoop(char volatile* watchVariable) {
 }
 
 EventTriggerId BasicTaskScheduler0::createEventTrigger(TaskFunc* eventHandlerProc) {
-  unsigned i = fLastUsedTriggerNum;
-  EventTriggerId mask = fLastUsedTriggerMask;
+  if (!fHaveSetUpTriggerWakeup) {
+    // Have the event loop wake up whenever an event is triggered.  (We can't do this in our constructor,
+    // because "setBackgroundHandling()" is implemented by our subclass.)
+    if (fTriggeredEvents->wakeupFd() >= 0) {
+      setBackgroundHandling(fTriggeredEvents->wakeupFd(), SOCKET_READABLE, triggerWakeupHandler, this);
+    }
+    fHaveSetUpTriggerWakeup = True;
+  }
 
+  // Look for a free trigger number, starting after the one that we used last.  (Any event that was triggered - but
+  // not yet handled - before a trigger was deleted is ignored, because its trigger's generation will have changed.)
+  unsigned i = fLastUsedTriggerNum;
   do {
-    i = (i+1)%MAX_NUM_EVENT_TRIGGERS;
-    mask >>= 1;
-    if (mask == 0) mask = 0x80000000;
+    i = (i+1)%fTriggeredEventHandlersSize;
+    if (fTriggeredEventHandlers[i] == NULL) break;
+  } while (i != fLastUsedTriggerNum);
 
-    if (fTriggeredEventHandlers[i] == NULL) {
-      // This trigger number is free; use it:
-      fTriggeredEventHandlers[i] = eventHandlerProc;
-      fTriggeredEventClientDatas[i] = NULL; // sanity
+  if (fTriggeredEventHandlers[i] != NULL) {
+    // All trigger numbers are in use, so double the size of the table (if we can), and use the first new trigger number:
+    if (fTriggeredEventHandlersSize >= MAX_NUM_EVENT_TRIGGERS) return 0;
+    unsigned newSize = 2*fTriggeredEventHandlersSize;
+    if (newSize > MAX_NUM_EVENT_TRIGGERS) newSize = MAX_NUM_EVENT_TRIGGERS;
+    TaskFunc** newHandlers = new TaskFunc*[newSize];
+    u_int16_t* newGenerations = new u_int16_t[newSize];
+    for (unsigned k = 0; k < newSize; ++k) {
+      newHandlers[k] = k < fTriggeredEventHandlersSize ? fTriggeredEventHandlers[k] : NULL;
+      newGenerations[k] = k < fTriggeredEventHandlersSize ? fTriggerGenerations[k] : 0;
+    }
+    delete[] fTriggeredEventHandlers; delete[] fTriggerGenerations;
+    fTriggeredEventHandlers = newHandlers; fTriggerGenerations = newGenerations;
+    i = fTriggeredEventHandlersSize;
+    fTriggeredEventHandlersSize = newSize;
+  }
 
-      fLastUsedTriggerMask = mask;
-      fLastUsedTriggerNum = i;
+  fTriggeredEventHandlers[i] = eventHandlerProc;
+  fLastUsedTriggerNum = i;
 
-      return mask;
-    }
-  } while (i != fLastUsedTriggerNum);
+  // Note that the trigger number part is i+1, because an "EventTriggerId" of 0 means 'no trigger':
+  return ((EventTriggerId)fTriggerGenerations[i]<<EVENT_TRIGGER_NUM_BITS) | (i+1);
+}
 
-  // All available event triggers are allocated; return 0 instead:
-  return 0;
+Boolean BasicTaskScheduler0::lookupEventTrigger(EventTriggerId eventTriggerId, unsigned& triggerNum) const {
+  triggerNum = (eventTriggerId&MAX_NUM_EVENT_TRIGGERS) - 1;
+  return triggerNum < fTriggeredEventHandlersSize && fTriggeredEventHandlers[triggerNum] != NULL
+    && fTriggerGenerations[triggerNum] == (u_int16_t)(eventTriggerId>>EVENT_TRIGGER_NUM_BITS);
 }
 
 void BasicTaskScheduler0::deleteEventTrigger(EventTriggerId eventTriggerId) {
-  fTriggersAwaitingHandling &=~ eventTriggerId;
-
-  if (eventTriggerId == fLastUsedTriggerMask) { // common-case optimization:
-    fTriggeredEventHandlers[fLastUsedTriggerNum] = NULL;
-    fTriggeredEventClientDatas[fLastUsedTriggerNum] = NULL;
-  } else {
-    // "eventTriggerId" should have just one bit set.
-    // However, we do the reasonable thing if the user happened to 'or' together two or more "EventTriggerId"s:
-    EventTriggerId mask = 0x80000000;
-    for (unsigned i = 0; i < MAX_NUM_EVENT_TRIGGERS; ++i) {
-      if ((eventTriggerId&mask) != 0) {
-	fTriggeredEventHandlers[i] = NULL;
-	fTriggeredEventClientDatas[i] = NULL;
-      }
-      mask >>= 1;
-    }
+  // Any already-triggered events for this trigger will be ignored when we get to them, because we also change
+  // the trigger's generation.  (That way, they won't get handled by a new trigger that reuses this trigger number.)
+  unsigned triggerNum;
+  if (lookupEventTrigger(eventTriggerId, triggerNum)) {
+    fTriggeredEventHandlers[triggerNum] = NULL;
+    ++fTriggerGenerations[triggerNum];
   }
 }
 
 void BasicTaskScheduler0::triggerEvent(EventTriggerId eventTriggerId, void* clientData) {
-  // First, record the "clientData".  (Note that we allow "eventTriggerId" to be a combination of bits for multiple events.)
-  EventTriggerId mask = 0x80000000;
-  for (unsigned i = 0; i < MAX_NUM_EVENT_TRIGGERS; ++i) {
-    if ((eventTriggerId&mask) != 0) {
-      fTriggeredEventClientDatas[i] = clientData;
+  // Note that this function (unlike others in the library) can be called from any thread, so it must not access
+  // anything other than "fTriggeredEvents".
+  if (eventTriggerId == 0) return;
+  fTriggeredEvents->enqueue(eventTriggerId, clientData);
+}
+
+void BasicTaskScheduler0::handleTriggeredEvents() {
+  for (unsigned i = 0; i < MAX_TRIGGERED_EVENTS_PER_STEP; ++i) {
+    TriggeredEvent* event = fTriggeredEvents->dequeue();
+    if (event == NULL) return;
+
+    EventTriggerId eventTriggerId = event->eventTriggerId;
+    void* clientData = event->clientData;
+    delete event;
+
+    // (Note that we look up the handler each time, in case a handler creates or deletes event triggers.)
+    unsigned triggerNum;
+    if (lookupEventTrigger(eventTriggerId, triggerNum)) {
+      (*fTriggeredEventHandlers[triggerNum])(clientData);
     }
-    mask >>= 1;
   }
 
-  // Then, note this event as being ready to be handled.
-  // (Note that because this function (unlike others in the library) can be called from an external thread, we do this last, to
-  //  reduce the risk of a race condition.)
-  fTriggersAwaitingHandling |= eventTriggerId;
+  // There may be more events to handle.  Make sure that the next "SingleStep()" doesn't block before handling them:
+  fTriggeredEvents->signal();
+}
+
+void BasicTaskScheduler0::triggerWakeupHandler(void* clientData, int /*mask*/) {
+  // The events themselves get handled by "handleTriggeredEvents()", later in the current "SingleStep()":
+  BasicTaskScheduler0* scheduler = (BasicTaskScheduler0*)clientData;
+  scheduler->fTriggeredEvents->noteWakeup();
 }
 
 
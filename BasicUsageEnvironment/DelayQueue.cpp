@@ -20,6 +20,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "DelayQueue.hh"
 #include "GroupsockHelper.hh"
+#include "HashTable.hh"
+#include <atomic>
 
 static const int MILLION = 1000000;
 
@@ -92,11 +94,12 @@ const DelayInterval ETERNITY(INT_MAX, MILLION-1);
 
 ///// DelayQueueEntry /////
 
-intptr_t DelayQueueEntry::tokenCounter = 0;
+// Entries may be created concurrently - by different threads, each with its own scheduler - so we
+// allocate tokens atomically.  (Otherwise, a lost update could give two live entries the same token.)
+static std::atomic<intptr_t> tokenCounter(0);
 
 DelayQueueEntry::DelayQueueEntry(DelayInterval delay)
-  : fDeltaTimeRemaining(delay) {
-  fNext = fPrev = this;
+  : fDelay(delay), fAlarmTime(0), fSequenceNum(0), fHeapIndex(-1) {
   fToken = ++tokenCounter;
 }
 
@@ -111,40 +114,50 @@ void DelayQueueEntry::handleTimeout() {
 ///// DelayQueue /////
 
 DelayQueue::DelayQueue()
-  : DelayQueueEntry(ETERNITY) {
+  : fHeap(NULL), fNumEntries(0), fHeapSize(0),
+    fEntriesByToken(HashTable::create(ONE_WORD_HASH_KEYS)), fNextSequenceNum(0),
+    fCurrentTime(0), fTimeToNextAlarm(DELAY_ZERO) {
   fLastSyncTime = TimeNow();
 }
 
 DelayQueue::~DelayQueue() {
-  while (fNext != this) {
-    DelayQueueEntry* entryToRemove = fNext;
+  DelayQueueEntry* entryToRemove;
+  while ((entryToRemove = head()) != NULL) {
     removeEntry(entryToRemove);
     delete entryToRemove;
   }
+
+  delete fEntriesByToken;
+  delete[] fHeap;
 }
 
 void DelayQueue::addEntry(DelayQueueEntry* newEntry) {
   synchronize();
 
-  DelayQueueEntry* cur = head();
-  while (newEntry->fDeltaTimeRemaining >= cur->fDeltaTimeRemaining) {
-    newEntry->fDeltaTimeRemaining -= cur->fDeltaTimeRemaining;
-    cur = cur->fNext;
+  newEntry->fAlarmTime = fCurrentTime + (int64_t)newEntry->fDelay.seconds()*MILLION + newEntry->fDelay.useconds();
+  newEntry->fSequenceNum = fNextSequenceNum++;
+      // so that entries with the same alarm time get handled in the order in which they were added
+
+  if (fNumEntries == fHeapSize) {
+    // Grow the heap:
+    unsigned newHeapSize = fHeapSize == 0 ? 32 : 2*fHeapSize;
+    DelayQueueEntry** newHeap = new DelayQueueEntry*[newHeapSize];
+    for (unsigned i = 0; i < fNumEntries; ++i) newHeap[i] = fHeap[i];
+    delete[] fHeap;
+    fHeap = newHeap;
+    fHeapSize = newHeapSize;
   }
+  placeEntry(newEntry, fNumEntries++);
+  siftUp(newEntry->fHeapIndex);
 
-  cur->fDeltaTimeRemaining -= newEntry->fDeltaTimeRemaining;
-
-  // Add "newEntry" to the queue, just before "cur":
-  newEntry->fNext = cur;
-  newEntry->fPrev = cur->fPrev;
-  cur->fPrev = newEntry->fPrev->fNext = newEntry;
+  fEntriesByToken->Add((char const*)(newEntry->token()), newEntry);
 }
 
 void DelayQueue::updateEntry(DelayQueueEntry* entry, DelayInterval newDelay) {
   if (entry == NULL) return;
 
   removeEntry(entry);
-  entry->fDeltaTimeRemaining = newDelay;
+  entry->fDelay = newDelay;
   addEntry(entry);
 }
 
@@ -154,13 +167,19 @@ void DelayQueue::updateEntry(intptr_t tokenToFind, DelayInterval newDelay) {
 }
 
 void DelayQueue::removeEntry(DelayQueueEntry* entry) {
-  if (entry == NULL || entry->fNext == NULL) return;
+  if (entry == NULL || entry->fHeapIndex < 0) return;
+
+  // Replace the entry with the last entry in the heap, then restore the heap ordering:
+  unsigned index = entry->fHeapIndex;
+  DelayQueueEntry* lastEntry = fHeap[--fNumEntries];
+  if (index < fNumEntries) {
+    placeEntry(lastEntry, index);
+    siftUp(index);
+    siftDown(lastEntry->fHeapIndex);
+  }
+  entry->fHeapIndex = -1; // in case we should try to remove it again
 
-  entry->fNext->fDeltaTimeRemaining += entry->fDeltaTimeRemaining;
-  entry->fPrev->fNext = entry->fNext;
-  entry->fNext->fPrev = entry->fPrev;
-  entry->fNext = entry->fPrev = NULL;
-  // in case we should try to remove it again
+  fEntriesByToken->Remove((char const*)(entry->token()));
 }
 
 DelayQueueEntry* DelayQueue::removeEntry(intptr_t tokenToFind) {
@@ -170,32 +189,33 @@ DelayQueueEntry* DelayQueue::removeEntry(intptr_t tokenToFind) {
 }
 
 DelayInterval const& DelayQueue::timeToNextAlarm() {
-  if (head()->fDeltaTimeRemaining == DELAY_ZERO) return DELAY_ZERO; // a common case
+  DelayQueueEntry* nextEntry = head();
+  if (nextEntry == NULL) return ETERNITY;
+  if (nextEntry->fAlarmTime <= fCurrentTime) return DELAY_ZERO; // a common case
 
   synchronize();
-  return head()->fDeltaTimeRemaining;
+  int64_t usecsRemaining = nextEntry->fAlarmTime - fCurrentTime;
+  if (usecsRemaining <= 0) return DELAY_ZERO;
+
+  fTimeToNextAlarm = DelayInterval((time_base_seconds)(usecsRemaining/MILLION), (time_base_seconds)(usecsRemaining%MILLION));
+  return fTimeToNextAlarm;
 }
 
 void DelayQueue::handleAlarm() {
-  if (head()->fDeltaTimeRemaining != DELAY_ZERO) synchronize();
+  DelayQueueEntry* nextEntry = head();
+  if (nextEntry == NULL) return;
+  if (nextEntry->fAlarmTime > fCurrentTime) synchronize();
 
-  if (head()->fDeltaTimeRemaining == DELAY_ZERO) {
+  if (nextEntry->fAlarmTime <= fCurrentTime) {
     // This event is due to be handled:
-    DelayQueueEntry* toRemove = head();
-    removeEntry(toRemove); // do this first, in case handler accesses queue
+    removeEntry(nextEntry); // do this first, in case handler accesses queue
 
-    toRemove->handleTimeout();
+    nextEntry->handleTimeout();
   }
 }
 
 DelayQueueEntry* DelayQueue::findEntryByToken(intptr_t tokenToFind) {
-  DelayQueueEntry* cur = head();
-  while (cur != this) {
-    if (cur->token() == tokenToFind) return cur;
-    cur = cur->fNext;
-  }
-
-  return NULL;
+  return (DelayQueueEntry*)(fEntriesByToken->Lookup((char const*)tokenToFind));
 }
 
 void DelayQueue::synchronize() {
@@ -209,14 +229,45 @@ void DelayQueue::synchronize() {
   DelayInterval timeSinceLastSync = timeNow - fLastSyncTime;
   fLastSyncTime = timeNow;
 
-  // Then, adjust the delay queue for any entries whose time is up:
-  DelayQueueEntry* curEntry = head();
-  while (timeSinceLastSync >= curEntry->fDeltaTimeRemaining) {
-    timeSinceLastSync -= curEntry->fDeltaTimeRemaining;
-    curEntry->fDeltaTimeRemaining = DELAY_ZERO;
-    curEntry = curEntry->fNext;
+  // Then, advance our own clock by this amount.  (Because we use our own clock - which never goes backwards - for
+  // each entry's alarm time, a change to the system clock doesn't delay (or hasten) any entries.)
+  fCurrentTime += (int64_t)timeSinceLastSync.seconds()*MILLION + timeSinceLastSync.useconds();
+}
+
+Boolean DelayQueue::isEarlier(DelayQueueEntry const* entry1, DelayQueueEntry const* entry2) const {
+  return entry1->fAlarmTime < entry2->fAlarmTime
+    || (entry1->fAlarmTime == entry2->fAlarmTime && entry1->fSequenceNum < entry2->fSequenceNum);
+}
+
+void DelayQueue::placeEntry(DelayQueueEntry* entry, unsigned index) {
+  fHeap[index] = entry;
+  entry->fHeapIndex = (int)index;
+}
+
+void DelayQueue::siftUp(unsigned index) {
+  DelayQueueEntry* entry = fHeap[index];
+  while (index > 0) {
+    unsigned parentIndex = (index-1)/2;
+    if (!isEarlier(entry, fHeap[parentIndex])) break;
+
+    placeEntry(fHeap[parentIndex], index);
+    index = parentIndex;
+  }
+  placeEntry(entry, index);
+}
+
+void DelayQueue::siftDown(unsigned index) {
+  DelayQueueEntry* entry = fHeap[index];
+  while (1) {
+    unsigned childIndex = 2*index + 1;
+    if (childIndex >= fNumEntries) break;
+    if (childIndex+1 < fNumEntries && isEarlier(fHeap[childIndex+1], fHeap[childIndex])) ++childIndex;
+    if (!isEarlier(fHeap[childIndex], entry)) break;
+
+    placeEntry(fHeap[childIndex], index);
+    index = childIndex;
   }
-  curEntry->fDeltaTimeRemaining -= timeSinceLastSync;
+  placeEntry(entry, index);
 }
 
 
@@ -0,0 +1,309 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018 Live Networks, Inc.  All rights reserved.
+// Basic Usage Environment: for a simple, non-scripted, console application
+// Implementation of an "epoll()"-based task scheduler (Linux only)
+
+#include "BasicUsageEnvironment.hh"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+
+// The maximum number of events that we ask for in each call to "epoll_wait()":
+#define EPOLL_MAX_EVENTS_PER_WAIT 256
+
+struct EpollHandlerDescriptor {
+  int conditionSet; // 0 iff there's no handler for this socket
+  TaskScheduler::BackgroundHandlerProc* handlerProc;
+  void* clientData;
+  u_int32_t generation; // incremented whenever the handler is cleared, so we can detect stale "epoll" events
+  Boolean isPollable; // False iff "epoll_ctl()" rejected the socket (e.g., because it's a regular file)
+  unsigned unpollableIndex; // our position in "fUnpollableSockets" (if "isPollable" is False)
+};
+
+// Each "epoll" event records both the socket number and the handler's generation:
+static u_int64_t packEventData(int socketNum, u_int32_t generation) {
+  return ((u_int64_t)generation<<32) | (u_int32_t)socketNum;
+}
+
+static u_int32_t epollEventsFromConditionSet(int conditionSet) {
+  u_int32_t events = 0;
+  if (conditionSet&SOCKET_READABLE) events |= EPOLLIN;
+  if (conditionSet&SOCKET_WRITABLE) events |= EPOLLOUT;
+  if (conditionSet&SOCKET_EXCEPTION) events |= EPOLLPRI;
+#ifdef EPOLLEXCLUSIVE
+  // ("epoll_ctl()" allows "EPOLLEXCLUSIVE" only with "EPOLLIN" and/or "EPOLLOUT".)
+  else if (conditionSet&SOCKET_EXCLUSIVE) events |= EPOLLEXCLUSIVE;
+#endif
+  return events;
+}
+
+static int conditionSetFromEpollEvents(u_int32_t events) {
+  int conditionSet = 0;
+  // Note: "select()" reports a socket that's hung up, or has an error, as being readable (and writable), so we do the same:
+  if (events&(EPOLLIN|EPOLLHUP|EPOLLERR)) conditionSet |= SOCKET_READABLE;
+  if (events&(EPOLLOUT|EPOLLHUP|EPOLLERR)) conditionSet |= SOCKET_WRITABLE;
+  if (events&EPOLLPRI) conditionSet |= SOCKET_EXCEPTION;
+  return conditionSet;
+}
+
+////////// EpollTaskScheduler //////////
+
+EpollTaskScheduler* EpollTaskScheduler::createNew(unsigned maxSchedulerGranularity) {
+  int epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd < 0) return NULL;
+
+  return new EpollTaskScheduler(maxSchedulerGranularity, epollFd);
+}
+
+EpollTaskScheduler::EpollTaskScheduler(unsigned maxSchedulerGranularity, int epollFd)
+  : fMaxSchedulerGranularity(maxSchedulerGranularity), fEpollFd(epollFd),
+    fEpollHandlers(NULL), fNumEpollHandlers(0),
+    fUnpollableSockets(NULL), fNumUnpollableSockets(0), fUnpollableSocketsSize(0),
+    fReadyEventsSize(EPOLL_MAX_EVENTS_PER_WAIT), fNumReadyEvents(0), fNextReadyEvent(0) {
+  fReadyEvents = new struct epoll_event[fReadyEventsSize];
+
+  if (maxSchedulerGranularity > 0) schedulerTickTask(); // ensures that we handle events frequently
+}
+
+EpollTaskScheduler::~EpollTaskScheduler() {
+  delete[] fReadyEvents;
+  delete[] fUnpollableSockets;
+  delete[] fEpollHandlers;
+  close(fEpollFd);
+}
+
+void EpollTaskScheduler::schedulerTickTask(void* clientData) {
+  ((EpollTaskScheduler*)clientData)->schedulerTickTask();
+}
+
+void EpollTaskScheduler::schedulerTickTask() {
+  scheduleDelayedTask(fMaxSchedulerGranularity, schedulerTickTask, this);
+}
+
+#ifndef MILLION
+#define MILLION 1000000
+#endif
+
+void EpollTaskScheduler::SingleStep(unsigned maxDelayTime) {
+  if (fNextReadyEvent >= fNumReadyEvents) {
+    // We've handled all of the events from the previous "epoll_wait()", so wait for some more:
+    DelayInterval const& timeToDelay = fDelayQueue.timeToNextAlarm();
+    int64_t usecsToDelay = (int64_t)timeToDelay.seconds()*MILLION + timeToDelay.useconds();
+    // Don't make the delay any larger than 1 million seconds (11.5 days), and also check our "maxDelayTime" parameter:
+    const int64_t MAX_USECS_TO_DELAY = (int64_t)MILLION*MILLION;
+    if (usecsToDelay > MAX_USECS_TO_DELAY) usecsToDelay = MAX_USECS_TO_DELAY;
+    if (maxDelayTime > 0 && usecsToDelay > (int64_t)maxDelayTime) usecsToDelay = maxDelayTime;
+    if (fNumUnpollableSockets > 0) usecsToDelay = 0; // because those sockets are always ready
+
+    // "epoll_wait()" takes milliseconds.  Round up, so that we don't return early, and then spin, before an alarm is due:
+    int64_t msecsToDelay = (usecsToDelay + 999)/1000;
+    if (msecsToDelay > 0x7FFFFFFF) msecsToDelay = 0x7FFFFFFF;
+
+    int numEvents = epoll_wait(fEpollFd, fReadyEvents, EPOLL_MAX_EVENTS_PER_WAIT, (int)msecsToDelay);
+    if (numEvents < 0) {
+      if (errno != EINTR && errno != EAGAIN) {
+	// Unexpected error - treat this as fatal:
+	perror("EpollTaskScheduler::SingleStep(): epoll_wait() fails");
+	internalError();
+      }
+      numEvents = 0;
+    }
+
+    // Then add an event for each 'unpollable' socket:
+    for (unsigned i = 0; i < fNumUnpollableSockets; ++i) {
+      int sock = fUnpollableSockets[i];
+      struct epoll_event& event = fReadyEvents[numEvents++];
+      event.events = EPOLLIN|EPOLLOUT;
+      event.data.u64 = packEventData(sock, fEpollHandlers[sock].generation);
+    }
+
+    fNumReadyEvents = numEvents;
+    fNextReadyEvent = 0;
+  }
+
+  // Call the handler function for one ready socket:
+  while (fNextReadyEvent < fNumReadyEvents) {
+    struct epoll_event const& event = fReadyEvents[fNextReadyEvent++];
+        // Note: we advance "fNextReadyEvent" before calling the handler,
+        // in case the handler calls "doEventLoop()" reentrantly.
+    int sock = (int)(u_int32_t)event.data.u64;
+    u_int32_t generation = (u_int32_t)(event.data.u64>>32);
+
+    EpollHandlerDescriptor* handler = lookupHandler(sock);
+    if (handler == NULL || handler->generation != generation || handler->handlerProc == NULL) {
+      continue; // the handler for this socket was cleared (by some earlier handler) after this event was reported
+    }
+
+    int resultConditionSet = conditionSetFromEpollEvents(event.events)&handler->conditionSet;
+    if (resultConditionSet != 0) {
+      (*handler->handlerProc)(handler->clientData, resultConditionSet);
+      break;
+    }
+  }
+
+  // Also handle any newly-triggered events (Note that we do this *after* calling a socket handler,
+  // in case the triggered event handler modifies The set of readable sockets.)
+  handleTriggeredEvents();
+
+  // Also handle any delayed event that may have come due.
+  fDelayQueue.handleAlarm();
+}
+
+void EpollTaskScheduler
+  ::setBackgroundHandling(int socketNum, int conditionSet, BackgroundHandlerProc* handlerProc, void* clientData) {
+  if (socketNum < 0) return;
+  if (conditionSet == 0) {
+    clearHandler(socketNum);
+    return;
+  }
+
+  EpollHandlerDescriptor& handler = handlerFor(socketNum);
+  Boolean wasAssigned = handler.conditionSet != 0;
+  u_int32_t oldEvents = epollEventsFromConditionSet(handler.conditionSet);
+  handler.conditionSet = conditionSet;
+  handler.handlerProc = handlerProc;
+  handler.clientData = clientData;
+  if (wasAssigned && !handler.isPollable) return; // this socket is already in "fUnpollableSockets"
+
+  struct epoll_event event;
+  event.events = epollEventsFromConditionSet(conditionSet);
+  event.data.u64 = packEventData(socketNum, handler.generation);
+  int op = wasAssigned ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+#ifdef EPOLLEXCLUSIVE
+  if (wasAssigned && ((oldEvents|event.events)&EPOLLEXCLUSIVE) != 0) {
+    // "EPOLL_CTL_MOD" can't be used to set or clear "EPOLLEXCLUSIVE" (or to modify a socket that has it), so start afresh:
+    epoll_ctl(fEpollFd, EPOLL_CTL_DEL, socketNum, &event);
+    op = EPOLL_CTL_ADD;
+  }
+#else
+  (void)oldEvents;
+#endif
+  if (epoll_ctl(fEpollFd, op, socketNum, &event) != 0) {
+    // If the socket was closed (and its number reused) without its handler being cleared, then the kernel will already have
+    // dropped it from our "epoll" set.  Conversely, it might still be in our set, if it was 'dup()'d.  Handle both cases:
+    if (errno == ENOENT) op = EPOLL_CTL_ADD;
+    else if (errno == EEXIST) op = EPOLL_CTL_MOD;
+    if ((errno != ENOENT && errno != EEXIST) || epoll_ctl(fEpollFd, op, socketNum, &event) != 0) {
+      if (errno == EPERM) {
+	// This descriptor doesn't support "epoll()" - e.g., because it's a regular file.
+	// "select()" treats such descriptors as always ready, so we do the same:
+	handler.isPollable = False;
+	addUnpollableSocket(socketNum);
+      } else {
+	perror("EpollTaskScheduler::setBackgroundHandling(): epoll_ctl() fails");
+	handler.conditionSet = 0;
+	handler.handlerProc = NULL;
+	handler.clientData = NULL;
+	++handler.generation;
+      }
+      return;
+    }
+  }
+  handler.isPollable = True;
+}
+
+void EpollTaskScheduler::moveSocketHandling(int oldSocketNum, int newSocketNum) {
+  if (oldSocketNum < 0 || newSocketNum < 0) return; // sanity check
+
+  EpollHandlerDescriptor* oldHandler = lookupHandler(oldSocketNum);
+  if (oldHandler == NULL) return;
+
+  int conditionSet = oldHandler->conditionSet;
+  BackgroundHandlerProc* handlerProc = oldHandler->handlerProc;
+  void* clientData = oldHandler->clientData;
+  clearHandler(oldSocketNum);
+  setBackgroundHandling(newSocketNum, conditionSet, handlerProc, clientData);
+}
+
+EpollHandlerDescriptor* EpollTaskScheduler::lookupHandler(int socketNum) {
+  if (socketNum < 0 || (unsigned)socketNum >= fNumEpollHandlers) return NULL;
+
+  EpollHandlerDescriptor* handler = &fEpollHandlers[socketNum];
+  return handler->conditionSet == 0 ? NULL : handler;
+}
+
+EpollHandlerDescriptor& EpollTaskScheduler::handlerFor(int socketNum) {
+  if ((unsigned)socketNum >= fNumEpollHandlers) {
+    // Grow our array of descriptors (at least doubling it), so that it includes "socketNum":
+    unsigned newNumHandlers = fNumEpollHandlers == 0 ? 64 : 2*fNumEpollHandlers;
+    if (newNumHandlers <= (unsigned)socketNum) newNumHandlers = socketNum+1;
+
+    EpollHandlerDescriptor* newHandlers = new EpollHandlerDescriptor[newNumHandlers];
+    if (fNumEpollHandlers > 0) memmove(newHandlers, fEpollHandlers, fNumEpollHandlers*sizeof (EpollHandlerDescriptor));
+    memset(&newHandlers[fNumEpollHandlers], 0, (newNumHandlers-fNumEpollHandlers)*sizeof (EpollHandlerDescriptor));
+
+    delete[] fEpollHandlers;
+    fEpollHandlers = newHandlers;
+    fNumEpollHandlers = newNumHandlers;
+  }
+
+  return fEpollHandlers[socketNum];
+}
+
+void EpollTaskScheduler::clearHandler(int socketNum) {
+  EpollHandlerDescriptor* handler = lookupHandler(socketNum);
+  if (handler == NULL) return;
+
+  if (handler->isPollable) {
+    struct epoll_event event; // ignored, but must be non-NULL for old kernels
+    memset(&event, 0, sizeof event);
+    epoll_ctl(fEpollFd, EPOLL_CTL_DEL, socketNum, &event); // this will fail if the socket has already been closed; that's OK
+  } else {
+    removeUnpollableSocket(socketNum);
+  }
+
+  handler->conditionSet = 0;
+  handler->handlerProc = NULL;
+  handler->clientData = NULL;
+  ++handler->generation; // so that any already-reported events for this socket get ignored
+}
+
+void EpollTaskScheduler::addUnpollableSocket(int socketNum) {
+  if (fNumUnpollableSockets == fUnpollableSocketsSize) {
+    unsigned newSize = fUnpollableSocketsSize == 0 ? 8 : 2*fUnpollableSocketsSize;
+
+    int* newUnpollableSockets = new int[newSize];
+    for (unsigned i = 0; i < fNumUnpollableSockets; ++i) newUnpollableSockets[i] = fUnpollableSockets[i];
+    delete[] fUnpollableSockets;
+    fUnpollableSockets = newUnpollableSockets;
+    fUnpollableSocketsSize = newSize;
+
+    // Also make sure that "fReadyEvents" has enough room for one event per 'unpollable' socket.
+    // (We copy the existing events, because some of them might not yet have been handled.)
+    struct epoll_event* newReadyEvents = new struct epoll_event[EPOLL_MAX_EVENTS_PER_WAIT + newSize];
+    memmove(newReadyEvents, fReadyEvents, fNumReadyEvents*sizeof (struct epoll_event));
+    delete[] fReadyEvents;
+    fReadyEvents = newReadyEvents;
+    fReadyEventsSize = EPOLL_MAX_EVENTS_PER_WAIT + newSize;
+  }
+
+  fEpollHandlers[socketNum].unpollableIndex = fNumUnpollableSockets;
+  fUnpollableSockets[fNumUnpollableSockets++] = socketNum;
+}
+
+void EpollTaskScheduler::removeUnpollableSocket(int socketNum) {
+  // Replace this socket's entry with the last one:
+  unsigned index = fEpollHandlers[socketNum].unpollableIndex;
+  int lastSocketNum = fUnpollableSockets[--fNumUnpollableSockets];
+  fUnpollableSockets[index] = lastSocketNum;
+  fEpollHandlers[lastSocketNum].unpollableIndex = index;
+}
+
+#endif
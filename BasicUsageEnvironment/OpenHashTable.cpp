@@ -0,0 +1,318 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018 Live Networks, Inc.  All rights reserved.
+// A hash table implementation that stores its entries in a single array ('open addressing'),
+// rather than in separately-allocated linked buckets.
+// Implementation
+
+#include "OpenHashTable.hh"
+#include "strDup.hh"
+#include <string.h>
+
+// Each entry lives at or after its 'home' slot (chosen from the top bits of its hash), in the
+// first slot where it is no closer to its own home than the slot's current occupant is to its
+// home ('Robin Hood' linear probing).  This keeps probe sequences short and even, and lets a
+// failed lookup stop as soon as it reaches an entry that's closer to home than the key would be.
+// Removing an entry shifts the following entries of its run back by one slot, so we never need
+// 'tombstones'.
+
+#define MIN_NUM_SLOTS_BITS 3
+#define HEAP_KEY 0x80000000 // in "Slot::info": the key is stored in separately-allocated memory
+
+// We keep the table at most 7/8 full (so there's always at least one empty slot):
+#define TABLE_IS_TOO_FULL(numEntries, numSlotsBits) (8*(numEntries) > 7*(1u<<(numSlotsBits)))
+
+static inline unsigned distanceOf(unsigned info) {
+  return (info&~HEAP_KEY) - 1; // assumes that the slot is full
+}
+
+OpenHashTable::OpenHashTable(int keyType)
+  : fSlots(NULL), fNumSlotsBits(0), fNumEntries(0), fKeyType(keyType) {
+}
+
+OpenHashTable::~OpenHashTable() {
+  if (fSlots == NULL) return;
+
+  unsigned const numSlots = 1u<<fNumSlotsBits;
+  for (unsigned i = 0; i < numSlots; ++i) {
+    if (fSlots[i].info != 0) deleteKey(fSlots[i]);
+  }
+  delete[] fSlots;
+}
+
+void* OpenHashTable::Add(char const* key, void* value) {
+  u_int32_t const hash = hashFromKey(key);
+  unsigned index;
+  if (lookupKey(key, hash, index)) {
+    // There's already an item with this key
+    void* oldValue = fSlots[index].value;
+    fSlots[index].value = value;
+    return oldValue;
+  }
+
+  // There's no existing entry; create a new one (first making sure that there'll be room for it):
+  Slot newSlot;
+  newSlot.hash = hash;
+  newSlot.info = 0;
+  assignKey(newSlot, key);
+  newSlot.value = value;
+
+  if (fSlots == NULL) {
+    rebuild(MIN_NUM_SLOTS_BITS);
+    insertSlot(newSlot);
+  } else if (TABLE_IS_TOO_FULL(fNumEntries+1, fNumSlotsBits)) {
+    rebuild(fNumSlotsBits+1);
+    insertSlot(newSlot);
+  } else {
+    // The failed lookup stopped at the slot where the new entry belongs, so insert it from there:
+    unsigned const mask = (1u<<fNumSlotsBits) - 1;
+    insertSlot(newSlot, index, (index - (hash >> (32 - fNumSlotsBits)))&mask);
+  }
+  ++fNumEntries;
+
+  return NULL;
+}
+
+Boolean OpenHashTable::Remove(char const* key) {
+  unsigned index;
+  if (!lookupKey(key, hashFromKey(key), index)) return False; // no such entry
+
+  deleteKey(fSlots[index]);
+  --fNumEntries;
+
+  // Shift back the following entries of this run (those that aren't already in their home slot):
+  unsigned const mask = (1u<<fNumSlotsBits) - 1;
+  unsigned nextIndex = (index+1)&mask;
+  while (fSlots[nextIndex].info != 0 && distanceOf(fSlots[nextIndex].info) > 0) {
+    fSlots[index] = fSlots[nextIndex];
+    --fSlots[index].info;
+
+    index = nextIndex;
+    nextIndex = (index+1)&mask;
+  }
+  fSlots[index].info = 0;
+
+  return True;
+}
+
+void* OpenHashTable::Lookup(char const* key) const {
+  unsigned index;
+  if (!lookupKey(key, hashFromKey(key), index)) return NULL; // no such entry
+
+  return fSlots[index].value;
+}
+
+unsigned OpenHashTable::numEntries() const {
+  return fNumEntries;
+}
+
+HashTable::Iterator* OpenHashTable::createIterator() const {
+  return new Iterator(*this);
+}
+
+// We visit slots in *decreasing* order, starting just below an empty slot.  That way, if the
+// entry that we've just returned gets removed, then the entries that "Remove()" shifts back
+// (into lower slots) are ones that we've already visited, so nothing gets skipped or repeated.
+
+OpenHashTable::Iterator::Iterator(OpenHashTable const& table)
+  : fTable(table), fNextIndex(0), fNumSlotsLeft(0) {
+  if (fTable.fSlots == NULL) return;
+
+  unsigned const mask = (1u<<fTable.fNumSlotsBits) - 1;
+  unsigned emptyIndex = 0;
+  while (fTable.fSlots[emptyIndex].info != 0) ++emptyIndex; // there's always an empty slot
+
+  fNextIndex = (emptyIndex-1)&mask;
+  fNumSlotsLeft = mask; // i.e., all slots other than "emptyIndex"
+}
+
+void* OpenHashTable::Iterator::next(char const*& key) {
+  if (fTable.fSlots == NULL) return NULL;
+
+  unsigned const mask = (1u<<fTable.fNumSlotsBits) - 1;
+  while (fNumSlotsLeft > 0) {
+    OpenHashTable::Slot const& slot = fTable.fSlots[fNextIndex&mask];
+    fNextIndex = (fNextIndex-1)&mask;
+    --fNumSlotsLeft;
+
+    if (slot.info != 0) {
+      key = fTable.keyOf(slot);
+      return slot.value;
+    }
+  }
+
+  return NULL;
+}
+
+////////// Implementation of HashTable creation function //////////
+
+HashTable* HashTable::create(int keyType) {
+  return new OpenHashTable(keyType);
+}
+
+////////// Implementation of internal member functions //////////
+
+// Note: We choose a key's home slot from the *top* bits of its hash, so those bits must depend on
+// all bits of the key.
+
+u_int32_t OpenHashTable::hashFromKey(char const* key) const {
+  if (fKeyType == STRING_HASH_KEYS) {
+    u_int32_t h = 2166136261U; // 'FNV-1a'
+    for (unsigned char const* p = (unsigned char const*)key; *p != '\0'; ++p) {
+      h = (h ^ *p)*16777619U;
+    }
+
+    // Finish with the 'finalizer' from MurmurHash3, because FNV-1a's top bits are poorly mixed for short keys:
+    h ^= h >> 16; h *= 0x85EBCA6B;
+    h ^= h >> 13; h *= 0xC2B2AE35;
+    h ^= h >> 16;
+    return h;
+  } else if (fKeyType == ONE_WORD_HASH_KEYS) {
+    // 'Fibonacci hashing' (multiplying by 2^64/phi), which - unlike the low bits - leaves the top
+    // bits well mixed:
+    return (u_int32_t)(((u_int64_t)(uintptr_t)key*0x9E3779B97F4A7C15ULL) >> 32);
+  } else {
+    unsigned const* k = (unsigned const*)key;
+    u_int32_t h = 0;
+    for (int i = 0; i < fKeyType; ++i) {
+      h = (h + k[i])*0x9E3779B1; // 2^32/phi
+    }
+    return h;
+  }
+}
+
+char const* OpenHashTable::keyOf(Slot const& slot) const {
+  if (fKeyType == ONE_WORD_HASH_KEYS || (slot.info&HEAP_KEY) != 0) return slot.key.ptr;
+  return slot.key.chars;
+}
+
+Boolean OpenHashTable::keyMatches(char const* key1, char const* key2) const {
+  // The way we check the keys for a match depends upon their type:
+  if (fKeyType == STRING_HASH_KEYS) {
+    return (strcmp(key1, key2) == 0);
+  } else if (fKeyType == ONE_WORD_HASH_KEYS) {
+    return (key1 == key2);
+  } else {
+    unsigned* k1 = (unsigned*)key1;
+    unsigned* k2 = (unsigned*)key2;
+
+    for (int i = 0; i < fKeyType; ++i) {
+      if (k1[i] != k2[i]) return False; // keys differ
+    }
+    return True;
+  }
+}
+
+Boolean OpenHashTable::lookupKey(char const* key, u_int32_t hash, unsigned& index) const {
+  if (fSlots == NULL) return False;
+
+  unsigned const mask = (1u<<fNumSlotsBits) - 1;
+  index = hash >> (32 - fNumSlotsBits);
+  if (fKeyType == ONE_WORD_HASH_KEYS) {
+    // A simpler loop for the commonest kind of key: Compare the keys directly (not their hashes), and -
+    // because these keys are never "HEAP_KEY"s - compare each slot's "info" directly with our distance+1
+    // (which also stops at an empty slot, whose "info" is 0):
+    for (unsigned info = 1; ; ++info) {
+      Slot const& slot = fSlots[index];
+      if (slot.info < info) return False;
+      if (slot.key.ptr == key) return True;
+
+      index = (index+1)&mask;
+    }
+  }
+
+  for (unsigned distance = 0; ; ++distance) {
+    Slot const& slot = fSlots[index];
+    if (slot.info == 0 || distanceOf(slot.info) < distance) return False;
+    if (slot.hash == hash && keyMatches(key, keyOf(slot))) return True;
+
+    index = (index+1)&mask;
+  }
+}
+
+void OpenHashTable::assignKey(Slot& slot, char const* key) {
+  // The way we assign the key depends upon its type:
+  if (fKeyType == STRING_HASH_KEYS) {
+    size_t keySize = strlen(key) + 1;
+    if (keySize <= sizeof slot.key.chars) {
+      memcpy(slot.key.chars, key, keySize);
+    } else {
+      slot.key.ptr = strDup(key);
+      slot.info |= HEAP_KEY;
+    }
+  } else if (fKeyType == ONE_WORD_HASH_KEYS) {
+    slot.key.ptr = key;
+  } else if (fKeyType > 0) {
+    size_t keySize = fKeyType*sizeof (unsigned);
+    if (keySize <= sizeof slot.key.words) {
+      memcpy(slot.key.words, key, keySize);
+    } else {
+      unsigned* keyTo = new unsigned[fKeyType];
+      memcpy(keyTo, key, keySize);
+      slot.key.ptr = (char const*)keyTo;
+      slot.info |= HEAP_KEY;
+    }
+  }
+}
+
+void OpenHashTable::deleteKey(Slot& slot) {
+  if ((slot.info&HEAP_KEY) != 0) {
+    if (fKeyType == STRING_HASH_KEYS) {
+      delete[] (char*)slot.key.ptr;
+    } else {
+      delete[] (unsigned*)slot.key.ptr;
+    }
+    slot.info &=~ HEAP_KEY;
+  }
+}
+
+void OpenHashTable::insertSlot(Slot& newSlot) {
+  insertSlot(newSlot, newSlot.hash >> (32 - fNumSlotsBits), 0); // start at our 'home' slot
+}
+
+void OpenHashTable::insertSlot(Slot& newSlot, unsigned index, unsigned distance) {
+  unsigned const mask = (1u<<fNumSlotsBits) - 1;
+  newSlot.info = (newSlot.info&HEAP_KEY) | (distance+1);
+
+  while (fSlots[index].info != 0) {
+    // If the current occupant is closer to its home than we are to ours, then it gives up its slot to us,
+    // and continues on, in our place:
+    if (distanceOf(fSlots[index].info) < distanceOf(newSlot.info)) {
+      Slot tmp = fSlots[index];
+      fSlots[index] = newSlot;
+      newSlot = tmp;
+    }
+    ++newSlot.info;
+    index = (index+1)&mask;
+  }
+  fSlots[index] = newSlot;
+}
+
+void OpenHashTable::rebuild(unsigned newNumSlotsBits) {
+  Slot* oldSlots = fSlots;
+  unsigned const oldNumSlots = oldSlots == NULL ? 0 : 1u<<fNumSlotsBits;
+
+  fNumSlotsBits = newNumSlotsBits;
+  unsigned const newNumSlots = 1u<<fNumSlotsBits;
+  fSlots = new Slot[newNumSlots];
+  for (unsigned i = 0; i < newNumSlots; ++i) fSlots[i].info = 0;
+
+  // Reinsert the existing entries (whose keys - including any separately-allocated keys - move with them):
+  for (unsigned i = 0; i < oldNumSlots; ++i) {
+    if (oldSlots[i].info != 0) insertSlot(oldSlots[i]);
+  }
+  delete[] oldSlots;
+}
@@ -29,6 +29,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 // A simple hash table implementation, inspired by the hash table
 // implementation used in Tcl 7.6: <http://www.tcl.tk/>
+// (Note that "HashTable::create()" now returns an "OpenHashTable" instead.)
 
 #define SMALL_HASH_TABLE_SIZE 4
 
@@ -62,6 +63,7 @@ private: // implementation of inherited pure virtual functions
   virtual void* Lookup(char const* key) const;
   // Returns 0 if not found
   virtual unsigned numEntries() const;
+  virtual HashTable::Iterator* createIterator() const;
 
 private:
   class TableEntry {
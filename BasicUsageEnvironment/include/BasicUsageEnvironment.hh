@@ -83,4 +83,60 @@ private:
 #endif
 };
 
+
+#if defined(__linux__)
+// A task scheduler that uses "epoll()" (rather than "select()") to wait for socket events.
+// Unlike "BasicTaskScheduler", it has no limit on socket numbers (i.e., no "FD_SETSIZE"), and the cost
+// of each event loop iteration is proportional to the number of ready sockets, rather than the highest socket number.
+struct epoll_event; // forward
+struct EpollHandlerDescriptor; // forward; defined in "EpollTaskScheduler.cpp"
+
+class EpollTaskScheduler: public BasicTaskScheduler0 {
+public:
+  static EpollTaskScheduler* createNew(unsigned maxSchedulerGranularity = 10000/*microseconds*/);
+    // "maxSchedulerGranularity" has the same meaning as for "BasicTaskScheduler::createNew()".
+    // Returns NULL if "epoll" is not available (in which case you should use a "BasicTaskScheduler" instead).
+  virtual ~EpollTaskScheduler();
+
+protected:
+  EpollTaskScheduler(unsigned maxSchedulerGranularity, int epollFd);
+      // called only by "createNew()"
+
+  static void schedulerTickTask(void* clientData);
+  void schedulerTickTask();
+
+protected:
+  // Redefined virtual functions:
+  virtual void SingleStep(unsigned maxDelayTime);
+
+  virtual void setBackgroundHandling(int socketNum, int conditionSet, BackgroundHandlerProc* handlerProc, void* clientData);
+  virtual void moveSocketHandling(int oldSocketNum, int newSocketNum);
+
+private:
+  EpollHandlerDescriptor* lookupHandler(int socketNum);
+  EpollHandlerDescriptor& handlerFor(int socketNum); // grows "fHandlers" if necessary
+  void clearHandler(int socketNum);
+  void addUnpollableSocket(int socketNum);
+  void removeUnpollableSocket(int socketNum);
+
+protected:
+  unsigned fMaxSchedulerGranularity;
+  int fEpollFd;
+
+private:
+  // Handler descriptors, indexed by socket number:
+  EpollHandlerDescriptor* fEpollHandlers;
+  unsigned fNumEpollHandlers;
+
+  // Descriptors that can't be used with "epoll()" (e.g., regular files).  Like "select()", we treat these as always ready:
+  int* fUnpollableSockets;
+  unsigned fNumUnpollableSockets, fUnpollableSocketsSize;
+
+  // The events reported by the most recent "epoll_wait()".  We handle one of these in each call to "SingleStep()"
+  // (as "BasicTaskScheduler" does), and call "epoll_wait()" again only after they've all been handled:
+  struct epoll_event* fReadyEvents;
+  unsigned fReadyEventsSize, fNumReadyEvents, fNextReadyEvent;
+};
+#endif
+
 #endif
@@ -66,8 +66,16 @@ private:
 };
 
 class HandlerSet; // forward
+class EventTriggerQueue; // forward
 
-#define MAX_NUM_EVENT_TRIGGERS 32
+#ifndef EVENT_TRIGGER_TABLE_INITIAL_SIZE
+#define EVENT_TRIGGER_TABLE_INITIAL_SIZE 32 // the table of event triggers grows (up to MAX_NUM_EVENT_TRIGGERS) as needed
+#endif
+#define EVENT_TRIGGER_NUM_BITS 16 // the low bits of an "EventTriggerId"; the high bits hold the trigger's 'generation'
+#define MAX_NUM_EVENT_TRIGGERS ((1<<EVENT_TRIGGER_NUM_BITS)-1)
+#ifndef MAX_TRIGGERED_EVENTS_PER_STEP
+#define MAX_TRIGGERED_EVENTS_PER_STEP 64 // so that a flood of triggered events can't starve sockets and delayed tasks
+#endif
 
 // An abstract base class, useful for subclassing
 // (e.g., to redefine the implementation of socket event handling)
@@ -95,6 +103,11 @@ public:
 protected:
   BasicTaskScheduler0();
 
+  void handleTriggeredEvents();
+      // Called by "SingleStep()" to call the handlers for (up to MAX_TRIGGERED_EVENTS_PER_STEP) triggered events
+  Boolean lookupEventTrigger(EventTriggerId eventTriggerId, unsigned& triggerNum) const;
+      // returns True (and sets "triggerNum") iff "eventTriggerId" is a current (i.e., not deleted) trigger
+
 protected:
   // To implement delayed operations:
   DelayQueue fDelayQueue;
@@ -104,11 +117,15 @@ protected:
   int fLastHandledSocketNum;
 
   // To implement event triggers:
-  EventTriggerId volatile fTriggersAwaitingHandling; // implemented as a 32-bit bitmap
-  EventTriggerId fLastUsedTriggerMask; // implemented as a 32-bit bitmap
-  TaskFunc* fTriggeredEventHandlers[MAX_NUM_EVENT_TRIGGERS];
-  void* fTriggeredEventClientDatas[MAX_NUM_EVENT_TRIGGERS];
-  unsigned fLastUsedTriggerNum; // in the range [0,MAX_NUM_EVENT_TRIGGERS)
+  EventTriggerQueue* fTriggeredEvents; // "triggerEvent()" (from any thread) adds to this; we remove from it
+  TaskFunc** fTriggeredEventHandlers; // indexed by trigger number (the low bits of "EventTriggerId", - 1)
+  u_int16_t* fTriggerGenerations; // ditto; each is incremented whenever its trigger is deleted
+  unsigned fTriggeredEventHandlersSize;
+  unsigned fLastUsedTriggerNum; // in the range [0,fTriggeredEventHandlersSize)
+  Boolean fHaveSetUpTriggerWakeup;
+
+private:
+  static void triggerWakeupHandler(void* clientData, int mask);
 };
 
 #endif
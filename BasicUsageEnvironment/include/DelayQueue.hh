@@ -24,6 +24,10 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "NetCommon.h"
 #endif
 
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+
 #ifdef TIME_BASE
 typedef TIME_BASE time_base_seconds;
 #else
@@ -147,17 +151,21 @@ protected: // abstract base class
 
 private:
   friend class DelayQueue;
-  DelayQueueEntry* fNext;
-  DelayQueueEntry* fPrev;
-  DelayInterval fDeltaTimeRemaining;
+  DelayInterval fDelay; // the delay, relative to when the entry was (most recently) added to the queue
+  int64_t fAlarmTime; // in microseconds, on the queue's (monotonic) clock
+  u_int64_t fSequenceNum; // used to handle entries with the same alarm time in FIFO order
+  int fHeapIndex; // our position in the queue's heap, or -1 if we're not in the queue
 
-  intptr_t fToken;
-  static intptr_t tokenCounter;
+  intptr_t fToken; // unique within the process (even if several threads each run their own scheduler)
 };
 
 ///// DelayQueue /////
 
-class DelayQueue: public DelayQueueEntry {
+class HashTable; // forward
+
+// The queue is implemented as a binary min-heap (ordered by alarm time), with a hash table (indexed by token)
+// for looking up entries.  Adding, updating, and removing an entry are all O(log n).
+class DelayQueue {
 public:
   DelayQueue();
   virtual ~DelayQueue();
@@ -172,11 +180,24 @@ public:
   void handleAlarm();
 
 private:
-  DelayQueueEntry* head() { return fNext; }
+  DelayQueueEntry* head() { return fNumEntries == 0 ? NULL : fHeap[0]; }
   DelayQueueEntry* findEntryByToken(intptr_t token);
-  void synchronize(); // bring the 'time remaining' fields up-to-date
+  void synchronize(); // bring "fCurrentTime" up-to-date
+
+  // Heap operations:
+  Boolean isEarlier(DelayQueueEntry const* entry1, DelayQueueEntry const* entry2) const;
+  void placeEntry(DelayQueueEntry* entry, unsigned index);
+  void siftUp(unsigned index);
+  void siftDown(unsigned index);
+
+  DelayQueueEntry** fHeap;
+  unsigned fNumEntries, fHeapSize;
+  HashTable* fEntriesByToken;
+  u_int64_t fNextSequenceNum;
 
+  int64_t fCurrentTime; // in microseconds; advances only when the system clock does
   _EventTime fLastSyncTime;
+  DelayInterval fTimeToNextAlarm;
 };
 
 #endif
@@ -0,0 +1,105 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018 Live Networks, Inc.  All rights reserved.
+// A hash table implementation that stores its entries in a single array ('open addressing'),
+// rather than in separately-allocated linked buckets.  (This is the implementation returned
+// by "HashTable::create()".)
+// C++ header
+
+#ifndef _OPEN_HASH_TABLE_HH
+#define _OPEN_HASH_TABLE_HH
+
+#ifndef _HASH_TABLE_HH
+#include "HashTable.hh"
+#endif
+#ifndef _NET_COMMON_H
+#include <NetCommon.h> // to ensure that "uintptr_t" and "u_int32_t" are defined
+#endif
+
+// Keys (strings, including their trailing '\0', or arrays of words) of up to this many bytes are
+// stored within the table itself; longer keys are copied into separately-allocated memory:
+#define OPEN_HASH_TABLE_INLINE_KEY_SIZE 16
+
+class OpenHashTable: public HashTable {
+private:
+  class Slot; // forward
+
+public:
+  OpenHashTable(int keyType);
+  virtual ~OpenHashTable();
+
+  // Used to iterate through the members of the table:
+  class Iterator; friend class Iterator; // to make Sun's C++ compiler happy
+  class Iterator: public HashTable::Iterator {
+  public:
+    Iterator(OpenHashTable const& table);
+
+  private: // implementation of inherited pure virtual functions
+    void* next(char const*& key); // returns 0 if none
+        // Note: It's OK to "Remove()" the entry that was most recently returned - but not to
+        // "Add()" new entries - while iterating.
+
+  private:
+    OpenHashTable const& fTable;
+    unsigned fNextIndex; // index of the next slot to be enumerated
+    unsigned fNumSlotsLeft;
+  };
+
+private: // implementation of inherited pure virtual functions
+  virtual void* Add(char const* key, void* value);
+  // Returns the old value if different, otherwise 0
+  virtual Boolean Remove(char const* key);
+  virtual void* Lookup(char const* key) const;
+  // Returns 0 if not found
+  virtual unsigned numEntries() const;
+  virtual HashTable::Iterator* createIterator() const;
+
+private:
+  class Slot {
+  public:
+    u_int32_t hash; // of the key
+    u_int32_t info; // 0 iff the slot is empty; otherwise, our distance from our 'home' slot, +1 (and maybe "HEAP_KEY")
+    union {
+      char const* ptr; // for ONE_WORD_HASH_KEYS, and for keys that don't fit in "chars"
+      char chars[OPEN_HASH_TABLE_INLINE_KEY_SIZE];
+      unsigned words[OPEN_HASH_TABLE_INLINE_KEY_SIZE/sizeof (unsigned)]; // for alignment
+    } key;
+    void* value;
+  };
+
+  u_int32_t hashFromKey(char const* key) const;
+  char const* keyOf(Slot const& slot) const;
+  Boolean keyMatches(char const* key1, char const* key2) const;
+
+  Boolean lookupKey(char const* key, u_int32_t hash, unsigned& index) const;
+    // returns True (and sets "index") iff "key" is present
+
+  void assignKey(Slot& slot, char const* key);
+  void deleteKey(Slot& slot);
+  void insertSlot(Slot& newSlot); // inserts an entry that we know isn't already present
+  void insertSlot(Slot& newSlot, unsigned index, unsigned distance);
+      // inserts an entry that we know isn't already present, and that belongs at or after "index"
+      // (which is "distance" slots after its 'home' slot)
+  void rebuild(unsigned newNumSlotsBits);
+
+private:
+  Slot* fSlots; // NULL until the first entry gets added
+  unsigned fNumSlotsBits; // the number of slots is 2^fNumSlotsBits (if "fSlots" != NULL)
+  unsigned fNumEntries;
+  int fKeyType;
+};
+
+#endif
@@ -30,6 +30,10 @@ HashTable::Iterator::Iterator() {
 
 HashTable::Iterator::~Iterator() {}
 
+HashTable::Iterator* HashTable::Iterator::create(HashTable const& hashTable) {
+  return hashTable.createIterator();
+}
+
 void* HashTable::RemoveNext() {
   Iterator* iter = Iterator::create(*this);
   char const* key;
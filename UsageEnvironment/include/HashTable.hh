@@ -43,9 +43,8 @@ public:
   // Used to iterate through the members of the table:
   class Iterator {
   public:
-    // The following must be implemented by a particular
-    // implementation (subclass):
     static Iterator* create(HashTable const& hashTable);
+        // (returns "hashTable.createIterator()")
     
     virtual ~Iterator();
     
@@ -55,6 +54,10 @@ public:
     Iterator(); // abstract base class
   };
   
+  // The following must be implemented by a particular
+  // implementation (subclass), to return its own kind of "Iterator":
+  virtual Iterator* createIterator() const = 0;
+  
   // A shortcut that can be used to successively remove each of
   // the entries in the table (e.g., so that their values can be
   // deleted, if they happen to be pointers to allocated memory).
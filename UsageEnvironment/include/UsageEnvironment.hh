@@ -135,6 +135,10 @@ public:
     #define SOCKET_READABLE    (1<<1)
     #define SOCKET_WRITABLE    (1<<2)
     #define SOCKET_EXCEPTION   (1<<3)
+    // A hint that can also be set in "conditionSet" (but is never set in "mask"): If the same socket (e.g., a listening socket
+    // that's shared by several threads) is also being handled by other schedulers, then only one of them need be woken when
+    // the socket becomes ready.  (Schedulers that can't do this simply ignore it.)
+    #define SOCKET_EXCLUSIVE   (1<<4)
   virtual void setBackgroundHandling(int socketNum, int conditionSet, BackgroundHandlerProc* handlerProc, void* clientData) = 0;
   void disableBackgroundHandling(int socketNum) { setBackgroundHandling(socketNum, 0, NULL, NULL); }
   virtual void moveSocketHandling(int oldSocketNum, int newSocketNum) = 0;
@@ -154,8 +158,8 @@ public:
       // Causes the (previously-registered) handler function for the specified event to be handled (from the event loop).
       // The handler function is called with "clientData" as parameter.
       // Note: This function (unlike other library functions) may be called from an external thread
-      // - to signal an external event.  (However, "triggerEvent()" should not be called with the
-      // same 'event trigger id' from different threads.)
+      // - to signal an external event.  (It may be called concurrently from several threads, even
+      // with the same 'event trigger id'.)
 
   // The following two functions are deprecated, and are provided for backwards-compatibility only:
   void turnOnBackgroundReadHandling(int socketNum, BackgroundHandlerProc* handlerProc, void* clientData) {
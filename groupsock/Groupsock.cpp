@@ -27,23 +27,50 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 #include <stdio.h>
 
+///////// OutputBatch //////////
+
+#define OUTPUT_BATCH_MAX_DATAGRAMS 64
+#define OUTPUT_BATCH_MAX_BYTES (256*1024)
+
+// The datagrams that have been queued (but not yet sent) by an "OutputSocket":
+class OutputBatch {
+public:
+  OutputBatch()
+    : fNumDatagrams(0), fNumBytes(0), fFlushTask(NULL) {
+  }
+
+public:
+  u_int8_t fData[OUTPUT_BATCH_MAX_BYTES];
+  struct sockaddr_in fDestAddresses[OUTPUT_BATCH_MAX_DATAGRAMS];
+  unsigned char* fBuffers[OUTPUT_BATCH_MAX_DATAGRAMS]; // each points into "fData"
+  unsigned fBufferSizes[OUTPUT_BATCH_MAX_DATAGRAMS];
+  unsigned fNumDatagrams, fNumBytes;
+  TaskToken fFlushTask;
+};
+
+
 ///////// OutputSocket //////////
 
 OutputSocket::OutputSocket(UsageEnvironment& env)
   : Socket(env, 0 /* let kernel choose port */),
-    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/) {
+    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/),
+    fOutputBatch(NULL), fNumBatchedDatagramsSent(0), fNumBatchSendCalls(0), fMaxBatchSize(0) {
 }
 
 OutputSocket::OutputSocket(UsageEnvironment& env, Port port)
   : Socket(env, port),
-    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/) {
+    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/),
+    fOutputBatch(NULL), fNumBatchedDatagramsSent(0), fNumBatchSendCalls(0), fMaxBatchSize(0) {
 }
 
 OutputSocket::~OutputSocket() {
+  setOutputBatching(False); // sends any remaining queued datagrams
 }
 
 Boolean OutputSocket::write(netAddressBits address, portNumBits portNum, u_int8_t ttl,
 			    unsigned char* buffer, unsigned bufferSize) {
+  if (fOutputBatch != NULL) return queueForOutput(address, portNum, ttl, buffer, bufferSize);
+
   struct in_addr destAddr; destAddr.s_addr = address;
   if ((unsigned)ttl == fLastSentTTL) {
     // Optimization: Don't do a 'set TTL' system call again
@@ -53,6 +80,109 @@ Boolean OutputSocket::write(netAddressBits address, portNumBits portNum, u_int8_
     fLastSentTTL = (unsigned)ttl;
   }
 
+  return setSourcePortIfNecessary();
+}
+
+Boolean OutputSocket::write(netAddressBits address, portNumBits portNum, u_int8_t ttl,
+			    unsigned char* header, unsigned headerSize, unsigned char* payload, unsigned payloadSize) {
+  if (fOutputBatch != NULL) return queueForOutput(address, portNum, ttl, header, headerSize, payload, payloadSize, False);
+
+  if ((unsigned)ttl != fLastSentTTL) {
+    if (!setSocketMulticastTTL(env(), socketNum(), ttl)) return False;
+    fLastSentTTL = (unsigned)ttl;
+  }
+  struct in_addr destAddr; destAddr.s_addr = address;
+  if (!writeSocket(env(), socketNum(), destAddr, portNum, header, headerSize, payload, payloadSize)) return False;
+
+  return setSourcePortIfNecessary();
+}
+
+void OutputSocket::setOutputBatching(Boolean batchOutput) {
+  if (batchOutput) {
+    if (fOutputBatch == NULL) fOutputBatch = new OutputBatch;
+  } else if (fOutputBatch != NULL) {
+    flushOutputBatch();
+    env().taskScheduler().unscheduleDelayedTask(fOutputBatch->fFlushTask);
+    delete fOutputBatch; fOutputBatch = NULL;
+  }
+}
+
+Boolean OutputSocket::flushOutputBatch() {
+  if (fOutputBatch == NULL || fOutputBatch->fNumDatagrams == 0) return True;
+
+  unsigned numSendCalls;
+  Boolean success = writeSocketBatch(env(), socketNum(), fOutputBatch->fDestAddresses,
+				     fOutputBatch->fBuffers, fOutputBatch->fBufferSizes,
+				     fOutputBatch->fNumDatagrams, numSendCalls);
+  fNumBatchedDatagramsSent += fOutputBatch->fNumDatagrams;
+  fNumBatchSendCalls += numSendCalls;
+  if (fOutputBatch->fNumDatagrams > fMaxBatchSize) fMaxBatchSize = fOutputBatch->fNumDatagrams;
+
+  fOutputBatch->fNumDatagrams = fOutputBatch->fNumBytes = 0;
+  if (!setSourcePortIfNecessary()) success = False;
+
+  return success;
+}
+
+void OutputSocket::flushOutputBatch(void* clientData) {
+  OutputSocket* outputSocket = (OutputSocket*)clientData;
+  outputSocket->fOutputBatch->fFlushTask = NULL;
+  outputSocket->flushOutputBatch();
+}
+
+Boolean OutputSocket::queueForOutput(netAddressBits address, portNumBits portNum, u_int8_t ttl,
+				     unsigned char* header, unsigned headerSize, unsigned char* payload, unsigned payloadSize,
+				     Boolean sameDataAsPrevious) {
+  OutputBatch* batch = fOutputBatch; // alias
+  if (batch == NULL) { // we're not batching output
+    return payloadSize == 0 ? write(address, portNum, ttl, header, headerSize)
+      : write(address, portNum, ttl, header, headerSize, payload, payloadSize);
+  }
+  unsigned const bufferSize = headerSize + payloadSize;
+
+  if ((unsigned)ttl != fLastSentTTL) {
+    // The TTL applies to the whole socket, so we need to send any datagrams that were queued with the old TTL first:
+    flushOutputBatch();
+    if (!setSocketMulticastTTL(env(), socketNum(), ttl)) return False;
+    fLastSentTTL = (unsigned)ttl;
+  }
+
+  if (batch->fNumDatagrams == 0) sameDataAsPrevious = False;
+  if (batch->fNumDatagrams == OUTPUT_BATCH_MAX_DATAGRAMS
+      || (!sameDataAsPrevious && batch->fNumBytes + bufferSize > OUTPUT_BATCH_MAX_BYTES)) {
+    // There's no room for this datagram, so send the ones that we've queued already:
+    flushOutputBatch();
+    sameDataAsPrevious = False;
+  }
+  if (bufferSize > OUTPUT_BATCH_MAX_BYTES) {
+    // This datagram is too big to queue (which shouldn't happen), so just send it now:
+    struct in_addr destAddr; destAddr.s_addr = address;
+    if (!writeSocket(env(), socketNum(), destAddr, portNum, header, headerSize, payload, payloadSize)) return False;
+    return setSourcePortIfNecessary();
+  }
+
+  unsigned i = batch->fNumDatagrams++;
+  if (sameDataAsPrevious) {
+    batch->fBuffers[i] = batch->fBuffers[i-1];
+  } else {
+    batch->fBuffers[i] = &batch->fData[batch->fNumBytes];
+    memmove(batch->fBuffers[i], header, headerSize);
+    if (payloadSize > 0) memmove(&batch->fBuffers[i][headerSize], payload, payloadSize);
+    batch->fNumBytes += bufferSize;
+  }
+  batch->fBufferSizes[i] = bufferSize;
+  MAKE_SOCKADDR_IN(destAddress, address, portNum);
+  batch->fDestAddresses[i] = destAddress;
+
+  if (batch->fFlushTask == NULL) {
+    // Arrange for the queue to be sent (from the event loop) once we've returned to it:
+    batch->fFlushTask = env().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)flushOutputBatch, this);
+  }
+
+  return True;
+}
+
+Boolean OutputSocket::setSourcePortIfNecessary() {
   if (sourcePortNum() == 0) {
     // Now that we've sent a packet, we can find out what the
     // kernel chose as our ephemeral source port number:
@@ -261,12 +391,24 @@ void Groupsock::multicastSendOnly() {
 
 Boolean Groupsock::output(UsageEnvironment& env, unsigned char* buffer, unsigned bufferSize,
 			  DirectedNetInterface* interfaceNotToFwdBackTo) {
+  return output(env, buffer, bufferSize, NULL, 0, interfaceNotToFwdBackTo);
+}
+
+Boolean Groupsock::output(UsageEnvironment& env, unsigned char* header, unsigned headerSize,
+			  unsigned char* payload, unsigned payloadSize,
+			  DirectedNetInterface* interfaceNotToFwdBackTo) {
+  unsigned const bufferSize = headerSize + payloadSize;
   do {
     // First, do the datagram send, to each destination:
     Boolean writeSuccess = True;
     for (destRecord* dests = fDests; dests != NULL; dests = dests->fNext) {
-      if (!write(dests->fGroupEId.groupAddress().s_addr, dests->fGroupEId.portNum(), dests->fGroupEId.ttl(),
-		 buffer, bufferSize)) {
+      netAddressBits const address = dests->fGroupEId.groupAddress().s_addr;
+      if (outputBatching()
+	  ? !queueForOutput(address, dests->fGroupEId.portNum(), dests->fGroupEId.ttl(),
+			    header, headerSize, payload, payloadSize, dests != fDests/*same data as the previous destination*/)
+	  : payloadSize == 0
+	  ? !write(address, dests->fGroupEId.portNum(), dests->fGroupEId.ttl(), header, headerSize)
+	  : !write(address, dests->fGroupEId.portNum(), dests->fGroupEId.ttl(), header, headerSize, payload, payloadSize)) {
 	writeSuccess = False;
 	break;
       }
@@ -278,10 +420,18 @@ Boolean Groupsock::output(UsageEnvironment& env, unsigned char* buffer, unsigned
     // Then, forward to our members:
     int numMembers = 0;
     if (!members().IsEmpty()) {
+      unsigned char* buffer = header;
+      if (payloadSize > 0) {
+	// Relaying needs the datagram in a single buffer:
+	buffer = new unsigned char[bufferSize];
+	memmove(buffer, header, headerSize);
+	memmove(&buffer[headerSize], payload, payloadSize);
+      }
       numMembers =
 	outputToAllMembersExcept(interfaceNotToFwdBackTo,
 				 ttl(), buffer, bufferSize,
 				 ourIPAddress(env));
+      if (buffer != header) delete[] buffer;
       if (numMembers < 0) break;
     }
 
@@ -323,10 +473,49 @@ Boolean Groupsock::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
     return False;
   }
 
+  noteIncomingDatagram(buffer, numBytes, bytesRead, fromAddressAndPort);
+  return True;
+}
+
+#define MAX_DATAGRAMS_PER_READ_BATCH 64
+
+Boolean Groupsock::handleReadBatch(unsigned char* const* buffers, unsigned bufferMaxSize, unsigned numBuffers,
+				   unsigned* bytesRead, struct sockaddr_in* fromAddressesAndPorts,
+				   unsigned& numDatagramsRead) {
+  numDatagramsRead = 0;
+
+  unsigned maxBytesToRead[MAX_DATAGRAMS_PER_READ_BATCH];
+  if (numBuffers > MAX_DATAGRAMS_PER_READ_BATCH) numBuffers = MAX_DATAGRAMS_PER_READ_BATCH;
+  for (unsigned i = 0; i < numBuffers; ++i) maxBytesToRead[i] = bufferMaxSize - TunnelEncapsulationTrailerMaxSize;
+
+  int numRead = readSocketBatch(env(), socketNum(), buffers, maxBytesToRead, numBuffers,
+				bytesRead, fromAddressesAndPorts);
+  if (numRead < 0) {
+    if (DebugLevel >= 0) { // this is a fatal error
+      UsageEnvironment::MsgString msg = strDup(env().getResultMsg());
+      env().setResultMsg("Groupsock read failed: ", msg);
+      delete[] (char*)msg;
+    }
+    return False;
+  }
+
+  numDatagramsRead = (unsigned)numRead;
+  for (unsigned i = 0; i < numDatagramsRead; ++i) {
+    unsigned numBytes = bytesRead[i];
+    noteIncomingDatagram(buffers[i], numBytes, bytesRead[i], fromAddressesAndPorts[i]);
+  }
+
+  return True;
+}
+
+void Groupsock::noteIncomingDatagram(unsigned char* buffer, unsigned numBytes, unsigned& bytesRead,
+				     struct sockaddr_in& fromAddressAndPort) {
+  bytesRead = 0;
+
   // If we're a SSM group, make sure the source address matches:
   if (isSSM()
       && fromAddressAndPort.sin_addr.s_addr != sourceFilterAddress().s_addr) {
-    return True;
+    return;
   }
 
   // We'll handle this data.
@@ -355,7 +544,6 @@ Boolean Groupsock::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
     env() << "\n";
   }
 
-  return True;
 }
 
 Boolean Groupsock::wasLoopedBackFromUs(UsageEnvironment& env,
@@ -371,6 +371,12 @@ Boolean writeSocket(UsageEnvironment& env,
 		    u_int8_t ttlArg,
 		    unsigned char* buffer, unsigned bufferSize) {
   // Before sending, set the socket's TTL:
+  if (!setSocketMulticastTTL(env, socket, ttlArg)) return False;
+
+  return writeSocket(env, socket, address, portNum, buffer, bufferSize);
+}
+
+Boolean setSocketMulticastTTL(UsageEnvironment& env, int socket, u_int8_t ttlArg) {
 #if defined(__WIN32__) || defined(_WIN32)
 #define TTL_TYPE int
 #else
@@ -383,7 +389,7 @@ Boolean writeSocket(UsageEnvironment& env,
     return False;
   }
 
-  return writeSocket(env, socket, address, portNum, buffer, bufferSize);
+  return True;
 }
 
 Boolean writeSocket(UsageEnvironment& env,
@@ -406,6 +412,143 @@ Boolean writeSocket(UsageEnvironment& env,
   return False;
 }
 
+Boolean writeSocket(UsageEnvironment& env,
+		    int socket, struct in_addr address, portNumBits portNum,
+		    unsigned char* header, unsigned headerSize,
+		    unsigned char* payload, unsigned payloadSize) {
+  if (payloadSize == 0) return writeSocket(env, socket, address, portNum, header, headerSize);
+
+  unsigned const datagramSize = headerSize + payloadSize;
+  do {
+    MAKE_SOCKADDR_IN(dest, address.s_addr, portNum);
+#if defined(__WIN32__) || defined(_WIN32)
+    WSABUF bufs[2];
+    bufs[0].buf = (char*)header; bufs[0].len = headerSize;
+    bufs[1].buf = (char*)payload; bufs[1].len = payloadSize;
+    DWORD numBytesSent = 0;
+    int bytesSent = WSASendTo(socket, bufs, 2, &numBytesSent, 0, (struct sockaddr*)&dest, sizeof dest, NULL, NULL) == 0
+      ? (int)numBytesSent : -1;
+#else
+    struct iovec iov[2];
+    iov[0].iov_base = header; iov[0].iov_len = headerSize;
+    iov[1].iov_base = payload; iov[1].iov_len = payloadSize;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_name = &dest;
+    msg.msg_namelen = sizeof dest;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    int bytesSent = sendmsg(socket, &msg, 0);
+#endif
+    if (bytesSent != (int)datagramSize) {
+      char tmpBuf[100];
+      sprintf(tmpBuf, "writeSocket(%d), sendmsg() error: wrote %d bytes instead of %u: ", socket, bytesSent, datagramSize);
+      socketErr(env, tmpBuf);
+      break;
+    }
+
+    return True;
+  } while (0);
+
+  return False;
+}
+
+#if defined(__linux__)
+// The maximum number of datagrams that we read or write with a single "recvmmsg()" or "sendmmsg()" call:
+#define MAX_DATAGRAMS_PER_MMSG_CALL 64
+#endif
+
+int readSocketBatch(UsageEnvironment& env, int socket,
+		    unsigned char* const* buffers, unsigned const* bufferSizes, unsigned numBuffers,
+		    unsigned* bytesRead, struct sockaddr_in* fromAddresses) {
+  if (numBuffers == 0) return 0;
+#if defined(__linux__)
+  struct mmsghdr msgs[MAX_DATAGRAMS_PER_MMSG_CALL];
+  struct iovec iovs[MAX_DATAGRAMS_PER_MMSG_CALL];
+  if (numBuffers > MAX_DATAGRAMS_PER_MMSG_CALL) numBuffers = MAX_DATAGRAMS_PER_MMSG_CALL;
+
+  memset(msgs, 0, numBuffers*sizeof msgs[0]);
+  for (unsigned i = 0; i < numBuffers; ++i) {
+    iovs[i].iov_base = buffers[i];
+    iovs[i].iov_len = bufferSizes[i];
+    msgs[i].msg_hdr.msg_name = &fromAddresses[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof fromAddresses[i];
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int numDatagramsRead = recvmmsg(socket, msgs, numBuffers, MSG_DONTWAIT, NULL);
+  if (numDatagramsRead < 0) {
+    // As in "readSocket()", treat some errors as if they were a read of zero datagrams:
+    int err = env.getErrno();
+    if (err == 111 /*ECONNREFUSED (Linux)*/ || err == EAGAIN || err == 113 /*EHOSTUNREACH (Linux)*/) return 0;
+
+    socketErr(env, "recvmmsg() error: ");
+    return -1;
+  }
+
+  for (int i = 0; i < numDatagramsRead; ++i) bytesRead[i] = msgs[i].msg_len;
+  return numDatagramsRead;
+#else
+  // Read just one datagram:
+  int numBytes = readSocket(env, socket, buffers[0], bufferSizes[0], fromAddresses[0]);
+  if (numBytes <= 0) return numBytes;
+
+  bytesRead[0] = numBytes;
+  return 1;
+#endif
+}
+
+Boolean writeSocketBatch(UsageEnvironment& env, int socket,
+			 struct sockaddr_in const* destAddresses, unsigned char* const* buffers, unsigned const* bufferSizes,
+			 unsigned numDatagrams, unsigned& numSendCalls) {
+  Boolean success = True;
+  numSendCalls = 0;
+
+  unsigned i = 0;
+  while (i < numDatagrams) {
+#if defined(__linux__)
+    struct mmsghdr msgs[MAX_DATAGRAMS_PER_MMSG_CALL];
+    struct iovec iovs[MAX_DATAGRAMS_PER_MMSG_CALL];
+    unsigned numToSend = numDatagrams - i;
+    if (numToSend > MAX_DATAGRAMS_PER_MMSG_CALL) numToSend = MAX_DATAGRAMS_PER_MMSG_CALL;
+
+    memset(msgs, 0, numToSend*sizeof msgs[0]);
+    for (unsigned j = 0; j < numToSend; ++j) {
+      iovs[j].iov_base = buffers[i+j];
+      iovs[j].iov_len = bufferSizes[i+j];
+      msgs[j].msg_hdr.msg_name = (void*)&destAddresses[i+j];
+      msgs[j].msg_hdr.msg_namelen = sizeof destAddresses[i+j];
+      msgs[j].msg_hdr.msg_iov = &iovs[j];
+      msgs[j].msg_hdr.msg_iovlen = 1;
+    }
+
+    int numSent = sendmmsg(socket, msgs, numToSend, 0);
+    ++numSendCalls;
+    if (numSent > 0) {
+      i += numSent;
+      continue;
+    }
+
+    // The first datagram could not be sent.  Report this, then skip past it:
+    char tmpBuf[100];
+    sprintf(tmpBuf, "writeSocketBatch(%d), sendmmsg() error: ", socket);
+    socketErr(env, tmpBuf);
+#else
+    ++numSendCalls;
+    if (writeSocket(env, socket, destAddresses[i].sin_addr, destAddresses[i].sin_port,
+		    buffers[i], bufferSizes[i])) {
+      ++i;
+      continue;
+    }
+#endif
+    success = False;
+    ++i;
+  }
+
+  return success;
+}
+
 void ignoreSigPipeOnSocket(int socketNum) {
   #ifdef USE_SIGNALS
   #ifdef SO_NOSIGPIPE
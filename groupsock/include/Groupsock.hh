@@ -36,6 +36,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // An "OutputSocket" is (by default) used only to send packets.
 // No packets are received on it (unless a subclass arranges this)
 
+class OutputBatch; // forward; defined in "Groupsock.cpp"
+
 class OutputSocket: public Socket {
 public:
   OutputSocket(UsageEnvironment& env);
@@ -47,20 +49,54 @@ public:
 		unsigned char* buffer, unsigned bufferSize) {
     return write(addressAndPort.sin_addr.s_addr, addressAndPort.sin_port, ttl, buffer, bufferSize);
   }
+  Boolean write(netAddressBits address, portNumBits portNum/*in network order*/, u_int8_t ttl,
+		unsigned char* header, unsigned headerSize, unsigned char* payload, unsigned payloadSize);
+      // Sends a single datagram that's made up of two separate pieces of data, without first copying them together
+
+  // Batched output (off by default):
+  // If enabled, then "write()" copies each datagram into a queue, rather than sending it immediately.  The queue is
+  // sent - using as few system calls as possible (i.e., "sendmmsg()", where available) - once per event loop iteration,
+  // or when it fills up.  (Note that a "write()" that is queued always succeeds; any subsequent send error is reported
+  // only via "env()".)
+  void setOutputBatching(Boolean batchOutput); // disabling batching also flushes the queue
+  Boolean outputBatching() const { return fOutputBatch != NULL; }
+  Boolean flushOutputBatch(); // sends any queued datagrams now
+
+  // Statistics about batched output:
+  unsigned numBatchedDatagramsSent() const { return fNumBatchedDatagramsSent; }
+  unsigned numBatchSendCalls() const { return fNumBatchSendCalls; } // the number of system calls used to send these
+  unsigned numSendCallsSaved() const { return fNumBatchedDatagramsSent - fNumBatchSendCalls; }
+  unsigned maxBatchSize() const { return fMaxBatchSize; } // the largest number of datagrams sent in one flush
 
 protected:
   OutputSocket(UsageEnvironment& env, Port port);
 
   portNumBits sourcePortNum() const {return fSourcePort.num();}
 
+  Boolean queueForOutput(netAddressBits address, portNumBits portNum, u_int8_t ttl,
+			 unsigned char* buffer, unsigned bufferSize, Boolean sameDataAsPrevious = False) {
+    return queueForOutput(address, portNum, ttl, buffer, bufferSize, NULL, 0, sameDataAsPrevious);
+  }
+  Boolean queueForOutput(netAddressBits address, portNumBits portNum, u_int8_t ttl,
+			 unsigned char* header, unsigned headerSize, unsigned char* payload, unsigned payloadSize,
+			 Boolean sameDataAsPrevious);
+      // Used to implement batched output.  If "sameDataAsPrevious" is True, then the data ("buffer","bufferSize") is known
+      // to be the same as that of the previously queued datagram, so it doesn't need to be copied again.
+
 private: // redefined virtual function
   virtual Boolean handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 			     unsigned& bytesRead,
 			     struct sockaddr_in& fromAddressAndPort);
 
+private:
+  static void flushOutputBatch(void* clientData);
+  Boolean setSourcePortIfNecessary();
+
 private:
   Port fSourcePort;
   unsigned fLastSentTTL;
+  OutputBatch* fOutputBatch; // non-NULL iff we're batching output
+  unsigned fNumBatchedDatagramsSent, fNumBatchSendCalls, fMaxBatchSize;
 };
 
 class destRecord {
@@ -130,6 +166,11 @@ public:
 
   virtual Boolean output(UsageEnvironment& env, unsigned char* buffer, unsigned bufferSize,
 			 DirectedNetInterface* interfaceNotToFwdBackTo = NULL);
+  Boolean output(UsageEnvironment& env, unsigned char* header, unsigned headerSize,
+		 unsigned char* payload, unsigned payloadSize,
+		 DirectedNetInterface* interfaceNotToFwdBackTo = NULL);
+      // Sends a datagram that's made up of two separate pieces of data (e.g., a RTP header, followed by
+      // payload data that's held elsewhere), without first copying them together.
 
   DirectedNetInterfaceSet& members() { return fMembers; }
 
@@ -152,10 +193,21 @@ public: // redefined virtual functions
 			     unsigned& bytesRead,
 			     struct sockaddr_in& fromAddressAndPort);
 
+public:
+  Boolean handleReadBatch(unsigned char* const* buffers, unsigned bufferMaxSize, unsigned numBuffers,
+			  unsigned* bytesRead, struct sockaddr_in* fromAddressesAndPorts,
+			  unsigned& numDatagramsRead);
+      // Like "handleRead()", except that up to "numBuffers" datagrams are read (using a single system call, if possible).
+      // Each buffer must be at least "bufferMaxSize" bytes long.  As with "handleRead()", a datagram that is to be
+      // ignored is returned with "bytesRead[i]" == 0.
+
 protected:
   destRecord* lookupDestRecordFromDestination(struct sockaddr_in const& destAddrAndPort) const;
 
 private:
+  void noteIncomingDatagram(unsigned char* buffer, unsigned numBytes, unsigned& bytesRead,
+			    struct sockaddr_in& fromAddressAndPort);
+    // used to implement "handleRead()" and "handleReadBatch()"
   void removeDestinationFrom(destRecord*& dests, unsigned sessionId);
     // used to implement (the public) "removeDestination()", and "changeDestinationParameters()"
   int outputToAllMembersExcept(DirectedNetInterface* exceptInterface,
@@ -33,6 +33,12 @@ int readSocket(UsageEnvironment& env,
 	       int socket, unsigned char* buffer, unsigned bufferSize,
 	       struct sockaddr_in& fromAddress);
 
+int readSocketBatch(UsageEnvironment& env, int socket,
+		    unsigned char* const* buffers, unsigned const* bufferSizes, unsigned numBuffers,
+		    unsigned* bytesRead, struct sockaddr_in* fromAddresses);
+    // Reads up to "numBuffers" datagrams (one into each buffer) using a single system call (i.e., "recvmmsg()",
+    // where available; otherwise just one datagram is read).  Returns the number of datagrams read, or -1 on error.
+
 Boolean writeSocket(UsageEnvironment& env,
 		    int socket, struct in_addr address, portNumBits portNum/*network byte order*/,
 		    u_int8_t ttlArg,
@@ -43,6 +49,22 @@ Boolean writeSocket(UsageEnvironment& env,
 		    unsigned char* buffer, unsigned bufferSize);
     // An optimized version of "writeSocket" that omits the "setsockopt()" call to set the TTL.
 
+Boolean writeSocket(UsageEnvironment& env,
+		    int socket, struct in_addr address, portNumBits portNum/*network byte order*/,
+		    unsigned char* header, unsigned headerSize,
+		    unsigned char* payload, unsigned payloadSize);
+    // A version of "writeSocket" that sends a single datagram made up of two separate pieces of data -
+    // without first copying them together (i.e., using "sendmsg()", where available).
+
+Boolean writeSocketBatch(UsageEnvironment& env, int socket,
+			 struct sockaddr_in const* destAddresses, unsigned char* const* buffers, unsigned const* bufferSizes,
+			 unsigned numDatagrams, unsigned& numSendCalls);
+    // Sends several datagrams (each to its own destination) using as few system calls as possible
+    // (i.e., "sendmmsg()", where available).  "numSendCalls" is set to the number of system calls that were made.
+    // Returns False iff any of the datagrams could not be sent.
+
+Boolean setSocketMulticastTTL(UsageEnvironment& env, int socket, u_int8_t ttlArg);
+
 void ignoreSigPipeOnSocket(int socketNum);
 
 unsigned getSendBufferSize(UsageEnvironment& env, int socket);
@@ -106,6 +106,9 @@ ADTSAudioFileSource
   audioSpecificConfig[0] = (audioObjectType<<3) | (samplingFrequencyIndex>>1);
   audioSpecificConfig[1] = (samplingFrequencyIndex<<7) | (channelConfiguration<<3);
   sprintf(fConfigStr, "%02X%02x", audioSpecificConfig[0], audioSpecificConfig[1]);
+
+  // Share the file's data with any other sources that are streaming it (if our environment has a file block cache):
+  useFileBlockCache();
 }
 
 ADTSAudioFileSource::~ADTSAudioFileSource() {
@@ -117,8 +120,8 @@ ADTSAudioFileSource::~ADTSAudioFileSource() {
 void ADTSAudioFileSource::doGetNextFrame() {
   // Begin by reading the 7-byte fixed_variable headers:
   unsigned char headers[7];
-  if (fread(headers, 1, sizeof headers, fFid) < sizeof headers
-      || feof(fFid) || ferror(fFid)) {
+  if (readFromFile(headers, sizeof headers) < sizeof headers
+      || reachedEndOfFile()) {
     // The input source has ended:
     handleClosure();
     return;
@@ -138,7 +141,7 @@ void ADTSAudioFileSource::doGetNextFrame() {
 
   // If there's a 'crc_check' field, skip it:
   if (!protection_absent) {
-    SeekFile64(fFid, 2, SEEK_CUR);
+    seekWithinFile(2, SEEK_CUR);
     numBytesToRead = numBytesToRead > 2 ? numBytesToRead - 2 : 0;
   }
 
@@ -147,7 +150,7 @@ void ADTSAudioFileSource::doGetNextFrame() {
     fNumTruncatedBytes = numBytesToRead - fMaxSize;
     numBytesToRead = fMaxSize;
   }
-  int numBytesRead = fread(fTo, 1, numBytesToRead, fFid);
+  int numBytesRead = readFromFile(fTo, numBytesToRead);
   if (numBytesRead < 0) numBytesRead = 0;
   fFrameSize = numBytesRead;
   fNumTruncatedBytes += numBytesToRead - numBytesRead;
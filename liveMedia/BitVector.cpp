@@ -19,6 +19,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "BitVector.hh"
+#include <NetCommon.h> // for u_int64_t
+#include <string.h>
 
 BitVector::BitVector(unsigned char* baseBytePtr,
 		     unsigned baseBitOffset,
@@ -40,29 +42,50 @@ static unsigned char const singleBitMask[8]
 
 #define MAX_LENGTH 32
 
-void BitVector::putBits(unsigned from, unsigned numBits) {
-  if (numBits == 0) return; 
+// Returns the 8 bytes beginning at "ptr", as a big-endian 64-bit word - except that any bytes at
+// or beyond "limit" are not read, and are returned as 0.  (When all 8 bytes are available,
+// compilers turn this into a single (unaligned) load and byte swap.)
+static inline u_int64_t getBigEndianWord(unsigned char const* ptr, unsigned char const* limit) {
+  if (limit - ptr >= 8) {
+    return ((u_int64_t)ptr[0]<<56) | ((u_int64_t)ptr[1]<<48) | ((u_int64_t)ptr[2]<<40) | ((u_int64_t)ptr[3]<<32)
+      | ((u_int64_t)ptr[4]<<24) | ((u_int64_t)ptr[5]<<16) | ((u_int64_t)ptr[6]<<8) | (u_int64_t)ptr[7];
+  }
+
+  u_int64_t word = 0;
+  for (unsigned i = 0; i < 8; ++i) {
+    word = (word<<8) | (ptr + i < limit ? ptr[i] : 0);
+  }
+  return word;
+}
 
-  unsigned char tmpBuf[4];
-  unsigned overflowingBits = 0;
+void BitVector::putBits(unsigned from, unsigned numBits) {
+  if (numBits == 0) return;
 
   if (numBits > MAX_LENGTH) {
     numBits = MAX_LENGTH;
   }
 
-  if (numBits > fTotNumBits - fCurBitIndex) {
-    overflowingBits = numBits - (fTotNumBits - fCurBitIndex);
+  // If there's not enough room, then we write only the first (i.e., high-order) bits of "from":
+  unsigned numBitsToWrite = numBits;
+  if (numBitsToWrite > fTotNumBits - fCurBitIndex) {
+    numBitsToWrite = fTotNumBits - fCurBitIndex;
+    if (numBitsToWrite == 0) return;
   }
 
-  tmpBuf[0] = (unsigned char)(from>>24);
-  tmpBuf[1] = (unsigned char)(from>>16);
-  tmpBuf[2] = (unsigned char)(from>>8);
-  tmpBuf[3] = (unsigned char)from;
-
-  shiftBits(fBaseBytePtr, fBaseBitOffset + fCurBitIndex, /* to */
-	    tmpBuf, MAX_LENGTH - numBits, /* from */
-	    numBits - overflowingBits /* num bits */);
-  fCurBitIndex += numBits - overflowingBits;
+  // Line up the bits (and a mask for them) with the bytes that they'll go in:
+  unsigned totBitOffset = fBaseBitOffset + fCurBitIndex;
+  unsigned toBitRem = totBitOffset%8;
+  u_int64_t mask = (~(u_int64_t)0 << (64 - numBitsToWrite)) >> toBitRem;
+  u_int64_t bits = (((u_int64_t)from << (64 - numBits)) >> toBitRem) & mask;
+
+  // Then replace these bits within each of these (at most 5) bytes:
+  unsigned char* toPtr = &fBaseBytePtr[totBitOffset/8];
+  unsigned numBytes = (toBitRem + numBitsToWrite + 7)/8;
+  for (unsigned i = 0; i < numBytes; ++i) {
+    unsigned shift = 56 - 8*i;
+    toPtr[i] = (unsigned char)((toPtr[i] &~ (mask>>shift)) | (bits>>shift));
+  }
+  fCurBitIndex += numBitsToWrite;
 }
 
 void BitVector::put1Bit(unsigned bit) {
@@ -83,40 +106,28 @@ void BitVector::put1Bit(unsigned bit) {
 unsigned BitVector::getBits(unsigned numBits) {
   if (numBits == 0) return 0;
 
-  unsigned char tmpBuf[4];
-  unsigned overflowingBits = 0;
-
   if (numBits > MAX_LENGTH) {
     numBits = MAX_LENGTH;
   }
 
-  if (numBits > fTotNumBits - fCurBitIndex) {
-    overflowingBits = numBits - (fTotNumBits - fCurBitIndex);
-  }
-
-  shiftBits(tmpBuf, 0, /* to */
-	    fBaseBytePtr, fBaseBitOffset + fCurBitIndex, /* from */
-	    numBits - overflowingBits /* num bits */);
-  fCurBitIndex += numBits - overflowingBits;
+  unsigned result = testBits(numBits); // any bits beyond the end are 0
+  skipBits(numBits);
 
-  unsigned result
-    = (tmpBuf[0]<<24) | (tmpBuf[1]<<16) | (tmpBuf[2]<<8) | tmpBuf[3];
-  result >>= (MAX_LENGTH - numBits); // move into low-order part of word
-  result &= (0xFFFFFFFF << overflowingBits); // so any overflow bits are 0
   return result;
 }
 
-unsigned BitVector::get1Bit() {
-  // The following is equivalent to "getBits(1)", except faster:
+unsigned BitVector::testBits(unsigned numBits) {
+  unsigned numValidBits = fTotNumBits - fCurBitIndex;
+  if (numValidBits > numBits) numValidBits = numBits;
+  if (numValidBits == 0) return 0;
 
-  if (fCurBitIndex >= fTotNumBits) { /* overflow */
-    return 0;
-  } else {
-    unsigned totBitOffset = fBaseBitOffset + fCurBitIndex++;
-    unsigned char curFromByte = fBaseBytePtr[totBitOffset/8];
-    unsigned result = (curFromByte >> (7-(totBitOffset%8))) & 0x01;
-    return result;
-  }
+  // Read the (at most 5) bytes that contain these bits, and move the bits into place:
+  unsigned totBitOffset = fBaseBitOffset + fCurBitIndex;
+  u_int64_t word
+    = getBigEndianWord(&fBaseBytePtr[totBitOffset/8], &fBaseBytePtr[(fBaseBitOffset + fTotNumBits + 7)/8]);
+  word <<= totBitOffset%8;
+
+  return (unsigned)(word >> (64 - numValidBits)) << (numBits - numValidBits);
 }
 
 void BitVector::skipBits(unsigned numBits) {
@@ -127,13 +138,45 @@ void BitVector::skipBits(unsigned numBits) {
   }
 }
 
+static inline unsigned numLeadingZeroBits(unsigned word) { // assumes that "word" != 0
+#if defined(__GNUC__)
+  return __builtin_clz(word);
+#else
+  unsigned result = 0;
+  while ((word&0x80000000) == 0) { word <<= 1; ++result; }
+  return result;
+#endif
+}
+
 unsigned BitVector::get_expGolomb() {
   unsigned numLeadingZeroBits = 0;
   unsigned codeStart = 1;
 
-  while (get1Bit() == 0 && fCurBitIndex < fTotNumBits) {
-    ++numLeadingZeroBits;
-    codeStart *= 2;
+  // Look at the next 32 bits (or however many remain) at once, to count the leading zero bits:
+  unsigned numBitsToTest = numBitsRemaining() < 32 ? numBitsRemaining() : 32;
+  unsigned nextBits = numBitsToTest == 0 ? 0 : testBits(numBitsToTest) << (32 - numBitsToTest);
+  if (nextBits != 0) {
+    // The usual case: We also skip the '1' bit that follows the leading zeros:
+    numLeadingZeroBits = ::numLeadingZeroBits(nextBits);
+    unsigned codeSize = 2*numLeadingZeroBits + 1;
+    if (codeSize <= numBitsToTest) {
+      // We already have the whole code:
+      fCurBitIndex += codeSize;
+      return (nextBits >> (32 - codeSize)) - 1;
+    }
+    codeStart <<= numLeadingZeroBits;
+    fCurBitIndex += numLeadingZeroBits + 1;
+  } else if (numBitsToTest < 32) {
+    // All of the remaining bits are 0 (and, as before, the last of these doesn't get counted):
+    if (numBitsToTest > 0) numLeadingZeroBits = numBitsToTest - 1;
+    codeStart <<= numLeadingZeroBits;
+    fCurBitIndex = fTotNumBits;
+  } else {
+    // 32 or more leading zero bits (which can happen only with bad data):
+    while (get1Bit() == 0 && fCurBitIndex < fTotNumBits) {
+      ++numLeadingZeroBits;
+      codeStart *= 2;
+    }
   }
 
   return codeStart - 1 + getBits(numLeadingZeroBits);
@@ -156,28 +199,28 @@ void shiftBits(unsigned char* toBasePtr, unsigned toBitOffset,
 
   /* Note that from and to may overlap, if from>to */
   unsigned char const* fromBytePtr = fromBasePtr + fromBitOffset/8;
-  unsigned fromBitRem = fromBitOffset%8;
   unsigned char* toBytePtr = toBasePtr + toBitOffset/8;
-  unsigned toBitRem = toBitOffset%8;
 
-  while (numBits-- > 0) {
-    unsigned char fromBitMask = singleBitMask[fromBitRem];
-    unsigned char fromBit = (*fromBytePtr)&fromBitMask;
-    unsigned char toBitMask = singleBitMask[toBitRem];
+  if (fromBitOffset%8 == 0 && toBitOffset%8 == 0) {
+    // Both are byte-aligned, so we can copy whole bytes at once, followed by any remaining bits:
+    unsigned numBytes = numBits/8;
+    memmove(toBytePtr, fromBytePtr, numBytes);
 
-    if (fromBit != 0) {
-      *toBytePtr |= toBitMask;
-    } else {
-      *toBytePtr &=~ toBitMask;
+    unsigned numRemainingBits = numBits%8;
+    if (numRemainingBits > 0) {
+      unsigned char mask = (unsigned char)(0xFF << (8 - numRemainingBits));
+      toBytePtr[numBytes] = (toBytePtr[numBytes] &~ mask) | (fromBytePtr[numBytes] & mask);
     }
+    return;
+  }
 
-    if (++fromBitRem == 8) {
-      ++fromBytePtr;
-      fromBitRem = 0;
-    }
-    if (++toBitRem == 8) {
-      ++toBytePtr;
-      toBitRem = 0;
-    }
+  // Otherwise, copy up to 32 bits at a time.  (Because we read each group of bits before we
+  // write it, and "to" <= "from", this is OK even if they overlap.)
+  BitVector fromBV((unsigned char*)fromBasePtr, fromBitOffset, numBits);
+  BitVector toBV(toBasePtr, toBitOffset, numBits);
+  while (numBits > 0) {
+    unsigned numBitsNow = numBits < MAX_LENGTH ? numBits : MAX_LENGTH;
+    toBV.putBits(fromBV.getBits(numBitsNow), numBitsNow);
+    numBits -= numBitsNow;
   }
 }
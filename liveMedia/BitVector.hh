@@ -39,9 +39,17 @@ public:
   void put1Bit(unsigned bit);
 
   unsigned getBits(unsigned numBits); // "numBits" <= 32
-  unsigned get1Bit();
+  unsigned get1Bit() { // equivalent to "getBits(1)", except faster
+    if (fCurBitIndex >= fTotNumBits) return 0; // overflow
+
+    unsigned totBitOffset = fBaseBitOffset + fCurBitIndex++;
+    return (fBaseBytePtr[totBitOffset/8] >> (7-(totBitOffset%8))) & 0x01;
+  }
   Boolean get1BitBoolean() { return get1Bit() != 0; }
 
+  unsigned testBits(unsigned numBits); // "numBits" <= 32
+      // As "getBits()", but doesn't advance.  (Any bits beyond the end of the vector are returned as 0.)
+
   void skipBits(unsigned numBits);
 
   unsigned curBitIndex() const { return fCurBitIndex; }
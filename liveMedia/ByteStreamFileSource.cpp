@@ -19,6 +19,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "ByteStreamFileSource.hh"
+#include "FileBlockCache.hh"
 #include "InputFile.hh"
 #include "GroupsockHelper.hh"
 
@@ -51,21 +52,28 @@ ByteStreamFileSource::createNew(UsageEnvironment& env, FILE* fid,
 }
 
 void ByteStreamFileSource::seekToByteAbsolute(u_int64_t byteNumber, u_int64_t numBytesToStream) {
-  SeekFile64(fFid, (int64_t)byteNumber, SEEK_SET);
+  seekWithinFile((int64_t)byteNumber, SEEK_SET);
 
   fNumBytesToStream = numBytesToStream;
   fLimitNumBytesToStream = fNumBytesToStream > 0;
 }
 
 void ByteStreamFileSource::seekToByteRelative(int64_t offset, u_int64_t numBytesToStream) {
-  SeekFile64(fFid, offset, SEEK_CUR);
+  seekWithinFile(offset, SEEK_CUR);
 
   fNumBytesToStream = numBytesToStream;
   fLimitNumBytesToStream = fNumBytesToStream > 0;
 }
 
 void ByteStreamFileSource::seekToEnd() {
-  SeekFile64(fFid, 0, SEEK_END);
+  seekWithinFile(0, SEEK_END);
+}
+
+void ByteStreamFileSource::followGrowingFile(unsigned idleTimeoutSeconds) {
+  fFollowGrowingFile = True;
+  stopUsingFileBlockCache(); // because we track the file's growth using "fFid"'s position
+  fIdleTimeoutSeconds = idleTimeoutSeconds;
+  gettimeofday(&fLastGrowthTime, NULL);
 }
 
 ByteStreamFileSource::ByteStreamFileSource(UsageEnvironment& env, FILE* fid,
@@ -73,13 +81,18 @@ ByteStreamFileSource::ByteStreamFileSource(UsageEnvironment& env, FILE* fid,
 					   unsigned playTimePerFrame)
   : FramedFileSource(env, fid), fFileSize(0), fPreferredFrameSize(preferredFrameSize),
     fPlayTimePerFrame(playTimePerFrame), fLastPlayTime(0),
-    fHaveStartedReading(False), fLimitNumBytesToStream(False), fNumBytesToStream(0) {
+    fHaveStartedReading(False), fLimitNumBytesToStream(False), fNumBytesToStream(0),
+    fFollowGrowingFile(False), fIdleTimeoutSeconds(0), fNumBytesRead(0), fNumDirectDeliveries(0) {
 #ifndef READ_FROM_FILES_SYNCHRONOUSLY
   makeSocketNonBlocking(fileno(fFid));
 #endif
 
   // Test whether the file is seekable
   fFidIsSeekable = FileIsSeekable(fFid);
+
+  // If the file is seekable (and thus probably a regular file), read it through our environment's file block cache
+  // (if it has one), so that other sources that are streaming the same file can share the data that we read:
+  if (fFidIsSeekable) useFileBlockCache();
 }
 
 ByteStreamFileSource::~ByteStreamFileSource() {
@@ -93,7 +106,13 @@ ByteStreamFileSource::~ByteStreamFileSource() {
 }
 
 void ByteStreamFileSource::doGetNextFrame() {
-  if (feof(fFid) || ferror(fFid) || (fLimitNumBytesToStream && fNumBytesToStream == 0)) {
+  if (fFollowGrowingFile && fFidIsSeekable) {
+    // Check (from the event loop) whether enough data is available yet:
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, checkForFileGrowth, this);
+    return;
+  }
+
+  if (reachedEndOfFile() || (fLimitNumBytesToStream && fNumBytesToStream == 0)) {
     handleClosure();
     return;
   }
@@ -101,6 +120,18 @@ void ByteStreamFileSource::doGetNextFrame() {
 #ifdef READ_FROM_FILES_SYNCHRONOUSLY
   doReadFromFile();
 #else
+  if (fileBlockCacheIsUsed()) {
+    // Read from the cache, once it has the data that we want.  (If it doesn't have it yet, it reads it from the
+    // file in the background, so the event loop doesn't wait for the disk.)
+    limitReadSize();
+    if (fileDataIsReady(fMaxSize)) {
+      doReadFromFile();
+    } else {
+      awaitFileData(fMaxSize, fileDataReadyHandler);
+    }
+    return;
+  }
+
   if (!fHaveStartedReading) {
     // Await readable data from the file:
     envir().taskScheduler().turnOnBackgroundReadHandling(fileno(fFid),
@@ -112,6 +143,7 @@ void ByteStreamFileSource::doGetNextFrame() {
 
 void ByteStreamFileSource::doStopGettingFrames() {
   envir().taskScheduler().unscheduleDelayedTask(nextTask());
+  stopAwaitingFileData();
 #ifndef READ_FROM_FILES_SYNCHRONOUSLY
   envir().taskScheduler().turnOffBackgroundReadHandling(fileno(fFid));
   fHaveStartedReading = False;
@@ -126,7 +158,107 @@ void ByteStreamFileSource::fileReadableHandler(ByteStreamFileSource* source, int
   source->doReadFromFile();
 }
 
-void ByteStreamFileSource::doReadFromFile() {
+void ByteStreamFileSource::fileDataReadyHandler(void* clientData) {
+  ByteStreamFileSource* source = (ByteStreamFileSource*)clientData;
+  source->doReadFromFile();
+}
+
+void ByteStreamFileSource::afterGettingFromEventLoop(void* clientData) {
+  ByteStreamFileSource* source = (ByteStreamFileSource*)clientData;
+  source->fNumDirectDeliveries = 0; // because we've returned to the event loop
+  FramedSource::afterGetting(source);
+}
+
+// How many seconds' worth of data - at the rate at which we're being read - to read ahead in the file, within limits:
+#ifndef FILE_READ_AHEAD_SECONDS
+#define FILE_READ_AHEAD_SECONDS 2
+#endif
+#ifndef FILE_READ_AHEAD_MIN_SIZE
+#define FILE_READ_AHEAD_MIN_SIZE (2*FILE_BLOCK_CACHE_BLOCK_SIZE)
+#endif
+#ifndef FILE_READ_AHEAD_MAX_SIZE
+#define FILE_READ_AHEAD_MAX_SIZE (4*1024*1024)
+#endif
+
+unsigned ByteStreamFileSource::readAheadSize() {
+  double bytesPerSecond;
+  if (fPlayTimePerFrame > 0 && fPreferredFrameSize > 0) {
+    // We know our bitrate:
+    bytesPerSecond = (fPreferredFrameSize*1000000.0)/fPlayTimePerFrame;
+  } else {
+    // Estimate our bitrate from how much we've read so far:
+    struct timeval timeNow;
+    gettimeofday(&timeNow, NULL);
+    double const secondsSinceFirstRead
+      = (timeNow.tv_sec - fFirstReadTime.tv_sec) + (timeNow.tv_usec - fFirstReadTime.tv_usec)/1000000.0;
+    if (secondsSinceFirstRead < 1.0) return FILE_READ_AHEAD_MIN_SIZE; // too soon to tell
+    bytesPerSecond = fNumBytesRead/secondsSinceFirstRead;
+  }
+
+  double const readAheadSize = bytesPerSecond*FILE_READ_AHEAD_SECONDS;
+  if (readAheadSize < FILE_READ_AHEAD_MIN_SIZE) return FILE_READ_AHEAD_MIN_SIZE;
+  if (readAheadSize > FILE_READ_AHEAD_MAX_SIZE) return FILE_READ_AHEAD_MAX_SIZE;
+  return (unsigned)readAheadSize;
+}
+
+// How often (in microseconds) we check whether a file that we're following has grown:
+#ifndef GROWING_FILE_POLL_INTERVAL
+#define GROWING_FILE_POLL_INTERVAL 100000
+#endif
+
+void ByteStreamFileSource::checkForFileGrowth(void* clientData) {
+  ByteStreamFileSource* source = (ByteStreamFileSource*)clientData;
+  source->checkForFileGrowth1();
+}
+
+void ByteStreamFileSource::checkForFileGrowth1() {
+  nextTask() = NULL;
+  if (ferror(fFid) || (fLimitNumBytesToStream && fNumBytesToStream == 0)) {
+    handleClosure();
+    return;
+  }
+
+  // Check how much data has been written to the file beyond our current position:
+  u_int64_t numBytesAvailable = 0;
+  struct stat sb;
+  int64_t curPosition = TellFile64(fFid);
+  if (fstat(fileno(fFid), &sb) == 0 && curPosition >= 0 && (u_int64_t)sb.st_size > (u_int64_t)curPosition) {
+    numBytesAvailable = (u_int64_t)sb.st_size - (u_int64_t)curPosition;
+    fFileSize = (u_int64_t)sb.st_size;
+  }
+
+  u_int64_t numBytesNeeded = fPreferredFrameSize > 0 ? fPreferredFrameSize : 1;
+  if (fLimitNumBytesToStream && fNumBytesToStream < numBytesNeeded) numBytesNeeded = fNumBytesToStream;
+  if (numBytesAvailable >= numBytesNeeded) {
+    gettimeofday(&fLastGrowthTime, NULL);
+    clearerr(fFid); // in case we'd previously read up to the (then) end of the file
+    if (numBytesAvailable < (u_int64_t)fMaxSize) {
+      // Don't read a partial 'preferred frame':
+      fMaxSize = (unsigned)(numBytesAvailable - numBytesAvailable%numBytesNeeded);
+    }
+    doReadFromFile();
+    return;
+  }
+
+  // Not enough data has been written yet.  Unless we've been waiting too long, check again later:
+  if (fIdleTimeoutSeconds > 0) {
+    struct timeval timeNow;
+    gettimeofday(&timeNow, NULL);
+    if ((unsigned)(timeNow.tv_sec - fLastGrowthTime.tv_sec) >= fIdleTimeoutSeconds) {
+      handleClosure();
+      return;
+    }
+  }
+  nextTask() = envir().taskScheduler().scheduleDelayedTask(GROWING_FILE_POLL_INTERVAL, checkForFileGrowth, this);
+}
+
+// How many frames - read from the file block cache - we deliver directly (i.e., recursively), before returning to the
+// event loop:
+#ifndef FILE_SOURCE_MAX_DIRECT_DELIVERIES
+#define FILE_SOURCE_MAX_DIRECT_DELIVERIES 16
+#endif
+
+void ByteStreamFileSource::limitReadSize() {
   // Try to read as many bytes as will fit in the buffer provided (or "fPreferredFrameSize" if less)
   if (fLimitNumBytesToStream && fNumBytesToStream < (u_int64_t)fMaxSize) {
     fMaxSize = (unsigned)fNumBytesToStream;
@@ -134,11 +266,15 @@ void ByteStreamFileSource::doReadFromFile() {
   if (fPreferredFrameSize > 0 && fPreferredFrameSize < fMaxSize) {
     fMaxSize = fPreferredFrameSize;
   }
+}
+
+void ByteStreamFileSource::doReadFromFile() {
+  limitReadSize();
 #ifdef READ_FROM_FILES_SYNCHRONOUSLY
-  fFrameSize = fread(fTo, 1, fMaxSize, fFid);
+  fFrameSize = readFromFile(fTo, fMaxSize);
 #else
   if (fFidIsSeekable) {
-    fFrameSize = fread(fTo, 1, fMaxSize, fFid);
+    fFrameSize = readFromFile(fTo, fMaxSize);
   } else {
     // For non-seekable files (e.g., pipes), call "read()" rather than "fread()", to ensure that the read doesn't block:
     fFrameSize = read(fileno(fFid), fTo, fMaxSize);
@@ -150,6 +286,13 @@ void ByteStreamFileSource::doReadFromFile() {
   }
   fNumBytesToStream -= fFrameSize;
 
+  if (fileBlockCacheIsUsed()) {
+    // Have the cache read the data that we'll want next, so that - ideally - we'll never have to wait for it:
+    if (fNumBytesRead == 0) gettimeofday(&fFirstReadTime, NULL);
+    fNumBytesRead += fFrameSize;
+    readAheadInFile(readAheadSize());
+  }
+
   // Set the 'presentation time':
   if (fPlayTimePerFrame > 0 && fPreferredFrameSize > 0) {
     if (fPresentationTime.tv_sec == 0 && fPresentationTime.tv_usec == 0) {
@@ -177,8 +320,21 @@ void ByteStreamFileSource::doReadFromFile() {
   nextTask() = envir().taskScheduler().scheduleDelayedTask(0,
 				(TaskFunc*)FramedSource::afterGetting, this);
 #else
-  // Because the file read was done from the event loop, we can call the
-  // 'after getting' function directly, without risk of infinite recursion:
-  FramedSource::afterGetting(this);
+  if (fileBlockCacheIsUsed()) {
+    // The read might have been done directly from "doGetNextFrame()" (even if we had to wait for the data, because
+    // the cache might have read it synchronously), so the reader - if it asks for more data straight away - will call
+    // us again recursively.  We allow a few such calls, but then - to bound the recursion - return to the event loop
+    // before informing the reader:
+    if (fNumDirectDeliveries < FILE_SOURCE_MAX_DIRECT_DELIVERIES) {
+      ++fNumDirectDeliveries;
+      FramedSource::afterGetting(this);
+    } else {
+      nextTask() = envir().taskScheduler().scheduleDelayedTask(0, afterGettingFromEventLoop, this);
+    }
+  } else {
+    // Because the file read was done from the event loop, we can call the
+    // 'after getting' function directly, without risk of infinite recursion:
+    FramedSource::afterGetting(this);
+  }
 #endif
 }
@@ -49,6 +49,12 @@ public:
   void seekToByteRelative(int64_t offset, u_int64_t numBytesToStream = 0);
   void seekToEnd(); // to force EOF handling on the next read
 
+  void followGrowingFile(unsigned idleTimeoutSeconds = 0);
+      // Treat the end of the file as meaning 'no more data yet', rather than EOF; i.e., wait for the file to grow
+      // (e.g., because it's a recording that's still being written).  In this mode, we deliver data only in units of
+      // "preferredFrameSize" bytes (if set), so that (e.g.) a partially-written Transport Stream packet never gets delivered.
+      // If "idleTimeoutSeconds" > 0, then we treat the file as having ended once it hasn't grown for this long.
+
 protected:
   ByteStreamFileSource(UsageEnvironment& env,
 		       FILE* fid,
@@ -59,7 +65,14 @@ protected:
   virtual ~ByteStreamFileSource();
 
   static void fileReadableHandler(ByteStreamFileSource* source, int mask);
+  static void fileDataReadyHandler(void* clientData);
+  static void afterGettingFromEventLoop(void* clientData);
+  void limitReadSize();
   void doReadFromFile();
+  unsigned readAheadSize();
+
+  static void checkForFileGrowth(void* clientData);
+  void checkForFileGrowth1();
 
 private:
   // redefined virtual functions:
@@ -77,6 +90,12 @@ private:
   Boolean fHaveStartedReading;
   Boolean fLimitNumBytesToStream;
   u_int64_t fNumBytesToStream; // used iff "fLimitNumBytesToStream" is True
+  Boolean fFollowGrowingFile;
+  unsigned fIdleTimeoutSeconds; // used iff "fFollowGrowingFile" is True
+  struct timeval fLastGrowthTime; // ditto
+  struct timeval fFirstReadTime; // used to estimate the rate at which we're being read...
+  u_int64_t fNumBytesRead; // ...and thus how much data to read ahead
+  unsigned fNumDirectDeliveries; // since we were last called from the event loop
 };
 
 #endif
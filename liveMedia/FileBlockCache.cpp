@@ -0,0 +1,928 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2018 Live Networks, Inc.  All rights reserved.
+// A cache of (aligned) blocks read from files, shared by all of the file sources in an environment
+// Implementation
+
+#include "FileBlockCache.hh"
+#include "Media.hh"
+#include <string.h>
+#if !defined(__WIN32__) && !defined(_WIN32)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#endif
+
+// On Linux, use "io_uring" - if we can - for background reads.  (We use its system calls directly, so as not to
+// depend upon "liburing".)
+#if defined(__linux__) && !defined(NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define USE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+static long readFileAt(int fd, void* to, unsigned numBytes, u_int64_t position) {
+#if defined(__WIN32__) || defined(_WIN32)
+  return -1; // not supported
+#else
+  ssize_t result;
+  do {
+    result = pread(fd, to, numBytes, (off_t)position);
+  } while (result < 0 && errno == EINTR);
+  return (long)result;
+#endif
+}
+
+////////// CachedFile, FileBlock, and FileReadWaiter //////////
+
+class CachedFile {
+public:
+  CachedFile(unsigned id, unsigned const* key, u_int64_t size, time_t modificationTime)
+    : fId(id), fSize(size), fModificationTime(modificationTime), fFd(-1),
+      fNumUsers(0), fNumBlocks(0), fNumReadsPending(0), fIsCurrent(True) {
+    for (unsigned i = 0; i < 4; ++i) fKey[i] = key[i];
+  }
+  virtual ~CachedFile() {
+#if !defined(__WIN32__) && !defined(_WIN32)
+    if (fFd >= 0) close(fFd);
+#endif
+  }
+
+  unsigned fId; // identifies our blocks (in the cache's "fBlocks" table)
+  unsigned fKey[4]; // our (device, inode), as used in the cache's "fFiles" table
+  u_int64_t fSize;
+  time_t fModificationTime;
+  int fFd; // a descriptor of our own for reading the file, while anyone has it open (or it's being read); else -1
+  unsigned fNumUsers, fNumBlocks, fNumReadsPending;
+  Boolean fIsCurrent; // False once the file has been modified; our blocks are then of no use to anyone else
+};
+
+class FileBlock {
+public:
+  FileBlock(CachedFile* file, u_int64_t blockNum, unsigned size)
+    : fFile(file), fBlockNum(blockNum), fData(new unsigned char[FILE_BLOCK_CACHE_BLOCK_SIZE]), fSize(size),
+      fIsBeingRead(False), fPrev(NULL), fNext(NULL), fNextToRead(NULL) {
+  }
+  virtual ~FileBlock() { delete[] fData; }
+
+  u_int64_t position() const { return fBlockNum*FILE_BLOCK_CACHE_BLOCK_SIZE; }
+  void makeKey(unsigned* key) const { makeKey(key, fFile, fBlockNum); }
+  static void makeKey(unsigned* key, CachedFile const* file, u_int64_t blockNum) {
+    key[0] = file->fId; key[1] = (unsigned)blockNum; key[2] = (unsigned)(blockNum>>32);
+  }
+
+  CachedFile* fFile;
+  u_int64_t fBlockNum;
+  unsigned char* fData; // FILE_BLOCK_CACHE_BLOCK_SIZE bytes
+  unsigned fSize; // less than FILE_BLOCK_CACHE_BLOCK_SIZE only at the end of the file
+  Boolean fIsBeingRead; // in the background (in which case only the reader may touch "fData")
+  FileBlock* fPrev; // in the cache's LRU list
+  FileBlock* fNext;
+  FileBlock* fNextToRead; // used by a "FileBlockReader" to queue blocks that it can't read yet
+};
+
+class FileReadWaiter {
+public:
+  FileReadWaiter(CachedFile* file, u_int64_t position, unsigned numBytes, TaskFunc* onReadable, void* clientData)
+    : fFile(file), fPosition(position), fNumBytes(numBytes), fOnReadable(onReadable), fClientData(clientData),
+      fNext(NULL) {
+  }
+
+  CachedFile* fFile;
+  u_int64_t fPosition;
+  unsigned fNumBytes;
+  TaskFunc* fOnReadable;
+  void* fClientData;
+  FileReadWaiter* fNext;
+};
+
+////////// FileBlockReader (and its subclasses) //////////
+//////////     used to read blocks in the background
+
+class FileBlockReader {
+public:
+  static FileBlockReader* createNew(UsageEnvironment& env, FileBlockCache& cache);
+      // returns NULL if background reading isn't supported
+  virtual ~FileBlockReader() {}
+
+  virtual char const* name() const = 0;
+  virtual void readBlock(FileBlock* block) = 0;
+      // reads "block->fSize" bytes - from "block->position()" in "block->fFile->fFd" - into "block->fData", then
+      // (from the event loop) calls "completed()"
+
+protected:
+  FileBlockReader(UsageEnvironment& env, FileBlockCache& cache) : fEnv(env), fCache(cache) {}
+  void completed(FileBlock* block, long result) { fCache.completeRead(block, result); }
+
+protected:
+  UsageEnvironment& fEnv;
+  FileBlockCache& fCache;
+};
+
+#if !defined(__WIN32__) && !defined(_WIN32)
+// Reads blocks using a pool of I/O threads (each doing "pread()"), which report back to the event loop using an
+// event trigger.  Used if "io_uring" isn't available.
+class ThreadPoolFileBlockReader: public FileBlockReader {
+public:
+  static ThreadPoolFileBlockReader* createNew(UsageEnvironment& env, FileBlockCache& cache);
+  virtual ~ThreadPoolFileBlockReader();
+
+protected:
+  ThreadPoolFileBlockReader(UsageEnvironment& env, FileBlockCache& cache);
+
+private: // redefined virtual functions
+  virtual char const* name() const { return "I/O threads"; }
+  virtual void readBlock(FileBlock* block);
+
+private:
+  static void* readThread(void* clientData);
+  void readThread1();
+  static void completionHandler(void* clientData);
+  void completionHandler1();
+
+  struct Request {
+    FileBlock* block;
+    int fd;
+    u_int64_t position;
+    unsigned numBytes;
+    long result;
+    Request* next;
+  };
+  static void append(Request*& head, Request*& tail, Request* request);
+
+private:
+  EventTriggerId fCompletionTrigger;
+  pthread_mutex_t fMutex; // protects the following:
+  pthread_cond_t fRequestAvailable;
+  Request* fRequestsHead; Request* fRequestsTail; // waiting for an I/O thread
+  Request* fCompletedHead; Request* fCompletedTail; // waiting for the event loop
+  Boolean fShuttingDown;
+  // (The following are used only by our constructor and destructor:)
+  pthread_t fThreads[FILE_BLOCK_CACHE_NUM_READ_THREADS];
+  unsigned fNumThreads;
+};
+
+ThreadPoolFileBlockReader* ThreadPoolFileBlockReader::createNew(UsageEnvironment& env, FileBlockCache& cache) {
+  ThreadPoolFileBlockReader* reader = new ThreadPoolFileBlockReader(env, cache);
+  if (reader->fCompletionTrigger == 0 || reader->fNumThreads == 0) {
+    delete reader;
+    return NULL;
+  }
+
+  return reader;
+}
+
+ThreadPoolFileBlockReader::ThreadPoolFileBlockReader(UsageEnvironment& env, FileBlockCache& cache)
+  : FileBlockReader(env, cache),
+    fRequestsHead(NULL), fRequestsTail(NULL), fCompletedHead(NULL), fCompletedTail(NULL),
+    fShuttingDown(False), fNumThreads(0) {
+  fCompletionTrigger = env.taskScheduler().createEventTrigger(completionHandler);
+  pthread_mutex_init(&fMutex, NULL);
+  pthread_cond_init(&fRequestAvailable, NULL);
+
+  while (fNumThreads < FILE_BLOCK_CACHE_NUM_READ_THREADS) {
+    if (pthread_create(&fThreads[fNumThreads], NULL, readThread, this) != 0) break;
+    ++fNumThreads;
+  }
+}
+
+ThreadPoolFileBlockReader::~ThreadPoolFileBlockReader() {
+  pthread_mutex_lock(&fMutex);
+  fShuttingDown = True;
+  pthread_cond_broadcast(&fRequestAvailable);
+  pthread_mutex_unlock(&fMutex);
+  for (unsigned i = 0; i < fNumThreads; ++i) pthread_join(fThreads[i], NULL);
+
+  // No reads are now in progress.  Forget any that weren't done (or whose completion hasn't been handled):
+  fEnv.taskScheduler().deleteEventTrigger(fCompletionTrigger);
+  while (fRequestsHead != NULL) { Request* next = fRequestsHead->next; delete fRequestsHead; fRequestsHead = next; }
+  while (fCompletedHead != NULL) { Request* next = fCompletedHead->next; delete fCompletedHead; fCompletedHead = next; }
+
+  pthread_cond_destroy(&fRequestAvailable);
+  pthread_mutex_destroy(&fMutex);
+}
+
+void ThreadPoolFileBlockReader::readBlock(FileBlock* block) {
+  Request* request = new Request;
+  request->block = block;
+  request->fd = block->fFile->fFd;
+  request->position = block->position();
+  request->numBytes = block->fSize;
+  request->result = -1;
+
+  pthread_mutex_lock(&fMutex);
+  append(fRequestsHead, fRequestsTail, request);
+  pthread_cond_signal(&fRequestAvailable);
+  pthread_mutex_unlock(&fMutex);
+}
+
+void* ThreadPoolFileBlockReader::readThread(void* clientData) {
+  ((ThreadPoolFileBlockReader*)clientData)->readThread1();
+  return NULL;
+}
+
+void ThreadPoolFileBlockReader::readThread1() {
+  pthread_mutex_lock(&fMutex);
+  while (1) {
+    while (fRequestsHead == NULL && !fShuttingDown) pthread_cond_wait(&fRequestAvailable, &fMutex);
+    if (fShuttingDown) break;
+
+    Request* request = fRequestsHead;
+    fRequestsHead = request->next;
+    if (fRequestsHead == NULL) fRequestsTail = NULL;
+    pthread_mutex_unlock(&fMutex);
+
+    // (Note that - while the read is in progress - no other thread touches the block's data.)
+    request->result = readFileAt(request->fd, request->block->fData, request->numBytes, request->position);
+
+    pthread_mutex_lock(&fMutex);
+    Boolean const wasEmpty = fCompletedHead == NULL;
+    append(fCompletedHead, fCompletedTail, request);
+    if (wasEmpty) fEnv.taskScheduler().triggerEvent(fCompletionTrigger, this);
+  }
+  pthread_mutex_unlock(&fMutex);
+}
+
+void ThreadPoolFileBlockReader::completionHandler(void* clientData) {
+  ((ThreadPoolFileBlockReader*)clientData)->completionHandler1();
+}
+
+void ThreadPoolFileBlockReader::completionHandler1() {
+  pthread_mutex_lock(&fMutex);
+  Request* request = fCompletedHead;
+  fCompletedHead = fCompletedTail = NULL;
+  pthread_mutex_unlock(&fMutex);
+
+  while (request != NULL) {
+    Request* nextRequest = request->next;
+    completed(request->block, request->result);
+    delete request;
+    request = nextRequest;
+  }
+}
+
+void ThreadPoolFileBlockReader::append(Request*& head, Request*& tail, Request* request) {
+  request->next = NULL;
+  if (tail == NULL) head = request; else tail->next = request;
+  tail = request;
+}
+#endif
+
+#ifdef USE_IO_URING
+// Reads blocks using "io_uring".  The kernel signals completed reads on an "eventfd", which the event loop watches.
+class IoUringFileBlockReader: public FileBlockReader {
+public:
+  static IoUringFileBlockReader* createNew(UsageEnvironment& env, FileBlockCache& cache);
+  virtual ~IoUringFileBlockReader();
+
+protected:
+  IoUringFileBlockReader(UsageEnvironment& env, FileBlockCache& cache);
+
+private: // redefined virtual functions
+  virtual char const* name() const { return "io_uring"; }
+  virtual void readBlock(FileBlock* block);
+
+private:
+  Boolean setUp();
+  void submit(FileBlock* block);
+  static void completionHandler(void* clientData, int mask);
+  void completionHandler1();
+  Boolean reapCompletion(FileBlock*& block, long& result);
+
+private:
+  int fRingFd, fEventFd;
+  void* fSQRing; size_t fSQRingSize;
+  void* fCQRing; size_t fCQRingSize; // (may be the same as "fSQRing")
+  struct io_uring_sqe* fSQEs; size_t fSQEsSize;
+  unsigned* fSQHead; unsigned* fSQTail; unsigned fSQMask; unsigned* fSQArray; unsigned fNumEntries;
+  unsigned* fCQHead; unsigned* fCQTail; unsigned fCQMask; struct io_uring_cqe* fCQEs;
+  struct iovec* fIovecs; // one for each submission queue entry
+  unsigned fNumReadsInProgress; // at most "fNumEntries", so that the completion queue can't overflow
+  FileBlock* fBacklogHead; // blocks that are waiting for a free submission queue entry
+  FileBlock* fBacklogTail;
+};
+
+IoUringFileBlockReader* IoUringFileBlockReader::createNew(UsageEnvironment& env, FileBlockCache& cache) {
+  IoUringFileBlockReader* reader = new IoUringFileBlockReader(env, cache);
+  if (!reader->setUp()) {
+    delete reader;
+    return NULL;
+  }
+
+  return reader;
+}
+
+IoUringFileBlockReader::IoUringFileBlockReader(UsageEnvironment& env, FileBlockCache& cache)
+  : FileBlockReader(env, cache),
+    fRingFd(-1), fEventFd(-1), fSQRing(MAP_FAILED), fSQRingSize(0), fCQRing(MAP_FAILED), fCQRingSize(0),
+    fSQEs((struct io_uring_sqe*)MAP_FAILED), fSQEsSize(0), fNumEntries(0), fIovecs(NULL),
+    fNumReadsInProgress(0), fBacklogHead(NULL), fBacklogTail(NULL) {
+}
+
+IoUringFileBlockReader::~IoUringFileBlockReader() {
+  // The kernel might still be writing into blocks, so wait until it's done:
+  FileBlock* block; long result;
+  while (fNumReadsInProgress > 0) {
+    if (!reapCompletion(block, result)
+	&& syscall(__NR_io_uring_enter, fRingFd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR) break;
+  }
+
+  if (fEventFd >= 0) {
+    fEnv.taskScheduler().disableBackgroundHandling(fEventFd);
+    close(fEventFd);
+  }
+  if (fSQEs != MAP_FAILED) munmap(fSQEs, fSQEsSize);
+  if (fCQRing != MAP_FAILED && fCQRing != fSQRing) munmap(fCQRing, fCQRingSize);
+  if (fSQRing != MAP_FAILED) munmap(fSQRing, fSQRingSize);
+  if (fRingFd >= 0) close(fRingFd);
+  delete[] fIovecs;
+}
+
+Boolean IoUringFileBlockReader::setUp() {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof params);
+  fRingFd = (int)syscall(__NR_io_uring_setup, 64, &params);
+  if (fRingFd < 0) return False; // "io_uring" isn't supported (or is disabled)
+
+  // Map the submission and completion queues into our memory:
+  fSQRingSize = params.sq_off.array + params.sq_entries*sizeof (unsigned);
+  fCQRingSize = params.cq_off.cqes + params.cq_entries*sizeof (struct io_uring_cqe);
+  if (params.features&IORING_FEAT_SINGLE_MMAP) {
+    if (fCQRingSize > fSQRingSize) fSQRingSize = fCQRingSize;
+    fCQRingSize = fSQRingSize;
+  }
+  fSQRing = mmap(NULL, fSQRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fRingFd, IORING_OFF_SQ_RING);
+  if (fSQRing == MAP_FAILED) return False;
+  if (params.features&IORING_FEAT_SINGLE_MMAP) {
+    fCQRing = fSQRing;
+  } else {
+    fCQRing = mmap(NULL, fCQRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fRingFd, IORING_OFF_CQ_RING);
+    if (fCQRing == MAP_FAILED) return False;
+  }
+  fSQEsSize = params.sq_entries*sizeof (struct io_uring_sqe);
+  fSQEs = (struct io_uring_sqe*)mmap(NULL, fSQEsSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+				     fRingFd, IORING_OFF_SQES);
+  if (fSQEs == MAP_FAILED) return False;
+
+  char* sq = (char*)fSQRing;
+  fSQHead = (unsigned*)(sq + params.sq_off.head);
+  fSQTail = (unsigned*)(sq + params.sq_off.tail);
+  fSQMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+  fSQArray = (unsigned*)(sq + params.sq_off.array);
+  fNumEntries = params.sq_entries;
+  char* cq = (char*)fCQRing;
+  fCQHead = (unsigned*)(cq + params.cq_off.head);
+  fCQTail = (unsigned*)(cq + params.cq_off.tail);
+  fCQMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+  fCQEs = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+  fIovecs = new struct iovec[fNumEntries];
+
+  // Have completions signalled on an 'eventfd' that the event loop watches:
+  fEventFd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+  if (fEventFd < 0) return False;
+  if (syscall(__NR_io_uring_register, fRingFd, IORING_REGISTER_EVENTFD, &fEventFd, 1) < 0) return False;
+  fEnv.taskScheduler().setBackgroundHandling(fEventFd, SOCKET_READABLE, completionHandler, this);
+
+  return True;
+}
+
+void IoUringFileBlockReader::readBlock(FileBlock* block) {
+  if (fNumReadsInProgress < fNumEntries) {
+    submit(block);
+  } else {
+    // Wait until an earlier read completes:
+    block->fNextToRead = NULL;
+    if (fBacklogTail == NULL) fBacklogHead = block; else fBacklogTail->fNextToRead = block;
+    fBacklogTail = block;
+  }
+}
+
+void IoUringFileBlockReader::submit(FileBlock* block) {
+  unsigned const tail = *fSQTail; // only we write this
+  unsigned const index = tail&fSQMask;
+
+  // (We use "IORING_OP_READV" - rather than "IORING_OP_READ" - because it's supported by older kernels.)
+  fIovecs[index].iov_base = block->fData;
+  fIovecs[index].iov_len = block->fSize;
+  struct io_uring_sqe* sqe = &fSQEs[index];
+  memset(sqe, 0, sizeof *sqe);
+  sqe->opcode = IORING_OP_READV;
+  sqe->fd = block->fFile->fFd;
+  sqe->addr = (unsigned long)&fIovecs[index];
+  sqe->len = 1;
+  sqe->off = block->position();
+  sqe->user_data = (unsigned long)block;
+  fSQArray[index] = index;
+  __atomic_store_n(fSQTail, tail+1, __ATOMIC_RELEASE);
+  ++fNumReadsInProgress;
+
+  long result;
+  do {
+    result = syscall(__NR_io_uring_enter, fRingFd, 1, 0, 0, NULL, 0);
+  } while (result < 0 && errno == EINTR);
+}
+
+void IoUringFileBlockReader::completionHandler(void* clientData, int /*mask*/) {
+  ((IoUringFileBlockReader*)clientData)->completionHandler1();
+}
+
+void IoUringFileBlockReader::completionHandler1() {
+  u_int64_t counter;
+  while (::read(fEventFd, &counter, sizeof counter) > 0) {}
+
+  FileBlock* block; long result;
+  while (reapCompletion(block, result)) {
+    // Now that a submission queue entry is free, use it for a block that's been waiting for one:
+    if (fBacklogHead != NULL) {
+      FileBlock* waitingBlock = fBacklogHead;
+      fBacklogHead = waitingBlock->fNextToRead;
+      if (fBacklogHead == NULL) fBacklogTail = NULL;
+      submit(waitingBlock);
+    }
+
+    completed(block, result); // Note: This might cause more blocks to be read
+  }
+}
+
+Boolean IoUringFileBlockReader::reapCompletion(FileBlock*& block, long& result) {
+  unsigned const head = *fCQHead; // only we write this
+  if (head == __atomic_load_n(fCQTail, __ATOMIC_ACQUIRE)) return False;
+
+  struct io_uring_cqe* cqe = &fCQEs[head&fCQMask];
+  block = (FileBlock*)(cqe->user_data);
+  result = cqe->res;
+  __atomic_store_n(fCQHead, head+1, __ATOMIC_RELEASE);
+  --fNumReadsInProgress;
+
+  return True;
+}
+#endif
+
+FileBlockReader* FileBlockReader::createNew(UsageEnvironment& env, FileBlockCache& cache) {
+  FileBlockReader* reader = NULL;
+#ifdef USE_IO_URING
+  reader = IoUringFileBlockReader::createNew(env, cache);
+#endif
+#if !defined(__WIN32__) && !defined(_WIN32)
+  if (reader == NULL) reader = ThreadPoolFileBlockReader::createNew(env, cache);
+#endif
+
+  return reader;
+}
+
+////////// FileBlockCache //////////
+
+FileBlockCache* FileBlockCache::reference(UsageEnvironment& env) {
+  _Tables* ourTables = _Tables::getOurTables(env);
+  if (ourTables->fileBlockCache == NULL) {
+    ourTables->fileBlockCache = new FileBlockCache(env);
+  }
+  FileBlockCache* cache = (FileBlockCache*)(ourTables->fileBlockCache);
+  ++cache->fReferenceCount;
+  return cache;
+}
+
+void FileBlockCache::release() {
+  if (--fReferenceCount > 0) return;
+
+  // We're no longer being used, so delete ourself (and perhaps the '_Tables' structure that points to us):
+  _Tables* ourTables = _Tables::getOurTables(fEnv, False);
+  if (ourTables != NULL) {
+    ourTables->fileBlockCache = NULL;
+    ourTables->reclaimIfPossible();
+  }
+  delete this;
+}
+
+FileBlockCache* FileBlockCache::lookup(UsageEnvironment& env) {
+  _Tables* ourTables = _Tables::getOurTables(env, False);
+  if (ourTables == NULL) return NULL;
+
+  return (FileBlockCache*)(ourTables->fileBlockCache);
+}
+
+FileBlockCache::FileBlockCache(UsageEnvironment& env)
+  : fEnv(env), fReferenceCount(0), fMaxSize(FILE_BLOCK_CACHE_DEFAULT_MAX_SIZE),
+    fFiles(HashTable::create(4)), fBlocks(HashTable::create(3)),
+    fLeastRecentlyUsed(NULL), fMostRecentlyUsed(NULL), fNextFileId(0),
+    fReader(NULL), fReaderIsUnavailable(False), fWaiters(NULL),
+    fNumFilesOpen(0), fNumBlocksCached(0), fNumBytesCached(0),
+    fNumHits(0), fNumMisses(0), fNumBackgroundReads(0), fNumBytesRead(0), fNumBytesDelivered(0) {
+}
+
+void FileBlockCache::setMaxSize(u_int64_t maxSize) {
+  fMaxSize = maxSize;
+  discardBlocksIfNecessary(NULL);
+}
+
+FileBlockCache::~FileBlockCache() {
+  // First, stop (waiting for) any background reads:
+  delete fReader;
+  while (fWaiters != NULL) {
+    FileReadWaiter* nextWaiter = fWaiters->fNext;
+    delete fWaiters;
+    fWaiters = nextWaiter;
+  }
+
+  // By now, every file has been closed, so discarding every block also deletes every "CachedFile":
+  while (fLeastRecentlyUsed != NULL) {
+    fLeastRecentlyUsed->fIsBeingRead = False;
+    discardBlock(fLeastRecentlyUsed);
+  }
+
+  delete fBlocks;
+  delete fFiles;
+}
+
+CachedFile* FileBlockCache::openFile(FILE* fid) {
+#if defined(__WIN32__) || defined(_WIN32)
+  // Not yet supported:
+  return NULL;
+#else
+  if (fMaxSize == 0 || fid == NULL) return NULL;
+
+  struct stat sb;
+  if (fstat(fileno(fid), &sb) != 0 || !S_ISREG(sb.st_mode)) return NULL;
+
+  unsigned key[4];
+  u_int64_t const dev = (u_int64_t)sb.st_dev;
+  u_int64_t const ino = (u_int64_t)sb.st_ino;
+  key[0] = (unsigned)dev; key[1] = (unsigned)(dev>>32);
+  key[2] = (unsigned)ino; key[3] = (unsigned)(ino>>32);
+
+  CachedFile* file = (CachedFile*)(fFiles->Lookup((char const*)key));
+  if (file != NULL && (file->fSize != (u_int64_t)sb.st_size || file->fModificationTime != sb.st_mtime)) {
+    // The file has changed since we first cached it.  Anyone who's still reading it can keep using its blocks,
+    // but no one else will:
+    fFiles->Remove((char const*)key);
+    file->fIsCurrent = False;
+    deleteFileIfUnused(file);
+    file = NULL;
+  }
+  if (file == NULL) {
+    file = new CachedFile(++fNextFileId, key, (u_int64_t)sb.st_size, sb.st_mtime);
+    fFiles->Add((char const*)key, file);
+  }
+
+  if (file->fFd < 0) {
+    file->fFd = dup(fileno(fid));
+    if (file->fFd < 0) {
+      deleteFileIfUnused(file);
+      return NULL;
+    }
+  }
+
+  if (file->fNumUsers++ == 0) ++fNumFilesOpen;
+  return file;
+#endif
+}
+
+void FileBlockCache::closeFile(CachedFile* file) {
+  if (file == NULL || --file->fNumUsers > 0) return;
+
+  --fNumFilesOpen;
+  closeFileIfIdle(file);
+
+  // Keep the file's blocks around (if it's still current), for whoever opens the file next:
+  deleteFileIfUnused(file);
+}
+
+unsigned FileBlockCache::read(CachedFile* file, u_int64_t position, unsigned char* to, unsigned numBytes) {
+  unsigned numBytesCopied = 0;
+
+  while (numBytesCopied < numBytes) {
+    if (position >= file->fSize) {
+      // The file has grown since it was opened.  Read the new data directly:
+      long result = readFileAt(file->fFd, &to[numBytesCopied], numBytes - numBytesCopied, position);
+      if (result > 0) {
+	numBytesCopied += result;
+	fNumBytesRead += result;
+      }
+      break;
+    }
+
+    u_int64_t const blockNum = position/FILE_BLOCK_CACHE_BLOCK_SIZE;
+    unsigned const offsetInBlock = (unsigned)(position%FILE_BLOCK_CACHE_BLOCK_SIZE);
+    FileBlock* block = lookupBlock(file, blockNum);
+    if (block == NULL) {
+      block = readBlock(file, blockNum);
+      if (block == NULL) break; // error
+    } else if (block->fIsBeingRead) {
+      // The block is being read in the background, so we can't use it yet.  Read the data that we want directly:
+      unsigned numBytesToRead = block->fSize - offsetInBlock;
+      if (numBytesToRead > numBytes - numBytesCopied) numBytesToRead = numBytes - numBytesCopied;
+      long result = readFileAt(file->fFd, &to[numBytesCopied], numBytesToRead, position);
+      if (result <= 0) break;
+      numBytesCopied += result;
+      position += result;
+      fNumBytesRead += result;
+      continue;
+    } else {
+      ++fNumHits;
+      markAsMostRecentlyUsed(block);
+    }
+    if (offsetInBlock >= block->fSize) break; // the block was short (e.g., because the file was truncated)
+
+    unsigned numBytesToCopy = block->fSize - offsetInBlock;
+    if (numBytesToCopy > numBytes - numBytesCopied) numBytesToCopy = numBytes - numBytesCopied;
+    memmove(&to[numBytesCopied], &block->fData[offsetInBlock], numBytesToCopy);
+    numBytesCopied += numBytesToCopy;
+    position += numBytesToCopy;
+  }
+
+  fNumBytesDelivered += numBytesCopied;
+  return numBytesCopied;
+}
+
+u_int64_t FileBlockCache::fileSize(CachedFile* file) {
+  return file == NULL ? 0 : file->fSize;
+}
+
+Boolean FileBlockCache::isReadable(CachedFile* file, u_int64_t position, unsigned numBytes) {
+  u_int64_t endPosition = position + numBytes;
+  if (endPosition > file->fSize) endPosition = file->fSize;
+  for (u_int64_t pos = position - position%FILE_BLOCK_CACHE_BLOCK_SIZE; pos < endPosition;
+       pos += FILE_BLOCK_CACHE_BLOCK_SIZE) {
+    FileBlock* block = lookupBlock(file, pos/FILE_BLOCK_CACHE_BLOCK_SIZE);
+    if (block == NULL) {
+      if (!fReaderIsUnavailable) return False; // we can read it in the background
+    } else if (block->fIsBeingRead) {
+      return False;
+    }
+  }
+
+  return True;
+}
+
+void FileBlockCache::readAsync(CachedFile* file, u_int64_t position, unsigned numBytes,
+			       TaskFunc* onReadable, void* clientData) {
+  startReading(file, position, numBytes);
+  if (!isBeingRead(file, position, numBytes)) {
+    (*onReadable)(clientData);
+    return;
+  }
+
+  // Wait until the reads are done:
+  FileReadWaiter* waiter = new FileReadWaiter(file, position, numBytes, onReadable, clientData);
+  waiter->fNext = fWaiters;
+  fWaiters = waiter;
+}
+
+void FileBlockCache::cancelReadAsync(void* clientData) {
+  FileReadWaiter** waiterPtr = &fWaiters;
+  while (*waiterPtr != NULL) {
+    FileReadWaiter* waiter = *waiterPtr;
+    if (waiter->fClientData == clientData) {
+      *waiterPtr = waiter->fNext;
+      delete waiter;
+    } else {
+      waiterPtr = &waiter->fNext;
+    }
+  }
+}
+
+void FileBlockCache::readAhead(CachedFile* file, u_int64_t position, unsigned numBytes) {
+  // Don't read so far ahead that we'd be discarding blocks that are about to be used:
+  if (numBytes > fMaxSize/4) numBytes = (unsigned)(fMaxSize/4);
+
+  startReading(file, position, numBytes);
+}
+
+void FileBlockCache::printStatistics(UsageEnvironment& env) const {
+  u_int64_t const numLookups = fNumHits + fNumMisses;
+  env << "File block cache: "
+      << (unsigned)fNumBytesCached << " bytes in " << fNumBlocksCached << " blocks (max "
+      << (unsigned)fMaxSize << " bytes); " << fNumFilesOpen << " files open\n";
+  env << "\tblock lookups: " << (unsigned)fNumHits << " hits, " << (unsigned)fNumMisses << " misses ("
+      << (numLookups == 0 ? 0 : (unsigned)((100*fNumHits)/numLookups)) << "% hit rate); "
+      << (unsigned)fNumBackgroundReads << " misses read in the background";
+  if (fReader != NULL) env << " (using " << fReader->name() << ")";
+  env << "\n";
+  env << "\t" << (unsigned)(fNumBytesRead/1024) << " KB read from files; "
+      << (unsigned)(fNumBytesDelivered/1024) << " KB delivered to file sources\n";
+}
+
+FileBlock* FileBlockCache::lookupBlock(CachedFile* file, u_int64_t blockNum) {
+  unsigned key[3];
+  FileBlock::makeKey(key, file, blockNum);
+
+  return (FileBlock*)(fBlocks->Lookup((char const*)key));
+}
+
+FileBlock* FileBlockCache::readBlock(CachedFile* file, u_int64_t blockNum) {
+  ++fNumMisses;
+  FileBlock* block = newBlock(file, blockNum);
+
+  long result = readFileAt(file->fFd, block->fData, block->fSize, block->position());
+  if (result <= 0) {
+    discardBlock(block);
+    return NULL;
+  }
+  fNumBytesRead += result;
+  if ((unsigned)result < block->fSize) { // the file must have been truncated
+    fNumBytesCached -= block->fSize - result;
+    block->fSize = (unsigned)result;
+  }
+
+  return block;
+}
+
+FileBlock* FileBlockCache::newBlock(CachedFile* file, u_int64_t blockNum) {
+  u_int64_t const position = blockNum*FILE_BLOCK_CACHE_BLOCK_SIZE;
+  unsigned size = FILE_BLOCK_CACHE_BLOCK_SIZE;
+  if (file->fSize - position < size) size = (unsigned)(file->fSize - position);
+
+  FileBlock* block = new FileBlock(file, blockNum, size);
+  unsigned key[3];
+  block->makeKey(key);
+  fBlocks->Add((char const*)key, block);
+  ++file->fNumBlocks;
+  ++fNumBlocksCached;
+  fNumBytesCached += block->fSize;
+  markAsMostRecentlyUsed(block);
+  discardBlocksIfNecessary(block);
+
+  return block;
+}
+
+void FileBlockCache::discardBlocksIfNecessary(FileBlock* blockToKeep) {
+  // Stay within our size limit, by discarding the least recently used blocks (other than "blockToKeep", and any
+  // that are being read):
+  FileBlock* oldBlock = fLeastRecentlyUsed;
+  while (fNumBytesCached > fMaxSize && oldBlock != NULL && oldBlock != blockToKeep) {
+    FileBlock* nextBlock = oldBlock->fNext;
+    if (!oldBlock->fIsBeingRead) discardBlock(oldBlock);
+    oldBlock = nextBlock;
+  }
+}
+
+void FileBlockCache::startReading(CachedFile* file, u_int64_t position, unsigned numBytes) {
+  if (fReader == NULL) {
+    if (fReaderIsUnavailable) return;
+    fReader = FileBlockReader::createNew(fEnv, *this);
+    if (fReader == NULL) {
+      fReaderIsUnavailable = True; // so we'll read synchronously instead
+      return;
+    }
+  }
+
+  u_int64_t endPosition = position + numBytes;
+  if (endPosition > file->fSize) endPosition = file->fSize;
+  for (u_int64_t pos = position - position%FILE_BLOCK_CACHE_BLOCK_SIZE; pos < endPosition;
+       pos += FILE_BLOCK_CACHE_BLOCK_SIZE) {
+    u_int64_t const blockNum = pos/FILE_BLOCK_CACHE_BLOCK_SIZE;
+    unsigned key[3];
+    FileBlock::makeKey(key, file, blockNum);
+    if (fBlocks->Lookup((char const*)key) != NULL) continue; // it's already cached (or being read)
+
+    ++fNumMisses;
+    ++fNumBackgroundReads;
+    FileBlock* block = newBlock(file, blockNum);
+    block->fIsBeingRead = True;
+    ++file->fNumReadsPending;
+    fReader->readBlock(block);
+  }
+}
+
+Boolean FileBlockCache::isBeingRead(CachedFile* file, u_int64_t position, unsigned numBytes) {
+  u_int64_t endPosition = position + numBytes;
+  if (endPosition > file->fSize) endPosition = file->fSize;
+  for (u_int64_t pos = position - position%FILE_BLOCK_CACHE_BLOCK_SIZE; pos < endPosition;
+       pos += FILE_BLOCK_CACHE_BLOCK_SIZE) {
+    unsigned key[3];
+    FileBlock::makeKey(key, file, pos/FILE_BLOCK_CACHE_BLOCK_SIZE);
+    FileBlock* block = (FileBlock*)(fBlocks->Lookup((char const*)key));
+    if (block != NULL && block->fIsBeingRead) return True;
+  }
+
+  return False;
+}
+
+void FileBlockCache::completeRead(FileBlock* block, long result) {
+  CachedFile* file = block->fFile;
+  block->fIsBeingRead = False;
+  --file->fNumReadsPending;
+
+  if (result > 0) {
+    fNumBytesRead += result;
+    if ((unsigned)result < block->fSize) { // the file must have been truncated
+      fNumBytesCached -= block->fSize - result;
+      block->fSize = (unsigned)result;
+    }
+  }
+
+  if (file->fNumUsers == 0) {
+    // No one can be waiting for this file's data:
+    closeFileIfIdle(file);
+    if (result <= 0) discardBlock(block); else deleteFileIfUnused(file); // either of which might delete "file"
+    return;
+  }
+  if (result <= 0) {
+    // The read failed.  (Anyone who wants this data will try again - synchronously - using "read()".)
+    discardBlock(block);
+  }
+
+  // Tell anyone who's been waiting for this file's data - and is no longer waiting for any more of it:
+  while (1) {
+    FileReadWaiter** waiterPtr = &fWaiters;
+    while (*waiterPtr != NULL) {
+      FileReadWaiter* waiter = *waiterPtr;
+      if (waiter->fFile == file && !isBeingRead(file, waiter->fPosition, waiter->fNumBytes)) break;
+      waiterPtr = &waiter->fNext;
+    }
+    FileReadWaiter* waiter = *waiterPtr;
+    if (waiter == NULL) break;
+
+    *waiterPtr = waiter->fNext;
+    TaskFunc* onReadable = waiter->fOnReadable;
+    void* clientData = waiter->fClientData;
+    delete waiter;
+    (*onReadable)(clientData); // Note: This might change "fWaiters", so we start again from its beginning afterwards
+  }
+}
+
+void FileBlockCache::markAsMostRecentlyUsed(FileBlock* block) {
+  if (block == fMostRecentlyUsed) return;
+
+  // Unlink "block" from the list (if it's there already):
+  if (block->fPrev != NULL) block->fPrev->fNext = block->fNext;
+  if (block->fNext != NULL) block->fNext->fPrev = block->fPrev;
+  if (block == fLeastRecentlyUsed) fLeastRecentlyUsed = block->fNext;
+
+  // Then add it at the end:
+  block->fPrev = fMostRecentlyUsed;
+  block->fNext = NULL;
+  if (fMostRecentlyUsed != NULL) fMostRecentlyUsed->fNext = block;
+  fMostRecentlyUsed = block;
+  if (fLeastRecentlyUsed == NULL) fLeastRecentlyUsed = block;
+}
+
+void FileBlockCache::discardBlock(FileBlock* block) {
+  if (block->fPrev != NULL) block->fPrev->fNext = block->fNext; else fLeastRecentlyUsed = block->fNext;
+  if (block->fNext != NULL) block->fNext->fPrev = block->fPrev; else fMostRecentlyUsed = block->fPrev;
+
+  unsigned key[3];
+  block->makeKey(key);
+  fBlocks->Remove((char const*)key);
+  --fNumBlocksCached;
+  fNumBytesCached -= block->fSize;
+
+  CachedFile* file = block->fFile;
+  delete block;
+  if (--file->fNumBlocks == 0) deleteFileIfUnused(file);
+}
+
+void FileBlockCache::closeFileIfIdle(CachedFile* file) {
+  // Close our descriptor for the file once no one is using it, and no reads of it are in progress:
+  if (file->fNumUsers > 0 || file->fNumReadsPending > 0 || file->fFd < 0) return;
+
+#if !defined(__WIN32__) && !defined(_WIN32)
+  close(file->fFd);
+#endif
+  file->fFd = -1;
+}
+
+void FileBlockCache::deleteFileIfUnused(CachedFile* file) {
+  if (file->fNumUsers > 0) return;
+
+  if (file->fNumBlocks > 0) {
+    if (file->fIsCurrent || file->fNumReadsPending > 0) return; // its blocks are still useful (or being read)
+
+    // Discard the file's (now useless) blocks.  (Discarding the last one of these will get us called again.)
+    unsigned numBlocksToDiscard = file->fNumBlocks;
+    FileBlock* block = fLeastRecentlyUsed;
+    while (numBlocksToDiscard > 0 && block != NULL) {
+      FileBlock* nextBlock = block->fNext;
+      if (block->fFile == file) {
+	--numBlocksToDiscard;
+	discardBlock(block);
+      }
+      block = nextBlock;
+    }
+    return;
+  }
+
+  if (file->fIsCurrent) fFiles->Remove((char const*)file->fKey);
+  delete file;
+}
@@ -0,0 +1,143 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2018 Live Networks, Inc.  All rights reserved.
+// A cache of (aligned) blocks read from files, shared by all of the file sources in an environment
+// C++ header
+
+#ifndef _FILE_BLOCK_CACHE_HH
+#define _FILE_BLOCK_CACHE_HH
+
+#ifndef _USAGE_ENVIRONMENT_HH
+#include "UsageEnvironment.hh"
+#endif
+#ifndef _HASH_TABLE_HH
+#include "HashTable.hh"
+#endif
+#include <stdio.h>
+
+// Files are read in blocks of this size, each beginning at a multiple of this size:
+#ifndef FILE_BLOCK_CACHE_BLOCK_SIZE
+#define FILE_BLOCK_CACHE_BLOCK_SIZE 65536
+#endif
+
+// The default size of a cache (see "GenericMediaServer::setFileBlockCacheSize()"):
+#ifndef FILE_BLOCK_CACHE_DEFAULT_MAX_SIZE
+#define FILE_BLOCK_CACHE_DEFAULT_MAX_SIZE (64*1024*1024)
+#endif
+
+// Blocks are read in the background (see "readAsync()" and "readAhead()") using "io_uring" (on Linux, if the kernel
+// supports it) or else by this many I/O threads (created when the first background read is needed):
+#ifndef FILE_BLOCK_CACHE_NUM_READ_THREADS
+#define FILE_BLOCK_CACHE_NUM_READ_THREADS 4
+#endif
+
+class CachedFile; // forward
+class FileBlock; // forward
+class FileBlockReader; // forward
+class FileReadWaiter; // forward
+
+class FileBlockCache {
+public:
+  static FileBlockCache* reference(UsageEnvironment& env);
+      // returns the cache that's shared by everyone in this environment (creating it if necessary).
+      // Each call to "reference()" should be paired with a call to "release()".
+  void release();
+
+  static FileBlockCache* lookup(UsageEnvironment& env);
+      // returns the existing cache (if any) for this environment, without taking a reference to it.
+      // File sources use the cache only if it already exists (i.e., if someone - e.g., a server - has asked for it).
+
+  u_int64_t maxSize() const { return fMaxSize; }
+  void setMaxSize(u_int64_t maxSize);
+      // the maximum number of bytes that we hold (least recently used blocks are discarded to stay within this).
+      // This should be large enough to hold at least a few blocks - plus any read-ahead - for each file that's being
+      // streamed concurrently.  (Initially FILE_BLOCK_CACHE_DEFAULT_MAX_SIZE.)
+      // If 0, file sources don't use the cache at all.
+
+  CachedFile* openFile(FILE* fid);
+      // returns a handle - shared with anyone else who has opened the same (unmodified) file - through which
+      // "fid"'s data can be read, or NULL if the file can't be cached (e.g., because it's not a regular file).
+      // (The handle doesn't use "fid" itself, which may be closed at any time.)
+      // Each successful call to "openFile()" should be paired with a call to "closeFile()".
+  void closeFile(CachedFile* file);
+
+  unsigned read(CachedFile* file, u_int64_t position, unsigned char* to, unsigned numBytes);
+      // copies up to "numBytes" bytes - starting at byte "position" of the file - into "to", first reading
+      // (synchronously) any blocks that aren't already cached.  Returns the number of bytes copied, which is less
+      // than "numBytes" only at the end of the file (or on error).
+      // (Only data up to the file's size - when it was opened - is cached; anything beyond this - because the file
+      // has since grown - is read directly.)
+  static u_int64_t fileSize(CachedFile* file); // as of when the file was opened
+
+  // Reading in the background, so that "read()" doesn't have to wait for the disk:
+  Boolean isReadable(CachedFile* file, u_int64_t position, unsigned numBytes);
+      // returns True iff "read()" of these bytes can be done without waiting for any reads that are in progress
+  void readAsync(CachedFile* file, u_int64_t position, unsigned numBytes, TaskFunc* onReadable, void* clientData);
+      // begins reading (in the background) any of these bytes that aren't already cached, then - once "isReadable()"
+      // for them - calls "onReadable(clientData)" from the event loop.  (If they're readable already, then
+      // "onReadable(clientData)" is called immediately.)
+  void cancelReadAsync(void* clientData); // ensures that no pending "onReadable()" will be called with "clientData"
+  void readAhead(CachedFile* file, u_int64_t position, unsigned numBytes);
+      // begins reading (in the background) any of these bytes that aren't already cached
+
+  // Statistics:
+  u_int64_t numHits() const { return fNumHits; } // blocks that were found in the cache
+  u_int64_t numMisses() const { return fNumMisses; } // blocks that had to be read from the file
+  u_int64_t numBackgroundReads() const { return fNumBackgroundReads; } // misses that were read in the background
+  u_int64_t numBytesRead() const { return fNumBytesRead; } // from files
+  u_int64_t numBytesDelivered() const { return fNumBytesDelivered; } // to file sources
+  u_int64_t numBytesCached() const { return fNumBytesCached; }
+  unsigned numBlocksCached() const { return fNumBlocksCached; }
+  unsigned numFilesOpen() const { return fNumFilesOpen; }
+  void printStatistics(UsageEnvironment& env) const;
+
+protected:
+  FileBlockCache(UsageEnvironment& env);
+  virtual ~FileBlockCache();
+
+private:
+  friend class FileBlockReader;
+  FileBlock* lookupBlock(CachedFile* file, u_int64_t blockNum);
+  FileBlock* readBlock(CachedFile* file, u_int64_t blockNum); // synchronously; returns NULL on error
+  FileBlock* newBlock(CachedFile* file, u_int64_t blockNum);
+  void startReading(CachedFile* file, u_int64_t position, unsigned numBytes); // in the background
+  Boolean isBeingRead(CachedFile* file, u_int64_t position, unsigned numBytes);
+  void completeRead(FileBlock* block, long result); // called (from the event loop) when a background read is done
+  void markAsMostRecentlyUsed(FileBlock* block);
+  void discardBlocksIfNecessary(FileBlock* blockToKeep);
+  void discardBlock(FileBlock* block);
+  void closeFileIfIdle(CachedFile* file);
+  void deleteFileIfUnused(CachedFile* file);
+
+private:
+  UsageEnvironment& fEnv;
+  unsigned fReferenceCount;
+  u_int64_t fMaxSize;
+  HashTable* fFiles; // maps a file's (device, inode) to its (current) "CachedFile"
+  HashTable* fBlocks; // maps (file id, block number) to a "FileBlock"
+  FileBlock* fLeastRecentlyUsed; // head of a doubly-linked list of all cached blocks...
+  FileBlock* fMostRecentlyUsed; // ...and its tail
+  unsigned fNextFileId;
+  FileBlockReader* fReader; // does our background reads; created when first needed
+  Boolean fReaderIsUnavailable; // if we failed to create "fReader"
+  FileReadWaiter* fWaiters; // pending "readAsync()" calls
+  unsigned fNumFilesOpen, fNumBlocksCached;
+  u_int64_t fNumBytesCached;
+  u_int64_t fNumHits, fNumMisses, fNumBackgroundReads, fNumBytesRead, fNumBytesDelivered;
+};
+
+#endif
@@ -20,15 +20,303 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "FileServerMediaSubsession.hh"
+#include "InputFile.hh"
+#include <GroupsockHelper.hh>
+#include <sys/stat.h>
+
+#ifndef AUX_SDP_LINE_CHECK_INTERVAL
+#define AUX_SDP_LINE_CHECK_INTERVAL 10000 // microseconds
+#endif
+
+// A client that's waiting for our 'aux' SDP line to be found:
+class AuxSDPLineWaiter {
+public:
+  AuxSDPLineWaiter(TaskFunc* func, void* clientData, AuxSDPLineWaiter* next)
+    : fFunc(func), fClientData(clientData), fNext(next) {
+  }
+
+  TaskFunc* fFunc;
+  void* fClientData;
+  AuxSDPLineWaiter* fNext;
+};
+
+static char* auxSDPLineCacheDirectory = NULL;
+
+void FileServerMediaSubsession::setAuxSDPLineCacheDirectory(char const* dirName) {
+  delete[] auxSDPLineCacheDirectory;
+  auxSDPLineCacheDirectory = strDup(dirName);
+}
 
 FileServerMediaSubsession
 ::FileServerMediaSubsession(UsageEnvironment& env, char const* fileName,
 			    Boolean reuseFirstSource)
   : OnDemandServerMediaSubsession(env, reuseFirstSource),
-    fFileSize(0) {
+    fFileSize(0), fAuxSDPLine(NULL), fHaveFinishedFindingAuxSDPLine(False),
+    fDummySource(NULL), fDummyGroupsock(NULL), fDummyRTPSink(NULL), fDummyObjectsAreOurs(True), fAuxSDPLineTask(NULL),
+    fAuxSDPLineWaiters(NULL) {
   fFileName = strDup(fileName);
 }
 
 FileServerMediaSubsession::~FileServerMediaSubsession() {
+  envir().taskScheduler().unscheduleDelayedTask(fAuxSDPLineTask);
+  if (fDummyObjectsAreOurs) {
+    Medium::close(fDummyRTPSink);
+    delete fDummyGroupsock;
+    Medium::close(fDummySource);
+  } else if (fDummyRTPSink != NULL) {
+    fDummyRTPSink->stopPlaying();
+  }
+  while (fAuxSDPLineWaiters != NULL) {
+    AuxSDPLineWaiter* next = fAuxSDPLineWaiters->fNext;
+    delete fAuxSDPLineWaiters;
+    fAuxSDPLineWaiters = next;
+  }
+  delete[] fAuxSDPLine;
   delete[] (char*)fFileName;
 }
+
+Boolean FileServerMediaSubsession::auxSDPLineRequiresReadingFile() {
+  // default implementation:
+  return False;
+}
+
+Boolean FileServerMediaSubsession
+::sdpLinesAreReady(TaskFunc* whenReadyFunc, void* whenReadyClientData) {
+  if (!auxSDPLineRequiresReadingFile() || fHaveFinishedFindingAuxSDPLine) return True;
+
+  if (fDummyRTPSink == NULL) { // we're not already finding it (for another client)
+    if (lookupCachedAuxSDPLine()) {
+      fHaveFinishedFindingAuxSDPLine = True;
+      return True;
+    }
+    if (!startFindingAuxSDPLine()) return True; // we can't read the file, so "sdpLines()" will fail (quickly) anyway
+  }
+
+  // Add the caller to our list of waiters (unless it's already there):
+  AuxSDPLineWaiter* waiter;
+  for (waiter = fAuxSDPLineWaiters; waiter != NULL; waiter = waiter->fNext) {
+    if (waiter->fFunc == whenReadyFunc && waiter->fClientData == whenReadyClientData) break;
+  }
+  if (waiter == NULL) {
+    fAuxSDPLineWaiters = new AuxSDPLineWaiter(whenReadyFunc, whenReadyClientData, fAuxSDPLineWaiters);
+  }
+
+  return False;
+}
+
+void FileServerMediaSubsession
+::cancelSDPLinesNotification(TaskFunc* whenReadyFunc, void* whenReadyClientData) {
+  AuxSDPLineWaiter** waiterPtr = &fAuxSDPLineWaiters;
+  while (*waiterPtr != NULL) {
+    AuxSDPLineWaiter* waiter = *waiterPtr;
+    if (waiter->fFunc == whenReadyFunc && waiter->fClientData == whenReadyClientData) {
+      *waiterPtr = waiter->fNext;
+      delete waiter;
+    } else {
+      waiterPtr = &waiter->fNext;
+    }
+  }
+}
+
+static void setDoneFlag(void* clientData) {
+  *(char volatile*)clientData = ~0;
+}
+
+char const* FileServerMediaSubsession::getAuxSDPLine(RTPSink* rtpSink, FramedSource* inputSource) {
+  if (!auxSDPLineRequiresReadingFile()) {
+    return OnDemandServerMediaSubsession::getAuxSDPLine(rtpSink, inputSource);
+  }
+
+  if (fHaveFinishedFindingAuxSDPLine) return fAuxSDPLine;
+
+  // Our caller didn't first wait for "sdpLinesAreReady()", so we have no choice but to block
+  // (within the event loop) until "fAuxSDPLine" has been found.  Unless we're already finding it (for another
+  // client), we find it using the source and "RTPSink" that we were given, rather than by reading the file again:
+  if (fDummyRTPSink == NULL) {
+    if (lookupCachedAuxSDPLine()) {
+      fHaveFinishedFindingAuxSDPLine = True;
+      return fAuxSDPLine;
+    }
+    if (rtpSink == NULL || inputSource == NULL) return NULL;
+    startFindingAuxSDPLine(rtpSink, inputSource);
+  }
+
+  char volatile doneFlag = 0;
+  if (!sdpLinesAreReady(setDoneFlag, (void*)&doneFlag)) {
+    envir().taskScheduler().doEventLoop(&doneFlag);
+  }
+
+  return fAuxSDPLine;
+}
+
+Boolean FileServerMediaSubsession::startFindingAuxSDPLine(RTPSink* rtpSink, FramedSource* inputSource) {
+  if (rtpSink != NULL && inputSource != NULL) {
+    fDummySource = inputSource;
+    fDummyRTPSink = rtpSink;
+    fDummyObjectsAreOurs = False;
+  } else {
+    // Create 'dummy' (unused) source and "RTPSink" objects, and start reading the file into the sink
+    // until its "auxSDPLine()" becomes known:
+    unsigned estBitrate;
+    fDummySource = createNewStreamSource(0, estBitrate);
+    if (fDummySource == NULL) return False;
+
+    struct in_addr dummyAddr;
+    dummyAddr.s_addr = 0;
+    fDummyGroupsock = createGroupsock(dummyAddr, 0);
+    unsigned char rtpPayloadType = 96 + trackNumber()-1; // if dynamic
+    fDummyRTPSink = createNewRTPSink(fDummyGroupsock, rtpPayloadType, fDummySource);
+    if (fDummyRTPSink == NULL) {
+      delete fDummyGroupsock; fDummyGroupsock = NULL;
+      closeStreamSource(fDummySource); fDummySource = NULL;
+      return False;
+    }
+    fDummyObjectsAreOurs = True;
+  }
+
+  fDummyRTPSink->startPlaying(*fDummySource, afterPlayingDummy, this);
+  checkForAuxSDPLine1();
+  return True;
+}
+
+void FileServerMediaSubsession::checkForAuxSDPLine(void* clientData) {
+  FileServerMediaSubsession* subsess = (FileServerMediaSubsession*)clientData;
+  subsess->checkForAuxSDPLine1();
+}
+
+void FileServerMediaSubsession::checkForAuxSDPLine1() {
+  fAuxSDPLineTask = NULL;
+
+  char const* dasl = fDummyRTPSink->auxSDPLine();
+  if (dasl != NULL) {
+    fAuxSDPLine = strDup(dasl);
+    cacheAuxSDPLine();
+
+    // We're done, but we can't close the 'dummy' objects right now (we may have been called from within one of them):
+    fAuxSDPLineTask = envir().taskScheduler().scheduleDelayedTask(0, finishFindingAuxSDPLine, this);
+  } else {
+    // try again after a brief delay:
+    fAuxSDPLineTask = envir().taskScheduler().scheduleDelayedTask(AUX_SDP_LINE_CHECK_INTERVAL,
+								 checkForAuxSDPLine, this);
+  }
+}
+
+void FileServerMediaSubsession::afterPlayingDummy(void* clientData) {
+  // We reached the end of the file without finding the 'aux' SDP line, so we'll do without it:
+  FileServerMediaSubsession* subsess = (FileServerMediaSubsession*)clientData;
+  TaskScheduler& scheduler = subsess->envir().taskScheduler();
+
+  scheduler.unscheduleDelayedTask(subsess->fAuxSDPLineTask);
+  subsess->fAuxSDPLineTask = scheduler.scheduleDelayedTask(0, finishFindingAuxSDPLine, subsess);
+}
+
+void FileServerMediaSubsession::finishFindingAuxSDPLine(void* clientData) {
+  FileServerMediaSubsession* subsess = (FileServerMediaSubsession*)clientData;
+  subsess->finishFindingAuxSDPLine1();
+}
+
+void FileServerMediaSubsession::finishFindingAuxSDPLine1() {
+  fAuxSDPLineTask = NULL;
+  if (fDummyObjectsAreOurs) {
+    Medium::close(fDummyRTPSink);
+    closeStreamSource(fDummySource);
+  } else {
+    fDummyRTPSink->stopPlaying(); // our caller will close its source and "RTPSink" itself
+  }
+  fDummyRTPSink = NULL; fDummySource = NULL;
+  delete fDummyGroupsock; fDummyGroupsock = NULL;
+  fHaveFinishedFindingAuxSDPLine = True;
+
+  // Tell each waiting client.  (We first detach the list of waiters, in case a client's handler calls back into us.)
+  AuxSDPLineWaiter* waiter = fAuxSDPLineWaiters;
+  fAuxSDPLineWaiters = NULL;
+  while (waiter != NULL) {
+    AuxSDPLineWaiter* next = waiter->fNext;
+    TaskFunc* func = waiter->fFunc; void* clientData = waiter->fClientData;
+    delete waiter;
+    (*func)(clientData);
+    waiter = next;
+  }
+}
+
+// Our cache of 'aux' SDP lines uses one file (in "auxSDPLineCacheDirectory") per media file.  Its name is a hash of
+// the media file's name.  It contains the media file's name, its size and modification time, then the 'aux' SDP line.
+
+static char* auxSDPLineCacheFileName(char const* fileName) {
+  u_int64_t hash = 14695981039346656037ULL; // 64-bit FNV-1a
+  for (unsigned char const* p = (unsigned char const*)fileName; *p != '\0'; ++p) {
+    hash = (hash^*p)*1099511628211ULL;
+  }
+
+  char* result = new char[strlen(auxSDPLineCacheDirectory) + 30];
+  sprintf(result, "%s/%08x%08x.sdp", auxSDPLineCacheDirectory, (unsigned)(hash>>32), (unsigned)hash);
+  return result;
+}
+
+static char* auxSDPLineCacheKey(char const* fileName) {
+  // Returns NULL if the file can't be 'stat'ed:
+#ifndef _WIN32_WCE
+  struct stat sb;
+  if (stat(fileName, &sb) != 0) return NULL;
+
+  char* result = new char[strlen(fileName) + 50];
+  sprintf(result, "%s\n%llu %llu\n", fileName, (unsigned long long)sb.st_size, (unsigned long long)sb.st_mtime);
+  return result;
+#else
+  return NULL;
+#endif
+}
+
+Boolean FileServerMediaSubsession::lookupCachedAuxSDPLine() {
+  if (auxSDPLineCacheDirectory == NULL) return False;
+
+  char* key = auxSDPLineCacheKey(fFileName);
+  if (key == NULL) return False;
+  char* cacheFileName = auxSDPLineCacheFileName(fFileName);
+
+  Boolean result = False;
+  FILE* fid = fopen(cacheFileName, "rb");
+  if (fid != NULL) {
+    unsigned const maxCacheFileSize = 100000; // far larger than any real 'aux' SDP line
+    u_int64_t cacheFileSize = GetFileSize(NULL, fid);
+    if (cacheFileSize > 0 && cacheFileSize < maxCacheFileSize) {
+      char* contents = new char[cacheFileSize+1];
+      if (fread(contents, 1, cacheFileSize, fid) == cacheFileSize) {
+	contents[cacheFileSize] = '\0';
+	unsigned const keyLength = strlen(key);
+	if (cacheFileSize >= keyLength && strncmp(contents, key, keyLength) == 0) {
+	  // The cache entry is for this file, and the file hasn't changed since:
+	  delete[] fAuxSDPLine;
+	  fAuxSDPLine = strDup(&contents[keyLength]);
+	  result = True;
+	}
+      }
+      delete[] contents;
+    }
+    fclose(fid);
+  }
+
+  delete[] cacheFileName; delete[] key;
+  return result;
+}
+
+void FileServerMediaSubsession::cacheAuxSDPLine() {
+  if (auxSDPLineCacheDirectory == NULL || fAuxSDPLine == NULL) return;
+
+  char* key = auxSDPLineCacheKey(fFileName);
+  if (key == NULL) return;
+  char* cacheFileName = auxSDPLineCacheFileName(fFileName);
+
+  // Write to a temporary file first, then rename it, so that no one (e.g., another server) sees a partial cache entry:
+  char* tmpFileName = new char[strlen(cacheFileName) + 20];
+  sprintf(tmpFileName, "%s.%08x", cacheFileName, our_random32());
+  FILE* fid = fopen(tmpFileName, "wb");
+  if (fid != NULL) {
+    Boolean writeSucceeded
+      = fputs(key, fid) >= 0 && fputs(fAuxSDPLine, fid) >= 0;
+    if (fclose(fid) != 0) writeSucceeded = False;
+    if (!writeSucceeded || rename(tmpFileName, cacheFileName) != 0) remove(tmpFileName);
+  }
+
+  delete[] tmpFileName; delete[] cacheFileName; delete[] key;
+}
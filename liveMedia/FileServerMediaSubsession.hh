@@ -30,14 +30,51 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 class FileServerMediaSubsession: public OnDemandServerMediaSubsession {
+public:
+  static void setAuxSDPLineCacheDirectory(char const* dirName);
+      // If set (to an existing, writable directory), then 'aux' SDP lines that had to be found by reading a file
+      // (see "auxSDPLineRequiresReadingFile()" below) are also saved in this directory - keyed by the file's name,
+      // size and modification time - so that they don't have to be found again (e.g., after the server restarts).
+
 protected: // we're a virtual base class
   FileServerMediaSubsession(UsageEnvironment& env, char const* fileName,
 			    Boolean reuseFirstSource);
   virtual ~FileServerMediaSubsession();
 
+  virtual Boolean auxSDPLineRequiresReadingFile();
+      // Subclasses redefine this to return True if their "RTPSink"'s "auxSDPLine()" isn't known until it has
+      // been fed some of the file (e.g., H.264 "sprop-parameter-sets").  In that case, we find it by reading the
+      // file - in the background - into a 'dummy' "RTPSink".  (The default implementation returns False.)
+
+protected: // redefined virtual functions
+  virtual Boolean sdpLinesAreReady(TaskFunc* whenReadyFunc, void* whenReadyClientData);
+  virtual void cancelSDPLinesNotification(TaskFunc* whenReadyFunc, void* whenReadyClientData);
+  virtual char const* getAuxSDPLine(RTPSink* rtpSink, FramedSource* inputSource);
+
+private:
+  Boolean startFindingAuxSDPLine(RTPSink* rtpSink = NULL, FramedSource* inputSource = NULL);
+      // If "rtpSink" and "inputSource" are given, we use them (but don't close them); otherwise we create our own
+  static void checkForAuxSDPLine(void* clientData);
+  void checkForAuxSDPLine1();
+  static void afterPlayingDummy(void* clientData);
+  static void finishFindingAuxSDPLine(void* clientData);
+  void finishFindingAuxSDPLine1();
+  Boolean lookupCachedAuxSDPLine();
+  void cacheAuxSDPLine();
+
 protected:
   char const* fFileName;
   u_int64_t fFileSize; // if known
+
+private:
+  char* fAuxSDPLine;
+  Boolean fHaveFinishedFindingAuxSDPLine;
+  FramedSource* fDummySource; // used when finding "fAuxSDPLine"
+  Groupsock* fDummyGroupsock; // ditto
+  RTPSink* fDummyRTPSink; // ditto
+  Boolean fDummyObjectsAreOurs; // ditto; if False, "fDummySource" and "fDummyRTPSink" are our caller's
+  TaskToken fAuxSDPLineTask; // ditto
+  class AuxSDPLineWaiter* fAuxSDPLineWaiters; // called once "fAuxSDPLine" has been found
 };
 
 #endif
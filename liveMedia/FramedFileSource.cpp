@@ -19,12 +19,127 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "FramedFileSource.hh"
+#include "FileBlockCache.hh"
+#include "InputFile.hh"
 
 ////////// FramedFileSource //////////
 
 FramedFileSource::FramedFileSource(UsageEnvironment& env, FILE* fid)
-  : FramedSource(env), fFid(fid) {
+  : FramedSource(env), fFid(fid),
+    fFileBlockCache(NULL), fCachedFile(NULL), fFilePosition(0), fReachedEndOfFile(False), fReadAheadPosition(0) {
 }
 
 FramedFileSource::~FramedFileSource() {
+  // Note: By now, our subclass has probably closed "fFid", so we don't touch it here.
+  if (fCachedFile != NULL) {
+    fFileBlockCache->cancelReadAsync(this);
+    fFileBlockCache->closeFile(fCachedFile);
+    fFileBlockCache->release();
+  }
+}
+
+Boolean FramedFileSource::useFileBlockCache() {
+  if (fCachedFile != NULL) return True; // we're already using it
+  if (fFid == NULL) return False;
+
+  // We use our environment's cache only if someone (e.g., a server - see "GenericMediaServer::setFileBlockCacheSize()")
+  // has already created it:
+  FileBlockCache* cache = FileBlockCache::lookup(envir());
+  if (cache == NULL || cache->maxSize() == 0) return False;
+
+  int64_t const curPosition = TellFile64(fFid);
+  if (curPosition < 0) return False;
+
+  fFileBlockCache = FileBlockCache::reference(envir());
+  fCachedFile = fFileBlockCache->openFile(fFid);
+  if (fCachedFile == NULL) {
+    fFileBlockCache->release(); fFileBlockCache = NULL;
+    return False;
+  }
+
+  fFilePosition = (u_int64_t)curPosition;
+  fReachedEndOfFile = False;
+  return True;
+}
+
+void FramedFileSource::stopUsingFileBlockCache() {
+  if (fCachedFile == NULL) return;
+
+  // Leave "fFid" positioned where our cached reads left off:
+  if (fFid != NULL) SeekFile64(fFid, (int64_t)fFilePosition, SEEK_SET);
+
+  fFileBlockCache->cancelReadAsync(this);
+  fFileBlockCache->closeFile(fCachedFile); fCachedFile = NULL;
+  fFileBlockCache->release(); fFileBlockCache = NULL;
+}
+
+size_t FramedFileSource::readFromFile(unsigned char* to, unsigned numBytes) {
+  if (fCachedFile == NULL) return fread(to, 1, numBytes, fFid);
+
+  unsigned numBytesRead = fFileBlockCache->read(fCachedFile, fFilePosition, to, numBytes);
+  fFilePosition += numBytesRead;
+  if (numBytesRead < numBytes) fReachedEndOfFile = True;
+
+  return numBytesRead;
+}
+
+void FramedFileSource::seekWithinFile(int64_t offset, int whence) {
+  if (fCachedFile == NULL) {
+    SeekFile64(fFid, offset, whence);
+    return;
+  }
+
+  int64_t newPosition = offset;
+  if (whence == SEEK_CUR) {
+    newPosition += (int64_t)fFilePosition;
+  } else if (whence == SEEK_END) {
+    newPosition += (int64_t)FileBlockCache::fileSize(fCachedFile);
+  }
+  if (newPosition < 0) return; // an invalid seek, so (like "fseek()") leave our position unchanged
+
+  fFilePosition = (u_int64_t)newPosition;
+  fReachedEndOfFile = False;
+  fReadAheadPosition = 0;
+}
+
+Boolean FramedFileSource::reachedEndOfFile() const {
+  if (fCachedFile == NULL) return feof(fFid) || ferror(fFid);
+
+  return fReachedEndOfFile;
+}
+
+Boolean FramedFileSource::fileDataIsReady(unsigned numBytes) {
+  if (fCachedFile == NULL) return True;
+
+  return fFileBlockCache->isReadable(fCachedFile, fFilePosition, numBytes);
+}
+
+void FramedFileSource::awaitFileData(unsigned numBytes, TaskFunc* onReady) {
+  if (fCachedFile == NULL) {
+    (*onReady)(this);
+    return;
+  }
+
+  fFileBlockCache->readAsync(fCachedFile, fFilePosition, numBytes, onReady, this);
+}
+
+void FramedFileSource::stopAwaitingFileData() {
+  if (fCachedFile == NULL) return;
+
+  fFileBlockCache->cancelReadAsync(this);
+}
+
+void FramedFileSource::readAheadInFile(unsigned numBytes) {
+  if (fCachedFile == NULL) return;
+
+  // Ask for more data only once we've moved (at least) a block beyond where we last asked for it.
+  // (This avoids looking up the same blocks over and over again.)
+  u_int64_t const endPosition = fFilePosition + numBytes;
+  if (fReadAheadPosition > fFilePosition && endPosition < fReadAheadPosition + FILE_BLOCK_CACHE_BLOCK_SIZE) return;
+
+  u_int64_t const startPosition = fReadAheadPosition > fFilePosition ? fReadAheadPosition : fFilePosition;
+  if (endPosition > startPosition) {
+    fFileBlockCache->readAhead(fCachedFile, startPosition, (unsigned)(endPosition - startPosition));
+  }
+  fReadAheadPosition = endPosition;
 }
@@ -25,13 +25,44 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "FramedSource.hh"
 #endif
 
+class FileBlockCache; // forward
+class CachedFile; // forward
+
 class FramedFileSource: public FramedSource {
 protected:
   FramedFileSource(UsageEnvironment& env, FILE* fid); // abstract base class
   virtual ~FramedFileSource();
 
+  // Subclasses that read "fFid" only through the following functions can - by calling "useFileBlockCache()" - have
+  // their reads satisfied from a "FileBlockCache" that's shared with other sources that are reading the same file:
+  Boolean useFileBlockCache();
+      // returns True iff the cache will be used (it's not used if our environment doesn't have one, or if "fFid"
+      // isn't a regular file)
+  void stopUsingFileBlockCache(); // subsequent reads are once again done directly from "fFid"
+  Boolean fileBlockCacheIsUsed() const { return fCachedFile != NULL; }
+  size_t readFromFile(unsigned char* to, unsigned numBytes); // like "fread()"
+  void seekWithinFile(int64_t offset, int whence); // like "SeekFile64()"
+  Boolean reachedEndOfFile() const; // like "feof() || ferror()"
+
+  // When the cache is used, the file can also be read in the background, so that "readFromFile()" doesn't block:
+  Boolean fileDataIsReady(unsigned numBytes);
+      // returns True iff the next "numBytes" bytes can be read without waiting for the disk
+      // (always True if the cache isn't being used)
+  void awaitFileData(unsigned numBytes, TaskFunc* onReady);
+      // reads the next "numBytes" bytes in the background, then (from the event loop) calls "onReady(this)"
+  void stopAwaitingFileData();
+  void readAheadInFile(unsigned numBytes);
+      // begins reading (in the background) the next "numBytes" bytes, if they're not already being read
+
 protected:
   FILE* fFid;
+
+private:
+  FileBlockCache* fFileBlockCache;
+  CachedFile* fCachedFile;
+  u_int64_t fFilePosition; // when reading from the cache
+  Boolean fReachedEndOfFile; // ditto
+  u_int64_t fReadAheadPosition; // the end of the data that we've most recently asked to be read ahead
 };
 
 #endif
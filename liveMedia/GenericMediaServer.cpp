@@ -20,10 +20,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "GenericMediaServer.hh"
+#include "PacketBufferPool.hh"
+#include "FileBlockCache.hh"
 #include <GroupsockHelper.hh>
-#if defined(__WIN32__) || defined(_WIN32) || defined(_QNX4)
-#define snprintf _snprintf
-#endif
 
 ////////// GenericMediaServer implementation //////////
 
@@ -61,15 +60,14 @@ void GenericMediaServer::removeServerMediaSession(char const* streamName) {
 void GenericMediaServer::closeAllClientSessionsForServerMediaSession(ServerMediaSession* serverMediaSession) {
   if (serverMediaSession == NULL) return;
   
-  HashTable::Iterator* iter = HashTable::Iterator::create(*fClientSessions);
+  IdTable::Iterator iter(*fClientSessions);
   GenericMediaServer::ClientSession* clientSession;
-  char const* key; // dummy
-  while ((clientSession = (GenericMediaServer::ClientSession*)(iter->next(key))) != NULL) {
+  u_int32_t sessionId; // dummy
+  while ((clientSession = (GenericMediaServer::ClientSession*)(iter.next(sessionId))) != NULL) {
     if (clientSession->fOurServerMediaSession == serverMediaSession) {
       delete clientSession;
     }
   }
-  delete iter;
 }
 
 void GenericMediaServer::closeAllClientSessionsForServerMediaSession(char const* streamName) {
@@ -93,18 +91,37 @@ GenericMediaServer
   : Medium(env),
     fServerSocket(ourSocket), fServerPort(ourPort), fReclamationSeconds(reclamationSeconds),
     fServerMediaSessions(HashTable::create(STRING_HASH_KEYS)),
-    fClientConnections(HashTable::create(ONE_WORD_HASH_KEYS)),
-    fClientSessions(HashTable::create(STRING_HASH_KEYS)) {
+    fClientConnections(new IdTable), fPreviousClientConnectionId(0),
+    fBufferPool(PacketBufferPool::reference(env)), fFileBlockCache(NULL),
+    fClientSessions(new IdTable) {
   ignoreSigPipeOnSocket(fServerSocket); // so that clients on the same host that are killed don't also kill us
   
-  // Arrange to handle connections from others:
-  env.taskScheduler().turnOnBackgroundReadHandling(fServerSocket, incomingConnectionHandler, this);
+  // Arrange to handle connections from others.  (Our socket might also be shared - e.g., as a "dup()" - by servers
+  // running in other threads, so ask that only one of us be woken for each new connection.)
+  env.taskScheduler().setBackgroundHandling(fServerSocket, SOCKET_READABLE|SOCKET_EXCLUSIVE, incomingConnectionHandler, this);
 }
 
 GenericMediaServer::~GenericMediaServer() {
   // Turn off background read handling:
   envir().taskScheduler().turnOffBackgroundReadHandling(fServerSocket);
   ::closeSocket(fServerSocket);
+
+  fBufferPool->release(); // note: our subclass's "cleanup()" will already have deleted our client connections
+  if (fFileBlockCache != NULL) fFileBlockCache->release();
+}
+
+void GenericMediaServer::setFileBlockCacheSize(u_int64_t maxSize) {
+  if (maxSize == 0) {
+    if (fFileBlockCache != NULL) {
+      // Stop new file sources from using the cache.  (Existing ones keep their own reference to it.)
+      fFileBlockCache->setMaxSize(0);
+      fFileBlockCache->release(); fFileBlockCache = NULL;
+    }
+    return;
+  }
+
+  if (fFileBlockCache == NULL) fFileBlockCache = FileBlockCache::reference(envir());
+  fFileBlockCache->setMaxSize(maxSize);
 }
 
 void GenericMediaServer::cleanup() {
@@ -209,9 +226,15 @@ void GenericMediaServer::incomingConnectionHandlerOnSocket(int serverSocket) {
 
 GenericMediaServer::ClientConnection
 ::ClientConnection(GenericMediaServer& ourServer, int clientSocket, struct sockaddr_in clientAddr)
-  : fOurServer(ourServer), fOurSocket(clientSocket), fClientAddr(clientAddr) {
-  // Add ourself to our 'client connections' table:
-  fOurServer.fClientConnections->Add((char const*)this, this);
+  : fOurServer(ourServer), fOurSocket(clientSocket), fClientAddr(clientAddr),
+    fRequestBuffer(NULL), fRequestBufferSize(0), fRequestBufferAllocatedSize(0),
+    fResponseBuffer(NULL), fResponseBufferSize(0), fResponseBufferAllocatedSize(0),
+    fRecursionCount(0) {
+  // Add ourself to our 'client connections' table, using the next unused connection id:
+  do {
+    fOurConnectionId = ++fOurServer.fPreviousClientConnectionId;
+  } while (fOurServer.fClientConnections->Lookup(fOurConnectionId) != NULL);
+  fOurServer.fClientConnections->Add(fOurConnectionId, this);
   
   // Arrange to handle incoming requests:
   resetRequestBuffer();
@@ -221,9 +244,11 @@ GenericMediaServer::ClientConnection
 
 GenericMediaServer::ClientConnection::~ClientConnection() {
   // Remove ourself from the server's 'client connections' hash table before we go:
-  fOurServer.fClientConnections->Remove((char const*)this);
+  fOurServer.fClientConnections->Remove(fOurConnectionId);
   
   closeSockets();
+  fOurServer.freeConnectionBuffer(fRequestBuffer, fRequestBufferAllocatedSize);
+  fOurServer.freeConnectionBuffer(fResponseBuffer, fResponseBufferAllocatedSize);
 }
 
 void GenericMediaServer::ClientConnection::closeSockets() {
@@ -242,13 +267,75 @@ void GenericMediaServer::ClientConnection::incomingRequestHandler(void* instance
 void GenericMediaServer::ClientConnection::incomingRequestHandler() {
   struct sockaddr_in dummy; // 'from' address, meaningless in this case
   
-  int bytesRead = readSocket(envir(), fOurSocket, &fRequestBuffer[fRequestBytesAlreadySeen], fRequestBufferBytesLeft, dummy);
+  prepareRequestBuffer();
+
+  // Reading enough data to fill our buffer means that the request is too big for us.  But if our buffer can
+  // still grow, then leave (at least) one byte unread, so that a full - but not yet full-size - buffer isn't
+  // mistaken for this:
+  unsigned maxBytesToRead = fRequestBufferBytesLeft;
+  if (fRequestBufferSize < REQUEST_BUFFER_SIZE && maxBytesToRead > 1) --maxBytesToRead;
+
+  int bytesRead = readSocket(envir(), fOurSocket, &fRequestBuffer[fRequestBytesAlreadySeen], maxBytesToRead, dummy);
   handleRequestBytes(bytesRead);
 }
 
 void GenericMediaServer::ClientConnection::resetRequestBuffer() {
   fRequestBytesAlreadySeen = 0;
-  fRequestBufferBytesLeft = sizeof fRequestBuffer;
+  fRequestBufferBytesLeft = fRequestBufferSize;
+}
+
+Boolean GenericMediaServer::ClientConnection::prepareRequestBuffer(unsigned numBytesWanted) {
+  if (fRequestBuffer == NULL) {
+    fRequestBufferSize = REQUEST_BUFFER_INITIAL_SIZE;
+    if (fRequestBufferSize > REQUEST_BUFFER_SIZE) fRequestBufferSize = REQUEST_BUFFER_SIZE;
+    fRequestBuffer = fOurServer.allocateConnectionBuffer(fRequestBufferSize, fRequestBufferAllocatedSize);
+    fRequestBufferBytesLeft = fRequestBufferSize - fRequestBytesAlreadySeen;
+  }
+
+  if (fRequestBufferBytesLeft <= numBytesWanted && fRecursionCount == 0) {
+    // Grow our buffer (by repeated doubling, up to REQUEST_BUFFER_SIZE bytes), copying the data that's already there:
+    unsigned newSize = fRequestBufferSize;
+    while (newSize < REQUEST_BUFFER_SIZE && newSize - fRequestBytesAlreadySeen <= numBytesWanted) newSize *= 2;
+    if (newSize > REQUEST_BUFFER_SIZE) newSize = REQUEST_BUFFER_SIZE;
+
+    if (newSize > fRequestBufferSize) {
+      if (newSize <= fRequestBufferAllocatedSize) {
+	// Common case: The buffer that we already have (rounded up to its pool size) is big enough:
+	fRequestBufferSize = newSize;
+      } else {
+	unsigned newAllocatedSize;
+	unsigned char* newBuffer = fOurServer.allocateConnectionBuffer(newSize, newAllocatedSize);
+	memmove(newBuffer, fRequestBuffer, fRequestBytesAlreadySeen);
+	fOurServer.freeConnectionBuffer(fRequestBuffer, fRequestBufferAllocatedSize);
+
+	fRequestBuffer = newBuffer;
+	fRequestBufferSize = newSize;
+	fRequestBufferAllocatedSize = newAllocatedSize;
+      }
+      fRequestBufferBytesLeft = fRequestBufferSize - fRequestBytesAlreadySeen;
+    }
+  }
+
+  return fRequestBufferBytesLeft > numBytesWanted;
+}
+
+void GenericMediaServer::ClientConnection::prepareResponseBuffer() {
+  if (fResponseBuffer != NULL) return;
+
+  fResponseBufferSize = RESPONSE_BUFFER_SIZE;
+  fResponseBuffer = fOurServer.allocateConnectionBuffer(fResponseBufferSize, fResponseBufferAllocatedSize);
+  fResponseBuffer[0] = '\0';
+}
+
+void GenericMediaServer::ClientConnection::releaseBuffers() {
+  fOurServer.freeConnectionBuffer(fRequestBuffer, fRequestBufferAllocatedSize);
+  fRequestBuffer = NULL;
+  fRequestBufferSize = fRequestBufferAllocatedSize = 0;
+  resetRequestBuffer();
+
+  fOurServer.freeConnectionBuffer(fResponseBuffer, fResponseBufferAllocatedSize);
+  fResponseBuffer = NULL;
+  fResponseBufferSize = fResponseBufferAllocatedSize = 0;
 }
 
 
@@ -265,10 +352,8 @@ GenericMediaServer::ClientSession::~ClientSession() {
   // Turn off any liveness checking:
   envir().taskScheduler().unscheduleDelayedTask(fLivenessCheckTask);
 
-  // Remove ourself from the server's 'client sessions' hash table before we go:
-  char sessionIdStr[8+1];
-  sprintf(sessionIdStr, "%08X", fOurSessionId);
-  fOurServer.fClientSessions->Remove(sessionIdStr);
+  // Remove ourself from the server's 'client sessions' table before we go:
+  fOurServer.fClientSessions->Remove(fOurSessionId);
   
   if (fOurServerMediaSession != NULL) {
     fOurServerMediaSession->decrementReferenceCount();
@@ -313,32 +398,74 @@ void GenericMediaServer::ClientSession::livenessTimeoutTask(ClientSession* clien
 
 GenericMediaServer::ClientSession* GenericMediaServer::createNewClientSessionWithId() {
   u_int32_t sessionId;
-  char sessionIdStr[8+1];
 
   // Choose a random (unused) 32-bit integer for the session id
   // (it will be encoded as a 8-digit hex number).  (We avoid choosing session id 0,
   // because that has a special use by some servers.)
   do {
     sessionId = (u_int32_t)our_random32();
-    snprintf(sessionIdStr, sizeof sessionIdStr, "%08X", sessionId);
-  } while (sessionId == 0 || lookupClientSession(sessionIdStr) != NULL);
+  } while (sessionId == 0 || lookupClientSession(sessionId) != NULL);
 
   ClientSession* clientSession = createNewClientSession(sessionId);
-  if (clientSession != NULL) fClientSessions->Add(sessionIdStr, clientSession);
+  if (clientSession != NULL) fClientSessions->Add(sessionId, clientSession);
 
   return clientSession;
 }
 
 GenericMediaServer::ClientSession*
 GenericMediaServer::lookupClientSession(u_int32_t sessionId) {
-  char sessionIdStr[8+1];
-  snprintf(sessionIdStr, sizeof sessionIdStr, "%08X", sessionId);
-  return lookupClientSession(sessionIdStr);
+  return (GenericMediaServer::ClientSession*)fClientSessions->Lookup(sessionId);
 }
 
 GenericMediaServer::ClientSession*
 GenericMediaServer::lookupClientSession(char const* sessionIdStr) {
-  return (GenericMediaServer::ClientSession*)fClientSessions->Lookup(sessionIdStr);
+  if (sessionIdStr == NULL) return NULL;
+
+  return lookupClientSession(sessionIdStr, strlen(sessionIdStr));
+}
+
+GenericMediaServer::ClientSession*
+GenericMediaServer::lookupClientSession(char const* sessionIdStr, unsigned sessionIdStrLen) {
+  u_int32_t sessionId;
+  if (!parseSessionIdString(sessionIdStr, sessionIdStrLen, sessionId)) return NULL;
+
+  return lookupClientSession(sessionId);
+}
+
+Boolean GenericMediaServer
+::parseSessionIdString(char const* sessionIdStr, unsigned sessionIdStrLen, u_int32_t& sessionId) {
+  // Accept only the exact "%08X" form that we use (so that - as before - e.g., a lower-case
+  // version of a session id doesn't match):
+  if (sessionIdStr == NULL || sessionIdStrLen != 8) return False;
+
+  u_int32_t result = 0;
+  for (unsigned i = 0; i < 8; ++i) {
+    char c = sessionIdStr[i];
+    if (c >= '0' && c <= '9') result = (result<<4)|(c-'0');
+    else if (c >= 'A' && c <= 'F') result = (result<<4)|(c-'A'+10);
+    else return False;
+  }
+
+  sessionId = result;
+  return True;
+}
+
+unsigned char* GenericMediaServer::allocateConnectionBuffer(unsigned size, unsigned& allocatedSize) {
+  if (size <= PacketBufferPool::maxBufferSize()) return fBufferPool->allocate(size, allocatedSize);
+
+  // This buffer is too big for our pool (because REQUEST_BUFFER_SIZE or RESPONSE_BUFFER_SIZE has been redefined):
+  allocatedSize = size;
+  return new unsigned char[size];
+}
+
+void GenericMediaServer::freeConnectionBuffer(unsigned char* buffer, unsigned allocatedSize) {
+  if (buffer == NULL) return;
+
+  if (allocatedSize <= PacketBufferPool::maxBufferSize()) {
+    fBufferPool->deallocate(buffer, allocatedSize);
+  } else {
+    delete[] buffer;
+  }
 }
 
 
@@ -28,14 +28,23 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _SERVER_MEDIA_SESSION_HH
 #include "ServerMediaSession.hh"
 #endif
+#ifndef _ID_TABLE_HH
+#include "IdTable.hh"
+#endif
 
 #ifndef REQUEST_BUFFER_SIZE
 #define REQUEST_BUFFER_SIZE 20000 // for incoming requests
 #endif
+#ifndef REQUEST_BUFFER_INITIAL_SIZE
+#define REQUEST_BUFFER_INITIAL_SIZE 2048 // a connection's request buffer starts at this size, growing (up to REQUEST_BUFFER_SIZE) if needed
+#endif
 #ifndef RESPONSE_BUFFER_SIZE
 #define RESPONSE_BUFFER_SIZE 20000
 #endif
 
+class PacketBufferPool; // forward
+class FileBlockCache; // forward
+
 class GenericMediaServer: public Medium {
 public:
   void addServerMediaSession(ServerMediaSession* serverMediaSession);
@@ -67,6 +76,12 @@ public:
 
   unsigned numClientSessions() const { return fClientSessions->numEntries(); }
 
+  void setFileBlockCacheSize(u_int64_t maxSize);
+      // Has the files that we stream (from sources that are created from now on) be read through a "FileBlockCache" of
+      // (at most) "maxSize" bytes, so that concurrent streams of the same file share the data that's read (and the disk
+      // is read in the background).  The cache is shared by everything in our environment.
+      // By default, there is no cache; "maxSize" == 0 stops using it again.
+
 protected:
   GenericMediaServer(UsageEnvironment& env, int ourSocket, Port ourPort,
 		     unsigned reclamationSeconds);
@@ -97,16 +112,31 @@ public: // should be protected, but some old compilers complain otherwise
     virtual void handleRequestBytes(int newBytesRead) = 0;
     void resetRequestBuffer();
 
+    // Our request and response buffers are taken from a pool only while we need them (i.e., while a request is being
+    // received and handled), so that idle connections don't each hold (up to) REQUEST_BUFFER_SIZE+RESPONSE_BUFFER_SIZE bytes:
+    Boolean prepareRequestBuffer(unsigned numBytesWanted = 1);
+        // Makes sure that we have a request buffer, with room for at least "numBytesWanted" more bytes (plus a trailing '\0'),
+        // growing it if necessary.  (We never grow - i.e., move - the buffer while "fRecursionCount" > 0.)
+        // Returns False if there's still not enough room.
+    void prepareResponseBuffer();
+    void releaseBuffers(); // must be called only when "fRequestBytesAlreadySeen" == 0
+
   protected:
     friend class GenericMediaServer;
     friend class ClientSession;
     friend class RTSPServer; // needed to make some broken Windows compilers work; remove this in the future when we end support for Windows
     GenericMediaServer& fOurServer;
+    u_int32_t fOurConnectionId; // our key in the server's 'client connections' table
     int fOurSocket;
     struct sockaddr_in fClientAddr;
-    unsigned char fRequestBuffer[REQUEST_BUFFER_SIZE];
-    unsigned char fResponseBuffer[RESPONSE_BUFFER_SIZE];
+    unsigned char* fRequestBuffer; // NULL if we're not currently using one
+    unsigned fRequestBufferSize; // the part of "fRequestBuffer" that we use (at most REQUEST_BUFFER_SIZE bytes)
+    unsigned fRequestBufferAllocatedSize;
+    unsigned char* fResponseBuffer; // NULL if we're not currently using one
+    unsigned fResponseBufferSize; // RESPONSE_BUFFER_SIZE (or 0, if "fResponseBuffer" is NULL)
+    unsigned fResponseBufferAllocatedSize;
     unsigned fRequestBytesAlreadySeen, fRequestBufferBytesLeft;
+    unsigned fRecursionCount; // the number of (nested) "handleRequestBytes()" calls that are currently in progress
   };
 
   // The state of an individual client session (using one or more sequential TCP connections) handled by a server:
@@ -140,6 +170,16 @@ protected:
   // Lookup a "ClientSession" object by sessionId (integer, and string):
   ClientSession* lookupClientSession(u_int32_t sessionId);
   ClientSession* lookupClientSession(char const* sessionIdStr);
+      // "sessionIdStr" must be the session id's 8-digit (upper-case) hex encoding - the form that we send in responses
+
+  ClientSession* lookupClientSession(char const* sessionIdStr, unsigned sessionIdStrLen);
+      // ditto, except that "sessionIdStr" need not be '\0'-terminated
+
+  static Boolean parseSessionIdString(char const* sessionIdStr, unsigned sessionIdStrLen, u_int32_t& sessionId);
+
+  // Allocate and free the buffers that our client connections use while handling requests:
+  unsigned char* allocateConnectionBuffer(unsigned size, unsigned& allocatedSize);
+  void freeConnectionBuffer(unsigned char* buffer, unsigned allocatedSize);
 
   // An iterator over our "ServerMediaSession" objects:
   class ServerMediaSessionIterator {
@@ -161,8 +201,13 @@ protected:
 
 private:
   HashTable* fServerMediaSessions; // maps 'stream name' strings to "ServerMediaSession" objects
-  HashTable* fClientConnections; // the "ClientConnection" objects that we're using
-  HashTable* fClientSessions; // maps 'session id' strings to "ClientSession" objects
+  // Note: If we run several event loops (each with its own server), then each server has its own
+  // tables of client connections and sessions, so these tables are never shared between threads.
+  IdTable* fClientConnections; // maps connection ids to the "ClientConnection" objects that we're using
+  u_int32_t fPreviousClientConnectionId;
+  PacketBufferPool* fBufferPool; // shared with everyone else in our environment
+  FileBlockCache* fFileBlockCache; // ditto; NULL unless "setFileBlockCacheSize()" was called
+  IdTable* fClientSessions; // maps session ids to "ClientSession" objects
 };
 
 // A data structure used for optional user/password authentication:
@@ -38,6 +38,15 @@ public:
 
   Boolean lastFragmentCompletedNALUnit() const { return fLastFragmentCompletedNALUnit; }
 
+  void setDeliverByReference(Boolean deliverByReference) { fDeliverByReference = deliverByReference; }
+      // If True, we don't copy each fragment to our client; instead, our client calls "takeFragmentData()" to find it
+      // (in our input buffer, where it remains valid until our client next asks us for data).
+  unsigned char* takeFragmentData() {
+    unsigned char* fragmentData = fFragmentData;
+    fFragmentData = NULL;
+    return fragmentData;
+  }
+
 private: // redefined virtual functions:
   virtual void doGetNextFrame();
   virtual void doStopGettingFrames();
@@ -52,6 +61,7 @@ private:
                           struct timeval presentationTime,
                           unsigned durationInMicroseconds);
   void reset();
+  void deliverFragment(unsigned char* fragmentData, unsigned fragmentSize);
 
 private:
   int fHNumber;
@@ -62,6 +72,8 @@ private:
   unsigned fCurDataOffset;
   unsigned fSaveNumTruncatedBytes;
   Boolean fLastFragmentCompletedNALUnit;
+  Boolean fDeliverByReference;
+  unsigned char* fFragmentData; // used only if "fDeliverByReference"
 };
 
 
@@ -75,6 +87,11 @@ H264or5VideoRTPSink
 		      u_int8_t const* pps, unsigned ppsSize)
   : VideoRTPSink(env, RTPgs, rtpPayloadFormat, 90000, hNumber == 264 ? "H264" : "H265"),
     fHNumber(hNumber), fOurFragmenter(NULL), fFmtpSDPLine(NULL) {
+#ifndef DONT_USE_ZERO_COPY_H264_OR_5_PACKETIZATION
+  // Our fragmenter holds each NAL unit (or fragment) contiguously - ready to be sent - so send it from there,
+  // rather than copying it into our output buffer first:
+  setZeroCopyPacketization(True);
+#endif
   if (vps != NULL) {
     fVPSSize = vpsSize;
     fVPS = new u_int8_t[fVPSSize];
@@ -121,6 +138,7 @@ Boolean H264or5VideoRTPSink::continuePlaying() {
   } else {
     fOurFragmenter->reassignInputSource(fSource);
   }
+  ((H264or5Fragmenter*)fOurFragmenter)->setDeliverByReference(zeroCopyPacketization());
   fSource = fOurFragmenter;
 
   // Then call the parent class's implementation:
@@ -149,6 +167,12 @@ void H264or5VideoRTPSink::doSpecialFrameHandling(unsigned /*fragmentationOffset*
   setTimestamp(framePresentationTime);
 }
 
+unsigned char* H264or5VideoRTPSink::referencedFrameData() {
+  if (fOurFragmenter == NULL) return NULL;
+
+  return ((H264or5Fragmenter*)fOurFragmenter)->takeFragmentData();
+}
+
 Boolean H264or5VideoRTPSink
 ::frameCanAppearAfterPacketStart(unsigned char const* /*frameStart*/,
 				 unsigned /*numBytesInFrame*/) const {
@@ -163,7 +187,8 @@ H264or5Fragmenter::H264or5Fragmenter(int hNumber,
 				     unsigned inputBufferMax, unsigned maxOutputPacketSize)
   : FramedFilter(env, inputSource),
     fHNumber(hNumber),
-    fInputBufferSize(inputBufferMax+1), fMaxOutputPacketSize(maxOutputPacketSize) {
+    fInputBufferSize(inputBufferMax+1), fMaxOutputPacketSize(maxOutputPacketSize),
+    fDeliverByReference(False), fFragmentData(NULL) {
   fInputBuffer = new unsigned char[fInputBufferSize];
   reset();
 }
@@ -201,7 +226,7 @@ void H264or5Fragmenter::doGetNextFrame() {
     fLastFragmentCompletedNALUnit = True; // by default
     if (fCurDataOffset == 1) { // case 1 or 2
       if (fNumValidDataBytes - 1 <= fMaxSize) { // case 1
-	memmove(fTo, &fInputBuffer[1], fNumValidDataBytes - 1);
+	deliverFragment(&fInputBuffer[1], fNumValidDataBytes - 1);
 	fFrameSize = fNumValidDataBytes - 1;
 	fCurDataOffset = fNumValidDataBytes;
       } else { // case 2
@@ -217,7 +242,7 @@ void H264or5Fragmenter::doGetNextFrame() {
 	  fInputBuffer[1] = fInputBuffer[2]; // Payload header (2nd byte)
 	  fInputBuffer[2] = 0x80 | nal_unit_type; // FU header (with S bit)
 	}
-	memmove(fTo, fInputBuffer, fMaxSize);
+	deliverFragment(fInputBuffer, fMaxSize);
 	fFrameSize = fMaxSize;
 	fCurDataOffset += fMaxSize - 1;
 	fLastFragmentCompletedNALUnit = False;
@@ -249,7 +274,7 @@ void H264or5Fragmenter::doGetNextFrame() {
 	fInputBuffer[fCurDataOffset-1] |= 0x40; // set the E bit in the FU header
 	fNumTruncatedBytes = fSaveNumTruncatedBytes;
       }
-      memmove(fTo, &fInputBuffer[fCurDataOffset-numExtraHeaderBytes], numBytesToSend);
+      deliverFragment(&fInputBuffer[fCurDataOffset-numExtraHeaderBytes], numBytesToSend);
       fFrameSize = numBytesToSend;
       fCurDataOffset += numBytesToSend - numExtraHeaderBytes;
     }
@@ -296,4 +321,13 @@ void H264or5Fragmenter::reset() {
   fNumValidDataBytes = fCurDataOffset = 1;
   fSaveNumTruncatedBytes = 0;
   fLastFragmentCompletedNALUnit = True;
+  fFragmentData = NULL;
+}
+
+void H264or5Fragmenter::deliverFragment(unsigned char* fragmentData, unsigned fragmentSize) {
+  if (fDeliverByReference) {
+    fFragmentData = fragmentData;
+  } else {
+    memmove(fTo, fragmentData, fragmentSize);
+  }
 }
@@ -45,6 +45,7 @@ private: // redefined virtual functions:
                                       unsigned numBytesInFrame,
                                       struct timeval framePresentationTime,
                                       unsigned numRemainingBytes);
+  virtual unsigned char* referencedFrameData();
   virtual Boolean frameCanAppearAfterPacketStart(unsigned char const* frameStart,
 						 unsigned numBytesInFrame) const;
 
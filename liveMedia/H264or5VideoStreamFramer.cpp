@@ -971,15 +971,11 @@ unsigned H264or5VideoStreamParser::parse() {
 #ifdef DEBUG
       unsigned const trailingNALUnitSize = remainingDataSize;
 #endif
-      while (remainingDataSize > 0) {
-	u_int8_t nextByte = get1Byte();
-	if (!fHaveSeenFirstByteOfNALUnit) {
-	  fFirstByteOfNALUnit = nextByte;
-	  fHaveSeenFirstByteOfNALUnit = True;
-	}
-	saveByte(nextByte);
-	--remainingDataSize;
+      if (remainingDataSize > 0 && !fHaveSeenFirstByteOfNALUnit) {
+	fFirstByteOfNALUnit = test1Byte();
+	fHaveSeenFirstByteOfNALUnit = True;
       }
+      saveValidBytes(remainingDataSize);
 
 #ifdef DEBUG
       if (fHNumber == 264) {
@@ -1003,16 +999,17 @@ unsigned H264or5VideoStreamParser::parse() {
 	fHaveSeenFirstByteOfNALUnit = True;
       }
       while (next4Bytes != 0x00000001 && (next4Bytes&0xFFFFFF00) != 0x00000100) {
-	// We save at least some of "next4Bytes".
-	if ((unsigned)(next4Bytes&0xFF) > 1) {
-	  // Common case: 0x00000001 or 0x000001 definitely doesn't begin anywhere in "next4Bytes", so we save all of it:
-	  save4Bytes(next4Bytes);
-	  skipBytes(4);
-	} else {
-	  // Save the first byte, and continue testing the rest:
-	  saveByte(next4Bytes>>24);
-	  skipBytes(1);
+	// Save (in one go) all of the input that we already have, up until the next 0x00000001 or 0x000001.
+	// (If we don't find one, we save all but the last 3 bytes, which might be the start of one.)
+	unsigned numBytesToSave = numBytesBeforeStartCodePrefix();
+	unsigned const numRemainingBytes = numRemainingValidBytes(); // >= 4
+	if (numBytesToSave < numRemainingBytes && remainingValidBytes()[numBytesToSave-1] == 0) {
+	  --numBytesToSave; // the start code is 0x00000001
 	}
+	if (numBytesToSave > numRemainingBytes - 3) numBytesToSave = numRemainingBytes - 3;
+	// Assert: numBytesToSave > 0, because "next4Bytes" didn't begin with a start code
+
+	saveValidBytes(numBytesToSave);
 	setParseState(); // ensures forward progress
 	next4Bytes = test4Bytes();
       }
@@ -0,0 +1,155 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2018 Live Networks, Inc.  All rights reserved.
+// A table that maps 32-bit integer ids (e.g., client session ids) to objects,
+// stored in a single array (using 'open addressing'), rather than in linked buckets.
+// Implementation
+
+#include "IdTable.hh"
+#include <string.h>
+
+#define INITIAL_NUM_SLOTS_BITS 4
+
+// Each entry lives in the first free slot at or after its 'home' slot ('linear probing').
+// We keep the table at most 3/4 full, so there's always at least one empty slot, and so
+// that runs of consecutive full slots stay short.
+
+IdTable::IdTable()
+  : fSlots(NULL), fNumSlotsBits(0), fNumEntries(0) {
+  rebuild(INITIAL_NUM_SLOTS_BITS);
+}
+
+IdTable::~IdTable() {
+  delete[] fSlots;
+}
+
+void* IdTable::Add(u_int32_t id, void* value) {
+  if (value == NULL) return NULL;
+
+  unsigned index = findIndex(id);
+  void* oldValue = fSlots[index].value;
+  if (oldValue == NULL) {
+    // This is a new entry.  First, make sure that there'll still be room in the table:
+    if (4*(fNumEntries+1) > 3*(1u<<fNumSlotsBits)) {
+      rebuild(fNumSlotsBits+1);
+      index = findIndex(id);
+    }
+    fSlots[index].id = id;
+    ++fNumEntries;
+  }
+  fSlots[index].value = value;
+
+  return oldValue == value ? NULL : oldValue;
+}
+
+Boolean IdTable::Remove(u_int32_t id) {
+  unsigned const mask = (1u<<fNumSlotsBits) - 1;
+  unsigned hole = findIndex(id);
+  if (fSlots[hole].value == NULL) return False; // not found
+
+  fSlots[hole].value = NULL;
+  --fNumEntries;
+
+  // Move back any following entries (in the same run of full slots) that can no longer be found
+  // from their 'home' slot, because of the hole that we've just made.  (This avoids the need for
+  // 'tombstones', so lookups never get slower as entries come and go.)
+  for (unsigned index = (hole+1)&mask; fSlots[index].value != NULL; index = (index+1)&mask) {
+    unsigned home = homeIndex(fSlots[index].id);
+    // The entry can move to "hole" only if "home" is not cyclically within (hole, index]:
+    if (((index - home)&mask) >= ((index - hole)&mask)) {
+      fSlots[hole] = fSlots[index];
+      fSlots[index].value = NULL;
+      hole = index;
+    }
+  }
+
+  return True;
+}
+
+void* IdTable::Lookup(u_int32_t id) const {
+  return fSlots[findIndex(id)].value;
+}
+
+void* IdTable::getFirst() const {
+  if (fNumEntries == 0) return NULL;
+
+  for (unsigned i = 0; ; ++i) {
+    if (fSlots[i].value != NULL) return fSlots[i].value;
+  }
+}
+
+unsigned IdTable::homeIndex(u_int32_t id) const {
+  // Use 'Fibonacci hashing', so that ids that are allocated sequentially (rather than randomly)
+  // still get spread across the table:
+  return (u_int32_t)(id*2654435769U) >> (32 - fNumSlotsBits);
+}
+
+unsigned IdTable::findIndex(u_int32_t id) const {
+  unsigned const mask = (1u<<fNumSlotsBits) - 1;
+  unsigned index = homeIndex(id);
+  while (fSlots[index].value != NULL && fSlots[index].id != id) index = (index+1)&mask;
+
+  return index;
+}
+
+void IdTable::rebuild(unsigned newNumSlotsBits) {
+  Slot* oldSlots = fSlots;
+  unsigned const oldNumSlots = oldSlots == NULL ? 0 : 1u<<fNumSlotsBits;
+
+  fNumSlotsBits = newNumSlotsBits;
+  unsigned const newNumSlots = 1u<<fNumSlotsBits;
+  fSlots = new Slot[newNumSlots];
+  memset(fSlots, 0, newNumSlots*sizeof (Slot));
+
+  for (unsigned i = 0; i < oldNumSlots; ++i) {
+    if (oldSlots[i].value != NULL) fSlots[findIndex(oldSlots[i].id)] = oldSlots[i];
+  }
+  delete[] oldSlots;
+}
+
+
+////////// IdTable::Iterator implementation //////////
+
+// We visit slots in *decreasing* order, starting just below an empty slot.  That way, if the
+// entry that we've just returned gets removed, then any entries that "Remove()" moves back
+// (into lower slots) are ones that we've already visited, so nothing gets skipped or repeated.
+
+IdTable::Iterator::Iterator(IdTable const& table)
+  : fTable(table), fNextIndex(0), fNumSlotsLeft(0) {
+  unsigned const mask = (1u<<fTable.fNumSlotsBits) - 1;
+  unsigned emptyIndex = 0;
+  while (fTable.fSlots[emptyIndex].value != NULL) ++emptyIndex; // there's always an empty slot
+
+  fNextIndex = (emptyIndex-1)&mask;
+  fNumSlotsLeft = mask; // i.e., all slots other than "emptyIndex"
+}
+
+void* IdTable::Iterator::next(u_int32_t& id) {
+  unsigned const mask = (1u<<fTable.fNumSlotsBits) - 1;
+  while (fNumSlotsLeft > 0) {
+    IdTable::Slot const& slot = fTable.fSlots[fNextIndex];
+    fNextIndex = (fNextIndex-1)&mask;
+    --fNumSlotsLeft;
+
+    if (slot.value != NULL) {
+      id = slot.id;
+      return slot.value;
+    }
+  }
+
+  return NULL;
+}
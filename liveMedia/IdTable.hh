@@ -0,0 +1,78 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2018 Live Networks, Inc.  All rights reserved.
+// A table that maps 32-bit integer ids (e.g., client session ids) to objects,
+// stored in a single array (using 'open addressing'), rather than in linked buckets.
+// C++ header
+
+#ifndef _ID_TABLE_HH
+#define _ID_TABLE_HH
+
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+#ifndef _NET_COMMON_H
+#include "NetCommon.h"
+#endif
+
+class IdTable {
+public:
+  IdTable();
+  virtual ~IdTable();
+
+  void* Add(u_int32_t id, void* value);
+      // "value" must not be NULL.  Returns the old value if different, otherwise NULL.
+  Boolean Remove(u_int32_t id);
+  void* Lookup(u_int32_t id) const; // returns NULL if not found
+  unsigned numEntries() const { return fNumEntries; }
+  Boolean IsEmpty() const { return fNumEntries == 0; }
+
+  void* getFirst() const;
+      // Returns an entry in the table (or NULL if the table is empty).
+      // (This is useful for deleting each entry in the table, if the entry's destructor also removes itself from the table.)
+
+  // Used to iterate through the members of the table:
+  class Iterator {
+  public:
+    Iterator(IdTable const& table);
+
+    void* next(u_int32_t& id); // returns NULL if none
+        // It's OK to "Remove()" the entry that was most recently returned - but not to "Add()" new entries -
+        // while iterating.
+
+  private:
+    IdTable const& fTable;
+    unsigned fNextIndex, fNumSlotsLeft;
+  };
+
+private:
+  unsigned homeIndex(u_int32_t id) const;
+  unsigned findIndex(u_int32_t id) const; // returns the index of "id"'s slot, or of the empty slot where it would go
+  void rebuild(unsigned newNumSlotsBits);
+
+private:
+  friend class Iterator;
+  struct Slot {
+    u_int32_t id;
+    void* value; // NULL iff the slot is empty
+  };
+  Slot* fSlots;
+  unsigned fNumSlotsBits; // the number of slots is 2^fNumSlotsBits
+  unsigned fNumEntries;
+};
+
+#endif
@@ -319,6 +319,22 @@ static void rsfscanf(unsigned char **fi, unsigned int* v) {
 #define HTN     34
 #define MXOFF   250
 
+// To decode most codes in one step, we look up the next HUFFMAN_LOOKUP_BITS bits in a table
+// (built from the decoder tree).  If these bits contain a whole code - and its sign bits, and
+// it needs no 'linbits' - then the table gives us the (signed) values directly.  Otherwise, it
+// tells us how many bits to skip, and the point in the tree that they lead to (a leaf, or - for
+// codes longer than HUFFMAN_LOOKUP_BITS - an inner node), from which we continue as before.
+#ifndef HUFFMAN_LOOKUP_BITS
+#define HUFFMAN_LOOKUP_BITS 8
+#endif
+
+struct hufflookup {
+  unsigned char numBits;	/*number of bits used			*/
+  unsigned char isComplete;	/*whether x,y,v,w are the final values	*/
+  unsigned short point;	/*resulting position in the decoder tree*/
+  signed char x, y, v, w;	/*decoded values (if "isComplete")	*/
+};
+
 struct huffcodetab {
   char tablename[3];	/*string, containing table_description	*/
   unsigned int xlen; 	/*max. x-index+			      	*/
@@ -330,12 +346,93 @@ struct huffcodetab {
   unsigned char *hlen;	/*pointer to array[xlen][ylen]		*/
   unsigned char(*val)[2];/*decoder tree				*/
   unsigned int treelen;	/*length of decoder tree		*/
+  struct hufflookup *lookup;/*array[1<<HUFFMAN_LOOKUP_BITS]	*/
 };
 
 static struct huffcodetab rsf_ht[HTN]; // array of all huffcodetable headers
 				/* 0..31 Huffman code table 0..31	*/
 				/* 32,33 count1-tables			*/
 
+/* the point in the decoder tree that we reach by following 'bit' from 'point' */
+static unsigned nextTreePoint(struct huffcodetab const* h, unsigned point, unsigned bit) {
+  while (h->val[point][bit] >= MXOFF) point += h->val[point][bit];
+  return point + h->val[point][bit];
+}
+
+static Boolean isQuadTable(struct huffcodetab const* h) {
+  return h->tablename[0] == '3' && (h->tablename[1] == '2' || h->tablename[1] == '3');
+}
+
+static void fillHuffmanLookupTable(struct huffcodetab* h, unsigned point,
+				   unsigned bits, unsigned numBits) {
+  if (point >= h->treelen) {
+    // This shouldn't happen (with a valid tree); decode these codes one bit at a time instead:
+    point = 0;
+    numBits = 0;
+  } else if (h->val[point][0] != 0 && numBits < HUFFMAN_LOOKUP_BITS) {
+    // We're not yet at a leaf, so continue with both branches:
+    fillHuffmanLookupTable(h, nextTreePoint(h, point, 0), bits<<1, numBits+1);
+    fillHuffmanLookupTable(h, nextTreePoint(h, point, 1), (bits<<1)|1, numBits+1);
+    return;
+  }
+
+  // Every lookup table index that begins with "bits" leads to "point".  If this is a leaf,
+  // then see whether the rest of each index also holds all of the sign bits that follow:
+  unsigned const numUnusedBits = HUFFMAN_LOOKUP_BITS - numBits;
+  int values[4] = {0, 0, 0, 0}; // in the order that their sign bits appear: (v,w,)x,y
+  unsigned numValues = 0;
+  Boolean canComplete = False;
+  if (numBits > 0 && h->val[point][0] == 0) {
+    unsigned char xy = h->val[point][1];
+    if (isQuadTable(h)) {
+      values[0] = (xy>>3)&1; values[1] = (xy>>2)&1; values[2] = (xy>>1)&1; values[3] = xy&1;
+      numValues = 4;
+      canComplete = True;
+    } else {
+      values[0] = xy>>4; values[1] = xy&0xf;
+      numValues = 2;
+      canComplete = h->linbits == 0
+	|| ((unsigned)values[0] != h->xlen-1 && (unsigned)values[1] != h->ylen-1);
+    }
+  }
+  unsigned numSignBits = 0;
+  for (unsigned k = 0; k < numValues; ++k) {
+    if (values[k] != 0) ++numSignBits;
+  }
+  if (numSignBits > numUnusedBits) canComplete = False;
+
+  for (unsigned i = 0; i < (1u<<numUnusedBits); ++i) {
+    struct hufflookup& entry = h->lookup[(bits<<numUnusedBits)|i];
+    entry.point = point;
+    entry.x = entry.y = entry.v = entry.w = 0;
+    if (!canComplete) {
+      entry.numBits = numBits;
+      entry.isComplete = False;
+      continue;
+    }
+
+    int signedValues[4];
+    unsigned signBitNum = numUnusedBits;
+    for (unsigned k = 0; k < numValues; ++k) {
+      signedValues[k] = values[k];
+      if (values[k] != 0 && ((i>>--signBitNum)&1) != 0) signedValues[k] = -values[k];
+    }
+    if (numValues == 4) {
+      entry.v = signedValues[0]; entry.w = signedValues[1];
+      entry.x = signedValues[2]; entry.y = signedValues[3];
+    } else {
+      entry.x = signedValues[0]; entry.y = signedValues[1];
+    }
+    entry.numBits = numBits + numSignBits;
+    entry.isComplete = True;
+  }
+}
+
+static void buildHuffmanLookupTable(struct huffcodetab* h) {
+  h->lookup = new struct hufflookup[1<<HUFFMAN_LOOKUP_BITS];
+  fillHuffmanLookupTable(h, 0, 0, 0);
+}
+
 /* read the huffman decoder table */
 static int read_decoder_table(unsigned char* fi) {
   int n,i,nn,t;
@@ -344,6 +441,7 @@ static int read_decoder_table(unsigned char* fi) {
   for (n=0;n<HTN;n++) {
     rsf_ht[n].table = NULL;
     rsf_ht[n].hlen = NULL;
+    rsf_ht[n].lookup = NULL;
 
     /* .table number treelen xlen ylen linbits */
     do {
@@ -388,6 +486,8 @@ static int read_decoder_table(unsigned char* fi) {
       while ((line[0] == '#') || (line[0] < ' ') ) {
         rsf_getline(line,99,&fi);
       }
+      /* (The lookup table isn't shared, because it depends on our own "linbits".) */
+      if (rsf_ht[n].treelen > 0) buildHuffmanLookupTable(&rsf_ht[n]);
     }
     else if (strcmp(command,".treedata")==0) {
       rsf_ht[n].ref  = -1;
@@ -407,6 +507,7 @@ static int read_decoder_table(unsigned char* fi) {
         rsf_ht[n].val[i][1]=(unsigned char)v1;
       }
       rsf_getline(line,99,&fi); /* read the rest of the line */
+      if (rsf_ht[n].treelen > 0) buildHuffmanLookupTable(&rsf_ht[n]);
     }
     else {
 #ifdef DEBUG
@@ -615,16 +716,25 @@ static int rsf_huffman_decoder(BitVector& bv,
 			/* unsigned */ int *y,  // returns decoded y value
 			       int* v, int* w) {
   HUFFBITS level;
-  unsigned point = 0;
+  unsigned point;
   int error = 1;
-  level     = dmask;
   *x = *y = *v = *w = 0;
   if (h->val == NULL) return 2;
 
   /* table 0 needs no bits */
   if (h->treelen == 0) return 0;
 
-  /* Lookup in Huffman table. */
+  /* Lookup in Huffman table: first, (usually) the whole code at once, */
+  /* then - if it's longer than that - the rest of it, bit by bit.     */
+
+  struct hufflookup const& entry = h->lookup[bv.testBits(HUFFMAN_LOOKUP_BITS)];
+  bv.skipBits(entry.numBits);
+  if (entry.isComplete) {
+    *x = entry.x; *y = entry.y; *v = entry.v; *w = entry.w;
+    return 0;
+  }
+  point = entry.point;
+  level = dmask >> entry.numBits;
 
   do {
     if (h->val[point][0]==0) {   /*end of tree*/
@@ -634,14 +744,7 @@ static int rsf_huffman_decoder(BitVector& bv,
       error = 0;
       break;
     }
-    if (bv.get1Bit()) {
-      while (h->val[point][1] >= MXOFF) point += h->val[point][1];
-      point += h->val[point][1];
-    }
-    else {
-      while (h->val[point][0] >= MXOFF) point += h->val[point][0];
-      point += h->val[point][0];
-    }
+    point = nextTreePoint(h, point, bv.get1Bit());
     level >>= 1;
   } while (level  || (point < h->treelen) );
 /////  } while (level  || (point < rsf_ht->treelen) );
@@ -656,8 +759,7 @@ static int rsf_huffman_decoder(BitVector& bv,
 
   /* Process sign encodings for quadruples tables. */
 
-  if (h->tablename[0] == '3'
-      && (h->tablename[1] == '2' || h->tablename[1] == '3')) {
+  if (isQuadTable(h)) {
      *v = (*y>>3) & 1;
      *w = (*y>>2) & 1;
      *x = (*y>>1) & 1;
@@ -761,39 +863,21 @@ unsigned MP3HuffmanEncode(MP3SideInfo::gr_info_s_t const* gr,
    return i;
 }
 
-static Boolean lookupHuffmanTableEntry(struct huffcodetab const* h,
-				       HUFFBITS bits, unsigned bitsLength,
-				       unsigned char& xy) {
-  unsigned point = 0;
-  unsigned mask = 1;
-  unsigned numBitsTestedSoFar = 0;
-  do {
-    if (h->val[point][0]==0) { // end of tree
-      xy = h->val[point][1];
-      if (h->hlen[xy] == 0) { // this entry hasn't already been used
-	h->table[xy] = bits;
-	h->hlen[xy] = bitsLength;
-	return True;
-      } else { // this entry has already been seen
-	return False;
-      }
-    }
+static void addHuffmanEncodingTableEntries(struct huffcodetab* h, unsigned point,
+					   HUFFBITS bits, unsigned bitsLength) {
+  if (point >= h->treelen || bitsLength > 8*SIZEOF_HUFFBITS) return; // shouldn't happen
 
-    if (numBitsTestedSoFar++ == bitsLength) {
-      // We don't yet have enough bits for this prefix
-      return False;
+  if (h->val[point][0]==0) { // end of tree
+    unsigned char xy = h->val[point][1];
+    if (h->hlen[xy] == 0 || bitsLength < h->hlen[xy]) { // use the shortest code for each value
+      h->table[xy] = bits;
+      h->hlen[xy] = bitsLength;
     }
-    if (bits&mask) {
-      while (h->val[point][1] >= MXOFF) point += h->val[point][1];
-      point += h->val[point][1];
-    } else {
-      while (h->val[point][0] >= MXOFF) point += h->val[point][0];
-      point += h->val[point][0];
-    }
-    mask <<= 1;
-  } while (mask || (point < h->treelen));
+    return;
+  }
 
-  return False;
+  addHuffmanEncodingTableEntries(h, nextTreePoint(h, point, 0), bits<<1, bitsLength+1);
+  addHuffmanEncodingTableEntries(h, nextTreePoint(h, point, 1), (bits<<1)|1, bitsLength+1);
 }
 
 static void buildHuffmanEncodingTable(struct huffcodetab* h) {
@@ -804,37 +888,13 @@ static void buildHuffmanEncodingTable(struct huffcodetab* h) {
     h->table[i] = 0; h->hlen[i] = 0;
   }
 
-  // Look up entries for each possible bit sequence length:
-  unsigned maxNumEntries = h->xlen * h->ylen;
-  unsigned numEntries = 0;
-  unsigned powerOf2 = 1;
-  for (unsigned bitsLength = 1;
-       bitsLength <= 8*SIZEOF_HUFFBITS; ++bitsLength) {
-    powerOf2 *= 2;
-    for (HUFFBITS bits = 0; bits < powerOf2; ++bits) {
-      // Find the table value - if any - for 'bits' (length 'bitsLength'):
-      unsigned char xy;
-      if (lookupHuffmanTableEntry(h, bits, bitsLength, xy)) {
-	++numEntries;
-	if (numEntries == maxNumEntries) return; // we're done
-      }
-    }
-  }
-#ifdef DEBUG
-  fprintf(stderr, "Didn't find enough entries!\n"); // shouldn't happen
-#endif
+  // Walk the decoder tree, noting the code (bits, and length) that leads to each value:
+  addHuffmanEncodingTableEntries(h, 0, 0, 0);
 }
 
 static void lookupXYandPutBits(BitVector& bv, struct huffcodetab const* h,
 			       unsigned char xy) {
-  HUFFBITS bits = h->table[xy];
-  unsigned bitsLength = h->hlen[xy];
-
-  // Note that "bits" is in reverse order, so read them from right-to-left:
-  while (bitsLength-- > 0) {
-    bv.put1Bit(bits&0x00000001);
-    bits >>= 1;
-  }
+  bv.putBits(h->table[xy], h->hlen[xy]);
 }
 
 static void putLinbits(BitVector& bv, struct huffcodetab const* h,
@@ -877,8 +937,7 @@ static void rsf_huffman_encoder(BitVector& bv,
 #endif
 #endif
 
-  if (h->tablename[0] == '3'
-      && (h->tablename[1] == '2' || h->tablename[1] == '3')) {// quad tables
+  if (isQuadTable(h)) {// quad tables
     if (x < 0) { xIsNeg = True; x = -x; }
     if (y < 0) { yIsNeg = True; y = -y; }
     if (v < 0) { vIsNeg = True; v = -v; }
@@ -128,7 +128,7 @@ MPEG2IFrameIndexFromTransportStream
   : FramedFilter(env, inputSource),
     fIsH264(False), fIsH265(False),
     fInputTransportPacketCounter((unsigned)-1), fClosureNumber(0), fLastContinuityCounter(~0),
-    fFirstPCR(0.0), fLastPCR(0.0), fHaveSeenFirstPCR(False),
+    fInitialPCR(0.0), fFirstPCR(0.0), fLastPCR(0.0), fHaveSeenFirstPCR(False),
     fPMT_PID(0x10), fVideo_PID(0xE0), // default values
     fParseBufferSize(PARSE_BUFFER_SIZE),
     fParseBufferFrameStart(0), fParseBufferParseEnd(4), fParseBufferDataEnd(0),
@@ -222,7 +222,7 @@ void MPEG2IFrameIndexFromTransportStream
     pcr += pcrExt/27000000.0f;
 
     if (!fHaveSeenFirstPCR) {
-      fFirstPCR = pcr;
+      fInitialPCR = fFirstPCR = pcr;
       fHaveSeenFirstPCR = True;
     } else if (pcr < fLastPCR) {
       // The PCR timestamp has gone backwards.  Display a warning about this
@@ -362,6 +362,25 @@ void MPEG2IFrameIndexFromTransportStream
   }
 }
 
+void MPEG2IFrameIndexFromTransportStream
+::noteTables(unsigned char* patPacket, unsigned char* pmtPacket) {
+  unsigned char* pkt[2] = { patPacket, pmtPacket };
+  for (unsigned i = 0; i < 2; ++i) {
+    u_int8_t adaptation_field_control = (pkt[i][3]&0x30)>>4;
+    u_int8_t totalHeaderSize = adaptation_field_control <= 1 ? 4 : 5 + pkt[i][4];
+    if (totalHeaderSize >= TRANSPORT_PACKET_SIZE) continue;
+
+    if (i == 0) analyzePAT(&pkt[i][totalHeaderSize], TRANSPORT_PACKET_SIZE-totalHeaderSize);
+    else analyzePMT(&pkt[i][totalHeaderSize], TRANSPORT_PACKET_SIZE-totalHeaderSize);
+  }
+}
+
+void MPEG2IFrameIndexFromTransportStream::notePrecedingPCRs(float firstPCR, float lastPCR) {
+  fInitialPCR = fFirstPCR = firstPCR;
+  fLastPCR = lastPCR;
+  fHaveSeenFirstPCR = True;
+}
+
 Boolean MPEG2IFrameIndexFromTransportStream::deliverIndexRecord() {
   IndexRecord* head = fHeadIndexRecord;
   if (head == NULL) return False;
@@ -430,7 +449,6 @@ Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
 
   // Inspect the frame's initial 4-byte code, to make sure it starts with a system code:
   if (fParseBufferDataEnd-fParseBufferFrameStart < 4) return False; // not enough data
-  unsigned numInitialBadBytes = 0;
   unsigned char const* p = &fParseBuffer[fParseBufferFrameStart];
   if (!(p[0] == 0 && p[1] == 0 && p[2] == 1)) {
     // There's no system code at the beginning.  Parse until we find one:
@@ -441,7 +459,7 @@ Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
     unsigned char nextCode;
     if (!parseToNextCode(nextCode)) return False;
 
-    numInitialBadBytes = fParseBufferParseEnd - fParseBufferFrameStart;
+    markAsJunk(fParseBufferParseEnd - fParseBufferFrameStart);
     fParseBufferFrameStart = fParseBufferParseEnd;
     fParseBufferParseEnd += 4; // skip over the code that we just saw
     p = &fParseBuffer[fParseBufferFrameStart];
@@ -554,19 +572,18 @@ Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
 
   // There is now a parsed 'frame', from "fParseBufferFrameStart"
   // to "fParseBufferParseEnd". Tag the corresponding index records to note this:
-  unsigned frameSize = fParseBufferParseEnd - fParseBufferFrameStart + numInitialBadBytes;
+  unsigned frameSize = fParseBufferParseEnd - fParseBufferFrameStart;
 #ifdef DEBUG
   envir() << "parsed " << recordTypeStr[curRecordType] << "; length "
 	  << frameSize << "\n";
 #endif
-  for (IndexRecord* r = fHeadIndexRecord; ; r = r->next()) {
-    if (numInitialBadBytes >= r->size()) {
-      r->recordType() = RECORD_JUNK;
-      numInitialBadBytes -= r->size();
-    } else {
-      r->recordType() = curRecordType;
-    }
-    if (r == fHeadIndexRecord) r->setFirstFlag();
+  IndexRecord* firstRecord = fHeadIndexRecord;
+  while (firstRecord->recordType() == RECORD_JUNK && firstRecord != fTailIndexRecord) {
+    firstRecord = firstRecord->next(); // skip over any records for bad bytes (that we've already noted)
+  }
+  for (IndexRecord* r = firstRecord; ; r = r->next()) {
+    r->recordType() = curRecordType;
+    if (r == firstRecord) r->setFirstFlag();
     // indicates that this is the first record for this frame
 
     if (r->size() > frameSize) {
@@ -626,6 +643,29 @@ Boolean MPEG2IFrameIndexFromTransportStream
   return False; // no luck this time
 }
 
+void MPEG2IFrameIndexFromTransportStream::markAsJunk(unsigned numBytes) {
+  // Tag (as junk) the index records for the first "numBytes" bytes of unparsed data, splitting a record if necessary.
+  // (We do this as soon as we find the bad bytes, because the frame that follows them might not get parsed until later.)
+  IndexRecord* r = fHeadIndexRecord;
+  while (numBytes > 0 && r != NULL) {
+    if (r->recordType() == RECORD_UNPARSED) {
+      if (r->size() > numBytes) {
+	// Move the rest of this record's data to a new record that comes afterwards:
+	IndexRecord* newRecord
+	  = new IndexRecord(r->startOffset() + numBytes, r->size() - numBytes,
+			    r->transportPacketNumber(), r->pcr());
+	newRecord->addAfter(r);
+	if (fTailIndexRecord == r) fTailIndexRecord = newRecord;
+	r->size() = numBytes;
+      }
+      r->recordType() = RECORD_JUNK;
+      numBytes -= r->size();
+    }
+    if (r == fTailIndexRecord) break;
+    r = r->next();
+  }
+}
+
 void MPEG2IFrameIndexFromTransportStream::compactParseBuffer() {
 #ifdef DEBUG
   envir() << "Compacting parse buffer: [" << fParseBufferFrameStart
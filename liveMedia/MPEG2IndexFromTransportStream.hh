@@ -40,6 +40,22 @@ public:
   static MPEG2IFrameIndexFromTransportStream*
   createNew(UsageEnvironment& env, FramedSource* inputSource);
 
+  void noteTables(unsigned char* patPacket, unsigned char* pmtPacket);
+      // Gives us the stream's PAT and PMT (each a complete Transport Stream packet) in advance; used when indexing
+      // part of a Transport Stream that doesn't begin with these tables
+  void notePrecedingPCRs(float firstPCR, float lastPCR);
+      // Gives us - in advance - the stream's first PCR, and the last PCR before the data that we'll be reading, so that
+      // our index records get the same PCRs as if we'd read the stream from its start; used (like "noteTables()") when
+      // indexing part of a Transport Stream
+
+  // Used to combine the index records from separately-indexed (consecutive) parts of the same Transport Stream:
+  Boolean haveSeenPCR() const { return fHaveSeenFirstPCR; }
+  float firstPCR() const { return fInitialPCR; } // the first PCR that we saw (as is), or were given
+  float lastPCR() const { return fLastPCR; } // the most recent PCR that we saw (as is)
+  float lastRelativePCR() const { return fLastPCR - fFirstPCR; }
+      // the most recent PCR, as it gets delivered in index records (i.e., relative to the start, and adjusted for
+      // any PCR timestamps that went backwards)
+
 protected:
   MPEG2IFrameIndexFromTransportStream(UsageEnvironment& env,
 				      FramedSource* inputSource);
@@ -69,6 +85,7 @@ private:
   Boolean deliverIndexRecord();
   Boolean parseFrame();
   Boolean parseToNextCode(unsigned char& nextCode);
+  void markAsJunk(unsigned numBytes);
   void compactParseBuffer();
   void addToTail(IndexRecord* newIndexRecord);
 
@@ -78,7 +95,7 @@ private:
   unsigned long fInputTransportPacketCounter;
   unsigned fClosureNumber;
   u_int8_t fLastContinuityCounter;
-  float fFirstPCR, fLastPCR;
+  float fInitialPCR, fFirstPCR, fLastPCR;
   Boolean fHaveSeenFirstPCR;
   u_int16_t fPMT_PID, fVideo_PID;
       // Note: We assume: 1 program per Transport Stream; 1 video stream per program
@@ -138,6 +138,18 @@ void MPEG2TransportFileServerMediaSubsession
   OnDemandServerMediaSubsession::setStreamScale(clientSessionId, streamToken, scale);
 }
 
+Boolean MPEG2TransportFileServerMediaSubsession
+::getStreamFileRange(unsigned clientSessionId, void* /*streamToken*/,
+		     char const*& fileName, u_int64_t& startByte, u_int64_t& numBytes) {
+  // We know the byte range only if we have an index file (which "seekStream()" used to compute it):
+  if (fIndexFile == NULL) return False;
+  ClientTrickPlayState* client = lookupClient(clientSessionId);
+  if (client == NULL || !client->getFileRange(startByte, numBytes)) return False;
+
+  fileName = fFileName;
+  return True;
+}
+
 void MPEG2TransportFileServerMediaSubsession
 ::deleteStream(unsigned clientSessionId, void*& streamToken) {
   if (fIndexFile != NULL) { // we support 'trick play'
@@ -228,7 +240,7 @@ ClientTrickPlayState::ClientTrickPlayState(MPEG2TransportStreamIndexFile* indexF
     fTrickModeFilter(NULL), fTrickPlaySource(NULL),
     fFramer(NULL),
     fScale(1.0f), fNextScale(1.0f), fNPT(0.0f),
-    fTSRecordNum(0), fIxRecordNum(0) {
+    fTSRecordNum(0), fIxRecordNum(0), fNumTSRecordsToStream(0) {
 }
 
 unsigned long ClientTrickPlayState::updateStateFromNPT(double npt, double streamDuration) {
@@ -280,6 +292,7 @@ unsigned long ClientTrickPlayState::updateStateFromNPT(double npt, double stream
   }
   fFramer->setNumTSPacketsToStream(numTSRecordsToStream);
   fFramer->setPCRLimit(pcrLimit);
+  fNumTSRecordsToStream = numTSRecordsToStream;
 
   return numTSRecordsToStream;
 }
@@ -306,6 +319,8 @@ void ClientTrickPlayState::updateStateOnScaleChange() {
     // And generate a Transport Stream from this:
     fTrickPlaySource = MPEG2TransportStreamFromESSource::createNew(env);
     fTrickPlaySource->addNewVideoSource(fTrickModeFilter, fIndexFile->mpegVersion());
+    fTrickPlaySource->setPreferredFrameSize(TRANSPORT_PACKETS_PER_NETWORK_PACKET*TRANSPORT_PACKET_SIZE);
+      // like our (non-'trick play') input source, deliver just one network packet's worth of data at a time
 
     fFramer->changeInputSource(fTrickPlaySource);
   } else {
@@ -337,6 +352,14 @@ void ClientTrickPlayState::updateStateOnPlayChange(Boolean reverseToPreviousVSH)
   }
 }
 
+Boolean ClientTrickPlayState::getFileRange(u_int64_t& startByte, u_int64_t& numBytes) {
+  if (fScale != 1.0f || fNextScale != 1.0f || fTrickPlaySource != NULL || fNumTSRecordsToStream == 0) return False;
+
+  startByte = (u_int64_t)fTSRecordNum*TRANSPORT_PACKET_SIZE;
+  numBytes = (u_int64_t)fNumTSRecordsToStream*TRANSPORT_PACKET_SIZE;
+  return True;
+}
+
 void ClientTrickPlayState::setSource(MPEG2TransportStreamFramer* framer) {
   fFramer = framer;
   fOriginalTransportStreamSource = (ByteStreamFileSource*)(framer->inputSource());
@@ -72,6 +72,8 @@ private: // redefined virtual functions
   virtual void pauseStream(unsigned clientSessionId, void* streamToken);
   virtual void seekStream(unsigned clientSessionId, void* streamToken, double& seekNPT, double streamDuration, u_int64_t& numBytes);
   virtual void setStreamScale(unsigned clientSessionId, void* streamToken, float scale);
+  virtual Boolean getStreamFileRange(unsigned clientSessionId, void* streamToken,
+				     char const*& fileName, u_int64_t& startByte, u_int64_t& numBytes);
   virtual void deleteStream(unsigned clientSessionId, void*& streamToken);
 
   // The virtual functions that are usually implemented by "ServerMediaSubsession"s:
@@ -114,6 +116,10 @@ public:
   void setNextScale(float nextScale) { fNextScale = nextScale; }
   Boolean areChangingScale() const { return fNextScale != fScale; }
 
+  Boolean getFileRange(u_int64_t& startByte, u_int64_t& numBytes);
+      // returns True iff we're streaming (at 1x) from the original Transport Stream file, and the amount to stream
+      // has been limited (by "updateStateFromNPT()"); if so, sets "startByte" and "numBytes" accordingly
+
 protected:
   void updateTSRecordNum();
   void reseekOriginalTransportStreamSource();
@@ -126,6 +132,7 @@ protected:
   MPEG2TransportStreamFramer* fFramer;
   float fScale, fNextScale, fNPT;
   unsigned long fTSRecordNum, fIxRecordNum;
+  unsigned long fNumTSRecordsToStream; // as set by "updateStateFromNPT()"
 };
 
 #endif
@@ -21,23 +21,239 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 //
 // Implementation
 
+
 #include "MPEG2TransportStreamIndexFile.hh"
 #include "InputFile.hh"
 
+////////// MPEG2TransportStreamIndexData //////////
+
+// The contents of an index file.  We read these into memory once, and share them among all of the
+// "MPEG2TransportStreamIndexFile"s (in the same environment) that use the same file, so that
+// seeking - by each 'trick play' client - doesn't require any file I/O.
+// (Note that we read the file, rather than "mmap()"ing it, because an index file might later get
+// truncated - e.g., by re-running the indexer - while we're still using it.)
+
+class MPEG2TransportStreamIndexData {
+public:
+  static MPEG2TransportStreamIndexData* reference(UsageEnvironment& env, char const* indexFileName);
+      // returns the contents of the index file (reading them, if we haven't already done so, or if the
+      // file has since changed).  Each call to "reference()" should be paired with a call to "release()".
+  void release();
+
+  unsigned long numRecords() const { return fNumRecords; }
+  u_int8_t const* record(unsigned long recordNum) const { return &fRecords[recordNum*INDEX_RECORD_SIZE]; }
+  int mpegVersion() const { return fMPEGVersion; }
+
+  unsigned long cleanPointAtOrBefore(unsigned long recordNum) const;
+      // returns the index record from which playing should start, in order to (cleanly) play "recordNum"
+
+private:
+  MPEG2TransportStreamIndexData(UsageEnvironment& env, char const* indexFileName,
+				u_int64_t fileSize, time_t modificationTime);
+  virtual ~MPEG2TransportStreamIndexData();
+
+  void readRecords();
+  void findCleanPoints();
+  Boolean isCleanPoint(unsigned long recordNum, unsigned long& startRecordNum) const;
+
+private:
+  UsageEnvironment& fEnv;
+  char* fFileName;
+  unsigned fReferenceCount;
+  u_int64_t fFileSize;
+  time_t fModificationTime;
+      // "fFileSize" and "fModificationTime" are used to tell whether the file has changed since we read it
+  u_int8_t* fRecords;
+  unsigned long fNumRecords;
+  int fMPEGVersion;
+
+  // A table of each 'clean point' - the start of a 'frame' from which a decoder can cleanly resume handling the stream -
+  // in increasing order of record number:
+  struct CleanPoint {
+    unsigned long recordNum;
+    unsigned long startRecordNum; // usually the same as "recordNum", but see the 'GOP hack' below
+  }* fCleanPoints;
+  unsigned long fNumCleanPoints;
+};
+
+static void getFileStatus(char const* fileName, u_int64_t& fileSize, time_t& modificationTime) {
+  fileSize = 0; modificationTime = 0; // by default
+#if !defined(_WIN32_WCE)
+  struct stat sb;
+  if (stat(fileName, &sb) == 0) {
+    fileSize = sb.st_size;
+    modificationTime = sb.st_mtime;
+  }
+#else
+  fileSize = GetFileSize(fileName, NULL);
+#endif
+}
+
+static int mpegVersionFromRecordType(u_int8_t recordType) {
+  u_int8_t const recordTypeWithoutStartBit = recordType&~0x80;
+  if (recordTypeWithoutStartBit >= 1 && recordTypeWithoutStartBit <= 4) return 2;
+  else if (recordTypeWithoutStartBit >= 5 && recordTypeWithoutStartBit <= 10) return 5;
+      // represents H.264
+  else if (recordTypeWithoutStartBit >= 11 && recordTypeWithoutStartBit <= 16) return 6;
+      // represents H.265
+  return 0; // unknown
+}
+
+MPEG2TransportStreamIndexData* MPEG2TransportStreamIndexData
+::reference(UsageEnvironment& env, char const* indexFileName) {
+  u_int64_t fileSize; time_t modificationTime;
+  getFileStatus(indexFileName, fileSize, modificationTime);
+
+  _Tables* ourTables = _Tables::getOurTables(env);
+  if (ourTables->tsIndexDataTable == NULL) {
+    ourTables->tsIndexDataTable = HashTable::create(STRING_HASH_KEYS);
+  }
+  HashTable* table = (HashTable*)(ourTables->tsIndexDataTable);
+
+  MPEG2TransportStreamIndexData* indexData = (MPEG2TransportStreamIndexData*)(table->Lookup(indexFileName));
+  if (indexData == NULL
+      || indexData->fFileSize != fileSize || indexData->fModificationTime != modificationTime) {
+    // We haven't read this file yet, or else it has changed since we read it (e.g., because it's still being written).
+    // (Anyone who is still using the old contents will continue to use them, until they release them.)
+    indexData = new MPEG2TransportStreamIndexData(env, indexFileName, fileSize, modificationTime);
+    table->Add(indexFileName, indexData);
+  }
+
+  ++indexData->fReferenceCount;
+  return indexData;
+}
+
+void MPEG2TransportStreamIndexData::release() {
+  if (--fReferenceCount > 0) return;
+
+  // We're no longer being used, so delete ourself (and perhaps the table - and the '_Tables' structure - that points to us):
+  _Tables* ourTables = _Tables::getOurTables(fEnv, False);
+  if (ourTables != NULL && ourTables->tsIndexDataTable != NULL) {
+    HashTable* table = (HashTable*)(ourTables->tsIndexDataTable);
+    if (table->Lookup(fFileName) == this) { // we might already have been replaced by newer contents
+      table->Remove(fFileName);
+      if (table->IsEmpty()) {
+	delete table;
+	ourTables->tsIndexDataTable = NULL;
+	ourTables->reclaimIfPossible();
+      }
+    }
+  }
+  delete this;
+}
+
+unsigned long MPEG2TransportStreamIndexData::cleanPointAtOrBefore(unsigned long recordNum) const {
+  // Binary search for the last clean point whose "recordNum" is <= "recordNum":
+  unsigned long lo = 0, hi = fNumCleanPoints;
+  while (lo < hi) {
+    unsigned long mid = lo + (hi-lo)/2;
+    if (fCleanPoints[mid].recordNum <= recordNum) lo = mid+1; else hi = mid;
+  }
+
+  return lo == 0 ? 0 /* use record 0 anyway */ : fCleanPoints[lo-1].startRecordNum;
+}
+
+MPEG2TransportStreamIndexData
+::MPEG2TransportStreamIndexData(UsageEnvironment& env, char const* indexFileName,
+				u_int64_t fileSize, time_t modificationTime)
+  : fEnv(env), fFileName(strDup(indexFileName)), fReferenceCount(0),
+    fFileSize(fileSize), fModificationTime(modificationTime),
+    fRecords(NULL), fNumRecords(0), fMPEGVersion(0), fCleanPoints(NULL), fNumCleanPoints(0) {
+  readRecords();
+  findCleanPoints();
+}
+
+MPEG2TransportStreamIndexData::~MPEG2TransportStreamIndexData() {
+  delete[] fCleanPoints;
+  delete[] fRecords;
+  delete[] fFileName;
+}
+
+void MPEG2TransportStreamIndexData::readRecords() {
+  if (fFileSize % INDEX_RECORD_SIZE != 0) {
+    fEnv << "Warning: Size of the index file \"" << fFileName
+	 << "\" (" << (unsigned)fFileSize
+	 << ") is not a multiple of the index record size ("
+	 << INDEX_RECORD_SIZE << ")\n";
+  }
+  unsigned long numRecords = (unsigned long)(fFileSize/INDEX_RECORD_SIZE);
+  if (numRecords == 0) return;
+
+  FILE* fid = OpenInputFile(fEnv, fFileName);
+  if (fid == NULL) return;
+
+  fRecords = new u_int8_t[numRecords*INDEX_RECORD_SIZE];
+  fNumRecords = (unsigned long)fread(fRecords, INDEX_RECORD_SIZE, numRecords, fid);
+      // This might be less than "numRecords", if the file has just been truncated
+  CloseInputFile(fid);
+}
+
+void MPEG2TransportStreamIndexData::findCleanPoints() {
+  // First, figure out the MPEG version, from the first index record that tells us:
+  for (unsigned long i = 0; i < fNumRecords && fMPEGVersion == 0; ++i) {
+    fMPEGVersion = mpegVersionFromRecordType(record(i)[0]);
+  }
+
+  // Then, count - and record - the clean points:
+  unsigned long i, startRecordNum;
+  for (i = 0; i < fNumRecords; ++i) {
+    if (isCleanPoint(i, startRecordNum)) ++fNumCleanPoints;
+  }
+  if (fNumCleanPoints == 0) return;
+
+  fCleanPoints = new CleanPoint[fNumCleanPoints];
+  unsigned long j = 0;
+  for (i = 0; i < fNumRecords; ++i) {
+    if (isCleanPoint(i, startRecordNum)) {
+      fCleanPoints[j].recordNum = i;
+      fCleanPoints[j].startRecordNum = startRecordNum;
+      ++j;
+    }
+  }
+}
+
+Boolean MPEG2TransportStreamIndexData
+::isCleanPoint(unsigned long recordNum, unsigned long& startRecordNum) const {
+  // A 'clean point' is the start of a 'frame' from which a decoder can cleanly resume
+  // handling the stream.  For H.264, this is a SPS.  For H.265, this is a VPS.
+  // For MPEG-2, this is a Video Sequence Header, or a GOP. 
+  u_int8_t recordType = record(recordNum)[0];
+  if ((recordType&0x80) == 0) return False; // This is not the start of a 'frame'
+  recordType &=~ 0x80; // remove the 'start of frame' bit
+  startRecordNum = recordNum;
+
+  if (fMPEGVersion == 5) { // H.264
+    return recordType == 5/*SPS*/;
+  } else if (fMPEGVersion == 6) { // H.265
+    return recordType == 11/*VPS*/;
+  } else { // MPEG-1, 2, or 4
+    if (recordType == 2/*GOP*/) {
+      // Hack: If the preceding record is for a Video Sequence Header, then use it instead:
+      // (Note that we never look at record 0 - and so never step back from it.)
+      unsigned long newRecordNum = recordNum;
+
+      while (newRecordNum-- > 1) {
+	recordType = record(newRecordNum)[0];
+	if ((recordType&0x7F) != 1) break; // not a Video Sequence Header
+	if ((recordType&0x80) != 0) { // this is the start of the VSH; use it
+	  startRecordNum = newRecordNum;
+	  break;
+	}
+      }
+    }
+    return True;
+  }
+}
+
+
+////////// MPEG2TransportStreamIndexFile //////////
+
 MPEG2TransportStreamIndexFile
 ::MPEG2TransportStreamIndexFile(UsageEnvironment& env, char const* indexFileName)
   : Medium(env),
-    fFileName(strDup(indexFileName)), fFid(NULL), fMPEGVersion(0), fCurrentIndexRecordNum(0),
-    fCachedPCR(0.0f), fCachedTSPacketNumber(0), fNumIndexRecords(0) {
-  // Get the file size, to determine how many index records it contains:
-  u_int64_t indexFileSize = GetFileSize(indexFileName, NULL);
-  if (indexFileSize % INDEX_RECORD_SIZE != 0) {
-    env << "Warning: Size of the index file \"" << indexFileName
- 	<< "\" (" << (unsigned)indexFileSize
-	<< ") is not a multiple of the index record size ("
-	<< INDEX_RECORD_SIZE << ")\n";
-  }
-  fNumIndexRecords = (unsigned long)(indexFileSize/INDEX_RECORD_SIZE);
+    fIndexData(MPEG2TransportStreamIndexData::reference(env, indexFileName)),
+    fCachedPCR(0.0f), fCachedTSPacketNumber(0), fCachedIndexRecordNumber(0), fBuf(NULL) {
+  fNumIndexRecords = fIndexData->numRecords();
 }
 
 MPEG2TransportStreamIndexFile* MPEG2TransportStreamIndexFile
@@ -56,8 +272,7 @@ MPEG2TransportStreamIndexFile* MPEG2TransportStreamIndexFile
 }
 
 MPEG2TransportStreamIndexFile::~MPEG2TransportStreamIndexFile() {
-  closeFid();
-  delete[] fFileName;
+  fIndexData->release();
 }
 
 void MPEG2TransportStreamIndexFile
@@ -122,7 +337,6 @@ void MPEG2TransportStreamIndexFile
     npt = 0.0f;
     tsPacketNumber = indexRecordNumber = 0;
   }
-  closeFid();
 }
 
 void MPEG2TransportStreamIndexFile
@@ -155,7 +369,7 @@ void MPEG2TransportStreamIndexFile
 
     while (ixRight-ixLeft > 1 && tsLeft < tsPacketNumber && tsPacketNumber <= tsRight) {
       unsigned long ixNew = ixLeft
-	+ (unsigned long)(((tsPacketNumber-tsLeft)/(tsRight-tsLeft))*(ixRight-ixLeft));
+	+ (unsigned long)((double(tsPacketNumber-tsLeft)/(tsRight-tsLeft))*(ixRight-ixLeft));
       if (ixNew == ixLeft || ixNew == ixRight) {
 	// Use bisection instead:
 	ixNew = (ixLeft+ixRight)/2;
@@ -192,7 +406,6 @@ void MPEG2TransportStreamIndexFile
     pcr = 0.0f;
     indexRecordNumber = 0;
   }
-  closeFid();
 }
 
 Boolean MPEG2TransportStreamIndexFile
@@ -210,65 +423,20 @@ Boolean MPEG2TransportStreamIndexFile
 }
 
 float MPEG2TransportStreamIndexFile::getPlayingDuration() {
-  if (fNumIndexRecords == 0 || !readOneIndexRecord(fNumIndexRecords-1)) return 0.0f;
+  if (fNumIndexRecords == 0 || !readIndexRecord(fNumIndexRecords-1)) return 0.0f;
 
   return pcrFromBuf();
 }
 
 int MPEG2TransportStreamIndexFile::mpegVersion() {
-  if (fMPEGVersion != 0) return fMPEGVersion; // we already know it
-
-  // Read the first index record, and figure out the MPEG version from its type:
-  if (!readOneIndexRecord(0)) return 0; // unknown; perhaps the indecx file is empty?	
-
-  setMPEGVersionFromRecordType(recordTypeFromBuf());
-  return fMPEGVersion;
-}
-
-Boolean MPEG2TransportStreamIndexFile::openFid() {
-  if (fFid == NULL && fFileName != NULL) {
-    if ((fFid = OpenInputFile(envir(), fFileName)) != NULL) {
-      fCurrentIndexRecordNum = 0;
-    }
-  }
-
-  return fFid != NULL;
-}
-
-Boolean MPEG2TransportStreamIndexFile::seekToIndexRecord(unsigned long indexRecordNumber) {
-  if (!openFid()) return False;
-
-  if (indexRecordNumber == fCurrentIndexRecordNum) return True; // we're already there
-
-  if (SeekFile64(fFid, (int64_t)(indexRecordNumber*INDEX_RECORD_SIZE), SEEK_SET) != 0) return False;
-  fCurrentIndexRecordNum = indexRecordNumber;
-  return True;
+  return fIndexData->mpegVersion();
 }
 
 Boolean MPEG2TransportStreamIndexFile::readIndexRecord(unsigned long indexRecordNum) {
-  do {
-    if (!seekToIndexRecord(indexRecordNum)) break;
-    if (fread(fBuf, INDEX_RECORD_SIZE, 1, fFid) != 1) break;
-    ++fCurrentIndexRecordNum;
-
-    return True;
-  } while (0);
-
-  return False; // an error occurred
-}
-
-Boolean MPEG2TransportStreamIndexFile::readOneIndexRecord(unsigned long indexRecordNum) {
-  Boolean result = readIndexRecord(indexRecordNum);
-  closeFid();
+  if (indexRecordNum >= fNumIndexRecords) return False;
 
-  return result;
-}
-
-void MPEG2TransportStreamIndexFile::closeFid() {
-  if (fFid != NULL) {
-    CloseInputFile(fFid);
-    fFid = NULL;
-  }
+  fBuf = fIndexData->record(indexRecordNum);
+  return True;
 }
 
 float MPEG2TransportStreamIndexFile::pcrFromBuf() {
@@ -281,69 +449,8 @@ unsigned long MPEG2TransportStreamIndexFile::tsPacketNumFromBuf() {
   return (fBuf[10]<<24) | (fBuf[9]<<16) | (fBuf[8]<<8) | fBuf[7];
 }
 
-void MPEG2TransportStreamIndexFile::setMPEGVersionFromRecordType(u_int8_t recordType) {
-  if (fMPEGVersion != 0) return; // we already know it
- 
-  u_int8_t const recordTypeWithoutStartBit = recordType&~0x80;
-  if (recordTypeWithoutStartBit >= 1 && recordTypeWithoutStartBit <= 4) fMPEGVersion = 2;
-  else if (recordTypeWithoutStartBit >= 5 && recordTypeWithoutStartBit <= 10) fMPEGVersion = 5;
-      // represents H.264
-  else if (recordTypeWithoutStartBit >= 11 && recordTypeWithoutStartBit <= 16) fMPEGVersion = 6;
-      // represents H.265
-}
-
-Boolean MPEG2TransportStreamIndexFile::rewindToCleanPoint(unsigned long&ixFound) {
-  Boolean success = False; // until we learn otherwise
-
-  while (ixFound > 0) {
-    if (!readIndexRecord(ixFound)) break;
-
-    u_int8_t recordType = recordTypeFromBuf();
-    setMPEGVersionFromRecordType(recordType);
-
-    // A 'clean point' is the start of a 'frame' from which a decoder can cleanly resume
-    // handling the stream.  For H.264, this is a SPS.  For H.265, this is a VPS.
-    // For MPEG-2, this is a Video Sequence Header, or a GOP. 
-
-    if ((recordType&0x80) != 0) { // This is the start of a 'frame'
-      recordType &=~ 0x80; // remove the 'start of frame' bit
-      if (fMPEGVersion == 5) { // H.264
-        if (recordType == 5/*SPS*/) {
-	  success = True;
-	  break;
-	}
-      } else if (fMPEGVersion == 6) { // H.265
-        if (recordType == 11/*VPS*/) {
-	  success = True;
-	  break;
-	}
-      } else { // MPEG-1, 2, or 4
-	if (recordType == 1/*VSH*/) {
-	  success = True;
-	  break;
-	} else if (recordType == 2/*GOP*/) {
-	  // Hack: If the preceding record is for a Video Sequence Header, then use it instead:
-	  unsigned long newIxFound = ixFound;
-
-	  while (--newIxFound > 0) {
-	    if (!readIndexRecord(newIxFound)) break;
-	    recordType = recordTypeFromBuf();
-	    if ((recordType&0x7F) != 1) break; // not a Video Sequence Header
-	    if ((recordType&0x80) != 0) { // this is the start of the VSH; use it
-	      ixFound = newIxFound;
-	      break;
-	    }
-	  }
-        }
-        success = True;
-        break;
-      }
-    }
-
-    // Keep checking, from the previous record:
-    --ixFound;
-  }
-  if (ixFound == 0) success = True; // use record 0 anyway
-
-  return success;
+Boolean MPEG2TransportStreamIndexFile::rewindToCleanPoint(unsigned long& ixFound) {
+  // Use the (precomputed) table of clean points, rather than searching backwards through the index:
+  ixFound = fIndexData->cleanPointAtOrBefore(ixFound);
+  return True;
 }
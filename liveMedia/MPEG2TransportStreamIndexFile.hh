@@ -30,6 +30,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #define INDEX_RECORD_SIZE 11
 
+class MPEG2TransportStreamIndexData; // forward
+
 class MPEG2TransportStreamIndexFile: public Medium {
 public:
   static MPEG2TransportStreamIndexFile* createNew(UsageEnvironment& env,
@@ -57,7 +59,7 @@ public:
 				unsigned long& transportPacketNum, u_int8_t& offset,
 				u_int8_t& size, float& pcr, u_int8_t& recordType);
   float getPlayingDuration();
-  void stopReading() { closeFid(); }
+  void stopReading() {} // no longer needed, because the index is held in memory
 
   int mpegVersion();
       // returns the best guess for the version of MPEG being used for data within the underlying Transport Stream file.
@@ -66,31 +68,25 @@ public:
 private:
   MPEG2TransportStreamIndexFile(UsageEnvironment& env, char const* indexFileName);
 
-  Boolean openFid();
-  Boolean seekToIndexRecord(unsigned long indexRecordNumber);
-  Boolean readIndexRecord(unsigned long indexRecordNum); // into "fBuf"
-  Boolean readOneIndexRecord(unsigned long indexRecordNum); // closes "fFid" at end
-  void closeFid();
+  Boolean readIndexRecord(unsigned long indexRecordNum); // sets "fBuf" to point to the record
 
   u_int8_t recordTypeFromBuf() { return fBuf[0]; }
   u_int8_t offsetFromBuf() { return fBuf[1]; }
   u_int8_t sizeFromBuf() { return fBuf[2]; }
   float pcrFromBuf(); // after "fBuf" has been read
   unsigned long tsPacketNumFromBuf();
-  void setMPEGVersionFromRecordType(u_int8_t recordType);
 
   Boolean rewindToCleanPoint(unsigned long&ixFound);
       // used to implement "lookupTSPacketNumber()"
 
 private:
-  char* fFileName;
-  FILE* fFid; // used internally when reading from the file
-  int fMPEGVersion;
-  unsigned long fCurrentIndexRecordNum; // within "fFid"
+  MPEG2TransportStreamIndexData* fIndexData;
+      // the contents of the index file; shared by each "MPEG2TransportStreamIndexFile" (in this environment)
+      // that reads the same file
   float fCachedPCR;
   unsigned long fCachedTSPacketNumber, fCachedIndexRecordNumber;
   unsigned long fNumIndexRecords;
-  unsigned char fBuf[INDEX_RECORD_SIZE]; // used for reading index records from file
+  u_int8_t const* fBuf; // the index record that we most recently 'read' (within "fIndexData")
 };
 
 #endif
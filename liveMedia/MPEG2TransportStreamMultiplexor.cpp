@@ -36,7 +36,7 @@ MPEG2TransportStreamMultiplexor
     fPreviousInputProgramMapVersion(0xFF), fCurrentInputProgramMapVersion(0xFF),
     fPCR_PID(0), fCurrentPID(0),
     fInputBuffer(NULL), fInputBufferSize(0), fInputBufferBytesUsed(0),
-    fIsFirstAdaptationField(True) {
+    fIsFirstAdaptationField(True), fPreferredFrameSize(0), fNumDeliveries(0) {
   for (unsigned i = 0; i < PID_TABLE_SIZE; ++i) {
     fPIDState[i].counter = 0;
     fPIDState[i].streamType = 0;
@@ -54,33 +54,18 @@ void MPEG2TransportStreamMultiplexor::doGetNextFrame() {
     return;
   }
 
+  // Deliver as many Transport packets as will fit in the client's buffer (or until we've used up
+  // the current input buffer), rather than just one packet per call:
+  if (fPreferredFrameSize >= TRANSPORT_PACKET_SIZE && fPreferredFrameSize < fMaxSize) fMaxSize = fPreferredFrameSize;
+  fFrameSize = 0;
   do {
-    // Periodically return a Program Association Table packet instead:
-    if (fOutgoingPacketCounter++ % PAT_PERIOD == 0) {
-      deliverPATPacket();
-      break;
-    }
-
-    // Periodically (or when we see a new PID) return a Program Map Table instead:
-    Boolean programMapHasChanged = fPIDState[fCurrentPID].counter == 0
-      || fCurrentInputProgramMapVersion != fPreviousInputProgramMapVersion;
-    if (fOutgoingPacketCounter % PMT_PERIOD == 0 || programMapHasChanged) {
-      if (programMapHasChanged) { // reset values for next time:
-	fPIDState[fCurrentPID].counter = 1;
-	fPreviousInputProgramMapVersion = fCurrentInputProgramMapVersion;
-      }
-      deliverPMTPacket(programMapHasChanged);
-      break;
-    }
-
-    // Normal case: Deliver (or continue delivering) the recently-read data:
-    deliverDataToClient(fCurrentPID, fInputBuffer, fInputBufferSize,
-			fInputBufferBytesUsed);
-  } while (0);
+    deliverNextPacket();
+  } while (fFrameSize > 0 && fMaxSize - fFrameSize >= TRANSPORT_PACKET_SIZE
+	   && fInputBufferBytesUsed < fInputBufferSize);
 
   // NEED TO SET fPresentationTime, durationInMicroseconds #####
   // Complete the delivery to the client:
-  if ((fOutgoingPacketCounter%10) == 0) {
+  if ((++fNumDeliveries%10) == 0) {
     // To avoid excessive recursion (and stack overflow) caused by excessively large input frames,
     // occasionally return to the event loop to do this:
     nextTask() = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)FramedSource::afterGetting, this);
@@ -89,6 +74,30 @@ void MPEG2TransportStreamMultiplexor::doGetNextFrame() {
   }
 }
 
+void MPEG2TransportStreamMultiplexor::deliverNextPacket() {
+  // Periodically return a Program Association Table packet instead:
+  if (fOutgoingPacketCounter++ % PAT_PERIOD == 0) {
+    deliverPATPacket();
+    return;
+  }
+
+  // Periodically (or when we see a new PID) return a Program Map Table instead:
+  Boolean programMapHasChanged = fPIDState[fCurrentPID].counter == 0
+    || fCurrentInputProgramMapVersion != fPreviousInputProgramMapVersion;
+  if (fOutgoingPacketCounter % PMT_PERIOD == 0 || programMapHasChanged) {
+    if (programMapHasChanged) { // reset values for next time:
+      fPIDState[fCurrentPID].counter = 1;
+      fPreviousInputProgramMapVersion = fCurrentInputProgramMapVersion;
+    }
+    deliverPMTPacket(programMapHasChanged);
+    return;
+  }
+
+  // Normal case: Deliver (or continue delivering) the recently-read data:
+  deliverDataToClient(fCurrentPID, fInputBuffer, fInputBufferSize,
+		      fInputBufferBytesUsed);
+}
+
 void MPEG2TransportStreamMultiplexor
 ::handleNewBuffer(unsigned char* buffer, unsigned bufferSize,
 		  int mpegVersion, MPEG1or2Demux::SCR scr, int16_t PID) {
@@ -148,12 +157,11 @@ void MPEG2TransportStreamMultiplexor
 void MPEG2TransportStreamMultiplexor
 ::deliverDataToClient(u_int8_t pid, unsigned char* buffer, unsigned bufferSize,
 		      unsigned& startPositionInBuffer) {
-  // Construct a new Transport packet, and deliver it to the client:
-  if (fMaxSize < TRANSPORT_PACKET_SIZE) {
-    fFrameSize = 0; // the client hasn't given us enough space; deliver nothing
+  // Construct a new Transport packet, and append it to the data that we're delivering to the client:
+  if (fMaxSize - fFrameSize < TRANSPORT_PACKET_SIZE) {
+    // the client hasn't given us enough space; deliver nothing (more)
     fNumTruncatedBytes = TRANSPORT_PACKET_SIZE;
   } else {
-    fFrameSize = TRANSPORT_PACKET_SIZE;
     Boolean willAddPCR = pid == fPCR_PID && startPositionInBuffer == 0
       && !(fPCR.highBit == 0 && fPCR.remainingBits == 0 && fPCR.extension == 0);
     unsigned const numBytesAvailable = bufferSize - startPositionInBuffer;
@@ -191,7 +199,7 @@ void MPEG2TransportStreamMultiplexor
     //         == TRANSPORT_PACKET_SIZE
 
     // Fill in the header of the Transport Stream packet:
-    unsigned char* header = fTo;
+    unsigned char* header = &fTo[fFrameSize];
     *header++ = 0x47; // sync_byte
     *header++ = (startPositionInBuffer == 0) ? 0x40 : 0x00;
       // transport_error_indicator, payload_unit_start_indicator, transport_priority,
@@ -234,6 +242,7 @@ void MPEG2TransportStreamMultiplexor
     // Finally, add the data bytes:
     memmove(header, &buffer[startPositionInBuffer], numDataBytes);
     startPositionInBuffer += numDataBytes;
+    fFrameSize += TRANSPORT_PACKET_SIZE;
   }
 }
 
@@ -246,7 +255,7 @@ void MPEG2TransportStreamMultiplexor
 void MPEG2TransportStreamMultiplexor::deliverPATPacket() {
   // First, create a new buffer for the PAT packet:
   unsigned const patSize = TRANSPORT_PACKET_SIZE - 4; // allow for the 4-byte header
-  unsigned char* patBuffer = new unsigned char[patSize];
+  unsigned char patBuffer[patSize];
 
   // and fill it in:
   unsigned char* pat = patBuffer;
@@ -272,9 +281,6 @@ void MPEG2TransportStreamMultiplexor::deliverPATPacket() {
   // Deliver the packet:
   unsigned startPosition = 0;
   deliverDataToClient(PAT_PID, patBuffer, patSize, startPosition);
-
-  // Finally, remove the new buffer:
-  delete[] patBuffer;
 }
 
 void MPEG2TransportStreamMultiplexor::deliverPMTPacket(Boolean hasChanged) {
@@ -282,7 +288,7 @@ void MPEG2TransportStreamMultiplexor::deliverPMTPacket(Boolean hasChanged) {
 
   // First, create a new buffer for the PMT packet:
   unsigned const pmtSize = TRANSPORT_PACKET_SIZE - 4; // allow for the 4-byte header
-  unsigned char* pmtBuffer = new unsigned char[pmtSize];
+  unsigned char pmtBuffer[pmtSize];
 
   // and fill it in:
   unsigned char* pmt = pmtBuffer;
@@ -322,9 +328,6 @@ void MPEG2TransportStreamMultiplexor::deliverPMTPacket(Boolean hasChanged) {
   // Deliver the packet:
   unsigned startPosition = 0;
   deliverDataToClient(OUR_PROGRAM_MAP_PID, pmtBuffer, pmtSize, startPosition);
-
-  // Finally, remove the new buffer:
-  delete[] pmtBuffer;
 }
 
 void MPEG2TransportStreamMultiplexor::setProgramStreamMap(unsigned frameSize) {
@@ -37,6 +37,12 @@ public:
       // Can be used by a downstream reader to test whether the next call to "doGetNextFrame()"
       // will deliver data immediately).
 
+  void setPreferredFrameSize(unsigned preferredFrameSize) { fPreferredFrameSize = preferredFrameSize; }
+      // Each delivery contains as many (whole) Transport packets as fit in the client's buffer.  If
+      // "preferredFrameSize" (>= 188) is set, then no more than this many bytes are delivered at a time.
+      // (This is useful - e.g. - if the output is being streamed via RTP, with several Transport packets
+      //  per network packet.)
+
 protected:
   MPEG2TransportStreamMultiplexor(UsageEnvironment& env);
   virtual ~MPEG2TransportStreamMultiplexor();
@@ -59,6 +65,7 @@ private:
   virtual void doGetNextFrame();
 
 private:
+  void deliverNextPacket(); // a PAT, a PMT, or (the next part of) the current input buffer
   void deliverDataToClient(u_int8_t pid, unsigned char* buffer, unsigned bufferSize,
 			   unsigned& startPositionInBuffer);
 
@@ -85,6 +92,8 @@ private:
   unsigned char* fInputBuffer;
   unsigned fInputBufferSize, fInputBufferBytesUsed;
   Boolean fIsFirstAdaptationField;
+  unsigned fPreferredFrameSize;
+  unsigned fNumDeliveries; // the number of (possibly multi-packet) frames that we've delivered
 };
 
 
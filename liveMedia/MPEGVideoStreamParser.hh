@@ -70,14 +70,40 @@ protected:
     *fTo++ = word>>24; *fTo++ = word>>16; *fTo++ = word>>8; *fTo++ = word;
   }
 
+  void saveBytes(unsigned char const* from, unsigned numBytes) { // as above, but in bulk
+    unsigned numBytesToSave = numBytes;
+    if (fTo + numBytesToSave > fLimit) numBytesToSave = fLimit - fTo; // there's not enough space left
+    memcpy(fTo, from, numBytesToSave);
+    fTo += numBytesToSave;
+    fNumTruncatedBytes += numBytes - numBytesToSave;
+  }
+
+  // Record (and parse past) the next "numBytes" input bytes, which must already be valid:
+  void saveValidBytes(unsigned numBytes) {
+    saveBytes(remainingValidBytes(), numBytes);
+    skipBytes(numBytes);
+  }
+
+  // The number of valid input bytes that we can parse past in one go, because no sync word
+  // (0x000001xx) begins in them.  (We stop short of the last 3 bytes, in case a sync word
+  // begins there, but we haven't yet read all of it.)
+  unsigned numBytesBeforeNextCode() {
+    unsigned numBytes = numBytesBeforeStartCodePrefix();
+    unsigned numRemainingBytes = numRemainingValidBytes();
+    if (numRemainingBytes < 3) return 0;
+    return numBytes < numRemainingBytes - 3 ? numBytes : numRemainingBytes - 3;
+  }
+
   // Save data until we see a sync word (0x000001xx):
   void saveToNextCode(u_int32_t& curWord) {
     saveByte(curWord>>24);
     curWord = (curWord<<8)|get1Byte();
     while ((curWord&0xFFFFFF00) != 0x00000100) {
       if ((unsigned)(curWord&0xFF) > 1) {
-	// a sync word definitely doesn't begin anywhere in "curWord"
+	// a sync word definitely doesn't begin anywhere in "curWord" (or straddle its end), so save it,
+	// along with all of the following input that we already have, up until the next sync word:
 	save4Bytes(curWord);
+	saveValidBytes(numBytesBeforeNextCode());
 	curWord = get4Bytes();
       } else {
 	// a sync word might begin in "curWord", although not at its start
@@ -93,7 +119,9 @@ protected:
     curWord = (curWord<<8)|get1Byte();
     while ((curWord&0xFFFFFF00) != 0x00000100) {
       if ((unsigned)(curWord&0xFF) > 1) {
-	// a sync word definitely doesn't begin anywhere in "curWord"
+	// a sync word definitely doesn't begin anywhere in "curWord" (or straddle its end), so skip it,
+	// along with all of the following input that we already have, up until the next sync word:
+	skipBytes(numBytesBeforeNextCode());
 	curWord = get4Bytes();
       } else {
 	// a sync word might begin in "curWord", although not at its start
@@ -125,6 +125,9 @@ public:
 
   MediaLookupTable* mediaTable;
   void* socketTable;
+  void* packetBufferPool;
+  void* tsIndexDataTable;
+  void* fileBlockCache;
 
 protected:
   _Tables(UsageEnvironment& env);
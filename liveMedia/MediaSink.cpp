@@ -21,6 +21,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MediaSink.hh"
 #include "GroupsockHelper.hh"
 #include <string.h>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 ////////// MediaSink //////////
 
@@ -112,23 +115,78 @@ Boolean MediaSink::isRTPSink() const {
 
 unsigned OutPacketBuffer::maxSize = 2000000; // by default
 
+// Most of each buffer is usually unused (because frames are usually much smaller than "maxSize").
+// Where possible, therefore, we allocate the buffer using "mmap()", so that its pages use real memory
+// only once they've been written to.  Then, each time that the buffer becomes empty, we give back
+// (to the OS) any pages beyond those that we've recently needed:
+#ifndef OUT_PACKET_BUFFER_RETAINED_SIZE
+#define OUT_PACKET_BUFFER_RETAINED_SIZE 65536 // we never release the first part of the buffer
+#endif
+#ifndef OUT_PACKET_BUFFER_USAGE_PERIOD
+#define OUT_PACKET_BUFFER_USAGE_PERIOD 1000 // the number of times that the buffer becomes empty, per 'period'
+#endif
+
 OutPacketBuffer
 ::OutPacketBuffer(unsigned preferredPacketSize, unsigned maxPacketSize, unsigned maxBufferSize)
   : fPreferred(preferredPacketSize), fMax(maxPacketSize),
+    fBufIsMapped(False), fMaxBytesUsed(0), fNumBytesTouched(0), fNumTimesEmptyInPeriod(0),
     fOverflowDataSize(0) {
   if (maxBufferSize == 0) maxBufferSize = maxSize;
   unsigned maxNumPackets = (maxBufferSize + (maxPacketSize-1))/maxPacketSize;
   fLimit = maxNumPackets*maxPacketSize;
-  fBuf = new unsigned char[fLimit];
+  fRecentMaxBytesUsed[0] = fRecentMaxBytesUsed[1] = 0;
+
+  fBuf = NULL;
+#if defined(__linux__)
+  if (fLimit > OUT_PACKET_BUFFER_RETAINED_SIZE) {
+    void* buf = mmap(NULL, fLimit, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (buf != MAP_FAILED) {
+      fBuf = (unsigned char*)buf;
+      fBufIsMapped = True;
+    }
+  }
+#endif
+  if (fBuf == NULL) fBuf = new unsigned char[fLimit];
+
   resetPacketStart();
   resetOffset();
   resetOverflowData();
 }
 
 OutPacketBuffer::~OutPacketBuffer() {
+#if defined(__linux__)
+  if (fBufIsMapped) {
+    munmap(fBuf, fLimit);
+    return;
+  }
+#endif
   delete[] fBuf;
 }
 
+void OutPacketBuffer::noteBufferIsEmpty() {
+  if (++fNumTimesEmptyInPeriod == OUT_PACKET_BUFFER_USAGE_PERIOD) {
+    // Begin a new period:
+    fRecentMaxBytesUsed[1] = fRecentMaxBytesUsed[0];
+    fRecentMaxBytesUsed[0] = 0;
+    fNumTimesEmptyInPeriod = 0;
+  }
+
+#if defined(__linux__)
+  if (!fBufIsMapped) return;
+
+  // Release any pages that we've written to, but haven't needed (during this or the previous period):
+  unsigned sizeToKeep = OUT_PACKET_BUFFER_RETAINED_SIZE;
+  if (fRecentMaxBytesUsed[0] > sizeToKeep) sizeToKeep = fRecentMaxBytesUsed[0];
+  if (fRecentMaxBytesUsed[1] > sizeToKeep) sizeToKeep = fRecentMaxBytesUsed[1];
+  unsigned const pageSize = 4096; // a multiple of this is OK, if the real page size is larger
+  sizeToKeep = ((sizeToKeep + pageSize-1)/pageSize)*pageSize;
+  if (fNumBytesTouched > sizeToKeep) {
+    madvise(&fBuf[sizeToKeep], fNumBytesTouched - sizeToKeep, MADV_DONTNEED);
+    fNumBytesTouched = sizeToKeep;
+  }
+#endif
+}
+
 void OutPacketBuffer::enqueue(unsigned char const* from, unsigned numBytes) {
   if (numBytes > totalBytesAvailable()) {
 #ifdef DEBUG
@@ -158,6 +216,7 @@ void OutPacketBuffer::insert(unsigned char const* from, unsigned numBytes,
   if (toPosition + numBytes > fCurOffset) {
     fCurOffset = toPosition + numBytes;
   }
+  noteBytesUsed(realToPosition + numBytes);
 }
 
 void OutPacketBuffer::insertWord(u_int32_t word, unsigned toPosition) {
@@ -199,6 +258,7 @@ void OutPacketBuffer
   fOverflowDataSize = overflowDataSize;
   fOverflowPresentationTime = presentationTime;
   fOverflowDurationInMicroseconds = durationInMicroseconds;
+  noteBytesUsed(fPacketStart + overflowDataOffset + overflowDataSize);
 }
 
 void OutPacketBuffer::useOverflowData() {
@@ -220,6 +280,8 @@ void OutPacketBuffer::adjustPacketStart(unsigned numBytes) {
 void OutPacketBuffer::resetPacketStart() {
   if (fOverflowDataSize > 0) {
     fOverflowDataOffset += fPacketStart;
+  } else {
+    noteBufferIsEmpty();
   }
   fPacketStart = 0;
 }
@@ -86,7 +86,7 @@ public:
   unsigned char* packet() const {return &fBuf[fPacketStart];}
   unsigned curPacketSize() const {return fCurOffset;}
 
-  void increment(unsigned numBytes) {fCurOffset += numBytes;}
+  void increment(unsigned numBytes) {fCurOffset += numBytes; noteBytesUsed(fPacketStart + fCurOffset);}
 
   void enqueue(unsigned char const* from, unsigned numBytes);
   void enqueueWord(u_int32_t word);
@@ -123,9 +123,30 @@ public:
   void resetOffset() { fCurOffset = 0; }
   void resetOverflowData() { fOverflowDataOffset = fOverflowDataSize = 0; }
 
+  // Buffer utilization statistics:
+  unsigned maxBytesUsed() const { return fMaxBytesUsed; } // the 'high-water mark' (over the buffer's lifetime)
+  unsigned numBytesTouched() const { return fNumBytesTouched; }
+      // the size of the part of the buffer that has been written to (and not since released back to the OS).
+      // (Where possible, the rest of the buffer - up to "totalBufferSize()" - doesn't use any real memory.)
+
+private:
+  void noteBytesUsed(unsigned endPosition) {
+    if (endPosition > fNumBytesTouched) {
+      fNumBytesTouched = endPosition;
+      if (endPosition > fMaxBytesUsed) fMaxBytesUsed = endPosition;
+    }
+    if (endPosition > fRecentMaxBytesUsed[0]) fRecentMaxBytesUsed[0] = endPosition;
+  }
+  void noteBufferIsEmpty();
+
 private:
   unsigned fPacketStart, fCurOffset, fPreferred, fMax, fLimit;
   unsigned char* fBuf;
+  Boolean fBufIsMapped; // if True, "fBuf" was allocated using "mmap()", rather than "new"
+
+  unsigned fMaxBytesUsed, fNumBytesTouched;
+  unsigned fRecentMaxBytesUsed[2]; // for the current and previous 'periods' of buffer use
+  unsigned fNumTimesEmptyInPeriod;
 
   unsigned fOverflowDataOffset, fOverflowDataSize;
   struct timeval fOverflowPresentationTime;
@@ -52,6 +52,7 @@ MultiFramedRTPSink::MultiFramedRTPSink(UsageEnvironment& env,
   : RTPSink(env, rtpGS, rtpPayloadType, rtpTimestampFrequency,
 	    rtpPayloadFormatName, numChannels),
     fOutBuf(NULL), fCurFragmentationOffset(0), fPreviousFrameEndedFragmentation(False),
+    fZeroCopyPacketization(False), fPayload(NULL), fPayloadSize(0), fNumPayloadBytesSentInPlace(0),
     fOnSendErrorFunc(NULL), fOnSendErrorData(NULL) {
   setPacketSizes((RTP_PAYLOAD_PREFERRED_SIZE), (RTP_PAYLOAD_MAX_SIZE));
 }
@@ -60,6 +61,22 @@ MultiFramedRTPSink::~MultiFramedRTPSink() {
   delete fOutBuf;
 }
 
+unsigned char* MultiFramedRTPSink::referencedFrameData() {
+  return NULL; // by default, our source copies each frame into our buffer
+}
+
+unsigned MultiFramedRTPSink::outBufferSize() const {
+  return fOutBuf == NULL ? 0 : fOutBuf->totalBufferSize();
+}
+
+unsigned MultiFramedRTPSink::outBufferMaxBytesUsed() const {
+  return fOutBuf == NULL ? 0 : fOutBuf->maxBytesUsed();
+}
+
+unsigned MultiFramedRTPSink::outBufferNumBytesTouched() const {
+  return fOutBuf == NULL ? 0 : fOutBuf->numBytesTouched();
+}
+
 void MultiFramedRTPSink
 ::doSpecialFrameHandling(unsigned /*fragmentationOffset*/,
 			 unsigned char* /*frameStart*/,
@@ -140,6 +157,7 @@ void MultiFramedRTPSink::setFrameSpecificHeaderBytes(unsigned char const* bytes,
 
 void MultiFramedRTPSink::setFramePadding(unsigned numPaddingBytes) {
   if (numPaddingBytes > 0) {
+    copyPayloadIntoBuffer(); // because the padding must follow it
     // Add the padding bytes (with the last one being the padding size):
     unsigned char paddingBuffer[255]; //max padding
     memset(paddingBuffer, 0, numPaddingBytes);
@@ -161,6 +179,7 @@ Boolean MultiFramedRTPSink::continuePlaying() {
 }
 
 void MultiFramedRTPSink::stopPlaying() {
+  fPayload = NULL; fPayloadSize = 0;
   fOutBuf->resetPacketStart();
   fOutBuf->resetOffset();
   fOutBuf->resetOverflowData();
@@ -249,6 +268,19 @@ void MultiFramedRTPSink
     fInitialPresentationTime = presentationTime;
   }    
 
+  // Check whether our source delivered this frame 'by reference'.  We can send the frame from where it is only if
+  // it's the only frame in this packet, and fits within it; otherwise we copy it into our buffer after all:
+  unsigned char* frameData = referencedFrameData();
+  if (frameData != NULL && frameSize > 0) {
+    if (fNumFramesUsedSoFar == 0 && !fOutBuf->wouldOverflow(frameSize)) {
+      fPayload = frameData;
+      fPayloadSize = frameSize;
+    } else {
+      if (frameSize > fOutBuf->totalBytesAvailable()) frameSize = fOutBuf->totalBytesAvailable(); // shouldn't happen
+      memmove(fOutBuf->curPtr(), frameData, frameSize);
+    }
+  }
+
   if (numTruncatedBytes > 0) {
     unsigned const bufferSize = fOutBuf->totalBytesAvailable();
     envir() << "MultiFramedRTPSink::afterGettingFrame1(): The input frame data was too large for our buffer size ("
@@ -310,9 +342,14 @@ void MultiFramedRTPSink
     sendPacketIfNecessary();
   } else {
     // Use this frame in our outgoing packet:
-    unsigned char* frameStart = fOutBuf->curPtr();
-    fOutBuf->increment(numFrameBytesToUse);
-        // do this now, in case "doSpecialFrameHandling()" calls "setFramePadding()" to append padding bytes
+    unsigned char* frameStart;
+    if (fPayload != NULL) {
+      frameStart = fPayload; // we don't copy this frame into our buffer
+    } else {
+      frameStart = fOutBuf->curPtr();
+      fOutBuf->increment(numFrameBytesToUse);
+          // do this now, in case "doSpecialFrameHandling()" calls "setFramePadding()" to append padding bytes
+    }
 
     // Here's where any payload format specific processing gets done:
     doSpecialFrameHandling(curFragmentationOffset, frameStart,
@@ -337,7 +374,8 @@ void MultiFramedRTPSink
     // (iii) it contains the last fragment of a fragmented frame, and we
     //      don't allow anything else to follow this or
     // (iv) one frame per packet is allowed:
-    if (fOutBuf->isPreferredSize()
+    if (fPayload != NULL // nothing may follow a frame that's not in our buffer
+	|| fOutBuf->isPreferredSize()
         || fOutBuf->wouldOverflow(numFrameBytesToUse)
         || (fPreviousFrameEndedFragmentation &&
             !allowOtherFramesAfterLastFragment())
@@ -354,6 +392,13 @@ void MultiFramedRTPSink
 
 static unsigned const rtpHeaderSize = 12;
 
+void MultiFramedRTPSink::copyPayloadIntoBuffer() {
+  if (fPayload == NULL) return;
+
+  fOutBuf->enqueue(fPayload, fPayloadSize);
+  fPayload = NULL; fPayloadSize = 0;
+}
+
 Boolean MultiFramedRTPSink::isTooBigForAPacket(unsigned numBytes) const {
   // Check whether a 'numBytes'-byte frame - together with a RTP header and
   // (possible) special headers - would be too big for an output packet:
@@ -368,14 +413,19 @@ void MultiFramedRTPSink::sendPacketIfNecessary() {
 #ifdef TEST_LOSS
     if ((our_random()%10) != 0) // simulate 10% packet loss #####
 #endif
-      if (!fRTPInterface.sendPacket(fOutBuf->packet(), fOutBuf->curPacketSize())) {
+      if (fPayload != NULL
+	  ? !fRTPInterface.sendPacket(fOutBuf->packet(), fOutBuf->curPacketSize(), fPayload, fPayloadSize)
+	  : !fRTPInterface.sendPacket(fOutBuf->packet(), fOutBuf->curPacketSize())) {
 	// if failure handler has been specified, call it
 	if (fOnSendErrorFunc != NULL) (*fOnSendErrorFunc)(fOnSendErrorData);
       }
     ++fPacketCount;
-    fTotalOctetCount += fOutBuf->curPacketSize();
-    fOctetCount += fOutBuf->curPacketSize()
+    unsigned const packetSize = fOutBuf->curPacketSize() + fPayloadSize;
+    fTotalOctetCount += packetSize;
+    fOctetCount += packetSize
       - rtpHeaderSize - fSpecialHeaderSize - fTotalFrameSpecificHeaderSizes;
+    fNumPayloadBytesSentInPlace += fPayloadSize;
+    fPayload = NULL; fPayloadSize = 0;
 
     ++fSeqNo; // for next time
   }
@@ -37,6 +37,20 @@ public:
     fOnSendErrorData = onSendErrorFuncData;
   }
 
+  void setZeroCopyPacketization(Boolean zeroCopy) { fZeroCopyPacketization = zeroCopy; }
+      // If True, then - for payload formats that support this (currently H.264 and H.265) - each packet's payload
+      // is sent directly from where our source holds it (together with the separately-built RTP header, using
+      // "sendmsg()"), rather than first being copied into our output buffer.  (This takes effect when we next
+      // start playing.)  "H264VideoRTPSink" and "H265VideoRTPSink" turn this on by default.
+  Boolean zeroCopyPacketization() const { return fZeroCopyPacketization; }
+  u_int64_t numPayloadBytesSentInPlace() const { return fNumPayloadBytesSentInPlace; }
+      // the number of payload bytes that we've sent without first copying them into our output buffer
+
+  // Statistics about our output buffer (which holds the frame(s) that are currently being packetized):
+  unsigned outBufferSize() const;
+  unsigned outBufferMaxBytesUsed() const; // the largest amount of the buffer that's been used so far
+  unsigned outBufferNumBytesTouched() const; // roughly, the amount of the buffer that's currently using real memory
+
 protected:
   MultiFramedRTPSink(UsageEnvironment& env,
 		     Groupsock* rtpgs, unsigned char rtpPayloadType,
@@ -47,6 +61,11 @@ protected:
 
   virtual ~MultiFramedRTPSink();
 
+  virtual unsigned char* referencedFrameData();
+      // Called after each frame is delivered by our source.  A subclass whose source delivers frames 'by reference'
+      // (rather than copying them into our buffer) - which it should do only if "zeroCopyPacketization()" is True -
+      // redefines this to return a pointer to the frame's data.  The default implementation returns NULL.
+
   virtual void doSpecialFrameHandling(unsigned fragmentationOffset,
 				      unsigned char* frameStart,
 				      unsigned numBytesInFrame,
@@ -112,6 +131,7 @@ private:
 			  struct timeval presentationTime,
 			  unsigned durationInMicroseconds);
   Boolean isTooBigForAPacket(unsigned numBytes) const;
+  void copyPayloadIntoBuffer();
 
   static void ourHandleClosure(void* clientData);
 
@@ -133,6 +153,11 @@ private:
   unsigned fTotalFrameSpecificHeaderSizes; // size of all frame-specific hdrs in pkt
   unsigned fOurMaxPacketSize;
 
+  Boolean fZeroCopyPacketization;
+  unsigned char* fPayload; // if non-NULL, the (last) frame in our packet, which is sent from here - not from "fOutBuf"
+  unsigned fPayloadSize;
+  u_int64_t fNumPayloadBytesSentInPlace;
+
   onSendErrorFunc* fOnSendErrorFunc;
   void* fOnSendErrorData;
 };
@@ -20,21 +20,26 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "MultiFramedRTPSource.hh"
+#include "PacketBufferPool.hh"
 #include "RTCP.hh"
 #include "GroupsockHelper.hh"
+#include "TunnelEncaps.hh"
 #include <string.h>
 
+#define MAX_PACKET_SIZE 65536
+
 ////////// ReorderingPacketBuffer definition //////////
 
 class ReorderingPacketBuffer {
 public:
-  ReorderingPacketBuffer(BufferedPacketFactory* packetFactory);
+  ReorderingPacketBuffer(UsageEnvironment& env, BufferedPacketFactory* packetFactory);
   virtual ~ReorderingPacketBuffer();
   void reset();
 
   BufferedPacket* getFreePacket(MultiFramedRTPSource* ourSource);
   Boolean storePacket(BufferedPacket* bPacket);
-  BufferedPacket* getNextCompletedPacket(Boolean& packetLossPreceded);
+  BufferedPacket* getNextCompletedPacket(Boolean& packetLossPreceded, struct timeval const* timeNow = NULL);
+      // "timeNow" (if not NULL) is the current time; otherwise we call "gettimeofday()" if we need it
   void releaseUsedPacket(BufferedPacket* packet);
   void freePacket(BufferedPacket* packet) {
     if (packet != fSavedPacket) {
@@ -43,18 +48,39 @@ public:
       fSavedPacketFree = True;
     }
   }
-  Boolean isEmpty() const { return fHeadPacket == NULL; }
+  Boolean isEmpty() const { return fNumPackets == 0; }
 
   void setThresholdTime(unsigned uSeconds) { fThresholdTime = uSeconds; }
   void resetHaveSeenFirstPacket() { fHaveSeenFirstPacket = False; }
 
+  unsigned packetBufferSize() const { return fPacketBufferSize; }
+      // the buffer size to use when reading a new (UDP) packet
+  Boolean noteIncomingPacketSize(unsigned packetSize, unsigned bufferSize);
+      // called after reading a "packetSize"-byte packet into a "bufferSize"-byte buffer.
+      // Returns False iff the packet filled the buffer (and so may have been truncated).
+
+private:
+  BufferedPacket*& slotFor(unsigned short rtpSeqNo) { return fRing[rtpSeqNo&(fRingSize-1)]; }
+  Boolean growRing(unsigned minSize);
+  void freeStoredPackets();
+
 private:
   BufferedPacketFactory* fPacketFactory;
+  PacketBufferPool* fPool; // shared by all packets in this environment
+  unsigned fLargestPacketSize; // of those that we've seen so far
+  unsigned fPacketBufferSize;
   unsigned fThresholdTime; // uSeconds
   Boolean fHaveSeenFirstPacket; // used to set initial "fNextExpectedSeqNo"
   unsigned short fNextExpectedSeqNo;
-  BufferedPacket* fHeadPacket;
-  BufferedPacket* fTailPacket;
+
+  // Stored packets are indexed by their RTP sequence number (modulo "fRingSize", which is a power of 2).
+  // All stored packets have sequence numbers in the range ["fHeadSeqNo", "fTailSeqNo"], which is always
+  // smaller than "fRingSize", so each slot holds at most one packet:
+  BufferedPacket** fRing;
+  unsigned fRingSize;
+  unsigned fNumPackets;
+  unsigned short fHeadSeqNo, fTailSeqNo; // valid only if "fNumPackets" > 0
+
   BufferedPacket* fSavedPacket;
       // to avoid calling new/free in the common case
   Boolean fSavedPacketFree;
@@ -68,9 +94,10 @@ MultiFramedRTPSource
 		       unsigned char rtpPayloadFormat,
 		       unsigned rtpTimestampFrequency,
 		       BufferedPacketFactory* packetFactory)
-  : RTPSource(env, RTPgs, rtpPayloadFormat, rtpTimestampFrequency) {
+  : RTPSource(env, RTPgs, rtpPayloadFormat, rtpTimestampFrequency),
+    fMaxPacketsPerRead(1), fPacketBatch(NULL) {
   reset();
-  fReorderingBuffer = new ReorderingPacketBuffer(packetFactory);
+  fReorderingBuffer = new ReorderingPacketBuffer(env, packetFactory);
 
   // Try to use a big receive buffer for RTP:
   increaseReceiveBufferTo(env, RTPgs->socketNum(), 2000000);
@@ -83,12 +110,41 @@ void MultiFramedRTPSource::reset() {
   fPacketReadInProgress = NULL;
   fNeedDelivery = False;
   fPacketLossInFragmentedFrame = False;
+  fNumDirectDeliveries = 0;
 }
 
 MultiFramedRTPSource::~MultiFramedRTPSource() {
+  freePacketBatch();
+  delete[] fPacketBatch;
   delete fReorderingBuffer;
 }
 
+#define MAX_PACKETS_PER_READ 64
+
+void MultiFramedRTPSource::setMaxPacketsPerRead(unsigned maxPacketsPerRead) {
+  if (maxPacketsPerRead == 0) maxPacketsPerRead = 1;
+  else if (maxPacketsPerRead > MAX_PACKETS_PER_READ) maxPacketsPerRead = MAX_PACKETS_PER_READ;
+
+  freePacketBatch();
+  delete[] fPacketBatch; fPacketBatch = NULL;
+  fMaxPacketsPerRead = maxPacketsPerRead;
+  if (fMaxPacketsPerRead > 1) {
+    fPacketBatch = new BufferedPacket*[fMaxPacketsPerRead];
+    for (unsigned i = 0; i < fMaxPacketsPerRead; ++i) fPacketBatch[i] = NULL;
+  }
+}
+
+void MultiFramedRTPSource::freePacketBatch() {
+  if (fPacketBatch == NULL) return;
+
+  for (unsigned i = 0; i < fMaxPacketsPerRead; ++i) {
+    if (fPacketBatch[i] != NULL) {
+      fReorderingBuffer->freePacket(fPacketBatch[i]);
+      fPacketBatch[i] = NULL;
+    }
+  }
+}
+
 Boolean MultiFramedRTPSource
 ::processSpecialHeader(BufferedPacket* /*packet*/,
 		       unsigned& resultSpecialHeaderSize) {
@@ -111,6 +167,7 @@ void MultiFramedRTPSource::doStopGettingFrames() {
   }
   envir().taskScheduler().unscheduleDelayedTask(nextTask());
   fRTPInterface.stopNetworkReading();
+  freePacketBatch();
   fReorderingBuffer->reset();
   reset();
 }
@@ -131,12 +188,12 @@ void MultiFramedRTPSource::doGetNextFrame() {
   doGetNextFrame1();
 }
 
-void MultiFramedRTPSource::doGetNextFrame1() {
+void MultiFramedRTPSource::doGetNextFrame1(struct timeval const* timeNow) {
   while (fNeedDelivery) {
     // If we already have packet data available, then deliver it now.
     Boolean packetLossPrecededThis;
     BufferedPacket* nextPacket
-      = fReorderingBuffer->getNextCompletedPacket(packetLossPrecededThis);
+      = fReorderingBuffer->getNextCompletedPacket(packetLossPrecededThis, timeNow);
     if (nextPacket == NULL) break;
 
     fNeedDelivery = False;
@@ -201,10 +258,16 @@ void MultiFramedRTPSource::doGetNextFrame1() {
 	// executed again without having first returned to the event loop.  Call our 'after getting' function
 	// directly, because there's no risk of a long chain of recursion (and thus stack overflow):
 	afterGetting(this);
+      } else if (fNumDirectDeliveries < MAX_PACKETS_PER_READ) {
+	// There are more queued incoming packets (e.g., because we've just read a batch of them).  Call our
+	// 'after getting' function directly anyway, but only a limited number of times before we next return to
+	// the event loop, so that the chain of recursion can't become too long:
+	++fNumDirectDeliveries;
+	afterGetting(this);
       } else {
 	// Special case: Call our 'after getting' function via the event loop.
 	nextTask() = envir().taskScheduler().scheduleDelayedTask(0,
-								 (TaskFunc*)FramedSource::afterGetting, this);
+								 (TaskFunc*)afterGettingFromEventLoop, this);
       }
     } else {
       // This packet contained fragmented data, and does not complete
@@ -226,7 +289,24 @@ void MultiFramedRTPSource::networkReadHandler(MultiFramedRTPSource* source, int
   source->networkReadHandler1();
 }
 
+void MultiFramedRTPSource::afterGettingFromEventLoop(MultiFramedRTPSource* source) {
+  source->fNumDirectDeliveries = 0;
+  afterGetting(source);
+}
+
 void MultiFramedRTPSource::networkReadHandler1() {
+  fNumDirectDeliveries = 0; // because we've been called from the event loop
+  if (fPacketBatch != NULL && fPacketReadInProgress == NULL && !fRTPInterface.nextReadIsFromTCP()) {
+    // Read (and process) several packets at once:
+    struct timeval timeNow;
+    if (readPacketBatch(timeNow)) {
+      doGetNextFrame1(&timeNow); // we've just got the current time, so don't get it again
+    } else {
+      doGetNextFrame1();
+    }
+    return;
+  }
+
   BufferedPacket* bPacket = fPacketReadInProgress;
   if (bPacket == NULL) {
     // Normal case: Get a free BufferedPacket descriptor to hold the new network packet:
@@ -235,10 +315,14 @@ void MultiFramedRTPSource::networkReadHandler1() {
 
   // Read the network packet, and perform sanity checks on the RTP header:
   Boolean readSuccess = False;
+  struct timeval timeNow;
   do {
     struct sockaddr_in fromAddress;
     Boolean packetReadWasIncomplete = fPacketReadInProgress != NULL;
-    if (!bPacket->fillInData(fRTPInterface, fromAddress, packetReadWasIncomplete)) {
+    Boolean const readIsFromTCP = fRTPInterface.nextReadIsFromTCP();
+    unsigned const bufferSize = readIsFromTCP ? MAX_PACKET_SIZE : fReorderingBuffer->packetBufferSize();
+      // (A packet that's read over TCP is never truncated, so we don't need to guess its size.)
+    if (!bPacket->fillInData(fRTPInterface, bufferSize, fromAddress, packetReadWasIncomplete)) {
       if (bPacket->bytesAvailable() == 0) { // should not happen??
 	envir() << "MultiFramedRTPSource internal error: Hit limit when reading incoming packet over TCP\n";
       }
@@ -252,6 +336,61 @@ void MultiFramedRTPSource::networkReadHandler1() {
     } else {
       fPacketReadInProgress = NULL;
     }
+    if (!readIsFromTCP
+	&& !fReorderingBuffer->noteIncomingPacketSize(bPacket->dataSize(), bPacket->dataSize() + bPacket->bytesAvailable())) break;
+
+    gettimeofday(&timeNow, NULL);
+    readSuccess = processIncomingPacket(bPacket, fromAddress, timeNow);
+  } while (0);
+  if (!readSuccess) {
+    fReorderingBuffer->freePacket(bPacket);
+    doGetNextFrame1();
+  } else {
+    doGetNextFrame1(&timeNow); // we've just got the current time, so don't get it again
+  }
+  // If we didn't get proper data this time, we'll get another chance
+}
+
+Boolean MultiFramedRTPSource::readPacketBatch(struct timeval& timeNow) {
+  // First, make sure that each entry in our batch has a free BufferedPacket descriptor:
+  unsigned char* buffers[MAX_PACKETS_PER_READ];
+  unsigned const bufferSize = fReorderingBuffer->packetBufferSize();
+  unsigned const maxPacketsToRead = bufferSize < MAX_PACKET_SIZE ? fMaxPacketsPerRead : 1;
+      // (If we don't yet know how large packets are, then read just one - into a full-size buffer.)
+  unsigned bufferMaxSize = 0;
+  for (unsigned i = 0; i < maxPacketsToRead; ++i) {
+    if (fPacketBatch[i] == NULL) fPacketBatch[i] = fReorderingBuffer->getFreePacket(this);
+    buffers[i] = fPacketBatch[i]->prepareForFillingIn(bufferSize);
+    unsigned bytesAvailable = fPacketBatch[i]->bytesAvailable();
+    if (i == 0 || bytesAvailable < bufferMaxSize) bufferMaxSize = bytesAvailable;
+  }
+
+  // Then, read as many network packets as are available (up to our limit):
+  unsigned bytesRead[MAX_PACKETS_PER_READ];
+  struct sockaddr_in fromAddresses[MAX_PACKETS_PER_READ];
+  unsigned numPacketsRead;
+  if (!fRTPInterface.handleReadBatch(buffers, bufferMaxSize, maxPacketsToRead,
+				     bytesRead, fromAddresses, numPacketsRead)) return False;
+
+  // Then process each packet in turn.  (Each packet that we use is removed from our batch.)
+  // (All of these packets were received at (effectively) the same time.)
+  gettimeofday(&timeNow, NULL);
+  for (unsigned i = 0; i < numPacketsRead; ++i) {
+    BufferedPacket* bPacket = fPacketBatch[i];
+    fPacketBatch[i] = NULL;
+
+    bPacket->noteFilledIn(bytesRead[i]);
+    if (!fReorderingBuffer->noteIncomingPacketSize(bytesRead[i], bufferMaxSize)
+	|| !processIncomingPacket(bPacket, fromAddresses[i], timeNow)) {
+      fReorderingBuffer->freePacket(bPacket);
+    }
+  }
+  return True;
+}
+
+Boolean MultiFramedRTPSource::processIncomingPacket(BufferedPacket* bPacket, struct sockaddr_in& fromAddress,
+						   struct timeval const& timeNow) {
+  do {
 #ifdef TEST_LOSS
     setPacketReorderingThresholdTime(0);
        // don't wait for 'lost' packets to arrive out-of-order later
@@ -324,35 +463,78 @@ void MultiFramedRTPSource::networkReadHandler1() {
 			  hasBeenSyncedUsingRTCP, bPacket->dataSize());
 
     // Fill in the rest of the packet descriptor, and store it:
-    struct timeval timeNow;
-    gettimeofday(&timeNow, NULL);
     bPacket->assignMiscParams(rtpSeqNo, rtpTimestamp, presentationTime,
 			      hasBeenSyncedUsingRTCP, rtpMarkerBit,
 			      timeNow);
     if (!fReorderingBuffer->storePacket(bPacket)) break;
 
-    readSuccess = True;
+    return True;
   } while (0);
-  if (!readSuccess) fReorderingBuffer->freePacket(bPacket);
 
-  doGetNextFrame1();
-  // If we didn't get proper data this time, we'll get another chance
+  return False;
 }
 
 
 ////////// BufferedPacket and BufferedPacketFactory implementation /////
 
-#define MAX_PACKET_SIZE 65536
+// Some packet subclasses (e.g., "JPEGBufferedPacket") write a few extra bytes past the end of the packet data,
+// so we leave this much space after the data when we grow a packet's buffer:
+#define PACKET_BUFFER_TAIL_ROOM 16
 
 BufferedPacket::BufferedPacket()
-  : fPacketSize(MAX_PACKET_SIZE),
-    fBuf(new unsigned char[MAX_PACKET_SIZE]),
-    fNextPacket(NULL) {
+  : fPacketSize(0), fBuf(NULL), fHead(0), fTail(0),
+    fPool(NULL), fNextPacket(NULL) {
+  // Note that we don't allocate our buffer until we're about to read data into it.
 }
 
 BufferedPacket::~BufferedPacket() {
   delete fNextPacket;
-  delete[] fBuf;
+  freeBuffer();
+}
+
+void BufferedPacket::resizeBuffer(unsigned minSize) {
+  if (minSize > MAX_PACKET_SIZE) minSize = MAX_PACKET_SIZE;
+
+  unsigned newPacketSize;
+  unsigned char* newBuf;
+  if (fPool != NULL) {
+    newBuf = fPool->allocate(minSize, newPacketSize);
+  } else {
+    newPacketSize = MAX_PACKET_SIZE;
+    newBuf = new unsigned char[newPacketSize];
+  }
+  if (newPacketSize == fPacketSize) {
+    // There's no change in our buffer size (this is the case, for example, if we don't have a pool):
+    if (fPool != NULL) fPool->deallocate(newBuf, newPacketSize); else delete[] newBuf;
+    return;
+  }
+
+  if (fTail > newPacketSize) fTail = newPacketSize; // shouldn't happen
+  if (fHead > fTail) fHead = fTail;
+  if (fTail > 0) memcpy(newBuf, fBuf, fTail);
+
+  freeBuffer();
+  fBuf = newBuf;
+  fPacketSize = newPacketSize;
+}
+
+void BufferedPacket::prepareBuffer(unsigned bufferSize) {
+  fHead = fTail = 0;
+  if (fPool == NULL) bufferSize = MAX_PACKET_SIZE; // we can't change our buffer's size
+  if (fPacketSize < bufferSize || fPacketSize/2 >= bufferSize) {
+    // Our buffer is too small - or (e.g., because it was used earlier to read a packet of unknown size) much too large:
+    resizeBuffer(bufferSize);
+  }
+  reset();
+}
+
+void BufferedPacket::freeBuffer() {
+  if (fPool != NULL) {
+    fPool->deallocate(fBuf, fPacketSize);
+  } else {
+    delete[] fBuf;
+  }
+  fBuf = NULL; fPacketSize = 0;
 }
 
 void BufferedPacket::reset() {
@@ -385,9 +567,9 @@ void BufferedPacket
   frameDurationInMicroseconds = 0; // by default.  Subclasses should correct this.
 }
 
-Boolean BufferedPacket::fillInData(RTPInterface& rtpInterface, struct sockaddr_in& fromAddress,
+Boolean BufferedPacket::fillInData(RTPInterface& rtpInterface, unsigned bufferSize, struct sockaddr_in& fromAddress,
 				   Boolean& packetReadWasIncomplete) {
-  if (!packetReadWasIncomplete) reset();
+  if (!packetReadWasIncomplete) prepareBuffer(bufferSize); // we're about to read a new packet
 
   unsigned const maxBytesToRead = bytesAvailable();
   if (maxBytesToRead == 0) return False; // exceeded buffer size when reading over TCP
@@ -405,6 +587,12 @@ Boolean BufferedPacket::fillInData(RTPInterface& rtpInterface, struct sockaddr_i
   return True;
 }
 
+unsigned char* BufferedPacket::prepareForFillingIn(unsigned bufferSize) {
+  prepareBuffer(bufferSize);
+
+  return &fBuf[fTail];
+}
+
 void BufferedPacket
 ::assignMiscParams(unsigned short rtpSeqNo, unsigned rtpTimestamp,
 		   struct timeval presentationTime,
@@ -429,6 +617,7 @@ void BufferedPacket::removePadding(unsigned numBytes) {
 }
 
 void BufferedPacket::appendData(unsigned char* newData, unsigned numBytes) {
+  if (numBytes > fPacketSize-fTail) resizeBuffer(fTail + numBytes + PACKET_BUFFER_TAIL_ROOM); // grow our buffer
   if (numBytes > fPacketSize-fTail) numBytes = fPacketSize - fTail;
   memmove(&fBuf[fTail], newData, numBytes);
   fTail += numBytes;
@@ -485,30 +674,78 @@ BufferedPacket* BufferedPacketFactory
 
 ////////// ReorderingPacketBuffer implementation //////////
 
+#ifndef REORDERING_BUFFER_INITIAL_RING_SIZE
+#define REORDERING_BUFFER_INITIAL_RING_SIZE 64
+#endif
+#define REORDERING_BUFFER_MAX_RING_SIZE 32768 // half of the sequence number space
+
 ReorderingPacketBuffer
-::ReorderingPacketBuffer(BufferedPacketFactory* packetFactory)
-  : fThresholdTime(100000) /* default reordering threshold: 100 ms */,
-    fHaveSeenFirstPacket(False), fHeadPacket(NULL), fTailPacket(NULL), fSavedPacket(NULL), fSavedPacketFree(True) {
+::ReorderingPacketBuffer(UsageEnvironment& env, BufferedPacketFactory* packetFactory)
+  : fPool(PacketBufferPool::reference(env)), fLargestPacketSize(0), fPacketBufferSize(MAX_PACKET_SIZE),
+    fThresholdTime(100000) /* default reordering threshold: 100 ms */,
+    fHaveSeenFirstPacket(False),
+    fRingSize(REORDERING_BUFFER_INITIAL_RING_SIZE), fNumPackets(0), fHeadSeqNo(0), fTailSeqNo(0),
+    fSavedPacket(NULL), fSavedPacketFree(True) {
   fPacketFactory = (packetFactory == NULL)
     ? (new BufferedPacketFactory)
     : packetFactory;
+
+  fRing = new BufferedPacket*[fRingSize];
+  for (unsigned i = 0; i < fRingSize; ++i) fRing[i] = NULL;
 }
 
 ReorderingPacketBuffer::~ReorderingPacketBuffer() {
   reset();
+  delete[] fRing;
   delete fPacketFactory;
+  fPool->release();
 }
 
 void ReorderingPacketBuffer::reset() {
-  if (fSavedPacketFree) delete fSavedPacket; // because fSavedPacket is not in the list
-  delete fHeadPacket; // will also delete fSavedPacket if it's in the list
+  freeStoredPackets();
+  if (fSavedPacketFree) delete fSavedPacket; // because fSavedPacket is not stored (if it was, it's now been freed)
   resetHaveSeenFirstPacket();
-  fHeadPacket = fTailPacket = fSavedPacket = NULL;
+  fSavedPacket = NULL;
+  fSavedPacketFree = True;
+}
+
+void ReorderingPacketBuffer::freeStoredPackets() {
+  if (fNumPackets == 0) return;
+
+  for (unsigned short seqNo = fHeadSeqNo; ; ++seqNo) {
+    BufferedPacket*& slot = slotFor(seqNo);
+    if (slot != NULL) {
+      freePacket(slot);
+      slot = NULL;
+      --fNumPackets;
+    }
+    if (seqNo == fTailSeqNo) break;
+  }
+  fNumPackets = 0; // should be already
+}
+
+Boolean ReorderingPacketBuffer::growRing(unsigned minSize) {
+  unsigned newRingSize = fRingSize;
+  while (newRingSize < minSize) newRingSize *= 2;
+  if (newRingSize > REORDERING_BUFFER_MAX_RING_SIZE) return False;
+
+  BufferedPacket** newRing = new BufferedPacket*[newRingSize];
+  for (unsigned i = 0; i < newRingSize; ++i) newRing[i] = NULL;
+  for (unsigned i = 0; i < fRingSize; ++i) {
+    BufferedPacket* packet = fRing[i];
+    if (packet != NULL) newRing[packet->rtpSeqNo()&(newRingSize-1)] = packet;
+  }
+
+  delete[] fRing;
+  fRing = newRing;
+  fRingSize = newRingSize;
+  return True;
 }
 
 BufferedPacket* ReorderingPacketBuffer::getFreePacket(MultiFramedRTPSource* ourSource) {
   if (fSavedPacket == NULL) { // we're being called for the first time
     fSavedPacket = fPacketFactory->createNewPacket(ourSource);
+    fSavedPacket->setPool(fPool);
     fSavedPacketFree = True;
   }
 
@@ -516,7 +753,9 @@ BufferedPacket* ReorderingPacketBuffer::getFreePacket(MultiFramedRTPSource* ourS
     fSavedPacketFree = False;
     return fSavedPacket;
   } else {
-    return fPacketFactory->createNewPacket(ourSource);
+    BufferedPacket* packet = fPacketFactory->createNewPacket(ourSource);
+    packet->setPool(fPool);
+    return packet;
   }
 }
 
@@ -524,6 +763,13 @@ Boolean ReorderingPacketBuffer::storePacket(BufferedPacket* bPacket) {
   unsigned short rtpSeqNo = bPacket->rtpSeqNo();
 
   if (!fHaveSeenFirstPacket) {
+    if (fNumPackets > 0
+	&& (unsigned short)(rtpSeqNo - fHeadSeqNo) >= REORDERING_BUFFER_MAX_RING_SIZE
+	&& (unsigned short)(fTailSeqNo - rtpSeqNo) >= REORDERING_BUFFER_MAX_RING_SIZE) {
+      // Any packets that we've already stored (from before the source's sequence numbers changed)
+      // are too far away to be stored along with this one, so throw them away:
+      freeStoredPackets();
+    }
     fNextExpectedSeqNo = rtpSeqNo; // initialization
     bPacket->isFirstPacket() = True;
     fHaveSeenFirstPacket = True;
@@ -533,76 +779,79 @@ Boolean ReorderingPacketBuffer::storePacket(BufferedPacket* bPacket) {
   // that we're looking for (in this case, it's been excessively delayed).
   if (seqNumLT(rtpSeqNo, fNextExpectedSeqNo)) return False;
 
-  if (fTailPacket == NULL) {
-    // Common case: There are no packets in the queue; this will be the first one:
-    bPacket->nextPacket() = NULL;
-    fHeadPacket = fTailPacket = bPacket;
-    return True;
-  }
-
-  if (seqNumLT(fTailPacket->rtpSeqNo(), rtpSeqNo)) {
-    // The next-most common case: There are packets already in the queue; this packet arrived in order => put it at the tail:
-    bPacket->nextPacket() = NULL;
-    fTailPacket->nextPacket() = bPacket;
-    fTailPacket = bPacket;
-    return True;
-  } 
-
-  if (rtpSeqNo == fTailPacket->rtpSeqNo()) {
-    // This is a duplicate packet - ignore it
-    return False;
-  }
+  if (fNumPackets == 0) {
+    // Common case: There are no packets stored; this will be the first one:
+    fHeadSeqNo = fTailSeqNo = rtpSeqNo;
+  } else {
+    // Figure out the range of sequence numbers that we'd have if we stored this packet, and make
+    // sure that our ring is large enough for this:
+    unsigned short newHeadSeqNo = fHeadSeqNo, newTailSeqNo = fTailSeqNo;
+    if (seqNumLT(fTailSeqNo, rtpSeqNo)) {
+      newTailSeqNo = rtpSeqNo; // the common case: the packet arrived in order
+    } else if (seqNumLT(rtpSeqNo, fHeadSeqNo)) {
+      newHeadSeqNo = rtpSeqNo;
+    }
+    unsigned const newRange = (unsigned short)(newTailSeqNo - newHeadSeqNo) + 1;
+    if (newRange > fRingSize && !growRing(newRange)) return False; // too far away to store
 
-  // Rare case: This packet is out-of-order.  Run through the list (from the head), to figure out where it belongs:
-  BufferedPacket* beforePtr = NULL;
-  BufferedPacket* afterPtr = fHeadPacket;
-  while (afterPtr != NULL) {
-    if (seqNumLT(rtpSeqNo, afterPtr->rtpSeqNo())) break; // it comes here
-    if (rtpSeqNo == afterPtr->rtpSeqNo()) {
+    if (slotFor(rtpSeqNo) != NULL) {
       // This is a duplicate packet - ignore it
       return False;
     }
-
-    beforePtr = afterPtr;
-    afterPtr = afterPtr->nextPacket();
+    fHeadSeqNo = newHeadSeqNo; fTailSeqNo = newTailSeqNo;
   }
 
-  // Link our new packet between "beforePtr" and "afterPtr":
-  bPacket->nextPacket() = afterPtr;
-  if (beforePtr == NULL) {
-    fHeadPacket = bPacket;
-  } else {
-    beforePtr->nextPacket() = bPacket;
+  bPacket->nextPacket() = NULL;
+  slotFor(rtpSeqNo) = bPacket;
+  ++fNumPackets;
+  return True;
+}
+
+Boolean ReorderingPacketBuffer::noteIncomingPacketSize(unsigned packetSize, unsigned bufferSize) {
+  if (packetSize + TunnelEncapsulationTrailerMaxSize >= bufferSize && bufferSize < MAX_PACKET_SIZE) {
+    // This packet filled its buffer, so it may have been truncated.  Discard it, and read the next packet into
+    // a full-size buffer, to find out how large packets have become:
+    fLargestPacketSize = 0;
+    fPacketBufferSize = MAX_PACKET_SIZE;
+    return False;
   }
 
+  if (packetSize > fLargestPacketSize) {
+    // Read new packets into buffers that are (at least) twice as large as the largest packet that we've seen so far.
+    // (This headroom means that we rarely need to discard a packet because packet sizes have increased.)
+    fLargestPacketSize = packetSize;
+    fPacketBufferSize = 2*packetSize + TunnelEncapsulationTrailerMaxSize + PACKET_BUFFER_TAIL_ROOM;
+    if (fPacketBufferSize > MAX_PACKET_SIZE) fPacketBufferSize = MAX_PACKET_SIZE;
+  }
   return True;
 }
 
 void ReorderingPacketBuffer::releaseUsedPacket(BufferedPacket* packet) {
-  // ASSERT: packet == fHeadPacket
+  // ASSERT: packet is the head packet
   // ASSERT: fNextExpectedSeqNo == packet->rtpSeqNo()
   ++fNextExpectedSeqNo; // because we're finished with this packet now
 
-  fHeadPacket = fHeadPacket->nextPacket();
-  if (!fHeadPacket) { 
-    fTailPacket = NULL;
+  slotFor(packet->rtpSeqNo()) = NULL;
+  if (--fNumPackets > 0) {
+    // Move forward to the next stored packet (which will become the new head):
+    do ++fHeadSeqNo; while (slotFor(fHeadSeqNo) == NULL);
   }
-  packet->nextPacket() = NULL;
 
   freePacket(packet);
 }
 
 BufferedPacket* ReorderingPacketBuffer
-::getNextCompletedPacket(Boolean& packetLossPreceded) {
-  if (fHeadPacket == NULL) return NULL;
+::getNextCompletedPacket(Boolean& packetLossPreceded, struct timeval const* timeNow) {
+  if (fNumPackets == 0) return NULL;
+  BufferedPacket* headPacket = slotFor(fHeadSeqNo);
 
   // Check whether the next packet we want is already at the head
   // of the queue:
-  // ASSERT: fHeadPacket->rtpSeqNo() >= fNextExpectedSeqNo
-  if (fHeadPacket->rtpSeqNo() == fNextExpectedSeqNo) {
-    packetLossPreceded = fHeadPacket->isFirstPacket();
+  // ASSERT: fHeadSeqNo >= fNextExpectedSeqNo
+  if (fHeadSeqNo == fNextExpectedSeqNo) {
+    packetLossPreceded = headPacket->isFirstPacket();
         // (The very first packet is treated as if there was packet loss beforehand.)
-    return fHeadPacket;
+    return headPacket;
   }
 
   // We're still waiting for our desired packet to arrive.  However, if
@@ -612,18 +861,21 @@ BufferedPacket* ReorderingPacketBuffer
   if (fThresholdTime == 0) {
     timeThresholdHasBeenExceeded = True; // optimization
   } else {
-    struct timeval timeNow;
-    gettimeofday(&timeNow, NULL);
+    struct timeval timeNowBuf;
+    if (timeNow == NULL) {
+      gettimeofday(&timeNowBuf, NULL);
+      timeNow = &timeNowBuf;
+    }
     unsigned uSecondsSinceReceived
-      = (timeNow.tv_sec - fHeadPacket->timeReceived().tv_sec)*1000000
-      + (timeNow.tv_usec - fHeadPacket->timeReceived().tv_usec);
+      = (timeNow->tv_sec - headPacket->timeReceived().tv_sec)*1000000
+      + (timeNow->tv_usec - headPacket->timeReceived().tv_usec);
     timeThresholdHasBeenExceeded = uSecondsSinceReceived > fThresholdTime;
   }
   if (timeThresholdHasBeenExceeded) {
-    fNextExpectedSeqNo = fHeadPacket->rtpSeqNo();
+    fNextExpectedSeqNo = fHeadSeqNo;
         // we've given up on earlier packets now
     packetLossPreceded = True;
-    return fHeadPacket;
+    return headPacket;
   }
 
   // Otherwise, keep waiting for our desired packet to arrive:
@@ -28,8 +28,14 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 class BufferedPacket; // forward
 class BufferedPacketFactory; // forward
+class PacketBufferPool; // forward
 
 class MultiFramedRTPSource: public RTPSource {
+public:
+  virtual void setMaxPacketsPerRead(unsigned maxPacketsPerRead);
+      // Setting this to a value larger than 1 (up to 64) lets us read up to this many packets at once (using
+      // "recvmmsg()", where available), and then process them all - before returning to the event loop.
+
 protected:
   MultiFramedRTPSource(UsageEnvironment& env, Groupsock* RTPgs,
 		       unsigned char rtpPayloadFormat,
@@ -62,20 +68,33 @@ private:
 
 private:
   void reset();
-  void doGetNextFrame1();
+  void doGetNextFrame1(struct timeval const* timeNow = NULL);
+      // "timeNow" (if not NULL) is the current time, if we already know it (e.g., because we've just read packets)
 
+  static void afterGettingFromEventLoop(MultiFramedRTPSource* source);
   static void networkReadHandler(MultiFramedRTPSource* source, int /*mask*/);
   void networkReadHandler1();
+  Boolean readPacketBatch(struct timeval& timeNow);
+      // returns True (and sets "timeNow" to the packets' reception time) iff we read packets
+  Boolean processIncomingPacket(BufferedPacket* bPacket, struct sockaddr_in& fromAddress,
+				struct timeval const& timeNow);
+      // checks the packet's RTP header, then stores it; returns False if the packet should be freed instead
+  void freePacketBatch();
 
   Boolean fAreDoingNetworkReads;
   BufferedPacket* fPacketReadInProgress;
   Boolean fNeedDelivery;
   Boolean fPacketLossInFragmentedFrame;
+  unsigned fNumDirectDeliveries; // of queued packets' data, since we were last called from the event loop
   unsigned char* fSavedTo;
   unsigned fSavedMaxSize;
 
   // A buffer to (optionally) hold incoming pkts that have been reorderered
   class ReorderingPacketBuffer* fReorderingBuffer;
+
+  // Used to read several incoming packets at once:
+  unsigned fMaxPacketsPerRead;
+  BufferedPacket** fPacketBatch; // each entry (if non-NULL) is a free packet, waiting to be filled in
 };
 
 
@@ -91,7 +110,12 @@ public:
   Boolean hasUsableData() const { return fTail > fHead; }
   unsigned useCount() const { return fUseCount; }
 
-  Boolean fillInData(RTPInterface& rtpInterface, struct sockaddr_in& fromAddress, Boolean& packetReadWasIncomplete);
+  Boolean fillInData(RTPInterface& rtpInterface, unsigned bufferSize, struct sockaddr_in& fromAddress,
+		     Boolean& packetReadWasIncomplete);
+      // "bufferSize" is the size of the buffer to read a new packet into (if "packetReadWasIncomplete" is False)
+  // Alternatively, when packets are read in batches, the reader calls:
+  unsigned char* prepareForFillingIn(unsigned bufferSize); // then reads up to "bytesAvailable()" bytes, then:
+  void noteFilledIn(unsigned numBytesRead) { fTail += numBytesRead; }
   void assignMiscParams(unsigned short rtpSeqNo, unsigned rtpTimestamp,
 			struct timeval presentationTime,
 			Boolean hasBeenSyncedUsingRTCP,
@@ -132,6 +156,16 @@ protected:
   unsigned fTail;
 
 private:
+  friend class ReorderingPacketBuffer;
+  void setPool(PacketBufferPool* pool) { fPool = pool; }
+  void resizeBuffer(unsigned minSize);
+      // replaces "fBuf" with a buffer of (at least) "minSize" bytes, preserving the data (up to "fTail") that's already there
+  void prepareBuffer(unsigned bufferSize);
+      // called before reading a new packet: empties our buffer, and makes its size (about) "bufferSize" bytes
+  void freeBuffer();
+
+private:
+  PacketBufferPool* fPool; // if non-NULL, where our buffer "fBuf" comes from
   BufferedPacket* fNextPacket; // used to link together packets
 
   unsigned fUseCount;
@@ -537,6 +537,11 @@ void StreamState
     if (fRTCPgs != NULL && !(fRTCPgs == fRTPgs && dests->rtcpPort.num() == dests->rtpPort.num())) {
       fRTCPgs->addDestination(dests->addr, dests->rtcpPort, clientSessionId);
     }
+#ifndef DONT_BATCH_SHARED_STREAM_OUTPUT
+    // If this stream is now being shared by several clients (i.e., "reuseFirstSource"), then each RTP packet gets sent to
+    // each of them.  Queue these datagrams, so that they get sent using as few system calls as possible:
+    if (fRTPgs != NULL && fRTPgs->hasMultipleDestinations()) fRTPgs->setOutputBatching(True);
+#endif
     if (fRTCPInstance != NULL) {
       fRTCPInstance->setSpecificRRHandler(dests->addr.s_addr, dests->rtcpPort,
 					  rtcpRRHandler, rtcpRRHandlerClientData);
@@ -592,6 +597,7 @@ void StreamState::endPlaying(Destinations* dests, unsigned clientSessionId) {
     // Tell the RTP and RTCP 'groupsocks' to stop using these destinations:
     if (fRTPgs != NULL) fRTPgs->removeDestination(clientSessionId);
     if (fRTCPgs != NULL && fRTCPgs != fRTPgs) fRTCPgs->removeDestination(clientSessionId);
+    if (fRTPgs != NULL && !fRTPgs->hasMultipleDestinations()) fRTPgs->setOutputBatching(False); // (which sends any queued datagrams)
     if (fRTCPInstance != NULL) {
       fRTCPInstance->unsetSpecificRRHandler(dests->addr.s_addr, dests->rtcpPort);
     }
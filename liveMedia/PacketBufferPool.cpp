@@ -0,0 +1,137 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2018 Live Networks, Inc.  All rights reserved.
+// A pool of (variable-sized) buffers, used to hold incoming RTP packets (and the request/response buffers of
+// RTSP server connections).
+// Implementation
+
+#include "PacketBufferPool.hh"
+#include "Media.hh"
+
+PacketBufferPool* PacketBufferPool::reference(UsageEnvironment& env) {
+  _Tables* ourTables = _Tables::getOurTables(env);
+  if (ourTables->packetBufferPool == NULL) {
+    ourTables->packetBufferPool = new PacketBufferPool(env);
+  }
+
+  PacketBufferPool* pool = (PacketBufferPool*)(ourTables->packetBufferPool);
+  ++pool->fReferenceCount;
+  return pool;
+}
+
+void PacketBufferPool::release() {
+  if (--fReferenceCount > 0) return;
+
+  // We're no longer being used, so delete ourself (and perhaps the '_Tables' structure that points to us):
+  _Tables* ourTables = _Tables::getOurTables(fEnv, False);
+  if (ourTables != NULL) {
+    ourTables->packetBufferPool = NULL;
+    ourTables->reclaimIfPossible();
+  }
+  delete this;
+}
+
+PacketBufferPool* PacketBufferPool::lookup(UsageEnvironment& env) {
+  _Tables* ourTables = _Tables::getOurTables(env, False);
+  if (ourTables == NULL) return NULL;
+
+  return (PacketBufferPool*)(ourTables->packetBufferPool);
+}
+
+PacketBufferPool::PacketBufferPool(UsageEnvironment& env)
+  : fEnv(env), fReferenceCount(0),
+    fNumBytesInUse(0), fMaxNumBytesInUse(0), fNumBytesAllocated(0), fMaxNumBytesAllocated(0) {
+  for (unsigned i = 0; i < PACKET_BUFFER_POOL_NUM_SIZE_CLASSES; ++i) {
+    fSizeClasses[i].freeList = NULL;
+    fSizeClasses[i].numFree = fSizeClasses[i].numInUse = fSizeClasses[i].maxNumInUse = 0;
+  }
+}
+
+PacketBufferPool::~PacketBufferPool() {
+  // Delete all unused buffers.  (Any buffers that are still in use are the responsibility of their owners.)
+  for (unsigned i = 0; i < PACKET_BUFFER_POOL_NUM_SIZE_CLASSES; ++i) {
+    unsigned char* buffer = fSizeClasses[i].freeList;
+    while (buffer != NULL) {
+      unsigned char* nextBuffer = *(unsigned char**)buffer;
+      delete[] buffer;
+      buffer = nextBuffer;
+    }
+  }
+}
+
+unsigned PacketBufferPool::sizeClassFor(unsigned size) {
+  unsigned sizeClass = 0;
+  while (sizeClass < PACKET_BUFFER_POOL_NUM_SIZE_CLASSES-1 && sizeOfClass(sizeClass) < size) ++sizeClass;
+
+  return sizeClass;
+}
+
+unsigned char* PacketBufferPool::allocate(unsigned minSize, unsigned& resultSize) {
+  unsigned const sizeClass = sizeClassFor(minSize);
+  SizeClass& sc = fSizeClasses[sizeClass];
+  resultSize = sizeOfClass(sizeClass);
+
+  unsigned char* buffer;
+  if (sc.freeList != NULL) {
+    // Common case: Reuse a buffer that was freed earlier:
+    buffer = sc.freeList;
+    sc.freeList = *(unsigned char**)buffer;
+    --sc.numFree;
+  } else {
+    buffer = new unsigned char[resultSize];
+    fNumBytesAllocated += resultSize;
+    if (fNumBytesAllocated > fMaxNumBytesAllocated) fMaxNumBytesAllocated = fNumBytesAllocated;
+  }
+
+  if (++sc.numInUse > sc.maxNumInUse) sc.maxNumInUse = sc.numInUse;
+  fNumBytesInUse += resultSize;
+  if (fNumBytesInUse > fMaxNumBytesInUse) fMaxNumBytesInUse = fNumBytesInUse;
+
+  return buffer;
+}
+
+void PacketBufferPool::deallocate(unsigned char* buffer, unsigned bufferSize) {
+  if (buffer == NULL) return;
+
+  unsigned const sizeClass = sizeClassFor(bufferSize);
+  SizeClass& sc = fSizeClasses[sizeClass];
+  --sc.numInUse;
+  fNumBytesInUse -= bufferSize;
+
+  if (sc.numFree < PACKET_BUFFER_POOL_MAX_FREE_PER_SIZE_CLASS) {
+    // Keep this buffer around, for later reuse:
+    *(unsigned char**)buffer = sc.freeList;
+    sc.freeList = buffer;
+    ++sc.numFree;
+  } else {
+    delete[] buffer;
+    fNumBytesAllocated -= bufferSize;
+  }
+}
+
+void PacketBufferPool::printStatistics(UsageEnvironment& env) const {
+  env << "Packet buffer pool: "
+      << (unsigned)fNumBytesInUse << " bytes in use (max " << (unsigned)fMaxNumBytesInUse << "); "
+      << (unsigned)fNumBytesAllocated << " bytes allocated (max " << (unsigned)fMaxNumBytesAllocated << ")\n";
+  for (unsigned i = 0; i < PACKET_BUFFER_POOL_NUM_SIZE_CLASSES; ++i) {
+    SizeClass const& sc = fSizeClasses[i];
+    if (sc.maxNumInUse == 0) continue;
+
+    env << "\t" << sizeOfClass(i) << "-byte buffers: " << sc.numInUse << " in use (max " << sc.maxNumInUse
+	<< "), " << sc.numFree << " free\n";
+  }
+}
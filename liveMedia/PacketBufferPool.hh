@@ -0,0 +1,95 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2018 Live Networks, Inc.  All rights reserved.
+// A pool of (variable-sized) buffers, used to hold incoming RTP packets (and the request/response buffers of
+// RTSP server connections).
+// C++ header
+
+#ifndef _PACKET_BUFFER_POOL_HH
+#define _PACKET_BUFFER_POOL_HH
+
+#ifndef _USAGE_ENVIRONMENT_HH
+#include "UsageEnvironment.hh"
+#endif
+
+// Buffers are allocated in power-of-two 'size classes', from 2^PACKET_BUFFER_POOL_MIN_SIZE_LOG2 bytes
+// up to 2^PACKET_BUFFER_POOL_MAX_SIZE_LOG2 bytes (the largest packet that we can receive):
+#define PACKET_BUFFER_POOL_MIN_SIZE_LOG2 9
+#define PACKET_BUFFER_POOL_MAX_SIZE_LOG2 16
+#define PACKET_BUFFER_POOL_NUM_SIZE_CLASSES (PACKET_BUFFER_POOL_MAX_SIZE_LOG2-PACKET_BUFFER_POOL_MIN_SIZE_LOG2+1)
+
+// The maximum number of unused buffers (of each size class) that we keep around for later reuse.
+// (Any others are deleted when they're freed.)
+#ifndef PACKET_BUFFER_POOL_MAX_FREE_PER_SIZE_CLASS
+#define PACKET_BUFFER_POOL_MAX_FREE_PER_SIZE_CLASS 64
+#endif
+
+class PacketBufferPool {
+public:
+  static PacketBufferPool* reference(UsageEnvironment& env);
+      // returns the pool that's shared by everyone in this environment (creating it if necessary).
+      // Each call to "reference()" should be paired with a call to "release()".
+  void release();
+
+  static PacketBufferPool* lookup(UsageEnvironment& env);
+      // returns the existing pool (if any) for this environment, without taking a reference to it;
+      // useful for reporting statistics
+
+  unsigned char* allocate(unsigned minSize, unsigned& resultSize);
+      // "resultSize" is the size of the buffer that's actually returned: "minSize" rounded up to its size class
+      // ("minSize" must not exceed "maxBufferSize()")
+  void deallocate(unsigned char* buffer, unsigned bufferSize);
+      // "bufferSize" must be the "resultSize" returned by "allocate()"
+
+  static unsigned maxBufferSize() { return 1<<PACKET_BUFFER_POOL_MAX_SIZE_LOG2; }
+
+  // Statistics:
+  static unsigned numSizeClasses() { return PACKET_BUFFER_POOL_NUM_SIZE_CLASSES; }
+  static unsigned sizeOfClass(unsigned sizeClass) { return 1<<(sizeClass+PACKET_BUFFER_POOL_MIN_SIZE_LOG2); }
+  unsigned numBuffersInUse(unsigned sizeClass) const { return fSizeClasses[sizeClass].numInUse; }
+  unsigned maxNumBuffersInUse(unsigned sizeClass) const { return fSizeClasses[sizeClass].maxNumInUse; }
+      // the 'high-water mark' for this size class
+  unsigned numFreeBuffers(unsigned sizeClass) const { return fSizeClasses[sizeClass].numFree; }
+  u_int64_t numBytesInUse() const { return fNumBytesInUse; }
+  u_int64_t maxNumBytesInUse() const { return fMaxNumBytesInUse; }
+  u_int64_t numBytesAllocated() const { return fNumBytesAllocated; } // includes free (but not yet deleted) buffers
+  u_int64_t maxNumBytesAllocated() const { return fMaxNumBytesAllocated; }
+  void printStatistics(UsageEnvironment& env) const;
+
+protected:
+  PacketBufferPool(UsageEnvironment& env);
+  virtual ~PacketBufferPool();
+
+private:
+  static unsigned sizeClassFor(unsigned size);
+
+private:
+  UsageEnvironment& fEnv;
+  unsigned fReferenceCount;
+
+  struct SizeClass {
+    unsigned char* freeList; // unused buffers are chained together (through their first bytes)
+    unsigned numFree;
+    unsigned numInUse;
+    unsigned maxNumInUse;
+  } fSizeClasses[PACKET_BUFFER_POOL_NUM_SIZE_CLASSES];
+
+  u_int64_t fNumBytesInUse, fMaxNumBytesInUse;
+  u_int64_t fNumBytesAllocated, fMaxNumBytesAllocated;
+};
+
+#endif
@@ -26,6 +26,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef MILLION
 #define MILLION 1000000
 #endif
+#ifndef PROXY_MAX_PACKETS_PER_READ
+#define PROXY_MAX_PACKETS_PER_READ 16 // the most incoming RTP packets (per stream) that we read at once (see "setMaxPacketsPerRead()")
+#endif
 
 // A "OnDemandServerMediaSubsession" subclass, used to implement a unicast RTSP server that's proxying another RTSP stream:
 
@@ -533,6 +536,11 @@ FramedSource* ProxyServerMediaSubsession::createNewStreamSource(unsigned clientS
     }
 
     if (fClientMediaSubsession.readSource() != NULL) {
+      // We may be proxying many (high bitrate) streams, so read several incoming packets at once, when we can:
+      if (fClientMediaSubsession.rtpSource() != NULL) {
+	fClientMediaSubsession.rtpSource()->setMaxPacketsPerRead(PROXY_MAX_PACKETS_PER_READ);
+      }
+
       // First, check whether we have defined a 'transcoder' filter to be used with this codec:
       if (sms->fTranscodingTable != NULL) {
 	char* outputCodecName;
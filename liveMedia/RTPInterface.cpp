@@ -64,9 +64,16 @@ public:
     fErrorHandlerClientData = clientData;
   }
 
+  int readBufferedData(u_int8_t* to, unsigned numBytes);
+      // Used (instead of "readSocket()") to read packet data from this socket: first from our buffer, then
+      // (for any remaining bytes) directly from the socket.
+      // Returns the number of bytes read (which may be < "numBytes"), 0 if no data is available, or -1 on error.
+
 private:
   static void tcpReadHandler(SocketDescriptor*, int mask);
+  static void bufferedDataHandler(void* clientData);
   Boolean tcpReadHandler1(int mask);
+  int fillReadBuffer(); // returns the result of "readSocket()"
 
 private:
   UsageEnvironment& fEnv;
@@ -77,6 +84,10 @@ private:
   ErrorHandler* fErrorHandler;
   void* fErrorHandlerClientData;
   u_int8_t fStreamChannelId, fSizeByte1;
+  // We read the socket in large chunks (rather than one byte at a time), into the following buffer:
+  u_int8_t* fReadBuffer;
+  unsigned fReadBufferStart, fReadBufferEnd; // the data that we've read, but not yet consumed
+  TaskToken fBufferedDataTask;
   Boolean fReadErrorOccurred, fDeleteMyselfNext, fAreInReadHandlerLoop;
   enum { AWAITING_DOLLAR, AWAITING_STREAM_CHANNEL_ID, AWAITING_SIZE1, AWAITING_SIZE2, AWAITING_PACKET_DATA } fTCPReadingState;
 };
@@ -248,6 +259,27 @@ Boolean RTPInterface::sendPacket(unsigned char* packet, unsigned packetSize) {
   return success;
 }
 
+Boolean RTPInterface::sendPacket(unsigned char* header, unsigned headerSize,
+				 unsigned char* payload, unsigned payloadSize) {
+  Boolean success = True; // we'll return False instead if any of the sends fail
+
+  // Normal case: Send as a UDP packet:
+  if (!fGS->output(envir(), header, headerSize, payload, payloadSize)) success = False;
+
+  // Also, send over each of our TCP sockets:
+  tcpStreamRecord* nextStream;
+  for (tcpStreamRecord* stream = fTCPStreams; stream != NULL; stream = nextStream) {
+    nextStream = stream->fNext; // Set this now, in case the following deletes "stream":
+    if (!sendRTPorRTCPPacketOverTCP(header, headerSize,
+				    stream->fStreamSocketNum, stream->fStreamChannelId,
+				    payload, payloadSize)) {
+      success = False;
+    }
+  }
+
+  return success;
+}
+
 void RTPInterface
 ::startNetworkReading(TaskScheduler::BackgroundHandlerProc* handlerProc) {
   // Normal case: Arrange to read UDP packets:
@@ -281,14 +313,19 @@ Boolean RTPInterface::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
     tcpSocketNum = fNextTCPReadStreamSocketNum;
     tcpStreamChannelId = fNextTCPReadStreamChannelId;
 
+    // Some (often all) of the packet data is usually already in the socket's read buffer:
+    SocketDescriptor* socketDescriptor = lookupSocketDescriptor(envir(), fNextTCPReadStreamSocketNum, False);
+    fromAddress.sin_addr.s_addr = 0;
+
     bytesRead = 0;
     unsigned totBytesToRead = fNextTCPReadSize;
     if (totBytesToRead > bufferMaxSize) totBytesToRead = bufferMaxSize;
     unsigned curBytesToRead = totBytesToRead;
     int curBytesRead;
-    while ((curBytesRead = readSocket(envir(), fNextTCPReadStreamSocketNum,
-				      &buffer[bytesRead], curBytesToRead,
-				      fromAddress)) > 0) {
+    while ((curBytesRead = socketDescriptor != NULL
+	    ? socketDescriptor->readBufferedData(&buffer[bytesRead], curBytesToRead)
+	    : readSocket(envir(), fNextTCPReadStreamSocketNum,
+			 &buffer[bytesRead], curBytesToRead, fromAddress)) > 0) {
       bytesRead += curBytesRead;
       if (bytesRead >= totBytesToRead) break;
       curBytesToRead -= curBytesRead;
@@ -316,6 +353,19 @@ Boolean RTPInterface::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
   return readSuccess;
 }
 
+Boolean RTPInterface::handleReadBatch(unsigned char* const* buffers, unsigned bufferMaxSize, unsigned numBuffers,
+				      unsigned* bytesRead, struct sockaddr_in* fromAddresses, unsigned& numPacketsRead) {
+  if (!fGS->handleReadBatch(buffers, bufferMaxSize, numBuffers, bytesRead, fromAddresses, numPacketsRead)) return False;
+
+  if (fAuxReadHandlerFunc != NULL) {
+    // Also pass the newly-read packet data to our auxilliary handler:
+    for (unsigned i = 0; i < numPacketsRead; ++i) {
+      (*fAuxReadHandlerFunc)(fAuxReadHandlerClientData, buffers[i], bytesRead[i]);
+    }
+  }
+  return True;
+}
+
 void RTPInterface::stopNetworkReading() {
   // Normal case
   if (fGS != NULL) envir().taskScheduler().turnOffBackgroundReadHandling(fGS->socketNum());
@@ -329,8 +379,39 @@ void RTPInterface::stopNetworkReading() {
 
 ////////// Helper Functions - Implementation /////////
 
+#ifndef RTPINTERFACE_MAX_COMBINED_TCP_HEADER_SIZE
+#define RTPINTERFACE_MAX_COMBINED_TCP_HEADER_SIZE 256
+#endif
+
 Boolean RTPInterface::sendRTPorRTCPPacketOverTCP(u_int8_t* packet, unsigned packetSize,
-						 int socketNum, unsigned char streamChannelId) {
+						 int socketNum, unsigned char streamChannelId,
+						 u_int8_t* payload, unsigned payloadSize) {
+  if (payloadSize > 0) {
+    // The packet is made up of two pieces: "packet" (e.g., a RTP header), then "payload".
+    unsigned const totalPacketSize = packetSize + payloadSize;
+    do {
+      u_int8_t framingHeader[4 + RTPINTERFACE_MAX_COMBINED_TCP_HEADER_SIZE];
+      framingHeader[0] = '$';
+      framingHeader[1] = streamChannelId;
+      framingHeader[2] = (u_int8_t) ((totalPacketSize&0xFF00)>>8);
+      framingHeader[3] = (u_int8_t) (totalPacketSize&0xFF);
+      if (packetSize <= RTPINTERFACE_MAX_COMBINED_TCP_HEADER_SIZE) {
+	// Common case: Send the framing header and the first piece using a single "send()":
+	memmove(&framingHeader[4], packet, packetSize);
+	if (!sendDataOverTCP(socketNum, framingHeader, 4 + packetSize, False)) break;
+      } else {
+	if (!sendDataOverTCP(socketNum, framingHeader, 4, False)) break;
+	if (!sendDataOverTCP(socketNum, packet, packetSize, True)) break;
+      }
+
+      if (!sendDataOverTCP(socketNum, payload, payloadSize, True)) break;
+
+      return True;
+    } while (0);
+
+    return False;
+  }
+
 #ifdef DEBUG_SEND
   fprintf(stderr, "sendRTPorRTCPPacketOverTCP: %d bytes over channel %d (socket %d)\n",
 	  packetSize, streamChannelId, socketNum); fflush(stderr);
@@ -366,6 +447,10 @@ Boolean RTPInterface::sendRTPorRTCPPacketOverTCP(u_int8_t* packet, unsigned pack
 #define RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS 500
 #endif
 
+#ifndef RTPINTERFACE_TCP_READ_BUFFER_SIZE
+#define RTPINTERFACE_TCP_READ_BUFFER_SIZE 16384
+#endif
+
 Boolean RTPInterface::sendDataOverTCP(int socketNum, u_int8_t const* data, unsigned dataSize, Boolean forceSendToSucceed) {
   int sendResult = send(socketNum, (char const*)data, dataSize, 0/*flags*/);
   if (sendResult < (int)dataSize) {
@@ -413,11 +498,14 @@ SocketDescriptor::SocketDescriptor(UsageEnvironment& env, int socketNum)
   :fEnv(env), fOurSocketNum(socketNum),
     fSubChannelHashTable(HashTable::create(ONE_WORD_HASH_KEYS)),
    fServerRequestAlternativeByteHandler(NULL), fServerRequestAlternativeByteHandlerClientData(NULL),
+   fErrorHandler(NULL), fErrorHandlerClientData(NULL),
+   fReadBuffer(new u_int8_t[RTPINTERFACE_TCP_READ_BUFFER_SIZE]), fReadBufferStart(0), fReadBufferEnd(0), fBufferedDataTask(NULL),
    fReadErrorOccurred(False), fDeleteMyselfNext(False), fAreInReadHandlerLoop(False), fTCPReadingState(AWAITING_DOLLAR) {
 }
 
 SocketDescriptor::~SocketDescriptor() {
   fEnv.taskScheduler().turnOffBackgroundReadHandling(fOurSocketNum);
+  fEnv.taskScheduler().unscheduleDelayedTask(fBufferedDataTask);
   removeSocketDescription(fEnv, fOurSocketNum);
 
   if (fSubChannelHashTable != NULL) {
@@ -441,12 +529,22 @@ SocketDescriptor::~SocketDescriptor() {
 
   // Finally:
   if (fServerRequestAlternativeByteHandler != NULL) {
+    if (!fReadErrorOccurred) {
+      // Any data that we've read from the socket, but not yet consumed, must be (RTSP) data for our alternative byte handler,
+      // which is about to take over the socket:
+      while (fReadBufferStart < fReadBufferEnd) {
+	u_int8_t c = fReadBuffer[fReadBufferStart++];
+	if (c != 0xFF && c != 0xFE) (*fServerRequestAlternativeByteHandler)(fServerRequestAlternativeByteHandlerClientData, c);
+      }
+    }
+
     // Hack: Pass a special character to our alternative byte handler, to tell it that either
     // - an error occurred when reading the TCP socket, or
     // - no error occurred, but it needs to take over control of the TCP socket once again.
     u_int8_t specialChar = fReadErrorOccurred ? 0xFF : 0xFE;
     (*fServerRequestAlternativeByteHandler)(fServerRequestAlternativeByteHandlerClientData, specialChar);
   }
+  delete[] fReadBuffer;
 }
 
 void SocketDescriptor::registerRTPInterface(unsigned char streamChannelId,
@@ -496,7 +594,21 @@ void SocketDescriptor::tcpReadHandler(SocketDescriptor* socketDescriptor, int ma
   socketDescriptor->fAreInReadHandlerLoop = True;
   while (!socketDescriptor->fDeleteMyselfNext && socketDescriptor->tcpReadHandler1(mask) && --count > 0) {}
   socketDescriptor->fAreInReadHandlerLoop = False;
-  if (socketDescriptor->fDeleteMyselfNext) delete socketDescriptor;
+  if (socketDescriptor->fDeleteMyselfNext) {
+    delete socketDescriptor;
+  } else if (socketDescriptor->fReadBufferStart < socketDescriptor->fReadBufferEnd
+	     && socketDescriptor->fBufferedDataTask == NULL) {
+    // We stopped (to avoid starving other sockets) while we still have buffered data.  Because the socket itself
+    // might not become readable again, arrange to handle this data (from the event loop) ASAP:
+    socketDescriptor->fBufferedDataTask
+      = socketDescriptor->fEnv.taskScheduler().scheduleDelayedTask(0, bufferedDataHandler, socketDescriptor);
+  }
+}
+
+void SocketDescriptor::bufferedDataHandler(void* clientData) {
+  SocketDescriptor* socketDescriptor = (SocketDescriptor*)clientData;
+  socketDescriptor->fBufferedDataTask = NULL;
+  tcpReadHandler(socketDescriptor, SOCKET_READABLE);
 }
 
 Boolean SocketDescriptor::tcpReadHandler1(int mask) {
@@ -509,14 +621,13 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask) {
   // However, because the socket is being read asynchronously, this data might arrive in pieces.
   
   u_int8_t c;
-  struct sockaddr_in fromAddress;
   if (fTCPReadingState != AWAITING_PACKET_DATA) {
-    int result = readSocket(fEnv, fOurSocketNum, &c, 1, fromAddress);
+    int result = fReadBufferStart < fReadBufferEnd ? 1 : fillReadBuffer();
     if (result == 0) { // There was no more data to read
       return False;
-    } else if (result != 1) { // error reading TCP socket, so we will no longer handle it
+    } else if (result < 0) { // error reading TCP socket, so we will no longer handle it
 #ifdef DEBUG_RECEIVE
-      fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): readSocket(1 byte) returned %d (error)\n", fOurSocketNum, result);
+      fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): readSocket() returned %d (error)\n", fOurSocketNum, result);
 #endif
       if (fErrorHandler)
         (*fErrorHandler)(fErrorHandlerClientData);
@@ -524,6 +635,16 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask) {
       fDeleteMyselfNext = True;
       return False;
     }
+
+    if (fTCPReadingState == AWAITING_DOLLAR && fReadBufferEnd - fReadBufferStart >= 4
+	&& fReadBuffer[fReadBufferStart] == '$' && lookupRTPInterface(fReadBuffer[fReadBufferStart+1]) != NULL) {
+      // Common case: We have a complete '$<streamChannelId><packetSize>' header in our buffer, so handle it all at once:
+      fStreamChannelId = fReadBuffer[fReadBufferStart+1];
+      fSizeByte1 = fReadBuffer[fReadBufferStart+2];
+      fReadBufferStart += 3;
+      fTCPReadingState = AWAITING_SIZE2;
+    }
+    c = fReadBuffer[fReadBufferStart++];
   }
 
   Boolean callAgain = True;
@@ -578,7 +699,7 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask) {
       break;
     }
     case AWAITING_PACKET_DATA: {
-      callAgain = False;
+      callAgain = fReadBufferStart < fReadBufferEnd; // keep going if we've already buffered more data
       fTCPReadingState = AWAITING_DOLLAR; // the next state, unless we end up having to read more data in the current state
       // Call the appropriate read handler to get the packet data from the TCP stream:
       RTPInterface* rtpInterface = lookupRTPInterface(fStreamChannelId);
@@ -597,10 +718,10 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask) {
 #ifdef DEBUG_RECEIVE
 	  fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): No handler proc for \"rtpInterface\" for channel %d; need to skip %d remaining bytes\n", fOurSocketNum, fStreamChannelId, rtpInterface->fNextTCPReadSize);
 #endif
-	  int result = readSocket(fEnv, fOurSocketNum, &c, 1, fromAddress);
+	  int result = fReadBufferStart < fReadBufferEnd ? 1 : fillReadBuffer();
 	  if (result < 0) { // error reading TCP socket, so we will no longer handle it
 #ifdef DEBUG_RECEIVE
-	    fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): readSocket(1 byte) returned %d (error)\n", fOurSocketNum, result);
+	    fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): readSocket() returned %d (error)\n", fOurSocketNum, result);
 #endif
       if (fErrorHandler)
         (*fErrorHandler)(fErrorHandlerClientData);
@@ -609,8 +730,12 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask) {
 	    return False;
 	  } else {
 	    fTCPReadingState = AWAITING_PACKET_DATA;
-	    if (result == 1) {
-	      --rtpInterface->fNextTCPReadSize;
+	    if (result > 0) {
+	      // Skip as much of the packet data as we have buffered:
+	      unsigned numBytesToSkip = fReadBufferEnd - fReadBufferStart;
+	      if (numBytesToSkip > rtpInterface->fNextTCPReadSize) numBytesToSkip = rtpInterface->fNextTCPReadSize;
+	      fReadBufferStart += numBytesToSkip;
+	      rtpInterface->fNextTCPReadSize -= numBytesToSkip;
 	      callAgain = True;
 	    }
 	  }
@@ -625,6 +750,36 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask) {
   return callAgain;
 }
 
+int SocketDescriptor::readBufferedData(u_int8_t* to, unsigned numBytes) {
+  // First, use whatever data we've already buffered:
+  unsigned numBytesBuffered = fReadBufferEnd - fReadBufferStart;
+  unsigned numBytesCopied = numBytes < numBytesBuffered ? numBytes : numBytesBuffered;
+  memmove(to, &fReadBuffer[fReadBufferStart], numBytesCopied);
+  fReadBufferStart += numBytesCopied;
+  if (numBytesCopied == numBytes) return numBytesCopied;
+
+  // Then read the rest directly into the caller's buffer (rather than first into our buffer, then copying it):
+  struct sockaddr_in fromAddress;
+  int result = readSocket(fEnv, fOurSocketNum, &to[numBytesCopied], numBytes - numBytesCopied, fromAddress);
+  if (result < 0) {
+    // If we've already copied some data, then return that; we'll see the error again on our next read:
+    return numBytesCopied > 0 ? (int)numBytesCopied : result;
+  }
+
+  return numBytesCopied + result;
+}
+
+int SocketDescriptor::fillReadBuffer() {
+  // Note: We're called only when our buffer is empty.
+  fReadBufferStart = fReadBufferEnd = 0;
+
+  struct sockaddr_in fromAddress;
+  int result = readSocket(fEnv, fOurSocketNum, fReadBuffer, RTPINTERFACE_TCP_READ_BUFFER_SIZE, fromAddress);
+  if (result > 0) fReadBufferEnd = result;
+
+  return result;
+}
+
 
 ////////// tcpStreamRecord implementation //////////
 
@@ -74,6 +74,9 @@ public:
   );
 
   Boolean sendPacket(unsigned char* packet, unsigned packetSize);
+  Boolean sendPacket(unsigned char* header, unsigned headerSize,
+		     unsigned char* payload, unsigned payloadSize);
+      // Sends a packet that's made up of two separate pieces of data, without first copying them together
   void startNetworkReading(TaskScheduler::BackgroundHandlerProc*
                            handlerProc);
   Boolean handleRead(unsigned char* buffer, unsigned bufferMaxSize,
@@ -88,6 +91,13 @@ public:
   // Otherwise (if "tcpSocketNum" >= 0), the packet was received (interleaved) over TCP, and
   //   "tcpStreamChannelId" will return the channel id.
 
+  Boolean nextReadIsFromTCP() const { return fNextTCPReadStreamSocketNum >= 0; }
+  Boolean handleReadBatch(unsigned char* const* buffers, unsigned bufferMaxSize, unsigned numBuffers,
+			  // out parameters:
+			  unsigned* bytesRead, struct sockaddr_in* fromAddresses, unsigned& numPacketsRead);
+  // Reads up to "numBuffers" packets (using a single system call, if possible) from our 'groupsock'.
+  // This must be called only if "nextReadIsFromTCP()" is False.
+
   void stopNetworkReading();
 
   UsageEnvironment& envir() const { return fOwner->envir(); }
@@ -106,7 +116,8 @@ public:
 private:
   // Helper functions for sending a RTP or RTCP packet over a TCP connection:
   Boolean sendRTPorRTCPPacketOverTCP(unsigned char* packet, unsigned packetSize,
-				     int socketNum, unsigned char streamChannelId);
+				     int socketNum, unsigned char streamChannelId,
+				     unsigned char* payload = NULL, unsigned payloadSize = 0);
   Boolean sendDataOverTCP(int socketNum, u_int8_t const* data, unsigned dataSize, Boolean forceSendToSucceed);
 
 private:
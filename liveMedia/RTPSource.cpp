@@ -42,6 +42,9 @@ Boolean RTPSource::lookupByName(UsageEnvironment& env,
   return True;
 }
 
+void RTPSource::setMaxPacketsPerRead(unsigned /*maxPacketsPerRead*/) {
+}
+
 Boolean RTPSource::hasBeenSynchronizedUsingRTCP() {
   return fCurPacketHasBeenSynchronizedUsingRTCP;
 }
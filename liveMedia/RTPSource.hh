@@ -42,6 +42,10 @@ public:
 
   virtual void setPacketReorderingThresholdTime(unsigned uSeconds) = 0;
 
+  virtual void setMaxPacketsPerRead(unsigned maxPacketsPerRead);
+      // By default, we read just one incoming (UDP) packet each time that our socket becomes readable.  Subclasses that can
+      // read several packets at once (e.g., "MultiFramedRTPSource") redefine this; our implementation does nothing.
+
   // used by RTCP:
   u_int32_t SSRC() const { return fSSRC; }
       // Note: This is *our* SSRC, not the SSRC in incoming RTP packets.
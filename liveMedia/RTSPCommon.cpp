@@ -48,19 +48,56 @@ static void decodeURL(char* url) {
   *url = '\0';
 }
 
-Boolean parseRTSPRequestString(char const* reqStr,
-			       unsigned reqStrSize,
-			       char* resultCmdName,
-			       unsigned resultCmdNameMaxSize,
-			       char* resultURLPreSuffix,
-			       unsigned resultURLPreSuffixMaxSize,
-			       char* resultURLSuffix,
-			       unsigned resultURLSuffixMaxSize,
-			       char* resultCSeq,
-			       unsigned resultCSeqMaxSize,
-                               char* resultSessionIdStr,
-                               unsigned resultSessionIdStrMaxSize,
-			       unsigned& contentLength) {
+Boolean RTSPSubstring::equals(char const* s) const {
+  return strlen(s) == len && memcmp(str, s, len) == 0;
+}
+
+Boolean RTSPSubstring::copyTo(char* result, unsigned resultMaxSize) const {
+  if (len >= resultMaxSize) return False; // there's no room
+
+  memcpy(result, str, len);
+  result[len] = '\0';
+  return True;
+}
+
+Boolean copyDecodedURL(RTSPSubstring const& url, char* result, unsigned resultMaxSize) {
+  if (!url.copyTo(result, resultMaxSize)) return False;
+
+  decodeURL(result);
+  return True;
+}
+
+static Boolean findHeader(char const* headerName, unsigned headerNameLen,
+			  char const* reqStr, unsigned reqStrSize, unsigned& j) {
+  // Look (case insensitively) for the next occurrence of "headerName" at or after position "j".  If found,
+  // set "j" to the position of its value (after any whitespace):
+  char const firstChar = headerName[0]|0x20; // lower case
+  for (; (int)j < (int)(reqStrSize-headerNameLen); ++j) {
+    if ((reqStr[j]|0x20) == firstChar // a quick check, before the full comparison
+	&& _strncasecmp(headerName, &reqStr[j], headerNameLen) == 0) {
+      j += headerNameLen;
+      while (j < reqStrSize && (reqStr[j] ==  ' ' || reqStr[j] == '\t')) ++j;
+      return True;
+    }
+  }
+  return False;
+}
+
+static Boolean getRestOfLine(char const* reqStr, unsigned reqStrSize, unsigned j, RTSPSubstring& result) {
+  // Set "result" to everything from position "j" up to the next \r or \n.  Returns False if there's no \r or \n:
+  result.str = &reqStr[j];
+  for (unsigned k = j; k < reqStrSize; ++k) {
+    if (reqStr[k] == '\r' || reqStr[k] == '\n') {
+      result.len = k - j;
+      return True;
+    }
+  }
+
+  result.len = reqStrSize - j;
+  return False;
+}
+
+Boolean parseRTSPRequest(char const* reqStr, unsigned reqStrSize, RTSPRequestParts& result) {
   // This parser is currently rather dumb; it should be made smarter #####
 
   // "Be liberal in what you accept": Skip over any whitespace at the start of the request:
@@ -71,20 +108,11 @@ Boolean parseRTSPRequestString(char const* reqStr,
   }
   if (i == reqStrSize) return False; // The request consisted of nothing but whitespace!
 
-  // Then read everything up to the next space (or tab) as the command name:
-  Boolean parseSucceeded = False;
-  unsigned i1 = 0;
-  for (; i1 < resultCmdNameMaxSize-1 && i < reqStrSize; ++i,++i1) {
-    char c = reqStr[i];
-    if (c == ' ' || c == '\t') {
-      parseSucceeded = True;
-      break;
-    }
-
-    resultCmdName[i1] = c;
-  }
-  resultCmdName[i1] = '\0';
-  if (!parseSucceeded) return False;
+  // Then everything up to the next space (or tab) is the command name:
+  result.cmdName.str = &reqStr[i];
+  for (; i < reqStrSize && reqStr[i] != ' ' && reqStr[i] != '\t'; ++i) {}
+  if (i == reqStrSize) return False;
+  result.cmdName.len = &reqStr[i] - result.cmdName.str;
 
   // Skip over the prefix of any "rtsp://" or "rtsp:/" URL that follows:
   unsigned j = i+1;
@@ -110,7 +138,7 @@ Boolean parseRTSPRequestString(char const* reqStr,
   }
 
   // Look for the URL suffix (before the following "RTSP/"):
-  parseSucceeded = False;
+  Boolean parseSucceeded = False;
   for (unsigned k = i+1; (int)k < (int)(reqStrSize-5); ++k) {
     if (reqStr[k] == 'R' && reqStr[k+1] == 'T' &&
 	reqStr[k+2] == 'S' && reqStr[k+3] == 'P' && reqStr[k+4] == '/') {
@@ -123,24 +151,13 @@ Boolean parseRTSPRequestString(char const* reqStr,
       //   k: last non-space before "RTSP/"
       //   k1: last slash in the range [i,k]
 
-      // The URL suffix comes from [k1+1,k]
-      // Copy "resultURLSuffix":
-      unsigned n = 0, k2 = k1+1;
-      if (k2 <= k) {
-        if (k - k1 + 1 > resultURLSuffixMaxSize) return False; // there's no room
-        while (k2 <= k) resultURLSuffix[n++] = reqStr[k2++];
-      }
-      resultURLSuffix[n] = '\0';
-
-      // The URL 'pre-suffix' comes from [i+1,k1-1]
-      // Copy "resultURLPreSuffix":
-      n = 0; k2 = i+1;
-      if (k2+1 <= k1) {
-        if (k1 - i > resultURLPreSuffixMaxSize) return False; // there's no room
-        while (k2 <= k1-1) resultURLPreSuffix[n++] = reqStr[k2++];
-      }
-      resultURLPreSuffix[n] = '\0';
-      decodeURL(resultURLPreSuffix);
+      // The URL suffix comes from [k1+1,k]:
+      result.urlSuffix.str = &reqStr[k1+1];
+      result.urlSuffix.len = k1+1 <= k ? k - k1 : 0;
+
+      // The URL 'pre-suffix' comes from [i+1,k1-1]:
+      result.urlPreSuffix.str = &reqStr[i+1];
+      result.urlPreSuffix.len = i+2 <= k1 ? k1 - (i+1) : 0;
 
       i = k + 7; // to go past " RTSP/"
       parseSucceeded = True;
@@ -149,62 +166,60 @@ Boolean parseRTSPRequestString(char const* reqStr,
   }
   if (!parseSucceeded) return False;
 
-  // Look for "CSeq:" (mandatory, case insensitive), skip whitespace,
-  // then read everything up to the next \r or \n as 'CSeq':
-  parseSucceeded = False;
-  for (j = i; (int)j < (int)(reqStrSize-5); ++j) {
-    if (_strncasecmp("CSeq:", &reqStr[j], 5) == 0) {
-      j += 5;
-      while (j < reqStrSize && (reqStr[j] ==  ' ' || reqStr[j] == '\t')) ++j;
-      unsigned n;
-      for (n = 0; n < resultCSeqMaxSize-1 && j < reqStrSize; ++n,++j) {
-	char c = reqStr[j];
-	if (c == '\r' || c == '\n') {
-	  parseSucceeded = True;
-	  break;
-	}
-
-	resultCSeq[n] = c;
-      }
-      resultCSeq[n] = '\0';
-      break;
-    }
-  }
-  if (!parseSucceeded) return False;
+  // Look for "CSeq:" (mandatory, case insensitive); everything up to the next \r or \n is the 'CSeq':
+  j = i;
+  if (!findHeader("CSeq:", 5, reqStr, reqStrSize, j)) return False;
+  if (!getRestOfLine(reqStr, reqStrSize, j, result.cseq)) return False;
 
-  // Look for "Session:" (optional, case insensitive), skip whitespace,
-  // then read everything up to the next \r or \n as 'Session':
-  resultSessionIdStr[0] = '\0'; // default value (empty string)
-  for (j = i; (int)j < (int)(reqStrSize-8); ++j) {
-    if (_strncasecmp("Session:", &reqStr[j], 8) == 0) {
-      j += 8;
-      while (j < reqStrSize && (reqStr[j] ==  ' ' || reqStr[j] == '\t')) ++j;
-      unsigned n;
-      for (n = 0; n < resultSessionIdStrMaxSize-1 && j < reqStrSize; ++n,++j) {
-	char c = reqStr[j];
-	if (c == '\r' || c == '\n') {
-	  break;
-	}
-
-	resultSessionIdStr[n] = c;
-      }
-      resultSessionIdStr[n] = '\0';
-      break;
-    }
+  // Look for "Session:" (optional, case insensitive):
+  j = i;
+  if (findHeader("Session:", 8, reqStr, reqStrSize, j)) {
+    (void)getRestOfLine(reqStr, reqStrSize, j, result.sessionId);
+  } else {
+    result.sessionId.str = "";
+    result.sessionId.len = 0;
   }
 
-  // Also: Look for "Content-Length:" (optional, case insensitive)
-  contentLength = 0; // default value
-  for (j = i; (int)j < (int)(reqStrSize-15); ++j) {
-    if (_strncasecmp("Content-Length:", &(reqStr[j]), 15) == 0) {
-      j += 15;
-      while (j < reqStrSize && (reqStr[j] ==  ' ' || reqStr[j] == '\t')) ++j;
-      unsigned num;
-      if (sscanf(&reqStr[j], "%u", &num) == 1) {
-	contentLength = num;
-      }
+  // Also: Look for "Content-Length:" (optional, case insensitive).  (If there's more than one, the last one counts.)
+  result.contentLength = 0; // default value
+  for (j = i; findHeader("Content-Length:", 15, reqStr, reqStrSize, j); ) {
+    if (j < reqStrSize && reqStr[j] >= '0' && reqStr[j] <= '9') {
+      unsigned num = 0;
+      for (; j < reqStrSize && reqStr[j] >= '0' && reqStr[j] <= '9'; ++j) num = 10*num + (reqStr[j] - '0');
+      result.contentLength = num;
     }
   }
+
+  return True;
+}
+
+Boolean parseRTSPRequestString(char const* reqStr,
+			       unsigned reqStrSize,
+			       char* resultCmdName,
+			       unsigned resultCmdNameMaxSize,
+			       char* resultURLPreSuffix,
+			       unsigned resultURLPreSuffixMaxSize,
+			       char* resultURLSuffix,
+			       unsigned resultURLSuffixMaxSize,
+			       char* resultCSeq,
+			       unsigned resultCSeqMaxSize,
+                               char* resultSessionIdStr,
+                               unsigned resultSessionIdStrMaxSize,
+			       unsigned& contentLength) {
+  RTSPRequestParts parts;
+  if (!parseRTSPRequest(reqStr, reqStrSize, parts)) return False;
+
+  if (!parts.cmdName.copyTo(resultCmdName, resultCmdNameMaxSize)
+      || !parts.urlSuffix.copyTo(resultURLSuffix, resultURLSuffixMaxSize)
+      || !copyDecodedURL(parts.urlPreSuffix, resultURLPreSuffix, resultURLPreSuffixMaxSize)
+      || !parts.cseq.copyTo(resultCSeq, resultCSeqMaxSize)) return False;
+
+  // A too-long 'Session' is truncated:
+  RTSPSubstring sessionId = parts.sessionId;
+  if (sessionId.len >= resultSessionIdStrMaxSize) sessionId.len = resultSessionIdStrMaxSize-1;
+  sessionId.copyTo(resultSessionIdStr, resultSessionIdStrMaxSize);
+
+  contentLength = parts.contentLength;
   return True;
 }
 
@@ -38,6 +38,35 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #define RTSP_PARAM_STRING_MAX 200
 
+// A sequence of characters within a request string (not necessarily '\0'-terminated):
+class RTSPSubstring {
+public:
+  Boolean equals(char const* s) const; // (case-sensitive)
+  Boolean copyTo(char* result, unsigned resultMaxSize) const;
+      // Copies (and '\0'-terminates) the characters into "result".  Returns False (copying nothing) if they don't fit.
+
+public:
+  char const* str;
+  unsigned len;
+};
+
+// The parts of a RTSP request that are needed in order to handle it.
+// Each of these refers to - rather than copies - part of the request string:
+class RTSPRequestParts {
+public:
+  RTSPSubstring cmdName, urlPreSuffix, urlSuffix, cseq, sessionId;
+      // "urlPreSuffix" has not yet been URL-decoded (see "copyDecodedURL()" below).
+      // "sessionId" is empty (i.e., has "len" 0) if there was no "Session:" header.
+  unsigned contentLength;
+};
+
+Boolean parseRTSPRequest(char const* reqStr, unsigned reqStrSize, RTSPRequestParts& result);
+    // Parses a RTSP request, without copying or allocating anything.  ("parseRTSPRequestString()"
+    // (below) does the same parsing, but copies the results into separate strings.)
+
+Boolean copyDecodedURL(RTSPSubstring const& url, char* result, unsigned resultMaxSize);
+    // Like "RTSPSubstring::copyTo()", but also replaces any %<hex><hex> sequences with the appropriate 8-bit character
+
 Boolean parseRTSPRequestString(char const *reqStr, unsigned reqStrSize,
 			       char *resultCmdName,
 			       unsigned resultCmdNameMaxSize,
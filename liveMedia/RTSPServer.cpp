@@ -272,11 +272,27 @@ RTSPServer::RTSPClientConnection
 ::RTSPClientConnection(RTSPServer& ourServer, int clientSocket, struct sockaddr_in clientAddr)
   : GenericMediaServer::ClientConnection(ourServer, clientSocket, clientAddr),
     fOurRTSPServer(ourServer), fClientInputSocket(fOurSocket), fClientOutputSocket(fOurSocket),
-    fIsActive(True), fRecursionCount(0), fOurSessionCookie(NULL) {
+    fIsActive(True), fOurSessionCookie(NULL),
+    fSessionAwaitingSDPDescription(NULL), fDeferredCSeq(NULL), fNumDecodedDeferredBytes(0), fRequestBytesAreDecoded(False) {
   resetRequestBuffer();
 }
 
+static void releaseServerMediaSession(GenericMediaServer& server, ServerMediaSession* session) {
+  // Decrement its reference count, now that we're done using it:
+  session->decrementReferenceCount();
+  if (session->referenceCount() == 0 && session->deleteWhenUnreferenced()) {
+    server.removeServerMediaSession(session);
+  }
+}
+
 RTSPServer::RTSPClientConnection::~RTSPClientConnection() {
+  if (fSessionAwaitingSDPDescription != NULL) {
+    // We were still waiting to send a "DESCRIBE" response:
+    fSessionAwaitingSDPDescription->cancelSDPDescriptionNotification(continueHandlingDESCRIBE, this);
+    releaseServerMediaSession(fOurServer, fSessionAwaitingSDPDescription);
+  }
+  delete[] fDeferredCSeq;
+
   if (fOurSessionCookie != NULL) {
     // We were being used for RTSP-over-HTTP tunneling. Also remove ourselves from the 'session cookie' hash table before we go:
     fOurRTSPServer.fClientConnectionsForHTTPTunneling->Remove(fOurSessionCookie);
@@ -289,7 +305,7 @@ RTSPServer::RTSPClientConnection::~RTSPClientConnection() {
 // Handler routines for specific RTSP commands:
 
 void RTSPServer::RTSPClientConnection::handleCmd_OPTIONS() {
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+  snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	   "RTSP/1.0 200 OK\r\nCSeq: %s\r\n%sPublic: %s\r\n\r\n",
 	   fCurrentCSeq, dateHeader(), fOurRTSPServer.allowedCommandNames());
 }
@@ -312,36 +328,51 @@ void RTSPServer::RTSPClientConnection
 
 void RTSPServer::RTSPClientConnection
 ::handleCmd_DESCRIBE(char const* urlPreSuffix, char const* urlSuffix, char const* fullRequestStr) {
-  ServerMediaSession* session = NULL;
+  char urlTotalSuffix[2*RTSP_PARAM_STRING_MAX];
+      // enough space for urlPreSuffix/urlSuffix'\0'
+  urlTotalSuffix[0] = '\0';
+  if (urlPreSuffix[0] != '\0') {
+    strcat(urlTotalSuffix, urlPreSuffix);
+    strcat(urlTotalSuffix, "/");
+  }
+  strcat(urlTotalSuffix, urlSuffix);
+
+  if (!authenticationOK("DESCRIBE", urlTotalSuffix, fullRequestStr)) return;
+
+  // We should really check that the request contains an "Accept:" #####
+  // for "application/sdp", because that's what we're sending back #####
+
+  // Begin by looking up the "ServerMediaSession" object for the specified "urlTotalSuffix":
+  ServerMediaSession* session = fOurServer.lookupServerMediaSession(urlTotalSuffix);
+  if (session == NULL) {
+    handleCmd_notFound();
+    return;
+  }
+
+  // Increment the "ServerMediaSession" object's reference count, in case someone removes it
+  // while we're using it:
+  session->incrementReferenceCount();
+
+  // If the session's SDP description can't yet be generated without blocking (e.g., because it depends upon data that
+  // must first be read from a file), then don't block the server; instead, defer our response until it's ready.
+  // (We don't do this for RTSP-over-HTTP tunneling, because we'd then have to hold back already-decoded request data.)
+  if (fClientOutputSocket == fClientInputSocket
+      && !session->sdpDescriptionIsReady(continueHandlingDESCRIBE, this)) {
+    fSessionAwaitingSDPDescription = session;
+    fNumDecodedDeferredBytes = 0;
+    delete[] fDeferredCSeq; fDeferredCSeq = strDup(fCurrentCSeq);
+    fResponseBuffer[0] = '\0'; // we'll respond later, from "continueHandlingDESCRIBE1()"
+    return;
+  }
+
+  completeCmd_DESCRIBE(session);
+}
+
+void RTSPServer::RTSPClientConnection::completeCmd_DESCRIBE(ServerMediaSession* session) {
   char* sdpDescription = NULL;
   char* rtspURL = NULL;
   do {
-    char urlTotalSuffix[2*RTSP_PARAM_STRING_MAX];
-        // enough space for urlPreSuffix/urlSuffix'\0'
-    urlTotalSuffix[0] = '\0';
-    if (urlPreSuffix[0] != '\0') {
-      strcat(urlTotalSuffix, urlPreSuffix);
-      strcat(urlTotalSuffix, "/");
-    }
-    strcat(urlTotalSuffix, urlSuffix);
-    
-    if (!authenticationOK("DESCRIBE", urlTotalSuffix, fullRequestStr)) break;
-    
-    // We should really check that the request contains an "Accept:" #####
-    // for "application/sdp", because that's what we're sending back #####
-    
-    // Begin by looking up the "ServerMediaSession" object for the specified "urlTotalSuffix":
-    session = fOurServer.lookupServerMediaSession(urlTotalSuffix);
-    if (session == NULL) {
-      handleCmd_notFound();
-      break;
-    }
-    
-    // Increment the "ServerMediaSession" object's reference count, in case someone removes it
-    // while we're using it:
-    session->incrementReferenceCount();
-
-    // Then, assemble a SDP description for this session:
+    // Assemble a SDP description for this session:
     sdpDescription = session->generateSDPDescription();
     if (sdpDescription == NULL) {
       // This usually means that a file name that was specified for a
@@ -355,7 +386,7 @@ void RTSPServer::RTSPClientConnection
     // (which is necessary to ensure that the correct URL gets used in subsequent "SETUP" requests).
     rtspURL = fOurRTSPServer.rtspURL(session, fClientInputSocket);
     
-    snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+    snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	     "RTSP/1.0 200 OK\r\nCSeq: %s\r\n"
 	     "%s"
 	     "Content-Base: %s/\r\n"
@@ -369,18 +400,53 @@ void RTSPServer::RTSPClientConnection
 	     sdpDescription);
   } while (0);
   
-  if (session != NULL) {
-    // Decrement its reference count, now that we're done using it:
-    session->decrementReferenceCount();
-    if (session->referenceCount() == 0 && session->deleteWhenUnreferenced()) {
-      fOurServer.removeServerMediaSession(session);
-    }
-  }
+  releaseServerMediaSession(fOurServer, session);
 
   delete[] sdpDescription;
   delete[] rtspURL;
 }
 
+void RTSPServer::RTSPClientConnection::continueHandlingDESCRIBE(void* instance) {
+  RTSPClientConnection* connection = (RTSPClientConnection*)instance;
+  connection->continueHandlingDESCRIBE1();
+}
+
+void RTSPServer::RTSPClientConnection::continueHandlingDESCRIBE1() {
+  ServerMediaSession* session = fSessionAwaitingSDPDescription;
+  if (session == NULL) return; // sanity check
+  if (!session->sdpDescriptionIsReady(continueHandlingDESCRIBE, this)) return; // we're still waiting for another subsession
+
+  fSessionAwaitingSDPDescription = NULL;
+  fCurrentCSeq = fDeferredCSeq;
+  completeCmd_DESCRIBE(session);
+#ifdef DEBUG
+  fprintf(stderr, "sending (deferred) response: %s", fResponseBuffer);
+#endif
+  send(fClientOutputSocket, (char const*)fResponseBuffer, strlen((char*)fResponseBuffer), 0);
+  fCurrentCSeq = NULL;
+  delete[] fDeferredCSeq; fDeferredCSeq = NULL;
+
+  // Then handle any (pipelined) request data that arrived while we were waiting.  Some of this data may have been
+  // read from a RTSP-over-HTTP tunnel (if the tunnel was set up while we were waiting), and so still needs to be
+  // Base64-decoded.  Do this first (in place), so that we can then handle all of the data without decoding it again:
+  compactRequestBuffer();
+  unsigned numDeferredRequestBytes = fRequestBytesAlreadySeen;
+  unsigned numDecodedBytes = fNumDecodedDeferredBytes;
+  if (numDecodedBytes > numDeferredRequestBytes) numDecodedBytes = numDeferredRequestBytes; // sanity check
+  fNumDecodedDeferredBytes = 0;
+  resetRequestBuffer();
+  if (numDeferredRequestBytes > numDecodedBytes) {
+    numDeferredRequestBytes
+      = numDecodedBytes + base64DecodeRequestBytes(&fRequestBuffer[numDecodedBytes], numDeferredRequestBytes - numDecodedBytes);
+  }
+  if (numDeferredRequestBytes > 0) {
+    fRequestBytesAreDecoded = True;
+    handleRequestBytes(numDeferredRequestBytes); // note: this might "delete this"
+  } else if (fRecursionCount == 0) {
+    releaseBuffers(); // until the next request arrives
+  }
+}
+
 static void lookForHeader(char const* headerName, char const* source, unsigned sourceLen, char* resultStr, unsigned resultMaxSize) {
   resultStr[0] = '\0';  // by default, return an empty string
   unsigned headerNameLen = strlen(headerName);
@@ -405,13 +471,13 @@ static void lookForHeader(char const* headerName, char const* source, unsigned s
 
 void RTSPServer::RTSPClientConnection::handleCmd_bad() {
   // Don't do anything with "fCurrentCSeq", because it might be nonsense
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+  snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	   "RTSP/1.0 400 Bad Request\r\n%sAllow: %s\r\n\r\n",
 	   dateHeader(), fOurRTSPServer.allowedCommandNames());
 }
 
 void RTSPServer::RTSPClientConnection::handleCmd_notSupported() {
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+  snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	   "RTSP/1.0 405 Method Not Allowed\r\nCSeq: %s\r\n%sAllow: %s\r\n\r\n",
 	   fCurrentCSeq, dateHeader(), fOurRTSPServer.allowedCommandNames());
 }
@@ -434,8 +500,8 @@ Boolean RTSPServer::RTSPClientConnection::parseHTTPRequestString(char* resultCmd
 								 char* acceptStr, unsigned acceptStrMaxSize) {
   // Check for the limited HTTP requests that we expect for specifying RTSP-over-HTTP tunneling.
   // This parser is currently rather dumb; it should be made smarter #####
-  char const* reqStr = (char const*)fRequestBuffer;
-  unsigned const reqStrSize = fRequestBytesAlreadySeen;
+  char const* reqStr = (char const*)&fRequestBuffer[fRequestStart];
+  unsigned const reqStrSize = fRequestBytesAlreadySeen - fRequestStart;
   
   // Read everything up to the first space as the command name:
   Boolean parseSucceeded = False;
@@ -482,13 +548,13 @@ Boolean RTSPServer::RTSPClientConnection::parseHTTPRequestString(char* resultCmd
 }
 
 void RTSPServer::RTSPClientConnection::handleHTTPCmd_notSupported() {
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+  snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	   "HTTP/1.1 405 Method Not Allowed\r\n%s\r\n\r\n",
 	   dateHeader());
 }
 
 void RTSPServer::RTSPClientConnection::handleHTTPCmd_notFound() {
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+  snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	   "HTTP/1.1 404 Not Found\r\n%s\r\n\r\n",
 	   dateHeader());
 }
@@ -498,7 +564,7 @@ void RTSPServer::RTSPClientConnection::handleHTTPCmd_OPTIONS() {
   fprintf(stderr, "Handled HTTP \"OPTIONS\" request\n");
 #endif
   // Construct a response to the "OPTIONS" command that notes that our special headers (for RTSP-over-HTTP tunneling) are allowed:
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+  snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	   "HTTP/1.1 200 OK\r\n"
 	   "%s"
 	   "Access-Control-Allow-Origin: *\r\n"
@@ -522,7 +588,7 @@ void RTSPServer::RTSPClientConnection::handleHTTPCmd_TunnelingGET(char const* se
 #endif
   
   // Construct our response:
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+  snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	   "HTTP/1.1 200 OK\r\n"
 	   "%s"
 	   "Cache-Control: no-cache\r\n"
@@ -565,10 +631,62 @@ void RTSPServer::RTSPClientConnection::handleHTTPCmd_StreamingGET(char const* /*
 void RTSPServer::RTSPClientConnection::resetRequestBuffer() {
   ClientConnection::resetRequestBuffer();
   
-  fLastCRLF = &fRequestBuffer[-3]; // hack: Ensures that we don't think we have end-of-msg if the data starts with <CR><LF>
+  fRequestStart = 0;
+  fLastCRLFIndex = -3; // hack: Ensures that we don't think we have end-of-msg if the data starts with <CR><LF>
   fBase64RemainderCount = 0;
 }
 
+void RTSPServer::RTSPClientConnection::compactRequestBuffer() {
+  if (fRequestStart == 0) return;
+
+  unsigned numBytesRemaining = fRequestBytesAlreadySeen - fRequestStart;
+  memmove(fRequestBuffer, &fRequestBuffer[fRequestStart], numBytesRemaining);
+  fRequestBytesAlreadySeen = numBytesRemaining;
+  fRequestBufferBytesLeft += fRequestStart;
+  fLastCRLFIndex -= fRequestStart;
+  fRequestStart = 0;
+}
+
+unsigned RTSPServer::RTSPClientConnection::base64DecodeRequestBytes(unsigned char* ptr, unsigned numNewBytes) {
+  // First, remove any whitespace that may be in the input data:
+  unsigned toIndex = 0;
+  for (unsigned fromIndex = 0; fromIndex < numNewBytes; ++fromIndex) {
+    char c = ptr[fromIndex];
+    if (!(c == ' ' || c == '\t' || c == '\r' || c == '\n')) { // not 'whitespace': space,tab,CR,NL
+      ptr[toIndex++] = c;
+    }
+  }
+  numNewBytes = toIndex;
+
+  unsigned numBytesToDecode = fBase64RemainderCount + numNewBytes;
+  unsigned newBase64RemainderCount = numBytesToDecode%4;
+  numBytesToDecode -= newBase64RemainderCount;
+  if (numBytesToDecode > 0) {
+    ptr[numNewBytes] = '\0';
+    unsigned decodedSize;
+    unsigned char* decodedBytes = base64Decode((char const*)(ptr-fBase64RemainderCount), numBytesToDecode, decodedSize);
+#ifdef DEBUG
+    fprintf(stderr, "Base64-decoded %d input bytes into %d new bytes:", numBytesToDecode, decodedSize);
+    for (unsigned k = 0; k < decodedSize; ++k) fprintf(stderr, "%c", decodedBytes[k]);
+    fprintf(stderr, "\n");
+#endif
+
+    // Copy the new decoded bytes in place of the old ones (we can do this because there are fewer decoded bytes than original):
+    unsigned char* to = ptr-fBase64RemainderCount;
+    for (unsigned i = 0; i < decodedSize; ++i) *to++ = decodedBytes[i];
+
+    // Then copy any remaining (undecoded) bytes to the end:
+    for (unsigned j = 0; j < newBase64RemainderCount; ++j) *to++ = (ptr-fBase64RemainderCount+numBytesToDecode)[j];
+
+    numNewBytes = decodedSize - fBase64RemainderCount + newBase64RemainderCount;
+      // adjust to allow for the size of the new decoded data (+ remainder)
+    delete[] decodedBytes;
+  }
+  fBase64RemainderCount = newBase64RemainderCount;
+
+  return numNewBytes;
+}
+
 void RTSPServer::RTSPClientConnection::closeSocketsRTSP() {
   // First, tell our server to stop any streaming that it might be doing over our output socket:
   fOurRTSPServer.stopTCPStreamingOnSocket(fClientOutputSocket);
@@ -598,14 +716,39 @@ void RTSPServer::RTSPClientConnection::handleAlternativeRequestByte1(u_int8_t re
 						  incomingRequestHandler, this);
   } else {
     // Normal case: Add this character to our buffer; then try to handle the data that we have buffered so far:
+    prepareRequestBuffer();
     if (fRequestBufferBytesLeft == 0 || fRequestBytesAlreadySeen >= REQUEST_BUFFER_SIZE) return;
     fRequestBuffer[fRequestBytesAlreadySeen] = requestByte;
     handleRequestBytes(1);
   }
 }
 
+// The commands that we handle (looked up without copying the command name from the request):
+static char const* const knownCommandNames[] = {
+  "OPTIONS", "DESCRIBE", "SETUP", "TEARDOWN", "PLAY", "PAUSE", "GET_PARAMETER", "SET_PARAMETER",
+  "REGISTER", "DEREGISTER", NULL
+};
+
+static char const* lookupCommandName(RTSPSubstring const& cmdName) {
+  for (char const* const* name = knownCommandNames; *name != NULL; ++name) {
+    if (cmdName.equals(*name)) return *name;
+  }
+  return ""; // a command that we don't handle
+}
+
 void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
+  if (fSessionAwaitingSDPDescription != NULL && newBytesRead >= 0 && (unsigned)newBytesRead < fRequestBufferBytesLeft) {
+    // We're still waiting to respond to a "DESCRIBE", so just keep this (pipelined) request data until we've done so.
+    // (We'll Base64-decode it then, if it came from a RTSP-over-HTTP tunnel.)
+    if (fClientOutputSocket == fClientInputSocket) fNumDecodedDeferredBytes += newBytesRead; // it doesn't need decoding
+    fRequestBytesAlreadySeen += newBytesRead;
+    fRequestBufferBytesLeft -= newBytesRead;
+    return;
+  }
+
   int numBytesRemaining = 0;
+  Boolean bytesAreDecoded = fRequestBytesAreDecoded; // if so, then only the first batch of bytes
+  fRequestBytesAreDecoded = False;
   ++fRecursionCount;
   
   do {
@@ -629,61 +772,31 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 	    this, numBytesRemaining > 0 ? "processing" : "read", newBytesRead, ptr);
 #endif
     
-    if (fClientOutputSocket != fClientInputSocket && numBytesRemaining == 0) {
+    if (fClientOutputSocket != fClientInputSocket && numBytesRemaining == 0 && !bytesAreDecoded) {
       // We're doing RTSP-over-HTTP tunneling, and input commands are assumed to have been Base64-encoded.
       // We therefore Base64-decode as much of this new data as we can (i.e., up to a multiple of 4 bytes).
-      
-      // But first, we remove any whitespace that may be in the input data:
-      unsigned toIndex = 0;
-      for (int fromIndex = 0; fromIndex < newBytesRead; ++fromIndex) {
-	char c = ptr[fromIndex];
-	if (!(c == ' ' || c == '\t' || c == '\r' || c == '\n')) { // not 'whitespace': space,tab,CR,NL
-	  ptr[toIndex++] = c;
-	}
-      }
-      newBytesRead = toIndex;
-      
-      unsigned numBytesToDecode = fBase64RemainderCount + newBytesRead;
-      unsigned newBase64RemainderCount = numBytesToDecode%4;
-      numBytesToDecode -= newBase64RemainderCount;
-      if (numBytesToDecode > 0) {
-	ptr[newBytesRead] = '\0';
-	unsigned decodedSize;
-	unsigned char* decodedBytes = base64Decode((char const*)(ptr-fBase64RemainderCount), numBytesToDecode, decodedSize);
-#ifdef DEBUG
-	fprintf(stderr, "Base64-decoded %d input bytes into %d new bytes:", numBytesToDecode, decodedSize);
-	for (unsigned k = 0; k < decodedSize; ++k) fprintf(stderr, "%c", decodedBytes[k]);
-	fprintf(stderr, "\n");
-#endif
-	
-	// Copy the new decoded bytes in place of the old ones (we can do this because there are fewer decoded bytes than original):
-	unsigned char* to = ptr-fBase64RemainderCount;
-	for (unsigned i = 0; i < decodedSize; ++i) *to++ = decodedBytes[i];
-	
-	// Then copy any remaining (undecoded) bytes to the end:
-	for (unsigned j = 0; j < newBase64RemainderCount; ++j) *to++ = (ptr-fBase64RemainderCount+numBytesToDecode)[j];
-	
-	newBytesRead = decodedSize - fBase64RemainderCount + newBase64RemainderCount;
-	  // adjust to allow for the size of the new decoded data (+ remainder)
-	delete[] decodedBytes;
-      }
-      fBase64RemainderCount = newBase64RemainderCount;
+      newBytesRead = base64DecodeRequestBytes(ptr, newBytesRead);
     }
     
-    unsigned char* tmpPtr = fLastCRLF + 2;
+    // Note: Pipelined requests are handled in place, one after the other, starting at "requestStart"
+    // (rather than each being moved to the front of the buffer first):
+    unsigned char* const requestStart = &fRequestBuffer[fRequestStart];
+    unsigned char* lastCRLF = fRequestBuffer + fLastCRLFIndex;
+    unsigned char* tmpPtr = lastCRLF + 2;
     if (fBase64RemainderCount == 0) { // no more Base-64 bytes remain to be read/decoded
       // Look for the end of the message: <CR><LF><CR><LF>
-      if (tmpPtr < fRequestBuffer) tmpPtr = fRequestBuffer;
+      if (tmpPtr < requestStart) tmpPtr = requestStart;
       while (tmpPtr < &ptr[newBytesRead-1]) {
 	if (*tmpPtr == '\r' && *(tmpPtr+1) == '\n') {
-	  if (tmpPtr - fLastCRLF == 2) { // This is it:
+	  if (tmpPtr - lastCRLF == 2) { // This is it:
 	    endOfMsg = True;
 	    break;
 	  }
-	  fLastCRLF = tmpPtr;
+	  lastCRLF = tmpPtr;
 	}
 	++tmpPtr;
       }
+      fLastCRLFIndex = lastCRLF - fRequestBuffer;
     }
     
     fRequestBufferBytesLeft -= newBytesRead;
@@ -691,44 +804,47 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
     
     if (!endOfMsg) break; // subsequent reads will be needed to complete the request
     
-    // Parse the request string into command name and 'CSeq', then handle the command:
+    // Parse the request string into command name and 'CSeq', then handle the command.
+    // (The parser doesn't copy anything; we copy out only those parts that our "handleCmd_*()" functions need as strings.)
+    prepareResponseBuffer();
     fRequestBuffer[fRequestBytesAlreadySeen] = '\0';
-    char cmdName[RTSP_PARAM_STRING_MAX];
+    char const* fullRequestStr = (char const*)requestStart;
+    RTSPRequestParts parts;
+    char const* cmdName = "";
     char urlPreSuffix[RTSP_PARAM_STRING_MAX];
     char urlSuffix[RTSP_PARAM_STRING_MAX];
     char cseq[RTSP_PARAM_STRING_MAX];
-    char sessionIdStr[RTSP_PARAM_STRING_MAX];
     unsigned contentLength = 0;
     Boolean playAfterSetup = False;
-    fLastCRLF[2] = '\0'; // temporarily, for parsing
-    Boolean parseSucceeded = parseRTSPRequestString((char*)fRequestBuffer, fLastCRLF+2 - fRequestBuffer,
-						    cmdName, sizeof cmdName,
-						    urlPreSuffix, sizeof urlPreSuffix,
-						    urlSuffix, sizeof urlSuffix,
-						    cseq, sizeof cseq,
-						    sessionIdStr, sizeof sessionIdStr,
-						    contentLength);
-    fLastCRLF[2] = '\r'; // restore its value
+    Boolean parseSucceeded = parseRTSPRequest(fullRequestStr, lastCRLF+2 - requestStart, parts)
+      && parts.cmdName.len < RTSP_PARAM_STRING_MAX
+      && copyDecodedURL(parts.urlPreSuffix, urlPreSuffix, sizeof urlPreSuffix)
+      && parts.urlSuffix.copyTo(urlSuffix, sizeof urlSuffix)
+      && parts.cseq.copyTo(cseq, sizeof cseq);
+    if (parseSucceeded) {
+      cmdName = lookupCommandName(parts.cmdName);
+      contentLength = parts.contentLength;
+    }
     // Check first for a bogus "Content-Length" value that would cause a pointer wraparound:
     if (tmpPtr + 2 + contentLength < tmpPtr + 2) {
 #ifdef DEBUG
-      fprintf(stderr, "parseRTSPRequestString() returned a bogus \"Content-Length:\" value: 0x%x (%d)\n", contentLength, (int)contentLength);
+      fprintf(stderr, "parseRTSPRequest() returned a bogus \"Content-Length:\" value: 0x%x (%d)\n", contentLength, (int)contentLength);
 #endif
       parseSucceeded = False;
     }
     if (parseSucceeded) {
 #ifdef DEBUG
-      fprintf(stderr, "parseRTSPRequestString() succeeded, returning cmdName \"%s\", urlPreSuffix \"%s\", urlSuffix \"%s\", CSeq \"%s\", Content-Length %u, with %d bytes following the message.\n", cmdName, urlPreSuffix, urlSuffix, cseq, contentLength, ptr + newBytesRead - (tmpPtr + 2));
+      fprintf(stderr, "parseRTSPRequest() succeeded, returning cmdName \"%.*s\", urlPreSuffix \"%s\", urlSuffix \"%s\", CSeq \"%s\", Content-Length %u, with %d bytes following the message.\n", parts.cmdName.len, parts.cmdName.str, urlPreSuffix, urlSuffix, cseq, contentLength, ptr + newBytesRead - (tmpPtr + 2));
 #endif
       // If there was a "Content-Length:" header, then make sure we've received all of the data that it specified:
       if (ptr + newBytesRead < tmpPtr + 2 + contentLength) break; // we still need more data; subsequent reads will give it to us 
       
       // If the request included a "Session:" id, and it refers to a client session that's
       // current ongoing, then use this command to indicate 'liveness' on that client session:
-      Boolean const requestIncludedSessionId = sessionIdStr[0] != '\0';
+      Boolean const requestIncludedSessionId = parts.sessionId.len > 0;
       if (requestIncludedSessionId) {
 	clientSession
-	  = (RTSPServer::RTSPClientSession*)(fOurRTSPServer.lookupClientSession(sessionIdStr));
+	  = (RTSPServer::RTSPClientSession*)(fOurRTSPServer.lookupClientSession(parts.sessionId.str, parts.sessionId.len));
 	if (clientSession != NULL) clientSession->noteLiveness();
       }
     
@@ -747,14 +863,14 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
       } else if (urlPreSuffix[0] == '\0' && urlSuffix[0] == '*' && urlSuffix[1] == '\0') {
 	// The special "*" URL means: an operation on the entire server.  This works only for GET_PARAMETER and SET_PARAMETER:
 	if (strcmp(cmdName, "GET_PARAMETER") == 0) {
-	  handleCmd_GET_PARAMETER((char const*)fRequestBuffer);
+	  handleCmd_GET_PARAMETER(fullRequestStr);
 	} else if (strcmp(cmdName, "SET_PARAMETER") == 0) {
-	  handleCmd_SET_PARAMETER((char const*)fRequestBuffer);
+	  handleCmd_SET_PARAMETER(fullRequestStr);
 	} else {
 	  handleCmd_notSupported();
 	}
       } else if (strcmp(cmdName, "DESCRIBE") == 0) {
-	handleCmd_DESCRIBE(urlPreSuffix, urlSuffix, (char const*)fRequestBuffer);
+	handleCmd_DESCRIBE(urlPreSuffix, urlSuffix, fullRequestStr);
       } else if (strcmp(cmdName, "SETUP") == 0) {
 	Boolean areAuthenticated = True;
 
@@ -771,7 +887,7 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 	    strcat(urlTotalSuffix, "/");
 	  }
 	  strcat(urlTotalSuffix, urlSuffix);
-	  if (authenticationOK("SETUP", urlTotalSuffix, (char const*)fRequestBuffer)) {
+	  if (authenticationOK("SETUP", urlTotalSuffix, fullRequestStr)) {
 	    clientSession
 	      = (RTSPServer::RTSPClientSession*)fOurRTSPServer.createNewClientSessionWithId();
 	  } else {
@@ -779,7 +895,7 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 	  }
 	}
 	if (clientSession != NULL) {
-	  clientSession->handleCmd_SETUP(this, urlPreSuffix, urlSuffix, (char const*)fRequestBuffer);
+	  clientSession->handleCmd_SETUP(this, urlPreSuffix, urlSuffix, fullRequestStr);
 	  playAfterSetup = clientSession->fStreamAfterSETUP;
 	} else if (areAuthenticated) {
 	  handleCmd_sessionNotFound();
@@ -790,21 +906,21 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 		 || strcmp(cmdName, "GET_PARAMETER") == 0
 		 || strcmp(cmdName, "SET_PARAMETER") == 0) {
 	if (clientSession != NULL) {
-	  clientSession->handleCmd_withinSession(this, cmdName, urlPreSuffix, urlSuffix, (char const*)fRequestBuffer);
+	  clientSession->handleCmd_withinSession(this, cmdName, urlPreSuffix, urlSuffix, fullRequestStr);
 	} else {
 	  handleCmd_sessionNotFound();
 	}
       } else if (strcmp(cmdName, "REGISTER") == 0 || strcmp(cmdName, "DEREGISTER") == 0) {
 	// Because - unlike other commands - an implementation of this command needs
 	// the entire URL, we re-parse the command to get it:
-	char* url = strDupSize((char*)fRequestBuffer);
-	if (sscanf((char*)fRequestBuffer, "%*s %s", url) == 1) {
+	char* url = strDupSize(fullRequestStr);
+	if (sscanf(fullRequestStr, "%*s %s", url) == 1) {
 	  // Check for special command-specific parameters in a "Transport:" header:
 	  Boolean reuseConnection, deliverViaTCP;
 	  char* proxyURLSuffix;
-	  parseTransportHeaderForREGISTER((const char*)fRequestBuffer, reuseConnection, deliverViaTCP, proxyURLSuffix);
+	  parseTransportHeaderForREGISTER(fullRequestStr, reuseConnection, deliverViaTCP, proxyURLSuffix);
 
-	  handleCmd_REGISTER(cmdName, url, urlSuffix, (char const*)fRequestBuffer, reuseConnection, deliverViaTCP, proxyURLSuffix);
+	  handleCmd_REGISTER(cmdName, url, urlSuffix, fullRequestStr, reuseConnection, deliverViaTCP, proxyURLSuffix);
 	  delete[] proxyURLSuffix;
 	} else {
 	  handleCmd_bad();
@@ -816,24 +932,25 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
       }
     } else {
 #ifdef DEBUG
-      fprintf(stderr, "parseRTSPRequestString() failed; checking now for HTTP commands (for RTSP-over-HTTP tunneling)...\n");
+      fprintf(stderr, "parseRTSPRequest() failed; checking now for HTTP commands (for RTSP-over-HTTP tunneling)...\n");
 #endif
       // The request was not (valid) RTSP, but check for a special case: HTTP commands (for setting up RTSP-over-HTTP tunneling):
+      char httpCmdName[RTSP_PARAM_STRING_MAX];
       char sessionCookie[RTSP_PARAM_STRING_MAX];
       char acceptStr[RTSP_PARAM_STRING_MAX];
-      *fLastCRLF = '\0'; // temporarily, for parsing
-      parseSucceeded = parseHTTPRequestString(cmdName, sizeof cmdName,
-					      urlSuffix, sizeof urlPreSuffix,
+      *lastCRLF = '\0'; // temporarily, for parsing
+      parseSucceeded = parseHTTPRequestString(httpCmdName, sizeof httpCmdName,
+					      urlSuffix, sizeof urlSuffix,
 					      sessionCookie, sizeof sessionCookie,
 					      acceptStr, sizeof acceptStr);
-      *fLastCRLF = '\r';
+      *lastCRLF = '\r';
       if (parseSucceeded) {
 #ifdef DEBUG
-	fprintf(stderr, "parseHTTPRequestString() succeeded, returning cmdName \"%s\", urlSuffix \"%s\", sessionCookie \"%s\", acceptStr \"%s\"\n", cmdName, urlSuffix, sessionCookie, acceptStr);
+	fprintf(stderr, "parseHTTPRequestString() succeeded, returning cmdName \"%s\", urlSuffix \"%s\", sessionCookie \"%s\", acceptStr \"%s\"\n", httpCmdName, urlSuffix, sessionCookie, acceptStr);
 #endif
 	// Check that the HTTP command is valid for RTSP-over-HTTP tunneling: There must be a 'session cookie'.
 	Boolean isValidHTTPCmd = True;
-	if (strcmp(cmdName, "OPTIONS") == 0) {
+	if (strcmp(httpCmdName, "OPTIONS") == 0) {
 	  handleHTTPCmd_OPTIONS();
 	} else if (sessionCookie[0] == '\0') {
 	  // There was no "x-sessioncookie:" header.  If there was an "Accept: application/x-rtsp-tunnelled" header,
@@ -841,14 +958,14 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 	  if (strcmp(acceptStr, "application/x-rtsp-tunnelled") == 0) {
 	    isValidHTTPCmd = False;
 	  } else {
-	    handleHTTPCmd_StreamingGET(urlSuffix, (char const*)fRequestBuffer);
+	    handleHTTPCmd_StreamingGET(urlSuffix, fullRequestStr);
 	  }
-	} else if (strcmp(cmdName, "GET") == 0) {
+	} else if (strcmp(httpCmdName, "GET") == 0) {
 	  handleHTTPCmd_TunnelingGET(sessionCookie);
-	} else if (strcmp(cmdName, "POST") == 0) {
+	} else if (strcmp(httpCmdName, "POST") == 0) {
 	  // We might have received additional data following the HTTP "POST" command - i.e., the first Base64-encoded RTSP command.
 	  // Check for this, and handle it if it exists:
-	  unsigned char const* extraData = fLastCRLF+4;
+	  unsigned char const* extraData = lastCRLF+4;
 	  unsigned extraDataSize = &fRequestBuffer[fRequestBytesAlreadySeen] - extraData;
 	  if (handleHTTPCmd_TunnelingPOST(sessionCookie, extraData, extraDataSize)) {
 	    // We don't respond to the "POST" command, and we go away:
@@ -872,25 +989,38 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 #ifdef DEBUG
     fprintf(stderr, "sending response: %s", fResponseBuffer);
 #endif
-    send(fClientOutputSocket, (char const*)fResponseBuffer, strlen((char*)fResponseBuffer), 0);
+    if (fSessionAwaitingSDPDescription == NULL) { // (otherwise, we'll send the response later)
+      send(fClientOutputSocket, (char const*)fResponseBuffer, strlen((char*)fResponseBuffer), 0);
+    }
     
     if (playAfterSetup) {
       // The client has asked for streaming to commence now, rather than after a
       // subsequent "PLAY" command.  So, simulate the effect of a "PLAY" command:
-      clientSession->handleCmd_withinSession(this, "PLAY", urlPreSuffix, urlSuffix, (char const*)fRequestBuffer);
+      clientSession->handleCmd_withinSession(this, "PLAY", urlPreSuffix, urlSuffix, fullRequestStr);
     }
     
-    // Check whether there are extra bytes remaining in the buffer, after the end of the request (a rare case).
-    // If so, move them to the front of our buffer, and keep processing it, because it might be a following, pipelined request.
-    unsigned requestSize = (fLastCRLF+4-fRequestBuffer) + contentLength;
-    numBytesRemaining = fRequestBytesAlreadySeen - requestSize;
-    resetRequestBuffer(); // to prepare for any subsequent request
-    
-    if (numBytesRemaining > 0) {
-      memmove(fRequestBuffer, &fRequestBuffer[requestSize], numBytesRemaining);
-      newBytesRead = numBytesRemaining;
+    // Check whether there are extra bytes remaining in the buffer, after the end of the request.
+    // If so, keep processing them (where they are), because they might be a following, pipelined request.
+    unsigned requestEnd = (lastCRLF+4-fRequestBuffer) + contentLength;
+    numBytesRemaining = fRequestBytesAlreadySeen - requestEnd;
+    if (numBytesRemaining <= 0) {
+      resetRequestBuffer(); // to prepare for any subsequent request
+      break;
+    }
+
+    fRequestStart = requestEnd;
+    fLastCRLFIndex = (int)requestEnd - 3; // see "resetRequestBuffer()"
+    fBase64RemainderCount = 0;
+    if (fSessionAwaitingSDPDescription != NULL) {
+      // We've deferred our response to this request, so keep (but don't yet handle) any following request data.
+      // (We've already Base64-decoded this data, if it needed it.)
+      fNumDecodedDeferredBytes = numBytesRemaining;
+      break;
     }
-  } while (numBytesRemaining > 0);
+    fRequestBytesAlreadySeen = requestEnd;
+    fRequestBufferBytesLeft += numBytesRemaining;
+    newBytesRead = numBytesRemaining;
+  } while (1);
   
   --fRecursionCount;
   if (!fIsActive) {
@@ -898,6 +1028,11 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
     // Note: The "fRecursionCount" test is for a pathological situation where we reenter the event loop and get called recursively
     // while handling a command (e.g., while handling a "DESCRIBE", to get a SDP description).
     // In such a case we don't want to actually delete ourself until we leave the outermost call.
+  } else if (fRecursionCount == 0) {
+    // Move any incomplete request to the front of our buffer (once, rather than after each pipelined request).
+    // If there's none (and no deferred response), then give up our buffers until the next request arrives:
+    compactRequestBuffer();
+    if (fRequestBytesAlreadySeen == 0 && fSessionAwaitingSDPDescription == NULL) releaseBuffers();
   }
 }
 
@@ -1016,7 +1151,7 @@ Boolean RTSPServer::RTSPClientConnection
   // If we get here, we failed to authenticate the user.
   // Send back a "401 Unauthorized" response, with a new random nonce:
   fCurrentAuthenticator.setRealmAndRandomNonce(authDB->realm());
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+  snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	   "RTSP/1.0 401 Unauthorized\r\n"
 	   "CSeq: %s\r\n"
 	   "%s"
@@ -1029,7 +1164,7 @@ Boolean RTSPServer::RTSPClientConnection
 
 void RTSPServer::RTSPClientConnection
 ::setRTSPResponse(char const* responseStr) {
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+  snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	   "RTSP/1.0 %s\r\n"
 	   "CSeq: %s\r\n"
 	   "%s\r\n",
@@ -1040,7 +1175,7 @@ void RTSPServer::RTSPClientConnection
 
 void RTSPServer::RTSPClientConnection
 ::setRTSPResponse(char const* responseStr, u_int32_t sessionId) {
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+  snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	   "RTSP/1.0 %s\r\n"
 	   "CSeq: %s\r\n"
 	   "%s"
@@ -1056,7 +1191,7 @@ void RTSPServer::RTSPClientConnection
   if (contentStr == NULL) contentStr = "";
   unsigned const contentLen = strlen(contentStr);
   
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+  snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	   "RTSP/1.0 %s\r\n"
 	   "CSeq: %s\r\n"
 	   "%s"
@@ -1074,7 +1209,7 @@ void RTSPServer::RTSPClientConnection
   if (contentStr == NULL) contentStr = "";
   unsigned const contentLen = strlen(contentStr);
   
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+  snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	   "RTSP/1.0 %s\r\n"
 	   "CSeq: %s\r\n"
 	   "%s"
@@ -1097,7 +1232,7 @@ void RTSPServer::RTSPClientConnection
 						incomingRequestHandler, this);
   
   // Also write any extra data to our buffer, and handle it:
-  if (extraDataSize > 0 && extraDataSize <= fRequestBufferBytesLeft/*sanity check; should always be true*/) {
+  if (extraDataSize > 0 && prepareRequestBuffer(extraDataSize)/*sanity check; should always be true*/) {
     unsigned char* ptr = &fRequestBuffer[fRequestBytesAlreadySeen];
     for (unsigned i = 0; i < extraDataSize; ++i) {
       ptr[i] = extraData[i];
@@ -1422,7 +1557,7 @@ void RTSPServer::RTSPClientSession
     if (fIsMulticast) {
       switch (streamingMode) {
           case RTP_UDP: {
-	    snprintf((char*)ourClientConnection->fResponseBuffer, sizeof ourClientConnection->fResponseBuffer,
+	    snprintf((char*)ourClientConnection->fResponseBuffer, ourClientConnection->fResponseBufferSize,
 		     "RTSP/1.0 200 OK\r\n"
 		     "CSeq: %s\r\n"
 		     "%s"
@@ -1440,7 +1575,7 @@ void RTSPServer::RTSPClientSession
 	    break;
 	  }
           case RAW_UDP: {
-	    snprintf((char*)ourClientConnection->fResponseBuffer, sizeof ourClientConnection->fResponseBuffer,
+	    snprintf((char*)ourClientConnection->fResponseBuffer, ourClientConnection->fResponseBufferSize,
 		     "RTSP/1.0 200 OK\r\n"
 		     "CSeq: %s\r\n"
 		     "%s"
@@ -1456,7 +1591,7 @@ void RTSPServer::RTSPClientSession
     } else {
       switch (streamingMode) {
           case RTP_UDP: {
-	    snprintf((char*)ourClientConnection->fResponseBuffer, sizeof ourClientConnection->fResponseBuffer,
+	    snprintf((char*)ourClientConnection->fResponseBuffer, ourClientConnection->fResponseBufferSize,
 		     "RTSP/1.0 200 OK\r\n"
 		     "CSeq: %s\r\n"
 		     "%s"
@@ -1472,7 +1607,7 @@ void RTSPServer::RTSPClientSession
 	    if (!fOurRTSPServer.fAllowStreamingRTPOverTCP) {
 	      ourClientConnection->handleCmd_unsupportedTransport();
 	    } else {
-	      snprintf((char*)ourClientConnection->fResponseBuffer, sizeof ourClientConnection->fResponseBuffer,
+	      snprintf((char*)ourClientConnection->fResponseBuffer, ourClientConnection->fResponseBufferSize,
 		       "RTSP/1.0 200 OK\r\n"
 		       "CSeq: %s\r\n"
 		       "%s"
@@ -1486,7 +1621,7 @@ void RTSPServer::RTSPClientSession
 	    break;
 	  }
           case RAW_UDP: {
-	    snprintf((char*)ourClientConnection->fResponseBuffer, sizeof ourClientConnection->fResponseBuffer,
+	    snprintf((char*)ourClientConnection->fResponseBuffer, ourClientConnection->fResponseBufferSize,
 		     "RTSP/1.0 200 OK\r\n"
 		     "CSeq: %s\r\n"
 		     "%s"
@@ -1789,7 +1924,7 @@ void RTSPServer::RTSPClientSession
   }
   
   // Fill in the response:
-  snprintf((char*)ourClientConnection->fResponseBuffer, sizeof ourClientConnection->fResponseBuffer,
+  snprintf((char*)ourClientConnection->fResponseBuffer, ourClientConnection->fResponseBufferSize,
 	   "RTSP/1.0 200 OK\r\n"
 	   "CSeq: %s\r\n"
 	   "%s"
@@ -189,6 +189,10 @@ public: // should be protected, but some old compilers complain otherwise
     virtual void handleHTTPCmd_StreamingGET(char const* urlSuffix, char const* fullRequestStr);
   protected:
     void resetRequestBuffer();
+    void compactRequestBuffer(); // moves any not-yet-handled (pipelined) request data to the front of "fRequestBuffer"
+    unsigned base64DecodeRequestBytes(unsigned char* ptr, unsigned numNewBytes);
+        // Base64-decodes - in place - the "numNewBytes" bytes at "ptr" (after any "fBase64RemainderCount" not-yet-decoded
+        // bytes that precede them), as much as we can.  Returns the resulting number of new bytes (decoded + remainder).
     void closeSocketsRTSP();
     static void handleAlternativeRequestByte(void*, u_int8_t requestByte);
     void handleAlternativeRequestByte1(u_int8_t requestByte);
@@ -197,6 +201,11 @@ public: // should be protected, but some old compilers complain otherwise
       // used to implement RTSP-over-HTTP tunneling
     static void continueHandlingREGISTER(ParamsForREGISTER* params);
     virtual void continueHandlingREGISTER1(ParamsForREGISTER* params);
+    void completeCmd_DESCRIBE(ServerMediaSession* session);
+        // sets the "DESCRIBE" response, and releases our reference to "session"
+    static void continueHandlingDESCRIBE(void* instance);
+    void continueHandlingDESCRIBE1();
+        // used to send a deferred "DESCRIBE" response, once its SDP description is ready
 
     // Shortcuts for setting up a RTSP response (prior to sending it):
     void setRTSPResponse(char const* responseStr);
@@ -208,12 +217,18 @@ public: // should be protected, but some old compilers complain otherwise
     int& fClientInputSocket; // aliased to ::fOurSocket
     int fClientOutputSocket;
     Boolean fIsActive;
-    unsigned char* fLastCRLF;
-    unsigned fRecursionCount;
+    unsigned fRequestStart; // the index (in "fRequestBuffer") of the request that we're currently handling
+    int fLastCRLFIndex; // the index (in "fRequestBuffer") of the last <CR><LF> that we've seen (or < fRequestStart if none)
     char const* fCurrentCSeq;
     Authenticator fCurrentAuthenticator; // used if access control is needed
     char* fOurSessionCookie; // used for optional RTSP-over-HTTP tunneling
     unsigned fBase64RemainderCount; // used for optional RTSP-over-HTTP tunneling (possible values: 0,1,2,3)
+    ServerMediaSession* fSessionAwaitingSDPDescription; // non-NULL while we're deferring a "DESCRIBE" response
+    char* fDeferredCSeq; // the "CSeq:" of the deferred "DESCRIBE"
+    unsigned fNumDecodedDeferredBytes;
+        // Of the (pipelined) request bytes that we keep while deferring a "DESCRIBE" response, the number (at the start) that
+        // we've already Base64-decoded (or that didn't need decoding).  Any others were read from a RTSP-over-HTTP tunnel.
+    Boolean fRequestBytesAreDecoded; // True while we're handling request bytes that we've already Base64-decoded
   };
 
   // The state of an individual client session (using one or more sequential TCP connections) handled by a RTSP server:
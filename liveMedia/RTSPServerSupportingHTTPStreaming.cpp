@@ -52,13 +52,14 @@ RTSPServerSupportingHTTPStreaming::createNewClientConnection(int clientSocket, s
 RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming
 ::RTSPClientConnectionSupportingHTTPStreaming(RTSPServer& ourServer, int clientSocket, struct sockaddr_in clientAddr)
   : RTSPClientConnection(ourServer, clientSocket, clientAddr),
-    fClientSessionId(0), fStreamSource(NULL), fPlaylistSource(NULL), fTCPSink(NULL) {
+    fClientSessionId(0), fStreamSource(NULL), fPlaylistSource(NULL), fTCPSink(NULL), fFileSender(NULL) {
 }
 
 RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming::~RTSPClientConnectionSupportingHTTPStreaming() {
   Medium::close(fPlaylistSource);
   Medium::close(fStreamSource);
   Medium::close(fTCPSink);
+  Medium::close(fFileSender);
 }
 
 static char const* lastModifiedHeader(char const* fileName) {
@@ -129,7 +130,7 @@ void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStream
       }
       
       // Construct our response:
-      snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+      snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	       "HTTP/1.1 200 OK\r\n"
 	       "%s"
 	       "Server: LIVE555 Streaming Media v%s\r\n"
@@ -144,7 +145,25 @@ void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStream
       // Send the response now, because we're about to add more data (from the source):
       send(fClientOutputSocket, (char const*)fResponseBuffer, strlen((char*)fResponseBuffer), 0);
       fResponseBuffer[0] = '\0'; // We've already sent the response.  This tells the calling code not to send it again.
-      
+
+      // If the segment is just a range of bytes from the file, then send these directly from the file (rather than
+      // copying them through the stream's source objects):
+      if (fFileSender != NULL) { // sanity check
+	fFileSender->stopSending();
+	Medium::close(fFileSender); fFileSender = NULL;
+      }
+      char const* fileName;
+      u_int64_t startByte, numFileBytes;
+      if (subsession->getStreamFileRange(fClientSessionId, streamToken, fileName, startByte, numFileBytes)
+	  && numFileBytes == numTSBytesToStream) {
+	fFileSender = TCPFileSender::createNew(envir(), fClientOutputSocket, fileName, startByte, numFileBytes);
+	if (fFileSender != NULL) {
+	  subsession->deleteStream(fClientSessionId, streamToken); // we don't need the stream's source objects
+	  fFileSender->startSending(afterStreaming, this);
+	  break;
+	}
+      }
+
       // Ask the media source to deliver - to the TCP sink - the desired data:
       if (fStreamSource != NULL) { // sanity check
 	if (fTCPSink != NULL) fTCPSink->stopPlaying();
@@ -226,7 +245,7 @@ void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStream
   unsigned playlistLen = s - playlist;
 
   // Construct our response:
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+  snprintf((char*)fResponseBuffer, fResponseBufferSize,
 	   "HTTP/1.1 200 OK\r\n"
 	   "%s"
 	   "Server: LIVE555 Streaming Media v%s\r\n"
@@ -30,6 +30,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _TCP_STREAM_SINK_HH
 #include "TCPStreamSink.hh"
 #endif
+#ifndef _TCP_FILE_SENDER_HH
+#include "TCPFileSender.hh"
+#endif
 
 class RTSPServerSupportingHTTPStreaming: public RTSPServer {
 public:
@@ -67,6 +70,7 @@ public: // should be protected, but some old compilers complain otherwise
     FramedSource* fStreamSource;
     ByteStreamMemoryBufferSource* fPlaylistSource;
     TCPStreamSink* fTCPSink;
+    TCPFileSender* fFileSender; // used instead of "fStreamSource" and "fTCPSink" if a segment comes straight from a file
   };
 };
 
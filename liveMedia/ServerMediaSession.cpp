@@ -208,6 +208,25 @@ Boolean ServerMediaSession::isServerMediaSession() const {
   return True;
 }
 
+Boolean ServerMediaSession::sdpDescriptionIsReady(TaskFunc* whenReadyFunc, void* whenReadyClientData) {
+  // Note that we check every subsession (rather than stopping at the first one that's not ready),
+  // so that all subsessions can prepare their SDP lines concurrently:
+  Boolean isReady = True;
+  for (ServerMediaSubsession* subsession = fSubsessionsHead; subsession != NULL;
+       subsession = subsession->fNext) {
+    if (!subsession->sdpLinesAreReady(whenReadyFunc, whenReadyClientData)) isReady = False;
+  }
+
+  return isReady;
+}
+
+void ServerMediaSession::cancelSDPDescriptionNotification(TaskFunc* whenReadyFunc, void* whenReadyClientData) {
+  for (ServerMediaSubsession* subsession = fSubsessionsHead; subsession != NULL;
+       subsession = subsession->fNext) {
+    subsession->cancelSDPLinesNotification(whenReadyFunc, whenReadyClientData);
+  }
+}
+
 char* ServerMediaSession::generateSDPDescription() {
   AddressString ipAddressStr(ourIPAddress(envir()));
   unsigned ipAddressStrSize = strlen(ipAddressStr.val());
@@ -364,6 +383,15 @@ char const* ServerMediaSubsession::trackId() {
   return fTrackId;
 }
 
+Boolean ServerMediaSubsession::sdpLinesAreReady(TaskFunc* /*whenReadyFunc*/, void* /*whenReadyClientData*/) {
+  // default implementation: "sdpLines()" doesn't block
+  return True;
+}
+
+void ServerMediaSubsession::cancelSDPLinesNotification(TaskFunc* /*whenReadyFunc*/, void* /*whenReadyClientData*/) {
+  // default implementation: do nothing
+}
+
 void ServerMediaSubsession::pauseStream(unsigned /*clientSessionId*/,
 					void* /*streamToken*/) {
   // default implementation: do nothing
@@ -396,6 +424,12 @@ FramedSource* ServerMediaSubsession::getStreamSource(void* /*streamToken*/) {
   // default implementation: return NULL
   return NULL;
 }
+Boolean ServerMediaSubsession::getStreamFileRange(unsigned /*clientSessionId*/, void* /*streamToken*/,
+						  char const*& /*fileName*/, u_int64_t& /*startByte*/,
+						  u_int64_t& /*numBytes*/) {
+  // default implementation: the stream's data doesn't come directly from a file
+  return False;
+}
 void ServerMediaSubsession::deleteStream(unsigned /*clientSessionId*/,
 					 void*& /*streamToken*/) {
   // default implementation: do nothing
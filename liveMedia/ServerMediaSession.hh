@@ -46,6 +46,13 @@ public:
   char* generateSDPDescription(); // based on the entire session
       // Note: The caller is responsible for freeing the returned string
 
+  Boolean sdpDescriptionIsReady(TaskFunc* whenReadyFunc, void* whenReadyClientData);
+      // Returns True iff "generateSDPDescription()" can be called without blocking (see "ServerMediaSubsession::sdpLinesAreReady()").
+      // Otherwise, returns False, and calls "whenReadyFunc(whenReadyClientData)" later (perhaps more than once), after which
+      // the caller should call this function again.
+  void cancelSDPDescriptionNotification(TaskFunc* whenReadyFunc, void* whenReadyClientData);
+      // Must be called by a caller of "sdpDescriptionIsReady()" that stops waiting (e.g., because it's being deleted).
+
   char const* streamName() const { return fStreamName; }
 
   Boolean addSubsession(ServerMediaSubsession* subsession);
@@ -122,6 +129,12 @@ public:
   unsigned trackNumber() const { return fTrackNumber; }
   char const* trackId();
   virtual char const* sdpLines() = 0;
+  virtual Boolean sdpLinesAreReady(TaskFunc* whenReadyFunc, void* whenReadyClientData);
+      // Returns True iff "sdpLines()" can be called without blocking (the default implementation always returns True).
+      // Otherwise, begins (or continues) preparing our SDP lines in the background, returns False, and - once they're
+      // ready - calls "whenReadyFunc(whenReadyClientData)" (from the event loop).
+  virtual void cancelSDPLinesNotification(TaskFunc* whenReadyFunc, void* whenReadyClientData);
+      // Cancels a pending call of "whenReadyFunc(whenReadyClientData)" (the default implementation does nothing).
   virtual void getStreamParameters(unsigned clientSessionId, // in
 				   netAddressBits clientAddress, // in
 				   Port const& clientRTPPort, // in
@@ -160,6 +173,12 @@ public:
   virtual void setStreamScale(unsigned clientSessionId, void* streamToken, float scale);
   virtual float getCurrentNPT(void* streamToken);
   virtual FramedSource* getStreamSource(void* streamToken);
+  virtual Boolean getStreamFileRange(unsigned clientSessionId, void* streamToken,
+				     char const*& fileName, u_int64_t& startByte, u_int64_t& numBytes);
+     // If (after "seekStream()") the data to be streamed is exactly the bytes "startByte" through
+     // "startByte"+"numBytes"-1 of the file "fileName" - with no transformation - then returns True.
+     // This lets the data be sent (e.g., over HTTP) directly from the file, without using the stream's source.
+     // (The default implementation returns False.)
   virtual void getRTPSinkandRTCP(void* streamToken,
 				 RTPSink const*& rtpSink, RTCPInstance const*& rtcp) = 0;
      // Returns pointers to the "RTPSink" and "RTCPInstance" objects for "streamToken".
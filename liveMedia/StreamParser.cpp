@@ -22,6 +22,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include <string.h>
 #include <stdlib.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2_START_CODE_SCAN 1
+#include <emmintrin.h>
+#endif
 
 #define BANK_SIZE 150000
 
@@ -116,6 +122,71 @@ unsigned StreamParser::bankSize() const {
   return BANK_SIZE;
 }
 
+#if defined(__AVX2__) || defined(USE_SSE2_START_CODE_SCAN)
+static inline unsigned indexOfLowestSetBit(unsigned mask) { // assumes mask != 0
+#if defined(__GNUC__)
+  return __builtin_ctz(mask);
+#else
+  unsigned i = 0;
+  while ((mask&1) == 0) { mask >>= 1; ++i; }
+  return i;
+#endif
+}
+#endif
+
+// Returns the first position "p" in [from, limit-3] for which p[0..2] is 0x000001, or NULL if none:
+static unsigned char const* findStartCodePrefix(unsigned char const* from, unsigned char const* limit) {
+  unsigned char const* p = from;
+
+  // First, look at a whole vector of positions at a time, by comparing three overlapping loads
+  // (at offsets 0, 1 and 2) with 0x00, 0x00 and 0x01 respectively:
+#if defined(__AVX2__)
+  __m256i const zeros = _mm256_setzero_si256();
+  __m256i const ones = _mm256_set1_epi8(1);
+  while (limit - p >= 32+2) {
+    __m256i z0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const*)p), zeros);
+    __m256i z1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const*)(p+1)), zeros);
+    __m256i o2 = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const*)(p+2)), ones);
+    unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(z0, z1), o2));
+    if (mask != 0) return p + indexOfLowestSetBit(mask);
+    p += 32;
+  }
+#elif defined(USE_SSE2_START_CODE_SCAN)
+  __m128i const zeros = _mm_setzero_si128();
+  __m128i const ones = _mm_set1_epi8(1);
+  while (limit - p >= 16+2) {
+    __m128i z0 = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const*)p), zeros);
+    __m128i z1 = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const*)(p+1)), zeros);
+    __m128i o2 = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const*)(p+2)), ones);
+    unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(z0, z1), o2));
+    if (mask != 0) return p + indexOfLowestSetBit(mask);
+    p += 16;
+  }
+#endif
+
+  // Then (or otherwise) check the remaining positions one at a time.  We look at the *last* byte
+  // of each candidate prefix first, because when it's > 1, no prefix can begin at any of the next
+  // 3 positions:
+  while (limit - p >= 3) {
+    if (p[2] > 1) {
+      p += 3;
+    } else if (p[2] == 1 && p[1] == 0 && p[0] == 0) {
+      return p;
+    } else {
+      ++p;
+    }
+  }
+
+  return NULL;
+}
+
+unsigned StreamParser::numBytesBeforeStartCodePrefix() {
+  unsigned char const* from = nextToParse();
+  unsigned char const* prefix = findStartCodePrefix(from, &curBank()[fTotNumValidBytes]);
+
+  return prefix == NULL ? numRemainingValidBytes() : prefix - from;
+}
+
 #define NO_MORE_BUFFERED_INPUT 1
 
 void StreamParser::ensureValidBytes1(unsigned numBytesNeeded) {
@@ -99,6 +99,16 @@ protected: // we're a virtual base class
 
   unsigned curOffset() const { return fCurParserIndex; }
 
+  // Direct access to the bytes that have already been read into the current bank (starting at the
+  // current parse position).  (These remain valid until the parser next needs more input.)
+  unsigned char const* remainingValidBytes() { return nextToParse(); }
+  unsigned numRemainingValidBytes() const { return fTotNumValidBytes - fCurParserIndex; }
+
+  unsigned numBytesBeforeStartCodePrefix();
+      // Returns the number of remaining valid bytes (from the current parse position) that precede the
+      // first 'start code prefix' (0x000001) that lies entirely within these bytes.  If there is no such
+      // prefix, returns "numRemainingValidBytes()".  (This does not advance the parse position.)
+
   unsigned& totNumValidBytes() { return fTotNumValidBytes; }
 
   Boolean haveSeenEOF() const { return fHaveSeenEOF; }
@@ -0,0 +1,117 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2018 Live Networks, Inc.  All rights reserved.
+// Sends a range of bytes from a file over a TCP socket, without copying the data through user space
+// Implementation
+
+#include "TCPFileSender.hh"
+#include <GroupsockHelper.hh> // for "ignoreSigPipeOnSocket()"
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define HAVE_SENDFILE 1
+#endif
+
+TCPFileSender* TCPFileSender::createNew(UsageEnvironment& env, int socketNum,
+					char const* fileName, u_int64_t startByte, u_int64_t numBytes) {
+#ifdef HAVE_SENDFILE
+  int fileFd = open(fileName, O_RDONLY);
+  if (fileFd < 0) return NULL;
+
+  return new TCPFileSender(env, socketNum, fileFd, startByte, numBytes);
+#else
+  // Not supported on this platform:
+  return NULL;
+#endif
+}
+
+void TCPFileSender::startSending(TaskFunc* afterFunc, void* afterClientData) {
+  fAfterFunc = afterFunc;
+  fAfterClientData = afterClientData;
+  sendMore();
+}
+
+void TCPFileSender::stopSending() {
+  envir().taskScheduler().disableBackgroundHandling(fOutputSocketNum);
+  fAfterFunc = NULL;
+}
+
+TCPFileSender::TCPFileSender(UsageEnvironment& env, int socketNum, int fileFd, u_int64_t startByte, u_int64_t numBytes)
+  : Medium(env), fOutputSocketNum(socketNum), fFileFd(fileFd),
+    fStartByte(startByte), fNextByte(startByte), fEndByte(startByte + numBytes),
+    fAfterFunc(NULL), fAfterClientData(NULL) {
+  ignoreSigPipeOnSocket(socketNum);
+}
+
+TCPFileSender::~TCPFileSender() {
+  // Turn off any pending background handling of our output socket:
+  envir().taskScheduler().disableBackgroundHandling(fOutputSocketNum);
+
+#ifdef HAVE_SENDFILE
+  ::close(fFileFd);
+#endif
+}
+
+void TCPFileSender::sendMore() {
+#ifdef HAVE_SENDFILE
+  u_int64_t numBytesSentNow = 0;
+  while (fNextByte < fEndByte) {
+    if (numBytesSentNow >= TCP_FILE_SENDER_MAX_BYTES_PER_SEND) {
+      // Let other events get handled before we continue.  (Our socket's still writable, so we'll be called back soon.)
+      envir().taskScheduler().setBackgroundHandling(fOutputSocketNum, SOCKET_WRITABLE, socketWritableHandler, this);
+      return;
+    }
+
+    u_int64_t numBytesToSend = fEndByte - fNextByte;
+    if (numBytesToSend > TCP_FILE_SENDER_MAX_BYTES_PER_SEND) numBytesToSend = TCP_FILE_SENDER_MAX_BYTES_PER_SEND;
+    off_t offset = (off_t)fNextByte;
+    ssize_t numBytesSent = sendfile(fOutputSocketNum, fFileFd, &offset, (size_t)numBytesToSend);
+    if (numBytesSent > 0) {
+      fNextByte += numBytesSent;
+      numBytesSentNow += numBytesSent;
+    } else if (numBytesSent < 0 && errno == EINTR) {
+      continue;
+    } else if (numBytesSent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // The output socket is no longer writable.  Set a handler to be called when it becomes writable again:
+      envir().taskScheduler().setBackgroundHandling(fOutputSocketNum, SOCKET_WRITABLE, socketWritableHandler, this);
+      return;
+    } else {
+      // An error occurred (or the file was shorter than we expected):
+      break;
+    }
+  }
+#endif
+
+  onCompletion();
+}
+
+void TCPFileSender::socketWritableHandler(void* clientData, int /*mask*/) {
+  TCPFileSender* sender = (TCPFileSender*)clientData;
+  sender->envir().taskScheduler().disableBackgroundHandling(sender->fOutputSocketNum);
+      // disable this handler until the next time it's needed
+  sender->sendMore();
+}
+
+void TCPFileSender::onCompletion() {
+  envir().taskScheduler().disableBackgroundHandling(fOutputSocketNum);
+
+  TaskFunc* afterFunc = fAfterFunc;
+  fAfterFunc = NULL;
+  if (afterFunc != NULL) (*afterFunc)(fAfterClientData); // Note: This might delete us
+}
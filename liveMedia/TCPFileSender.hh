@@ -0,0 +1,66 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2018 Live Networks, Inc.  All rights reserved.
+// Sends a range of bytes from a file over a TCP socket, without copying the data through user space
+// C++ header
+
+#ifndef _TCP_FILE_SENDER_HH
+#define _TCP_FILE_SENDER_HH
+
+#ifndef _MEDIA_HH
+#include "Media.hh"
+#endif
+
+// The most that we send at once, before letting the event loop handle other events:
+#ifndef TCP_FILE_SENDER_MAX_BYTES_PER_SEND
+#define TCP_FILE_SENDER_MAX_BYTES_PER_SEND (1024*1024)
+#endif
+
+class TCPFileSender: public Medium {
+public:
+  static TCPFileSender* createNew(UsageEnvironment& env, int socketNum,
+				  char const* fileName, u_int64_t startByte, u_int64_t numBytes);
+  // "socketNum" is the socket number of an existing, writable TCP socket (which should be non-blocking).
+  // The caller is responsible for closing this socket later (when this object no longer exists).
+  // Returns NULL if the file can't be opened, or if this platform doesn't support sending files this way
+  // (in which case the caller should instead stream the file - e.g., using a "TCPStreamSink").
+
+  void startSending(TaskFunc* afterFunc, void* afterClientData);
+      // "afterFunc(afterClientData)" is called once all of the data has been sent (or on error)
+  void stopSending();
+
+  u_int64_t numBytesSent() const { return fNextByte - fStartByte; }
+
+protected:
+  TCPFileSender(UsageEnvironment& env, int socketNum, int fileFd, u_int64_t startByte, u_int64_t numBytes);
+      // called only by "createNew()"
+  virtual ~TCPFileSender();
+
+private:
+  void sendMore();
+  static void socketWritableHandler(void* clientData, int mask);
+  void onCompletion();
+
+private:
+  int fOutputSocketNum;
+  int fFileFd;
+  u_int64_t fStartByte, fNextByte, fEndByte;
+  TaskFunc* fAfterFunc;
+  void* fAfterClientData;
+};
+
+#endif
@@ -116,6 +116,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "AMRAudioRTPSink.hh"
 #include "T140TextRTPSink.hh"
 #include "TCPStreamSink.hh"
+#include "TCPFileSender.hh"
 #include "MP3AudioFileServerMediaSubsession.hh"
 #include "MPEG1or2VideoFileServerMediaSubsession.hh"
 #include "MPEG1or2FileServerDemux.hh"
@@ -128,5 +129,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MatroskaFileServerDemux.hh"
 #include "OggFileServerDemux.hh"
 #include "ProxyServerMediaSession.hh"
+#include "PacketBufferPool.hh"
+#include "FileBlockCache.hh"
 
 #endif
@@ -19,6 +19,68 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "uLawAudioFilter.hh"
+// (Build with -DNO_SIMD_AUDIO_KERNELS to use only the one-sample-at-a-time conversions, or with
+// -DNO_RUNTIME_CPU_DISPATCH to use only the SSE2 versions - e.g., to test them.)
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(NO_SIMD_AUDIO_KERNELS)
+#define USE_SSE2_AUDIO_KERNELS 1
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(NO_RUNTIME_CPU_DISPATCH)
+// We can also build SSSE3 and AVX2 versions of some conversions, and choose them at run time:
+#define USE_RUNTIME_CPU_DISPATCH 1
+#include <immintrin.h>
+#endif
+#endif
+
+// Notes on the vectorized ("SIMD") conversions below:
+// - They're used only on x86, so "host order" there means little-endian.
+// - Each converts as many whole blocks of samples as it can, and returns the number of samples
+//   that it converted; the caller then converts any remaining samples one at a time.
+
+#ifdef USE_RUNTIME_CPU_DISPATCH
+static Boolean cpuHasSSSE3() {
+  static int hasSSSE3 = -1; // until we've checked
+  if (hasSSSE3 < 0) hasSSSE3 = __builtin_cpu_supports("ssse3") ? 1 : 0;
+  return hasSSSE3 != 0;
+}
+
+static Boolean cpuHasAVX2() {
+  static int hasAVX2 = -1; // until we've checked
+  if (hasAVX2 < 0) hasAVX2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+  return hasAVX2 != 0;
+}
+#endif
+
+#ifdef USE_SSE2_AUDIO_KERNELS
+static inline __m128i byteSwap16(__m128i values) {
+  return _mm_or_si128(_mm_slli_epi16(values, 8), _mm_srli_epi16(values, 8));
+}
+
+#ifdef USE_RUNTIME_CPU_DISPATCH
+__attribute__((target("avx2")))
+static unsigned swapBytes16_AVX2(u_int8_t* p, unsigned numValues) {
+  unsigned i;
+  for (i = 0; i + 16 <= numValues; i += 16) {
+    __m256i const values = _mm256_loadu_si256((__m256i const*)&p[2*i]);
+    _mm256_storeu_si256((__m256i*)&p[2*i],
+			_mm256_or_si256(_mm256_slli_epi16(values, 8), _mm256_srli_epi16(values, 8)));
+  }
+  return i;
+}
+#endif
+
+static unsigned swapBytes16_SIMD(u_int8_t* p, unsigned numValues) {
+  // Swaps the byte order of 16-bit values (in place):
+#ifdef USE_RUNTIME_CPU_DISPATCH
+  if (cpuHasAVX2()) return swapBytes16_AVX2(p, numValues);
+#endif
+  unsigned i;
+  for (i = 0; i + 8 <= numValues; i += 8) {
+    __m128i const values = _mm_loadu_si128((__m128i const*)&p[2*i]);
+    _mm_storeu_si128((__m128i*)&p[2*i], byteSwap16(values));
+  }
+  return i;
+}
+#endif
 
 ////////// 16-bit PCM (in various byte orders) -> 8-bit u-Law //////////
 
@@ -102,6 +164,97 @@ static unsigned char uLawFrom16BitLinear(u_int16_t sample) {
   return result;
 }
 
+#ifdef USE_SSE2_AUDIO_KERNELS
+// The same conversion, for 8 samples at once (with each result in the low byte of its 16-bit lane).
+// Rather than looking up the exponent, we convert the (biased) magnitude - which is always in
+// [2^7, 2^15) - to floating point.  The float's exponent (minus 127+7) and the top 4 bits of its
+// mantissa are then exactly the u-Law exponent and mantissa:
+static inline __m128i uLawFrom16BitLinear8(__m128i sample) {
+  __m128i const sign = _mm_srai_epi16(sample, 15); // all 1s iff the sample is negative
+
+  // Get the clipped magnitude.  (This is done using signed 16-bit arithmetic, in which the
+  // magnitude of -32768 won't fit, so we clip (|sample| - 1) for negative samples instead.)
+  __m128i magnitude = _mm_xor_si128(sample, sign);
+  magnitude = _mm_min_epi16(magnitude, _mm_add_epi16(_mm_set1_epi16(CLIP), sign));
+  magnitude = _mm_add_epi16(_mm_sub_epi16(magnitude, sign), _mm_set1_epi16(BIAS));
+
+  __m128i const zero = _mm_setzero_si128();
+  __m128i const lo = _mm_castps_si128(_mm_cvtepi32_ps(_mm_unpacklo_epi16(magnitude, zero)));
+  __m128i const hi = _mm_castps_si128(_mm_cvtepi32_ps(_mm_unpackhi_epi16(magnitude, zero)));
+  __m128i const exponentAndMantissa
+    = _mm_sub_epi16(_mm_packs_epi32(_mm_srli_epi32(lo, 19), _mm_srli_epi32(hi, 19)), _mm_set1_epi16(134<<4));
+
+  return _mm_andnot_si128(_mm_or_si128(exponentAndMantissa, _mm_and_si128(sign, _mm_set1_epi16(0x80))),
+			  _mm_set1_epi16(0xFF));
+}
+
+#ifdef USE_RUNTIME_CPU_DISPATCH
+__attribute__((target("avx2")))
+static inline __m256i uLawFrom16BitLinear16(__m256i sample) {
+  // The same as "uLawFrom16BitLinear8()", for 16 samples at once:
+  __m256i const sign = _mm256_srai_epi16(sample, 15);
+
+  __m256i magnitude = _mm256_xor_si256(sample, sign);
+  magnitude = _mm256_min_epi16(magnitude, _mm256_add_epi16(_mm256_set1_epi16(CLIP), sign));
+  magnitude = _mm256_add_epi16(_mm256_sub_epi16(magnitude, sign), _mm256_set1_epi16(BIAS));
+
+  __m256i const zero = _mm256_setzero_si256();
+  __m256i const lo = _mm256_castps_si256(_mm256_cvtepi32_ps(_mm256_unpacklo_epi16(magnitude, zero)));
+  __m256i const hi = _mm256_castps_si256(_mm256_cvtepi32_ps(_mm256_unpackhi_epi16(magnitude, zero)));
+  __m256i const exponentAndMantissa
+    = _mm256_sub_epi16(_mm256_packs_epi32(_mm256_srli_epi32(lo, 19), _mm256_srli_epi32(hi, 19)),
+		       _mm256_set1_epi16(134<<4));
+
+  return _mm256_andnot_si256(_mm256_or_si256(exponentAndMantissa, _mm256_and_si256(sign, _mm256_set1_epi16(0x80))),
+			     _mm256_set1_epi16(0xFF));
+}
+
+__attribute__((target("avx2")))
+static unsigned uLawFrom16BitLinear_AVX2(unsigned char* to, unsigned char const* from,
+					 unsigned numSamples, Boolean isBigEndian) {
+  __m256i const zero = _mm256_setzero_si256();
+  __m256i const twos = _mm256_set1_epi8(2);
+  unsigned i;
+  for (i = 0; i + 32 <= numSamples; i += 32) {
+    __m256i s0 = _mm256_loadu_si256((__m256i const*)&from[2*i]);
+    __m256i s1 = _mm256_loadu_si256((__m256i const*)&from[2*i+32]);
+    if (isBigEndian) {
+      s0 = _mm256_or_si256(_mm256_slli_epi16(s0, 8), _mm256_srli_epi16(s0, 8));
+      s1 = _mm256_or_si256(_mm256_slli_epi16(s1, 8), _mm256_srli_epi16(s1, 8));
+    }
+    // ("_mm256_packus_epi16()" interleaves the 128-bit halves of its inputs, so we then reorder them:)
+    __m256i result = _mm256_permute4x64_epi64(_mm256_packus_epi16(uLawFrom16BitLinear16(s0),
+								   uLawFrom16BitLinear16(s1)), 0xD8);
+    result = _mm256_or_si256(result, _mm256_and_si256(_mm256_cmpeq_epi8(result, zero), twos)); // CCITT trap
+    _mm256_storeu_si256((__m256i*)&to[i], result);
+  }
+  return i;
+}
+#endif
+
+static unsigned uLawFrom16BitLinear_SIMD(unsigned char* to, unsigned char const* from,
+					 unsigned numSamples, Boolean isBigEndian) {
+#ifdef USE_RUNTIME_CPU_DISPATCH
+  if (cpuHasAVX2()) return uLawFrom16BitLinear_AVX2(to, from, numSamples, isBigEndian);
+#endif
+  __m128i const zero = _mm_setzero_si128();
+  __m128i const twos = _mm_set1_epi8(2);
+  unsigned i;
+  for (i = 0; i + 16 <= numSamples; i += 16) {
+    __m128i s0 = _mm_loadu_si128((__m128i const*)&from[2*i]);
+    __m128i s1 = _mm_loadu_si128((__m128i const*)&from[2*i+16]);
+    if (isBigEndian) {
+      s0 = byteSwap16(s0);
+      s1 = byteSwap16(s1);
+    }
+    __m128i result = _mm_packus_epi16(uLawFrom16BitLinear8(s0), uLawFrom16BitLinear8(s1));
+    result = _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi8(result, zero), twos)); // CCITT trap
+    _mm_storeu_si128((__m128i*)&to[i], result);
+  }
+  return i;
+}
+#endif
+
 void uLawFromPCMAudioSource
 ::afterGettingFrame1(unsigned frameSize, unsigned numTruncatedBytes,
 		     struct timeval presentationTime,
@@ -109,24 +262,28 @@ void uLawFromPCMAudioSource
   // Translate raw 16-bit PCM samples (in the input buffer)
   // into uLaw samples (in the output buffer).
   unsigned numSamples = frameSize/2;
+  unsigned i = 0;
+#ifdef USE_SSE2_AUDIO_KERNELS
+  i = uLawFrom16BitLinear_SIMD(fTo, fInputBuffer, numSamples, fByteOrdering == 2);
+#endif
   switch (fByteOrdering) {
     case 0: { // host order
       u_int16_t* inputSample = (u_int16_t*)fInputBuffer;
-      for (unsigned i = 0; i < numSamples; ++i) {
+      for (; i < numSamples; ++i) {
 	fTo[i] = uLawFrom16BitLinear(inputSample[i]);
       }
       break;
     }
     case 1: { // little-endian order
-      for (unsigned i = 0; i < numSamples; ++i) {
+      for (; i < numSamples; ++i) {
 	u_int16_t const newValue = (fInputBuffer[2*i+1]<<8)|fInputBuffer[2*i];
 	fTo[i] = uLawFrom16BitLinear(newValue);
       }
       break;
     }
     case 2: { // network (i.e., big-endian) order
-      for (unsigned i = 0; i < numSamples; ++i) {
-	u_int16_t const newValue = (fInputBuffer[2*i]<<8)|fInputBuffer[2*i+i];
+      for (; i < numSamples; ++i) {
+	u_int16_t const newValue = (fInputBuffer[2*i]<<8)|fInputBuffer[2*i+1];
 	fTo[i] = uLawFrom16BitLinear(newValue);
       }
       break;
@@ -152,25 +309,17 @@ PCMFromuLawAudioSource* PCMFromuLawAudioSource
 PCMFromuLawAudioSource
 ::PCMFromuLawAudioSource(UsageEnvironment& env,
 			 FramedSource* inputSource)
-  : FramedFilter(env, inputSource),
-    fInputBuffer(NULL), fInputBufferSize(0) {
+  : FramedFilter(env, inputSource) {
 }
 
 PCMFromuLawAudioSource::~PCMFromuLawAudioSource() {
-  delete[] fInputBuffer;
 }
 
 void PCMFromuLawAudioSource::doGetNextFrame() {
-  // Figure out how many bytes of input data to ask for, and increase
-  // our input buffer if necessary:
+  // Arrange to read uLaw samples directly into the start of the client's buffer.
+  // (We then convert them in place, working backwards.)
   unsigned bytesToRead = fMaxSize/2; // because we're converting 8 bits->16
-  if (bytesToRead > fInputBufferSize) {
-    delete[] fInputBuffer; fInputBuffer = new unsigned char[bytesToRead];
-    fInputBufferSize = bytesToRead;
-  }
-
-  // Arrange to read samples into the input buffer:
-  fInputSource->getNextFrame(fInputBuffer, bytesToRead,
+  fInputSource->getNextFrame(fTo, bytesToRead,
 			     afterGettingFrame, this,
                              FramedSource::handleClosure, this);
 }
@@ -198,17 +347,105 @@ static u_int16_t linear16FromuLaw(unsigned char uLawByte) {
   return result;
 }
 
+#ifdef USE_SSE2_AUDIO_KERNELS
+// The same conversion, for 8 samples at once (with each uLaw byte in the low byte of its 16-bit lane).
+// The magnitude that we want is ((33 + 2*mantissa) << (exponent+2)) - 132, so we build the
+// float with that value (before the subtraction) directly from the exponent and mantissa bits:
+#define FLOAT_BITS_FOR_uLAW ((134<<23)|(1<<18))
+
+static inline __m128i linear16FromuLaw8(__m128i uLawByte) {
+  uLawByte = _mm_xor_si128(uLawByte, _mm_set1_epi16(0xFF));
+  __m128i const sign = _mm_srai_epi16(_mm_slli_epi16(uLawByte, 8), 15); // all 1s iff negative
+  __m128i const exponentAndMantissa = _mm_and_si128(uLawByte, _mm_set1_epi16(0x7F));
+
+  __m128i const zero = _mm_setzero_si128();
+  __m128i const floatBits = _mm_set1_epi32(FLOAT_BITS_FOR_uLAW);
+  __m128i const lo
+    = _mm_cvttps_epi32(_mm_castsi128_ps(_mm_add_epi32(_mm_slli_epi32(_mm_unpacklo_epi16(exponentAndMantissa, zero), 19),
+						      floatBits)));
+  __m128i const hi
+    = _mm_cvttps_epi32(_mm_castsi128_ps(_mm_add_epi32(_mm_slli_epi32(_mm_unpackhi_epi16(exponentAndMantissa, zero), 19),
+						      floatBits)));
+  __m128i const magnitude = _mm_sub_epi16(_mm_packs_epi32(lo, hi), _mm_set1_epi16(132));
+
+  return _mm_sub_epi16(_mm_xor_si128(magnitude, sign), sign);
+}
+
+#ifdef USE_RUNTIME_CPU_DISPATCH
+__attribute__((target("avx2")))
+static inline __m256i linear16FromuLaw16(__m256i uLawByte) {
+  // The same as "linear16FromuLaw8()", for 16 samples at once:
+  uLawByte = _mm256_xor_si256(uLawByte, _mm256_set1_epi16(0xFF));
+  __m256i const sign = _mm256_srai_epi16(_mm256_slli_epi16(uLawByte, 8), 15);
+  __m256i const exponentAndMantissa = _mm256_and_si256(uLawByte, _mm256_set1_epi16(0x7F));
+
+  __m256i const zero = _mm256_setzero_si256();
+  __m256i const floatBits = _mm256_set1_epi32(FLOAT_BITS_FOR_uLAW);
+  __m256i const lo
+    = _mm256_cvttps_epi32(_mm256_castsi256_ps(_mm256_add_epi32(_mm256_slli_epi32(_mm256_unpacklo_epi16(exponentAndMantissa, zero), 19),
+							       floatBits)));
+  __m256i const hi
+    = _mm256_cvttps_epi32(_mm256_castsi256_ps(_mm256_add_epi32(_mm256_slli_epi32(_mm256_unpackhi_epi16(exponentAndMantissa, zero), 19),
+							       floatBits)));
+  __m256i const magnitude = _mm256_sub_epi16(_mm256_packs_epi32(lo, hi), _mm256_set1_epi16(132));
+
+  return _mm256_sub_epi16(_mm256_xor_si256(magnitude, sign), sign);
+}
+
+__attribute__((target("avx2")))
+static void linear16FromuLaw_AVX2(u_int16_t* to, unsigned char const* from, unsigned numSamples) {
+  for (unsigned i = numSamples; i > 0; ) {
+    i -= 16;
+    __m256i const uLawBytes = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)&from[i]));
+    _mm256_storeu_si256((__m256i*)&to[i], linear16FromuLaw16(uLawBytes));
+  }
+}
+#endif
+
+static unsigned linear16FromuLaw_SIMD(u_int16_t* to, unsigned char const* from, unsigned numSamples) {
+  // Unlike the other SIMD conversions, this converts the *first* (numSamples&~15) samples, working
+  // backwards, so that "to" may overlap "from" (provided that "to" doesn't precede it):
+  numSamples &=~ 15;
+#ifdef USE_RUNTIME_CPU_DISPATCH
+  if (cpuHasAVX2()) {
+    linear16FromuLaw_AVX2(to, from, numSamples);
+    return numSamples;
+  }
+#endif
+  __m128i const zero = _mm_setzero_si128();
+  for (unsigned i = numSamples; i > 0; ) {
+    i -= 16;
+    __m128i const uLawBytes = _mm_loadu_si128((__m128i const*)&from[i]);
+    __m128i const result0 = linear16FromuLaw8(_mm_unpacklo_epi8(uLawBytes, zero));
+    __m128i const result1 = linear16FromuLaw8(_mm_unpackhi_epi8(uLawBytes, zero));
+    _mm_storeu_si128((__m128i*)&to[i], result0);
+    _mm_storeu_si128((__m128i*)&to[i+8], result1);
+  }
+  return numSamples;
+}
+#endif
+
 void PCMFromuLawAudioSource
 ::afterGettingFrame1(unsigned frameSize, unsigned numTruncatedBytes,
 		     struct timeval presentationTime,
 		     unsigned durationInMicroseconds) {
-  // Translate uLaw samples (in the input buffer)
+  // Translate uLaw samples (at the start of the output buffer)
   // into 16-bit PCM samples (in the output buffer), in host order.
+  // Because each sample doubles in size, we do this backwards, from the last sample:
   unsigned numSamples = frameSize;
+  unsigned char const* inputSample = fTo;
   u_int16_t* outputSample = (u_int16_t*)fTo;
-  for (unsigned i = 0; i < numSamples; ++i) {
-    outputSample[i] = linear16FromuLaw(fInputBuffer[i]);
+  unsigned numSIMDSamples = 0;
+#ifdef USE_SSE2_AUDIO_KERNELS
+  numSIMDSamples = numSamples&~15;
+#endif
+  for (unsigned i = numSamples; i > numSIMDSamples; ) {
+    --i;
+    outputSample[i] = linear16FromuLaw(inputSample[i]);
   }
+#ifdef USE_SSE2_AUDIO_KERNELS
+  linear16FromuLaw_SIMD(outputSample, inputSample, numSIMDSamples);
+#endif
 
   // Complete delivery to the client:
   fFrameSize = numSamples*2;
@@ -260,7 +497,11 @@ void NetworkFromHostOrder16
   // to network order (in-place)
   unsigned numValues = frameSize/2;
   u_int16_t* value = (u_int16_t*)fTo;
-  for (unsigned i = 0; i < numValues; ++i) {
+  unsigned i = 0;
+#ifdef USE_SSE2_AUDIO_KERNELS
+  i = swapBytes16_SIMD(fTo, numValues);
+#endif
+  for (; i < numValues; ++i) {
     value[i] = htons(value[i]);
   }
 
@@ -314,7 +555,11 @@ void HostFromNetworkOrder16
   // to host order (in-place):
   unsigned numValues = frameSize/2;
   u_int16_t* value = (u_int16_t*)fTo;
-  for (unsigned i = 0; i < numValues; ++i) {
+  unsigned i = 0;
+#ifdef USE_SSE2_AUDIO_KERNELS
+  i = swapBytes16_SIMD(fTo, numValues);
+#endif
+  for (; i < numValues; ++i) {
     value[i] = ntohs(value[i]);
   }
 
@@ -364,7 +609,11 @@ void EndianSwap16::afterGettingFrame1(unsigned frameSize, unsigned numTruncatedB
   // Swap the byte order of the 16-bit values that we have just read (in place):
   unsigned numValues = frameSize/2;
   u_int16_t* value = (u_int16_t*)fTo;
-  for (unsigned i = 0; i < numValues; ++i) {
+  unsigned i = 0;
+#ifdef USE_SSE2_AUDIO_KERNELS
+  i = swapBytes16_SIMD(fTo, numValues);
+#endif
+  for (; i < numValues; ++i) {
     u_int16_t const orig = value[i];
     value[i] = ((orig&0xFF)<<8) | ((orig&0xFF00)>>8);
   }
@@ -380,6 +629,35 @@ void EndianSwap16::afterGettingFrame1(unsigned frameSize, unsigned numTruncatedB
 
 ////////// 24-bit values: little-endian <-> big-endian //////////
 
+#ifdef USE_RUNTIME_CPU_DISPATCH
+__attribute__((target("ssse3")))
+static unsigned swapBytes24_SSSE3(u_int8_t* p, unsigned numValues) {
+  // Swaps the byte order of 24-bit values (in place), 16 values (i.e., 3 16-byte vectors) at a time.
+  // Each output vector takes bytes from the corresponding input vector, and also from its neighbor(s),
+  // because values straddle the vector boundaries.  (A "-1" shuffle index produces a zero byte.)
+  __m128i const from0To0 = _mm_setr_epi8(2,1,0, 5,4,3, 8,7,6, 11,10,9, 14,13,12, -1);
+  __m128i const from1To0 = _mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 1);
+  __m128i const from0To1 = _mm_setr_epi8(-1, 15, -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1);
+  __m128i const from1To1 = _mm_setr_epi8(0, -1, 4,3,2, 7,6,5, 10,9,8, 13,12,11, -1, 15);
+  __m128i const from2To1 = _mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 0, -1);
+  __m128i const from1To2 = _mm_setr_epi8(14, -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1);
+  __m128i const from2To2 = _mm_setr_epi8(-1, 3,2,1, 6,5,4, 9,8,7, 12,11,10, 15,14,13);
+
+  unsigned i;
+  for (i = 0; i + 16 <= numValues; i += 16) {
+    __m128i* v = (__m128i*)&p[3*i];
+    __m128i const in0 = _mm_loadu_si128(&v[0]);
+    __m128i const in1 = _mm_loadu_si128(&v[1]);
+    __m128i const in2 = _mm_loadu_si128(&v[2]);
+    _mm_storeu_si128(&v[0], _mm_or_si128(_mm_shuffle_epi8(in0, from0To0), _mm_shuffle_epi8(in1, from1To0)));
+    _mm_storeu_si128(&v[1], _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(in0, from0To1), _mm_shuffle_epi8(in1, from1To1)),
+					 _mm_shuffle_epi8(in2, from2To1)));
+    _mm_storeu_si128(&v[2], _mm_or_si128(_mm_shuffle_epi8(in1, from1To2), _mm_shuffle_epi8(in2, from2To2)));
+  }
+  return i;
+}
+#endif
+
 EndianSwap24*
 EndianSwap24::createNew(UsageEnvironment& env, FramedSource* inputSource) {
   return new EndianSwap24(env, inputSource);
@@ -415,7 +693,14 @@ void EndianSwap24::afterGettingFrame1(unsigned frameSize, unsigned numTruncatedB
   // Swap the byte order of the 24-bit values that we have just read (in place):
   unsigned const numValues = frameSize/3;
   u_int8_t* p = fTo;
-  for (unsigned i = 0; i < numValues; ++i) {
+  unsigned i = 0;
+#ifdef USE_RUNTIME_CPU_DISPATCH
+  if (cpuHasSSSE3()) {
+    i = swapBytes24_SSSE3(p, numValues);
+    p += 3*i;
+  }
+#endif
+  for (; i < numValues; ++i) {
     u_int8_t tmp = p[0];
     p[0] = p[2];
     p[2] = tmp;
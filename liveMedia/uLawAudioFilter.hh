@@ -89,10 +89,6 @@ private:
 			  unsigned numTruncatedBytes,
 			  struct timeval presentationTime,
 			  unsigned durationInMicroseconds);
-
-private:
-  unsigned char* fInputBuffer;
-  unsigned fInputBufferSize;
 };
 
 
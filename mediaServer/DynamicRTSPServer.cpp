@@ -21,6 +21,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "DynamicRTSPServer.hh"
 #include <liveMedia.hh>
 #include <string.h>
+#if !defined(__WIN32__) && !defined(_WIN32)
+#include <unistd.h>
+#endif
 
 DynamicRTSPServer*
 DynamicRTSPServer::createNew(UsageEnvironment& env, Port ourPort,
@@ -32,6 +35,26 @@ DynamicRTSPServer::createNew(UsageEnvironment& env, Port ourPort,
   return new DynamicRTSPServer(env, ourSocket, ourPort, authDatabase, reclamationTestSeconds);
 }
 
+DynamicRTSPServer*
+DynamicRTSPServer::createNew(UsageEnvironment& env, DynamicRTSPServer const& listeningServer,
+			     UserAuthenticationDatabase* authDatabase,
+			     unsigned reclamationTestSeconds) {
+#if defined(__WIN32__) || defined(_WIN32)
+  env.setResultMsg("Sharing a listening socket between servers is not supported on this platform");
+  return NULL;
+#else
+  // Each server gets its own descriptor for the (same) listening socket, so that each can close its own.
+  // (We don't use "SO_REUSEPORT" for this, because that would also let other processes share the port.)
+  int ourSocket = dup(listeningServer.fServerSocket);
+  if (ourSocket < 0) {
+    env.setResultErrMsg("dup() failed: ");
+    return NULL;
+  }
+
+  return new DynamicRTSPServer(env, ourSocket, listeningServer.fServerPort, authDatabase, reclamationTestSeconds);
+#endif
+}
+
 DynamicRTSPServer::DynamicRTSPServer(UsageEnvironment& env, int ourSocket,
 				     Port ourPort,
 				     UserAuthenticationDatabase* authDatabase, unsigned reclamationTestSeconds)
@@ -30,6 +30,11 @@ public:
   static DynamicRTSPServer* createNew(UsageEnvironment& env, Port ourPort,
 				      UserAuthenticationDatabase* authDatabase,
 				      unsigned reclamationTestSeconds = 65);
+  static DynamicRTSPServer* createNew(UsageEnvironment& env, DynamicRTSPServer const& listeningServer,
+				      UserAuthenticationDatabase* authDatabase,
+				      unsigned reclamationTestSeconds = 65);
+      // Creates a server - for another thread, with its own "UsageEnvironment" - that accepts
+      // connections on (a duplicate of) "listeningServer"'s socket.  (Not supported on Windows.)
 
 protected:
   DynamicRTSPServer(UsageEnvironment& env, int ourSocket, Port ourPort,
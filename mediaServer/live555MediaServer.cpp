@@ -18,14 +18,31 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // main program
 
 #include <BasicUsageEnvironment.hh>
+#include <liveMedia.hh>
 #include "DynamicRTSPServer.hh"
 #include "version.hh"
+#if defined(__WIN32__) || defined(_WIN32)
+// We don't support sharing a listening socket between threads on Windoze, so we always use a single event loop
+#else
+#define USE_MULTIPLE_EVENT_LOOPS 1
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
-int main(int argc, char** argv) {
-  // Begin by setting up our usage environment:
-  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
-  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+#ifndef MAX_NUM_EVENT_LOOPS
+#define MAX_NUM_EVENT_LOOPS 256
+#endif
+
+static UsageEnvironment* createEnvironment() {
+  TaskScheduler* scheduler = NULL;
+#if defined(__linux__)
+  scheduler = EpollTaskScheduler::createNew(); // scales to many more concurrent clients than "select()"
+#endif
+  if (scheduler == NULL) scheduler = BasicTaskScheduler::createNew();
+  return BasicUsageEnvironment::createNew(*scheduler);
+}
 
+static UserAuthenticationDatabase* createAuthDB() {
   UserAuthenticationDatabase* authDB = NULL;
 #ifdef ACCESS_CONTROL
   // To implement client access control to the RTSP server, do the following:
@@ -34,20 +51,136 @@ int main(int argc, char** argv) {
   // Repeat the above with each <username>, <password> that you wish to allow
   // access to the server.
 #endif
+  return authDB;
+}
+
+// If > 0, each event loop's server reads the files that it streams through a "FileBlockCache" of this size.
+// (The total size - given by the "-f" option - is shared out among the event loops.)
+static u_int64_t fileBlockCacheSizePerEventLoop = 0;
+
+#ifdef USE_MULTIPLE_EVENT_LOOPS
+// Each additional event loop runs in its own thread, with its own "UsageEnvironment" and its own
+// "DynamicRTSPServer" (and thus its own "ServerMediaSession"s).  These servers all accept connections
+// on the first server's listening socket, so each new RTSP connection is accepted by whichever event
+// loop gets to it first.  (With "epoll()", only one of the event loops is woken for each new connection.)
+// (We don't use "SO_REUSEPORT" for this, because then another server process could also share - rather
+// than fail to use - our port.)
+static void* eventLoopThread(void* arg) {
+  DynamicRTSPServer const* listeningServer = (DynamicRTSPServer const*)arg;
+  UsageEnvironment* env = createEnvironment();
+
+  RTSPServer* rtspServer
+    = DynamicRTSPServer::createNew(*env, *listeningServer, createAuthDB());
+  if (rtspServer == NULL) {
+    *env << "Failed to create additional RTSP server: " << env->getResultMsg() << "\n";
+    return NULL;
+  }
+  if (fileBlockCacheSizePerEventLoop > 0) rtspServer->setFileBlockCacheSize(fileBlockCacheSizePerEventLoop);
+
+  env->taskScheduler().doEventLoop(); // does not return
+  return NULL;
+}
+#endif
+
+static char const* progName;
+
+static void usage(UsageEnvironment& env) {
+  env << "Usage: " << progName
+      << " [-c <sdp-cache-directory>] [-f <file-cache-MBytes>]"
+#ifdef USE_MULTIPLE_EVENT_LOOPS
+      << " [-n <num-event-loops>]"
+      << "\n\t(If <num-event-loops> is 0, we use one event loop (thread) per CPU core.)"
+#endif
+      << "\n\t(If <file-cache-MBytes> is 0, we use " << (unsigned)(FILE_BLOCK_CACHE_DEFAULT_MAX_SIZE/(1024*1024))
+      << " MBytes.  This is shared out among the event loops.)"
+      << "\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  // Begin by setting up our usage environment:
+  UsageEnvironment* env = createEnvironment();
+
+  // Check command-line options:
+  unsigned numEventLoops = 1;
+  Boolean useFileBlockCache = False;
+  unsigned fileBlockCacheMBytes = 0;
+  progName = argv[0];
+  while (argc > 1) {
+    char* const opt = argv[1];
+    if (opt[0] != '-') usage(*env);
+
+    switch (opt[1]) {
+    case 'c': { // a directory in which to cache SDP parameters that had to be found by reading a file (e.g., for H.264)
+      if (argc > 2) {
+	FileServerMediaSubsession::setAuxSDPLineCacheDirectory(argv[2]);
+	++argv; --argc;
+	break;
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage(*env);
+      break;
+    }
+
+    case 'f': { // read the files that we stream through a cache, so that concurrent streams of the same file share the data
+      if (argc > 2 && sscanf(argv[2], "%u", &fileBlockCacheMBytes) == 1) {
+	useFileBlockCache = True;
+	++argv; --argc;
+	break;
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage(*env);
+      break;
+    }
+
+#ifdef USE_MULTIPLE_EVENT_LOOPS
+    case 'n': { // the number of event loops (each in its own thread) that serve RTSP clients
+      if (argc > 2 && sscanf(argv[2], "%u", &numEventLoops) == 1) {
+	++argv; --argc;
+	if (numEventLoops == 0) {
+	  long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+	  numEventLoops = numCores > 0 ? (unsigned)numCores : 1;
+	}
+	if (numEventLoops > MAX_NUM_EVENT_LOOPS) numEventLoops = MAX_NUM_EVENT_LOOPS;
+	break;
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage(*env);
+      break;
+    }
+#endif
+
+    default: {
+      usage(*env);
+      break;
+    }
+    }
+
+    ++argv; --argc;
+  }
+  if (useFileBlockCache) {
+    u_int64_t const fileBlockCacheSize
+      = fileBlockCacheMBytes == 0 ? FILE_BLOCK_CACHE_DEFAULT_MAX_SIZE : (u_int64_t)fileBlockCacheMBytes*1024*1024;
+    fileBlockCacheSizePerEventLoop = fileBlockCacheSize/numEventLoops;
+  }
 
   // Create the RTSP server.  Try first with the default port number (554),
   // and then with the alternative port number (8554):
-  RTSPServer* rtspServer;
+  DynamicRTSPServer* rtspServer;
   portNumBits rtspServerPortNum = 554;
-  rtspServer = DynamicRTSPServer::createNew(*env, rtspServerPortNum, authDB);
+  rtspServer = DynamicRTSPServer::createNew(*env, rtspServerPortNum, createAuthDB());
   if (rtspServer == NULL) {
     rtspServerPortNum = 8554;
-    rtspServer = DynamicRTSPServer::createNew(*env, rtspServerPortNum, authDB);
+    rtspServer = DynamicRTSPServer::createNew(*env, rtspServerPortNum, createAuthDB());
   }
   if (rtspServer == NULL) {
     *env << "Failed to create RTSP server: " << env->getResultMsg() << "\n";
     exit(1);
   }
+  if (fileBlockCacheSizePerEventLoop > 0) rtspServer->setFileBlockCacheSize(fileBlockCacheSizePerEventLoop);
 
   *env << "LIVE555 Media Server\n";
   *env << "\tversion " << MEDIA_SERVER_VERSION_STRING
@@ -86,6 +219,21 @@ int main(int argc, char** argv) {
     *env << "(RTSP-over-HTTP tunneling is not available.)\n";
   }
 
+#ifdef USE_MULTIPLE_EVENT_LOOPS
+  // Start any additional event loops.  (This (first) event loop continues to handle RTSP-over-HTTP
+  // tunneling by itself, because a tunnel's two HTTP connections must be handled by the same server.)
+  unsigned numEventLoopsStarted = 1;
+  for (unsigned i = 1; i < numEventLoops; ++i) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, eventLoopThread, rtspServer) != 0) break;
+    pthread_detach(thread);
+    ++numEventLoopsStarted;
+  }
+  if (numEventLoopsStarted > 1) {
+    *env << "(We use " << numEventLoopsStarted << " event loops (threads) to handle RTSP clients.)\n";
+  }
+#endif
+
   env->taskScheduler().doEventLoop(); // does not return
 
   return 0; // only to prevent compiler warning
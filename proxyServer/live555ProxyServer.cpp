@@ -61,7 +61,11 @@ int main(int argc, char** argv) {
   OutPacketBuffer::maxSize = 100000; // bytes
 
   // Begin by setting up our usage environment:
-  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  TaskScheduler* scheduler = NULL;
+#if defined(__linux__)
+  scheduler = EpollTaskScheduler::createNew(); // scales to many more concurrent clients than "select()"
+#endif
+  if (scheduler == NULL) scheduler = BasicTaskScheduler::createNew();
   env = BasicUsageEnvironment::createNew(*scheduler);
 
   *env << "LIVE555 Proxy Server\n"
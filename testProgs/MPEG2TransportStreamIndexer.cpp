@@ -18,10 +18,19 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // and generates a separate index file that can be used - by our RTSP server
 // implementation - to support 'trick play' operations when streaming the
 // Transport Stream file.
+// It can also index a file that's still being written (e.g., a recording in progress),
+// or - for a large, complete file - index several parts of the file in parallel.
 // main program
 
 #include <liveMedia.hh>
 #include <BasicUsageEnvironment.hh>
+#if defined(__WIN32__) || defined(_WIN32)
+// We don't implement parallel indexing on Windoze
+#else
+#define INDEX_IN_PARALLEL 1
+#include "parallelIndexer.hh"
+#include <unistd.h>
+#endif
 
 void afterPlaying(void* clientData); // forward
 
@@ -29,8 +38,17 @@ UsageEnvironment* env;
 char const* programName;
 
 void usage() {
-  *env << "usage: " << programName << " <transport-stream-file-name>\n";
+  *env << "usage: " << programName << " [-l <idle-timeout-seconds>]"
+#ifdef INDEX_IN_PARALLEL
+       << " [-j <num-threads>]"
+#endif
+       << " <transport-stream-file-name>\n";
   *env << "\twhere <transport-stream-file-name> ends with \".ts\"\n";
+  *env << "\t-l: index a file that's still being written (e.g., a recording in progress), adding to the index file as the\n"
+       << "\t    file grows - until it hasn't grown for <idle-timeout-seconds> (0 means 'keep waiting forever')\n";
+#ifdef INDEX_IN_PARALLEL
+  *env << "\t-j: index a (complete) file in up to <num-threads> parts, in parallel (0 means 'one per CPU core')\n";
+#endif
   exit(1);
 }
 
@@ -41,7 +59,31 @@ int main(int argc, char const** argv) {
 
   // Parse the command line:
   programName = argv[0];
+  Boolean followGrowingFile = False;
+  unsigned idleTimeoutSeconds = 0;
+  int numThreads = 1;
+  while (argc > 1) {
+    char const* opt = argv[1];
+    if (opt[0] != '-') break;
+
+    if (strcmp(opt, "-l") == 0 && argc > 2) {
+      if (sscanf(argv[2], "%u", &idleTimeoutSeconds) != 1) usage();
+      followGrowingFile = True;
+#ifdef INDEX_IN_PARALLEL
+    } else if (strcmp(opt, "-j") == 0 && argc > 2) {
+      if (sscanf(argv[2], "%d", &numThreads) != 1 || numThreads < 0) usage();
+      if (numThreads == 0) numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    } else {
+      usage();
+    }
+    argv += 2; argc -= 2;
+  }
   if (argc != 2) usage();
+  if (followGrowingFile && numThreads > 1) {
+    *env << "ERROR: A file that's still being written can't be indexed in parallel\n";
+    usage();
+  }
 
   char const* inputFileName = argv[1];
   // Check whether the input file name ends with ".ts":
@@ -52,23 +94,34 @@ int main(int argc, char const** argv) {
     usage();
   }
 
+  // The output file name is the same as the input file name, except with suffix ".tsx":
+  char* outputFileName = new char[len+2]; // allow for trailing x\0
+  sprintf(outputFileName, "%sx", inputFileName);
+
+#ifdef INDEX_IN_PARALLEL
+  if (numThreads > 1) {
+    *env << "Writing index file \"" << outputFileName << "\"...";
+    if (!indexInParallel(*env, inputFileName, outputFileName, (unsigned)numThreads)) exit(1);
+    afterPlaying(NULL); // does not return
+  }
+#endif
+
   // Open the input file (as a 'byte stream file source'):
-  FramedSource* input
+  ByteStreamFileSource* input
     = ByteStreamFileSource::createNew(*env, inputFileName, TRANSPORT_PACKET_SIZE);
   if (input == NULL) {
     *env << "Failed to open input file \"" << inputFileName << "\" (does it exist?)\n";
     exit(1);
   }
+  if (followGrowingFile) input->followGrowingFile(idleTimeoutSeconds);
 
   // Create a filter that indexes the input Transport Stream data:
   FramedSource* indexer
     = MPEG2IFrameIndexFromTransportStream::createNew(*env, input);
 
-  // The output file name is the same as the input file name, except with suffix ".tsx":
-  char* outputFileName = new char[len+2]; // allow for trailing x\0
-  sprintf(outputFileName, "%sx", inputFileName);
-
-  // Open the output file (for writing), as a 'file sink':
+  // Open the output file (for writing), as a 'file sink'.
+  // (Because "FileSink" flushes its output after each index record, the index file can be used - e.g., by our RTSP server -
+  // while it's still being written.)
   MediaSink* output = FileSink::createNew(*env, outputFileName);
   if (output == NULL) {
     *env << "Failed to open output file \"" << outputFileName << "\"\n";
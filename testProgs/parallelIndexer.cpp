@@ -0,0 +1,428 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// Indexing a (complete) Transport Stream file in parallel - used by "MPEG2TransportStreamIndexer -j"
+// Implementation
+
+#include "parallelIndexer.hh"
+#include "BasicUsageEnvironment.hh"
+#include "InputFile.hh"
+#include <pthread.h>
+
+// To index the file in parallel, we split it into parts, index each part (using its own thread, and event loop)
+// into a separate, temporary index file, and then combine these into the final index file - adjusting the
+// transport packet numbers in each part's index records.
+//
+// Each part (after the first) begins with a video packet that begins a PES packet - and contains the start code
+// of the first 'frame' in it - so that the indexer can begin cleanly.  Because a part might not contain the PAT and
+// PMT before its first video packet, we give each part's indexer the PAT and PMT from the start of the file in advance.
+// We also give it the file's first PCR, and the last PCR before the part, so that its index records get the same
+// PCRs as they would if the whole file were indexed at once.
+//
+// A part's first video packet can also contain the end of the previous part's last frame (e.g., the first byte of a
+// 4-byte start code).  An indexer that begins with that packet doesn't know which frame those bytes belong to, so it
+// doesn't deliver index records for them.  So we have each part's indexer read this packet as well, and - from the
+// records that it delivers for it - keep just those that continue the part's last frame.
+
+#define MAX_NUM_PARTS 256
+#define TRANSPORT_SYNC_BYTE 0x47
+#define PAT_PID 0
+#define SCAN_BLOCK_NUM_PACKETS 256 // the number of Transport Stream packets that we read at a time, when scanning
+
+struct IndexerPart {
+  char const* inputFileName;
+  unsigned char const* patPacket; // NULL for the first part
+  unsigned char const* pmtPacket; // ditto
+  Boolean havePrecedingPCRs;
+  float precedingFirstPCR, precedingLastPCR; // used iff "havePrecedingPCRs"
+  u_int64_t startByte;
+  u_int64_t numBytes; // 0 means 'to the end of the file'
+  char* indexFileName; // temporary
+  Boolean succeeded;
+  Boolean haveSeenPCR;
+  float firstPCR, lastPCR, lastRelativePCR;
+  float pcrDecreaseAtEnd; // > 0 iff the PCR goes backwards in the packet that we share with the next part
+};
+
+static void afterPlayingPart(void* clientData) {
+  *(char volatile*)clientData = ~0;
+}
+
+// Each part is indexed in its own thread, with its own "TaskScheduler" and "UsageEnvironment", so the
+// threads share no library state - other than the process-wide counter from which "DelayQueueEntry"
+// tokens are allocated, which is atomic for this reason.
+static void* indexPart(void* arg) {
+  IndexerPart* part = (IndexerPart*)arg;
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* partEnv = BasicUsageEnvironment::createNew(*scheduler);
+
+  ByteStreamFileSource* input
+    = ByteStreamFileSource::createNew(*partEnv, part->inputFileName, TRANSPORT_PACKET_SIZE);
+  MPEG2IFrameIndexFromTransportStream* indexer = NULL;
+  MediaSink* output = NULL;
+  if (input != NULL) {
+    input->seekToByteAbsolute(part->startByte, part->numBytes);
+    indexer = MPEG2IFrameIndexFromTransportStream::createNew(*partEnv, input);
+    if (part->patPacket != NULL) {
+      indexer->noteTables((unsigned char*)part->patPacket, (unsigned char*)part->pmtPacket);
+    }
+    if (part->havePrecedingPCRs) indexer->notePrecedingPCRs(part->precedingFirstPCR, part->precedingLastPCR);
+    output = FileSink::createNew(*partEnv, part->indexFileName);
+  }
+
+  if (output != NULL) {
+    char volatile doneFlag = 0;
+    output->startPlaying(*indexer, afterPlayingPart, (void*)&doneFlag);
+    partEnv->taskScheduler().doEventLoop(&doneFlag);
+
+    part->succeeded = True;
+    part->haveSeenPCR = indexer->haveSeenPCR();
+    part->firstPCR = indexer->firstPCR();
+    part->lastPCR = indexer->lastPCR();
+    part->lastRelativePCR = indexer->lastRelativePCR();
+  }
+
+  Medium::close(output);
+  if (indexer != NULL) Medium::close(indexer); else Medium::close(input); // closing "indexer" also closes "input"
+  partEnv->reclaim();
+  delete scheduler;
+  return NULL;
+}
+
+// Returns a pointer to the payload (if any) of a Transport Stream packet:
+static unsigned char const* payloadOf(unsigned char const* pkt, unsigned& payloadSize) {
+  u_int8_t adaptation_field_control = (pkt[3]&0x30)>>4;
+  if (!(adaptation_field_control == 1 || adaptation_field_control == 3)) return NULL;
+
+  unsigned totalHeaderSize = adaptation_field_control == 1 ? 4 : 5 + pkt[4];
+  if (totalHeaderSize >= TRANSPORT_PACKET_SIZE) return NULL;
+
+  payloadSize = TRANSPORT_PACKET_SIZE - totalHeaderSize;
+  return &pkt[totalHeaderSize];
+}
+
+// Returns True - setting "pcr" - iff a Transport Stream packet has a PCR.  (This is checked - and computed - exactly as
+// "MPEG2IFrameIndexFromTransportStream" does it.)
+static Boolean pcrOf(unsigned char const* pkt, float& pcr) {
+  u_int8_t adaptation_field_control = (pkt[3]&0x30)>>4;
+  unsigned totalHeaderSize = adaptation_field_control <= 1 ? 4 : 5 + pkt[4];
+  if ((adaptation_field_control == 2 && totalHeaderSize != TRANSPORT_PACKET_SIZE) ||
+      (adaptation_field_control == 3 && totalHeaderSize >= TRANSPORT_PACKET_SIZE)) return False;
+  if (!(totalHeaderSize > 5 && (pkt[5]&0x10) != 0)) return False;
+
+  u_int32_t pcrBaseHigh = (pkt[6]<<24)|(pkt[7]<<16)|(pkt[8]<<8)|pkt[9];
+  pcr = pcrBaseHigh/45000.0f;
+  if ((pkt[10]&0x80) != 0) pcr += 1/90000.0f; // add in low-bit (if set)
+  unsigned short pcrExt = ((pkt[10]&0x01)<<8) | pkt[11];
+  pcr += pcrExt/27000000.0f;
+  return True;
+}
+
+// These are simplified versions of the PAT and PMT parsing done by "MPEG2IFrameIndexFromTransportStream":
+static int pmtPIDFromPAT(unsigned char const* pkt, unsigned size) {
+  while (size >= 17) {
+    u_int16_t program_number = (pkt[9]<<8) | pkt[10];
+    if (program_number != 0) return ((pkt[11]&0x1F)<<8) | pkt[12];
+
+    pkt += 4; size -= 4;
+  }
+  return -1;
+}
+
+static int videoPIDFromPMT(unsigned char const* pkt, unsigned size) {
+  u_int16_t section_length = ((pkt[2]&0x0F)<<8) | pkt[3];
+  if ((unsigned)(4+section_length) < size) size = (4+section_length);
+
+  if (size < 22) return -1;
+  unsigned program_info_length = ((pkt[11]&0x0F)<<8) | pkt[12];
+  pkt += 13; size -= 13;
+  if (size < program_info_length) return -1;
+  pkt += program_info_length; size -= program_info_length;
+
+  while (size >= 9) {
+    u_int8_t stream_type = pkt[0];
+    if (stream_type == 1 || stream_type == 2 ||
+	stream_type == 0x1B/*H.264 video*/ || stream_type == 0x24/*H.265 video*/) {
+      return ((pkt[1]&0x1F)<<8) | pkt[2];
+    }
+
+    u_int16_t ES_info_length = ((pkt[3]&0x0F)<<8) | pkt[4];
+    pkt += 5; size -= 5;
+    if (size < ES_info_length) return -1;
+    pkt += ES_info_length; size -= ES_info_length;
+  }
+  return -1;
+}
+
+// Finds the first PAT and PMT in the file (and, from these, the PIDs of the PMT and the video stream).
+// Returns False if they couldn't be found.
+static Boolean findTables(FILE* fid, unsigned char* patPacket, unsigned char* pmtPacket, int& videoPID) {
+  unsigned char buf[SCAN_BLOCK_NUM_PACKETS*TRANSPORT_PACKET_SIZE];
+  int pmtPID = -1;
+  videoPID = -1;
+
+  if (SeekFile64(fid, 0, SEEK_SET) != 0) return False;
+  for (unsigned numBlocks = 0; numBlocks < 100; ++numBlocks) {
+    unsigned numPackets = (unsigned)fread(buf, TRANSPORT_PACKET_SIZE, SCAN_BLOCK_NUM_PACKETS, fid);
+    if (numPackets == 0) break;
+
+    for (unsigned i = 0; i < numPackets; ++i) {
+      unsigned char const* pkt = &buf[i*TRANSPORT_PACKET_SIZE];
+      if (pkt[0] != TRANSPORT_SYNC_BYTE) return False; // the file is not packet-aligned; give up
+
+      unsigned payloadSize;
+      unsigned char const* payload = payloadOf(pkt, payloadSize);
+      if (payload == NULL) continue;
+
+      int PID = ((pkt[1]&0x1F)<<8) | pkt[2];
+      if (PID == PAT_PID && pmtPID < 0) {
+	pmtPID = pmtPIDFromPAT(payload, payloadSize);
+	memcpy(patPacket, pkt, TRANSPORT_PACKET_SIZE);
+      } else if (PID == pmtPID) {
+	videoPID = videoPIDFromPMT(payload, payloadSize);
+	if (videoPID >= 0) {
+	  memcpy(pmtPacket, pkt, TRANSPORT_PACKET_SIZE);
+	  return True;
+	}
+      }
+    }
+  }
+
+  return False;
+}
+
+// Scans the file, beginning at "fromByte", for a video packet that begins a PES packet, and that contains (all of) the
+// start code of the first 'frame' in it.  Returns its position, or "toByte" if there's no such packet before "toByte".
+static u_int64_t findPartStart(FILE* fid, u_int64_t fromByte, u_int64_t toByte, int videoPID) {
+  unsigned char buf[SCAN_BLOCK_NUM_PACKETS*TRANSPORT_PACKET_SIZE];
+  int lastContinuityCounter = -1;
+
+  if (SeekFile64(fid, (int64_t)fromByte, SEEK_SET) != 0) return toByte;
+  u_int64_t pos = fromByte;
+  while (pos < toByte) {
+    unsigned numPackets = (unsigned)fread(buf, TRANSPORT_PACKET_SIZE, SCAN_BLOCK_NUM_PACKETS, fid);
+    if (numPackets == 0) break;
+
+    for (unsigned i = 0; i < numPackets && pos < toByte; ++i, pos += TRANSPORT_PACKET_SIZE) {
+      unsigned char const* pkt = &buf[i*TRANSPORT_PACKET_SIZE];
+      if (pkt[0] != TRANSPORT_SYNC_BYTE) return toByte; // the file is not packet-aligned; give up
+
+      int PID = ((pkt[1]&0x1F)<<8) | pkt[2];
+      unsigned payloadSize;
+      unsigned char const* payload = payloadOf(pkt, payloadSize);
+      if (PID != videoPID || payload == NULL) continue;
+
+      // Don't begin with a packet that the indexer would ignore (as a duplicate of the previous video packet):
+      int const continuityCounter = pkt[3]&0x0F;
+      Boolean const isDuplicate = lastContinuityCounter < 0 || continuityCounter == lastContinuityCounter;
+      lastContinuityCounter = continuityCounter;
+      Boolean payload_unit_start_indicator = (pkt[1]&0x40) != 0;
+      if (isDuplicate || !payload_unit_start_indicator) continue;
+
+      if (payloadSize < 9 || !(payload[0] == 0 && payload[1] == 0 && payload[2] == 1)) continue;
+      unsigned const esStart = 9 + payload[8]; // after the PES header
+      for (unsigned j = esStart; j + 4 <= payloadSize; ++j) {
+	if (payload[j] == 0 && payload[j+1] == 0 && payload[j+2] == 1) return pos;
+      }
+    }
+  }
+
+  return toByte;
+}
+
+// Finds the first PCR in the file.  Returns False if there's none.
+static Boolean findFirstPCR(FILE* fid, float& pcr, u_int64_t& pcrByte) {
+  unsigned char buf[SCAN_BLOCK_NUM_PACKETS*TRANSPORT_PACKET_SIZE];
+
+  if (SeekFile64(fid, 0, SEEK_SET) != 0) return False;
+  u_int64_t pos = 0;
+  while (1) {
+    unsigned numPackets = (unsigned)fread(buf, TRANSPORT_PACKET_SIZE, SCAN_BLOCK_NUM_PACKETS, fid);
+    if (numPackets == 0) return False;
+
+    for (unsigned i = 0; i < numPackets; ++i, pos += TRANSPORT_PACKET_SIZE) {
+      if (pcrOf(&buf[i*TRANSPORT_PACKET_SIZE], pcr)) {
+	pcrByte = pos;
+	return True;
+      }
+    }
+  }
+}
+
+// Returns True - setting "pcr" - iff the packet at "byte" has a PCR:
+static Boolean findPCRAt(FILE* fid, u_int64_t byte, float& pcr) {
+  unsigned char pkt[TRANSPORT_PACKET_SIZE];
+  return SeekFile64(fid, (int64_t)byte, SEEK_SET) == 0 && fread(pkt, TRANSPORT_PACKET_SIZE, 1, fid) == 1
+    && pcrOf(pkt, pcr);
+}
+
+// Finds the last PCR before "beforeByte", given that there's one at "pcrByte" (< "beforeByte"):
+static float findLastPCRBefore(FILE* fid, u_int64_t beforeByte, u_int64_t pcrByte) {
+  unsigned char buf[SCAN_BLOCK_NUM_PACKETS*TRANSPORT_PACKET_SIZE];
+
+  u_int64_t endByte = beforeByte;
+  while (endByte > pcrByte) {
+    u_int64_t startByte = pcrByte;
+    if (endByte - startByte > sizeof buf) startByte = endByte - sizeof buf;
+    unsigned numPackets = (unsigned)((endByte - startByte)/TRANSPORT_PACKET_SIZE);
+    if (SeekFile64(fid, (int64_t)startByte, SEEK_SET) != 0
+	|| fread(buf, TRANSPORT_PACKET_SIZE, numPackets, fid) != numPackets) break;
+
+    float pcr;
+    for (unsigned i = numPackets; i > 0; --i) {
+      if (pcrOf(&buf[(i-1)*TRANSPORT_PACKET_SIZE], pcr)) return pcr;
+    }
+    endByte = startByte;
+  }
+
+  // We shouldn't get here (because there's a PCR at "pcrByte"), unless the file couldn't be read:
+  float pcr = 0.0f;
+  (void)findPCRAt(fid, pcrByte, pcr);
+  return pcr;
+}
+
+Boolean indexInParallel(UsageEnvironment& env, char const* inputFileName, char const* outputFileName,
+			unsigned numThreads) {
+  if (numThreads > MAX_NUM_PARTS) numThreads = MAX_NUM_PARTS;
+  IndexerPart parts[MAX_NUM_PARTS];
+  unsigned numParts = 0;
+
+  // Begin by choosing where each part will begin:
+  FILE* fid = OpenInputFile(env, inputFileName);
+  if (fid == NULL) {
+    env << "Failed to open input file \"" << inputFileName << "\" (does it exist?)\n";
+    return False;
+  }
+  u_int64_t const fileSize = GetFileSize(inputFileName, NULL);
+  u_int64_t const numPacketsInFile = fileSize/TRANSPORT_PACKET_SIZE;
+
+  unsigned char patPacket[TRANSPORT_PACKET_SIZE], pmtPacket[TRANSPORT_PACKET_SIZE];
+  int videoPID;
+  parts[numParts++].startByte = 0;
+  if (!findTables(fid, patPacket, pmtPacket, videoPID)) numThreads = 1; // we can't split this file
+  unsigned i;
+  for (i = 1; i < numThreads; ++i) {
+    u_int64_t nominalStart = (numPacketsInFile*i/numThreads)*TRANSPORT_PACKET_SIZE;
+    u_int64_t nextNominalStart = (numPacketsInFile*(i+1)/numThreads)*TRANSPORT_PACKET_SIZE;
+    if (nominalStart <= parts[numParts-1].startByte) continue;
+
+    u_int64_t start = findPartStart(fid, nominalStart, nextNominalStart, videoPID);
+    if (start < nextNominalStart) parts[numParts++].startByte = start;
+  }
+
+  // Then, find the PCRs that precede each part:
+  float firstPCR;
+  u_int64_t firstPCRByte;
+  Boolean const haveFirstPCR = findFirstPCR(fid, firstPCR, firstPCRByte);
+  for (i = 0; i < numParts; ++i) {
+    IndexerPart& part = parts[i];
+    part.pcrDecreaseAtEnd = 0.0f;
+    part.havePrecedingPCRs = i > 0 && haveFirstPCR && firstPCRByte < part.startByte;
+    if (part.havePrecedingPCRs) {
+      part.precedingFirstPCR = firstPCR;
+      part.precedingLastPCR = findLastPCRBefore(fid, part.startByte, firstPCRByte);
+
+      // If the PCR goes backwards in this part's first packet, then both this part's indexer, and the previous part's
+      // indexer (which also reads this packet), compensate for it.  Note this, so that we count it only once:
+      float pcr;
+      if (findPCRAt(fid, part.startByte, pcr) && pcr < part.precedingLastPCR) {
+	parts[i-1].pcrDecreaseAtEnd = part.precedingLastPCR - pcr;
+      }
+    }
+  }
+  CloseInputFile(fid);
+
+  // Then, index each part (in its own thread):
+  pthread_t threads[MAX_NUM_PARTS];
+  unsigned const outputFileNameLen = strlen(outputFileName);
+  for (i = 0; i < numParts; ++i) {
+    IndexerPart& part = parts[i];
+    part.inputFileName = inputFileName;
+    part.patPacket = i == 0 ? NULL : patPacket;
+    part.pmtPacket = i == 0 ? NULL : pmtPacket;
+    // (Each part - except the last - also reads the next part's first packet; see above.)
+    part.numBytes = i+1 < numParts ? parts[i+1].startByte - part.startByte + TRANSPORT_PACKET_SIZE : 0;
+    part.indexFileName = new char[outputFileNameLen + 20];
+    sprintf(part.indexFileName, "%s.part%u", outputFileName, i);
+    part.succeeded = part.haveSeenPCR = False;
+    part.firstPCR = part.lastPCR = part.lastRelativePCR = 0.0f;
+
+    if (pthread_create(&threads[i], NULL, indexPart, &part) != 0) {
+      env << "Failed to create a thread for indexing part " << i << "\n";
+      exit(1); // because other threads might already be running
+    }
+  }
+  for (i = 0; i < numParts; ++i) pthread_join(threads[i], NULL);
+
+  // Finally, combine the parts' index records into the final index file.  The only PCRs that need adjusting are those
+  // after a part in which the PCR went backwards.  (A part's indexer compensates for this - as the indexer of the whole
+  // file would - but only for the rest of its own part.)
+  Boolean succeeded = True;
+  FILE* outFid = fopen(outputFileName, "wb");
+  if (outFid == NULL) {
+    env << "Failed to open output file \"" << outputFileName << "\"\n";
+    succeeded = False;
+  }
+  float pcrAdjustment = 0.0f;
+  for (i = 0; i < numParts; ++i) {
+    IndexerPart& part = parts[i];
+    if (succeeded && !part.succeeded) {
+      env << "Failed to index part " << i << " of \"" << inputFileName << "\"\n";
+      succeeded = False;
+    }
+
+    unsigned long const firstTransportPacketNum = (unsigned long)(part.startByte/TRANSPORT_PACKET_SIZE);
+    unsigned long const nextPartTransportPacketNum
+      = i+1 < numParts ? (unsigned long)(parts[i+1].startByte/TRANSPORT_PACKET_SIZE) : ~0UL;
+
+    FILE* partFid = succeeded ? OpenInputFile(env, part.indexFileName) : NULL;
+    if (partFid != NULL) {
+      u_int8_t r[INDEX_RECORD_SIZE];
+      while (fread(r, INDEX_RECORD_SIZE, 1, partFid) == 1) {
+	unsigned long tpn = ((r[10]<<24) | (r[9]<<16) | (r[8]<<8) | r[7]) + firstTransportPacketNum;
+	if (tpn >= nextPartTransportPacketNum && (r[0]&0x80) != 0) break; // the next part's first frame (see above)
+	r[7] = (unsigned char)(tpn);
+	r[8] = (unsigned char)(tpn>>8);
+	r[9] = (unsigned char)(tpn>>16);
+	r[10] = (unsigned char)(tpn>>24);
+
+	if (pcrAdjustment != 0.0f) {
+	  float pcr = ((r[5]<<16) | (r[4]<<8) | r[3]) + r[6]/256.0f + pcrAdjustment;
+	  unsigned pcr_int = (unsigned)pcr;
+	  u_int8_t pcr_frac = (u_int8_t)(256*(pcr-pcr_int));
+	  r[3] = (unsigned char)(pcr_int);
+	  r[4] = (unsigned char)(pcr_int>>8);
+	  r[5] = (unsigned char)(pcr_int>>16);
+	  r[6] = (unsigned char)(pcr_frac);
+	}
+
+	fwrite(r, INDEX_RECORD_SIZE, 1, outFid);
+      }
+      CloseInputFile(partFid);
+    }
+    remove(part.indexFileName);
+    delete[] part.indexFileName;
+
+    // If the PCR went backwards in this part, then its indexer reduced its 'first PCR' (from which PCRs are delivered
+    // relative) by the same amount:
+    if (part.haveSeenPCR) {
+      pcrAdjustment += part.lastRelativePCR - (part.lastPCR - part.firstPCR) - part.pcrDecreaseAtEnd;
+    }
+  }
+  if (outFid != NULL) fclose(outFid);
+
+  return succeeded;
+}
@@ -0,0 +1,33 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// Indexing a (complete) Transport Stream file in parallel - used by "MPEG2TransportStreamIndexer -j"
+// Interfaces
+
+#ifndef _PARALLEL_INDEXER_HH
+#define _PARALLEL_INDEXER_HH
+
+#include "liveMedia.hh"
+
+extern Boolean indexInParallel(UsageEnvironment& env, char const* inputFileName, char const* outputFileName,
+			       unsigned numThreads);
+    // Writes the index file for "inputFileName" by indexing up to "numThreads" parts of it in parallel (each in its own
+    // thread).  The result is the same - byte for byte - as indexing the whole file using a single
+    // "MPEG2IFrameIndexFromTransportStream", unless the file's PCR goes backwards somewhere.  (In that case, the PCRs in
+    // later parts' index records might differ by 1/256 second.)
+    // Returns False - after reporting the error to "env" - if the file couldn't be indexed.
+
+#endif
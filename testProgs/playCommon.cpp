@@ -741,6 +741,9 @@ void continueAfterDESCRIBE(RTSPClient*, int resultCode, char* resultString) {
 	  // (1 second) for reordering misordered incoming packets:
 	  unsigned const thresh = 1000000; // 1 second
 	  subsession->rtpSource()->setPacketReorderingThresholdTime(thresh);
+
+	  // Also, because the incoming data rate may be high, read several incoming packets at once, when we can:
+	  subsession->rtpSource()->setMaxPacketsPerRead(16);
 	  
 	  // Set the RTP source's OS socket buffer size as appropriate - either if we were explicitly asked (using -B),
 	  // or if the desired FileSink buffer size happens to be larger than the current OS socket buffer size.
@@ -0,0 +1,130 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A common framework, used for the "test*Speed" (benchmark) applications
+// Implementation
+
+#include "speedTestCommon.hh"
+#include "GroupsockHelper.hh" // for "gettimeofday()"
+#include <string.h>
+
+////////// Random numbers //////////
+
+static u_int64_t randomState = 1;
+
+void seedTestRandom(u_int32_t seed) {
+  randomState = seed;
+}
+
+u_int32_t testRandom32() {
+  // A 64-bit linear congruential generator; we return the high-order (most random) bits:
+  randomState = randomState*6364136223846793005ULL + 1442695040888963407ULL;
+  return (u_int32_t)(randomState>>32);
+}
+
+////////// Timing //////////
+
+double timeNow() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec/1000000.0;
+}
+
+////////// Options //////////
+
+Boolean checkOnlyOption(int& argc, char**& argv) {
+  if (argc < 2 || strcmp(argv[1], "-c") != 0) return False;
+
+  // Remove the option, keeping "argv[0]" (the program name) in place:
+  argv[1] = argv[0];
+  --argc; ++argv;
+  return True;
+}
+
+////////// SpeedTestSink //////////
+
+#define FNV1A_OFFSET_BASIS 1469598103934665603ULL
+#define FNV1A_PRIME 1099511628211ULL
+
+SpeedTestSink* SpeedTestSink::createNew(UsageEnvironment& env, unsigned bufferSize, u_int64_t maxNumBytes) {
+  return new SpeedTestSink(env, bufferSize, maxNumBytes);
+}
+
+SpeedTestSink::SpeedTestSink(UsageEnvironment& env, unsigned bufferSize, u_int64_t maxNumBytes)
+  : MediaSink(env), fBufferSize(bufferSize), fMaxNumBytes(maxNumBytes), fDoneFlag(0),
+    fNumFrames(0), fNumBytes(0), fNumTruncatedBytes(0), fHash(FNV1A_OFFSET_BASIS) {
+  fBuffer = new unsigned char[bufferSize];
+}
+
+SpeedTestSink::~SpeedTestSink() {
+  delete[] fBuffer;
+}
+
+double SpeedTestSink::playFrom(FramedSource& source) {
+  fNumFrames = fNumBytes = fNumTruncatedBytes = 0;
+  fHash = FNV1A_OFFSET_BASIS;
+  fDoneFlag = 0;
+
+  double startTime = timeNow();
+  if (!startPlaying(source, afterPlaying, this)) return 0.0;
+  envir().taskScheduler().doEventLoop(&fDoneFlag);
+  double seconds = timeNow() - startTime;
+
+  stopPlaying();
+  return seconds;
+}
+
+void SpeedTestSink::hashFrame(unsigned char const* frame, unsigned frameSize, unsigned numTruncatedBytes) {
+  hashBytes(frame, frameSize);
+  fHash = (fHash ^ frameSize ^ ((u_int64_t)numTruncatedBytes<<32))*FNV1A_PRIME;
+}
+
+void SpeedTestSink::hashBytes(unsigned char const* data, unsigned numBytes) {
+  u_int64_t hash = fHash;
+  for (unsigned i = 0; i < numBytes; ++i) hash = (hash ^ data[i])*FNV1A_PRIME;
+  fHash = hash;
+}
+
+Boolean SpeedTestSink::continuePlaying() {
+  if (fSource == NULL) return False;
+
+  fSource->getNextFrame(fBuffer, fBufferSize, afterGettingFrame, this, onSourceClosure, this);
+  return True;
+}
+
+void SpeedTestSink::afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
+				      struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+  SpeedTestSink* sink = (SpeedTestSink*)clientData;
+  sink->afterGettingFrame(frameSize, numTruncatedBytes);
+}
+
+void SpeedTestSink::afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes) {
+  ++fNumFrames;
+  fNumBytes += frameSize;
+  fNumTruncatedBytes += numTruncatedBytes;
+  hashFrame(fBuffer, frameSize, numTruncatedBytes);
+
+  if (fMaxNumBytes > 0 && fNumBytes >= fMaxNumBytes) {
+    fDoneFlag = ~0;
+  } else {
+    continuePlaying();
+  }
+}
+
+void SpeedTestSink::afterPlaying(void* clientData) {
+  SpeedTestSink* sink = (SpeedTestSink*)clientData;
+  sink->fDoneFlag = ~0;
+}
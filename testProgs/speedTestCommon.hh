@@ -0,0 +1,81 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A common framework, used for the "test*Speed" (benchmark) applications
+// Interfaces
+
+#ifndef _SPEED_TEST_COMMON_HH
+#define _SPEED_TEST_COMMON_HH
+
+#include "liveMedia.hh"
+
+// A deterministic pseudo-random number generator, so that each run uses the same test data
+// (unless it's given a different seed):
+extern void seedTestRandom(u_int32_t seed);
+extern u_int32_t testRandom32();
+
+// The current time, in seconds (for timing):
+extern double timeNow();
+
+// Returns True iff the first argument is "-c" ('check only; don't time anything'), in which case
+// it's also removed from "argc"/"argv":
+extern Boolean checkOnlyOption(int& argc, char**& argv);
+
+// A sink that counts - and hashes - the frames that it receives:
+class SpeedTestSink: public MediaSink {
+public:
+  static SpeedTestSink* createNew(UsageEnvironment& env, unsigned bufferSize, u_int64_t maxNumBytes = 0);
+      // If "maxNumBytes" is non-zero, we stop playing once we've received at least that many bytes.
+
+  double playFrom(FramedSource& source);
+      // Plays "source" (in the event loop) until it closes, or until we've received "maxNumBytes".
+      // Returns the time taken, in seconds.  (The counts and hash start again from scratch each time.)
+
+  void stop() { fDoneFlag = ~0; } // makes "playFrom()" return (e.g., when called from a 'watchdog' task)
+
+  u_int64_t numFrames() const { return fNumFrames; }
+  u_int64_t numBytes() const { return fNumBytes; }
+  u_int64_t numTruncatedBytes() const { return fNumTruncatedBytes; }
+  u_int64_t hash() const { return fHash; }
+
+protected:
+  SpeedTestSink(UsageEnvironment& env, unsigned bufferSize, u_int64_t maxNumBytes);
+      // called only by "createNew()", or by subclass constructors
+  virtual ~SpeedTestSink();
+
+  virtual void hashFrame(unsigned char const* frame, unsigned frameSize, unsigned numTruncatedBytes);
+      // Called for each frame.  By default, hashes the whole frame, and its size; redefine this to hash
+      // less (e.g., for a test where hashing every byte would take a significant part of the time).
+  void hashBytes(unsigned char const* data, unsigned numBytes); // FNV-1a
+
+private: // redefined virtual functions
+  virtual Boolean continuePlaying();
+
+private:
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
+				struct timeval presentationTime, unsigned durationInMicroseconds);
+  void afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes);
+  static void afterPlaying(void* clientData);
+
+private:
+  unsigned char* fBuffer;
+  unsigned fBufferSize;
+  u_int64_t fMaxNumBytes;
+  char fDoneFlag;
+  u_int64_t fNumFrames, fNumBytes, fNumTruncatedBytes, fHash;
+};
+
+#endif
@@ -0,0 +1,321 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that tests and times the audio filters in "uLawAudioFilter.hh" ("uLawFromPCMAudioSource",
+// "PCMFromuLawAudioSource", "NetworkFromHostOrder16", "HostFromNetworkOrder16", "EndianSwap16" and
+// "EndianSwap24"):
+// - First, it checks each filter's output against a one-sample-at-a-time reference conversion:
+//   for every 16-bit sample value (in each byte ordering), every uLaw byte, and every frame size up
+//   to a few hundred bytes (so that every combination of whole vector blocks and leftover samples
+//   gets used), with differently-aligned (but, for 16-bit samples, 16-bit-aligned) output buffers.
+// - Then, it times each filter on 1 MByte frames.
+// The library uses vector ("SIMD") code for these filters on x86, choosing (at run time) the best
+// version that the CPU supports.  To check the SSE2-only versions, or the one-sample-at-a-time code,
+// instead, rebuild the library with -DNO_RUNTIME_CPU_DISPATCH or -DNO_SIMD_AUDIO_KERNELS.
+//
+// Usage: testAudioFilterSpeed [-c]
+//     -c: only do the check; don't time anything
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh" // for "gettimeofday()"
+
+////////// Reference conversions //////////
+
+static unsigned char referenceuLawFrom16BitLinear(u_int16_t sample) {
+  static int const exp_lut[256] = {0,0,1,1,2,2,2,2,3,3,3,3,3,3,3,3,
+				   4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+				   5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
+				   5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
+				   6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
+				   6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
+				   6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
+				   6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
+				   7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+				   7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+				   7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+				   7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+				   7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+				   7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+				   7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+				   7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7};
+  unsigned char sign = (sample >> 8) & 0x80;
+  if (sign != 0) sample = -sample; // get the magnitude
+
+  if (sample > 32635) sample = 32635; // clip the magnitude
+  sample += 0x84;
+
+  unsigned char exponent = exp_lut[(sample>>7) & 0xFF];
+  unsigned char mantissa = (sample >> (exponent+3)) & 0x0F;
+  unsigned char result = ~(sign | (exponent << 4) | mantissa);
+  if (result == 0 ) result = 0x02; // CCITT trap
+
+  return result;
+}
+
+static u_int16_t referenceLinear16FromuLaw(unsigned char uLawByte) {
+  static int const exp_lut[8] = {0,132,396,924,1980,4092,8316,16764};
+  uLawByte = ~uLawByte;
+
+  Boolean sign = (uLawByte & 0x80) != 0;
+  unsigned char exponent = (uLawByte>>4) & 0x07;
+  unsigned char mantissa = uLawByte & 0x0F;
+
+  u_int16_t result = exp_lut[exponent] + (mantissa << (exponent+3));
+  if (sign) result = -result;
+  return result;
+}
+
+////////// A source that delivers a given frame from memory //////////
+
+class MemoryFrameSource: public FramedSource {
+public:
+  MemoryFrameSource(UsageEnvironment& env)
+    : FramedSource(env), fData(NULL), fDataSize(0) {
+  }
+
+  void setFrame(unsigned char const* data, unsigned dataSize) { fData = data; fDataSize = dataSize; }
+
+private: // redefined virtual functions
+  virtual void doGetNextFrame() {
+    // Note: The filter may ask us to deliver to (part of) the same buffer that it'll deliver to.
+    fFrameSize = fDataSize;
+    if (fFrameSize > fMaxSize) {
+      fNumTruncatedBytes = fFrameSize - fMaxSize;
+      fFrameSize = fMaxSize;
+    } else {
+      fNumTruncatedBytes = 0;
+    }
+    memmove(fTo, fData, fFrameSize);
+    gettimeofday(&fPresentationTime, NULL);
+    fDurationInMicroseconds = 0;
+
+    FramedSource::afterGetting(this); // we deliver immediately
+  }
+
+private:
+  unsigned char const* fData;
+  unsigned fDataSize;
+};
+
+static unsigned lastFrameSize;
+static void afterGettingFrame(void* /*clientData*/, unsigned frameSize, unsigned /*numTruncatedBytes*/,
+			      struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+  lastFrameSize = frameSize;
+}
+
+static void onSourceClosure(void* /*clientData*/) {}
+
+// Passes a frame through a filter, returning the size of the resulting frame:
+static unsigned filterFrame(FramedSource* filter, unsigned char* to, unsigned maxSize) {
+  lastFrameSize = ~0;
+  filter->getNextFrame(to, maxSize, afterGettingFrame, NULL, onSourceClosure, NULL);
+  return lastFrameSize; // (all of our sources deliver immediately)
+}
+
+static void closeFilter(FramedSource* filter) {
+  ((FramedFilter*)filter)->detachInputSource(); // because the input source is shared between filters
+  Medium::close(filter);
+}
+
+////////// Checks //////////
+
+#define MAX_CHECK_FRAME_SIZE 400 // bytes
+#define ALL_SAMPLES_FRAME_SIZE (65536 + 37) // samples
+
+static unsigned numErrors = 0;
+static void reportError(char const* filterName, unsigned frameSize, unsigned index) {
+  if (numErrors++ < 10) {
+    fprintf(stderr, "%s: wrong output for a %u-byte frame, at byte/sample %u\n", filterName, frameSize, index);
+  }
+}
+
+static void putSample(unsigned char* to, u_int16_t sample, int byteOrdering) {
+  // "byteOrdering" is as for "uLawFromPCMAudioSource": 0 == host order; 1 == little-endian order; 2 == network order
+  if (byteOrdering == 0) {
+    memcpy(to, &sample, 2);
+  } else if (byteOrdering == 1) {
+    to[0] = (unsigned char)sample; to[1] = (unsigned char)(sample>>8);
+  } else {
+    to[0] = (unsigned char)(sample>>8); to[1] = (unsigned char)sample;
+  }
+}
+
+static void checkuLawFromPCM(UsageEnvironment& env, MemoryFrameSource* source,
+			     unsigned char* in, unsigned char* out) {
+  for (int byteOrdering = 0; byteOrdering <= 2; ++byteOrdering) {
+    FramedSource* filter = uLawFromPCMAudioSource::createNew(env, source, byteOrdering);
+    char const* filterName = "uLawFromPCMAudioSource";
+
+    // Every 16-bit sample value (in scrambled order, followed by some more), in one frame:
+    unsigned i;
+    for (i = 0; i < ALL_SAMPLES_FRAME_SIZE; ++i) putSample(&in[2*i], (u_int16_t)(i*40503u), byteOrdering);
+    source->setFrame(in, 2*ALL_SAMPLES_FRAME_SIZE);
+    if (filterFrame(filter, out, ALL_SAMPLES_FRAME_SIZE) != ALL_SAMPLES_FRAME_SIZE) {
+      reportError(filterName, 2*ALL_SAMPLES_FRAME_SIZE, 0);
+    }
+    for (i = 0; i < ALL_SAMPLES_FRAME_SIZE; ++i) {
+      if (out[i] != referenceuLawFrom16BitLinear((u_int16_t)(i*40503u))) reportError(filterName, 2*ALL_SAMPLES_FRAME_SIZE, i);
+    }
+
+    // Every (small) frame size, with different output buffer alignments:
+    for (unsigned frameSize = 0; frameSize <= MAX_CHECK_FRAME_SIZE; frameSize += 2) {
+      unsigned const numSamples = frameSize/2;
+      for (i = 0; i < numSamples; ++i) putSample(&in[2*i], (u_int16_t)(i*7919u + frameSize*257), byteOrdering);
+      source->setFrame(in, frameSize);
+      unsigned char* to = &out[frameSize%4];
+      if (filterFrame(filter, to, numSamples) != numSamples) reportError(filterName, frameSize, 0);
+      for (i = 0; i < numSamples; ++i) {
+	if (to[i] != referenceuLawFrom16BitLinear((u_int16_t)(i*7919u + frameSize*257))) reportError(filterName, frameSize, i);
+      }
+    }
+
+    closeFilter(filter);
+  }
+}
+
+static void checkPCMFromuLaw(UsageEnvironment& env, MemoryFrameSource* source,
+			     unsigned char* in, unsigned char* out) {
+  FramedSource* filter = PCMFromuLawAudioSource::createNew(env, source);
+  char const* filterName = "PCMFromuLawAudioSource";
+
+  // Every (small) frame size, with different (16-bit-aligned) output buffer alignments (and so, between them,
+  // every uLaw byte):
+  for (unsigned frameSize = 0; frameSize <= MAX_CHECK_FRAME_SIZE; ++frameSize) {
+    unsigned i;
+    for (i = 0; i < frameSize; ++i) in[i] = (unsigned char)(i*7 + frameSize);
+    source->setFrame(in, frameSize);
+    unsigned char* to = &out[2*(frameSize%2)];
+    if (filterFrame(filter, to, 2*frameSize) != 2*frameSize) reportError(filterName, frameSize, 0);
+    for (i = 0; i < frameSize; ++i) {
+      u_int16_t sample;
+      memcpy(&sample, &to[2*i], 2);
+      if (sample != referenceLinear16FromuLaw(in[i])) reportError(filterName, frameSize, i);
+    }
+  }
+
+  closeFilter(filter);
+}
+
+static void checkByteSwaps(UsageEnvironment& env, MemoryFrameSource* source,
+			   unsigned char* in, unsigned char* out) {
+  u_int16_t const one = 1;
+  Boolean const hostIsLittleEndian = *(unsigned char const*)&one == 1;
+
+  for (int k = 0; k < 4; ++k) {
+    FramedSource* filter;
+    char const* filterName;
+    unsigned valueSize = 2;
+    Boolean swaps = True;
+    switch (k) {
+      case 0: {
+	filter = NetworkFromHostOrder16::createNew(env, source); filterName = "NetworkFromHostOrder16";
+	swaps = hostIsLittleEndian;
+	break;
+      }
+      case 1: {
+	filter = HostFromNetworkOrder16::createNew(env, source); filterName = "HostFromNetworkOrder16";
+	swaps = hostIsLittleEndian;
+	break;
+      }
+      case 2: {
+	filter = EndianSwap16::createNew(env, source); filterName = "EndianSwap16";
+	break;
+      }
+      default: {
+	filter = EndianSwap24::createNew(env, source); filterName = "EndianSwap24";
+	valueSize = 3;
+	break;
+      }
+    }
+
+    for (unsigned frameSize = 0; frameSize <= MAX_CHECK_FRAME_SIZE; ++frameSize) {
+      unsigned i;
+      for (i = 0; i < frameSize; ++i) in[i] = (unsigned char)(i*13 + frameSize*3 + 1);
+      source->setFrame(in, frameSize);
+      unsigned char* to = &out[valueSize == 2 ? 2*(frameSize%2) : frameSize%4]; // keep 16-bit values aligned
+      unsigned const outSize = frameSize - frameSize%valueSize; // any partial value at the end is dropped
+      if (filterFrame(filter, to, frameSize) != outSize) reportError(filterName, frameSize, 0);
+      for (i = 0; i < outSize; ++i) {
+	unsigned const byteInValue = i%valueSize;
+	unsigned const from = swaps ? i - byteInValue + (valueSize-1 - byteInValue) : i;
+	if (to[i] != in[from]) reportError(filterName, frameSize, i);
+      }
+    }
+
+    closeFilter(filter);
+  }
+}
+
+////////// Timing //////////
+
+#define TIMING_FRAME_SIZE (1<<20) // bytes
+#define NUM_TIMING_ITERATIONS 200
+
+static void timeFilter(char const* filterName, FramedSource* filter, MemoryFrameSource* source,
+		       unsigned char const* in, unsigned inSize, unsigned char* out, unsigned outSize) {
+  source->setFrame(in, inSize);
+
+  double startTime = timeNow();
+  for (unsigned i = 0; i < NUM_TIMING_ITERATIONS; ++i) filterFrame(filter, out, outSize);
+  double seconds = timeNow() - startTime;
+
+  printf("%-24s %6.3f ns/input byte (including the test source's copy)\n",
+	 filterName, seconds*1e9/((double)NUM_TIMING_ITERATIONS*inSize));
+  closeFilter(filter);
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+  Boolean checkOnly = checkOnlyOption(argc, argv);
+
+  MemoryFrameSource* source = new MemoryFrameSource(*env);
+  unsigned const bufferSize = 4*TIMING_FRAME_SIZE;
+  unsigned char* in = new unsigned char[bufferSize];
+  unsigned char* out = new unsigned char[bufferSize];
+
+  checkuLawFromPCM(*env, source, in, out);
+  checkPCMFromuLaw(*env, source, in, out);
+  checkByteSwaps(*env, source, in, out);
+  if (numErrors > 0) {
+    fprintf(stderr, "Check failed (%u errors)\n", numErrors);
+    return 1;
+  }
+  printf("Check passed\n");
+  if (checkOnly) return 0;
+
+  for (unsigned i = 0; i < bufferSize; ++i) in[i] = (unsigned char)(i*2654435761u >> 13);
+  unsigned const frameSize = TIMING_FRAME_SIZE;
+  timeFilter("uLawFromPCMAudioSource", uLawFromPCMAudioSource::createNew(*env, source, 1), source,
+	     in, 2*frameSize, out, frameSize);
+  timeFilter("PCMFromuLawAudioSource", PCMFromuLawAudioSource::createNew(*env, source), source,
+	     in, frameSize/2, out, frameSize);
+  timeFilter("NetworkFromHostOrder16", NetworkFromHostOrder16::createNew(*env, source), source,
+	     in, frameSize, out, frameSize);
+  timeFilter("HostFromNetworkOrder16", HostFromNetworkOrder16::createNew(*env, source), source,
+	     in, frameSize, out, frameSize);
+  timeFilter("EndianSwap16", EndianSwap16::createNew(*env, source), source,
+	     in, frameSize, out, frameSize);
+  timeFilter("EndianSwap24", EndianSwap24::createNew(*env, source), source,
+	     in, frameSize/3*3, out, frameSize/3*3);
+
+  Medium::close(source);
+  delete[] out; delete[] in;
+  return 0;
+}
@@ -0,0 +1,373 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that tests and times the library's "BitVector" class (and "shiftBits()"), by comparing it
+// with the original (one-bit-at-a-time) implementation, which is reproduced here:
+// - First, a randomized differential test: random sequences of "getBits()", "get1Bit()", "putBits()",
+//   "put1Bit()", "get_expGolomb()", "get_expGolombSigned()" and "skipBits()" calls - on vectors of random
+//   sizes and offsets - followed by random (possibly overlapping) "shiftBits()" calls, must give the
+//   same results, and leave the same data, with both implementations.
+// - Then, a micro-benchmark of both implementations.
+//
+// Usage: testBitVectorSpeed [-c] [<random-seed>]
+//     -c: only do the differential test; don't time anything
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BitVector.hh"
+#include <stdio.h>
+
+////////// The original implementation //////////
+
+static unsigned char const singleBitMask[8] = {0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01};
+
+static void originalShiftBits(unsigned char* toBasePtr, unsigned toBitOffset,
+			      unsigned char const* fromBasePtr, unsigned fromBitOffset,
+			      unsigned numBits) {
+  if (numBits == 0) return;
+
+  /* Note that from and to may overlap, if from>to */
+  unsigned char const* fromBytePtr = fromBasePtr + fromBitOffset/8;
+  unsigned fromBitRem = fromBitOffset%8;
+  unsigned char* toBytePtr = toBasePtr + toBitOffset/8;
+  unsigned toBitRem = toBitOffset%8;
+
+  while (numBits-- > 0) {
+    unsigned char fromBitMask = singleBitMask[fromBitRem];
+    unsigned char fromBit = (*fromBytePtr)&fromBitMask;
+    unsigned char toBitMask = singleBitMask[toBitRem];
+
+    if (fromBit != 0) {
+      *toBytePtr |= toBitMask;
+    } else {
+      *toBytePtr &=~ toBitMask;
+    }
+
+    if (++fromBitRem == 8) {
+      ++fromBytePtr;
+      fromBitRem = 0;
+    }
+    if (++toBitRem == 8) {
+      ++toBytePtr;
+      toBitRem = 0;
+    }
+  }
+}
+
+#define MAX_LENGTH 32
+
+class OriginalBitVector {
+public:
+  OriginalBitVector(unsigned char* baseBytePtr, unsigned baseBitOffset, unsigned totNumBits)
+    : fBaseBytePtr(baseBytePtr), fBaseBitOffset(baseBitOffset), fTotNumBits(totNumBits), fCurBitIndex(0) {
+  }
+
+  void putBits(unsigned from, unsigned numBits) {
+    if (numBits == 0) return;
+
+    unsigned char tmpBuf[4];
+    unsigned overflowingBits = 0;
+
+    if (numBits > MAX_LENGTH) {
+      numBits = MAX_LENGTH;
+    }
+
+    if (numBits > fTotNumBits - fCurBitIndex) {
+      overflowingBits = numBits - (fTotNumBits - fCurBitIndex);
+    }
+
+    tmpBuf[0] = (unsigned char)(from>>24);
+    tmpBuf[1] = (unsigned char)(from>>16);
+    tmpBuf[2] = (unsigned char)(from>>8);
+    tmpBuf[3] = (unsigned char)from;
+
+    originalShiftBits(fBaseBytePtr, fBaseBitOffset + fCurBitIndex, /* to */
+		      tmpBuf, MAX_LENGTH - numBits, /* from */
+		      numBits - overflowingBits /* num bits */);
+    fCurBitIndex += numBits - overflowingBits;
+  }
+
+  void put1Bit(unsigned bit) {
+    if (fCurBitIndex >= fTotNumBits) { /* overflow */
+      return;
+    } else {
+      unsigned totBitOffset = fBaseBitOffset + fCurBitIndex++;
+      unsigned char mask = singleBitMask[totBitOffset%8];
+      if (bit) {
+	fBaseBytePtr[totBitOffset/8] |= mask;
+      } else {
+	fBaseBytePtr[totBitOffset/8] &=~ mask;
+      }
+    }
+  }
+
+  unsigned getBits(unsigned numBits) {
+    if (numBits == 0) return 0;
+
+    unsigned char tmpBuf[4];
+    unsigned overflowingBits = 0;
+
+    if (numBits > MAX_LENGTH) {
+      numBits = MAX_LENGTH;
+    }
+
+    if (numBits > fTotNumBits - fCurBitIndex) {
+      overflowingBits = numBits - (fTotNumBits - fCurBitIndex);
+    }
+
+    originalShiftBits(tmpBuf, 0, /* to */
+		      fBaseBytePtr, fBaseBitOffset + fCurBitIndex, /* from */
+		      numBits - overflowingBits /* num bits */);
+    fCurBitIndex += numBits - overflowingBits;
+
+    unsigned result
+      = (tmpBuf[0]<<24) | (tmpBuf[1]<<16) | (tmpBuf[2]<<8) | tmpBuf[3];
+    result >>= (MAX_LENGTH - numBits); // move into low-order part of word
+    result &= (0xFFFFFFFF << overflowingBits); // so any overflow bits are 0
+    return result;
+  }
+
+  unsigned get1Bit() {
+    if (fCurBitIndex >= fTotNumBits) { /* overflow */
+      return 0;
+    } else {
+      unsigned totBitOffset = fBaseBitOffset + fCurBitIndex++;
+      unsigned char curFromByte = fBaseBytePtr[totBitOffset/8];
+      unsigned result = (curFromByte >> (7-(totBitOffset%8))) & 0x01;
+      return result;
+    }
+  }
+
+  void skipBits(unsigned numBits) {
+    if (numBits > fTotNumBits - fCurBitIndex) { /* overflow */
+      fCurBitIndex = fTotNumBits;
+    } else {
+      fCurBitIndex += numBits;
+    }
+  }
+
+  unsigned curBitIndex() const { return fCurBitIndex; }
+  unsigned numBitsRemaining() const { return fTotNumBits - fCurBitIndex; }
+
+  unsigned get_expGolomb() {
+    unsigned numLeadingZeroBits = 0;
+    unsigned codeStart = 1;
+
+    while (get1Bit() == 0 && fCurBitIndex < fTotNumBits) {
+      ++numLeadingZeroBits;
+      codeStart *= 2;
+    }
+
+    return codeStart - 1 + getBits(numLeadingZeroBits);
+  }
+
+  int get_expGolombSigned() {
+    unsigned codeNum = get_expGolomb();
+
+    if ((codeNum&1) == 0) { // even
+      return -(int)(codeNum/2);
+    } else { // odd
+      return (codeNum+1)/2;
+    }
+  }
+
+private:
+  unsigned char* fBaseBytePtr;
+  unsigned fBaseBitOffset;
+  unsigned fTotNumBits;
+  unsigned fCurBitIndex;
+};
+
+////////// Differential test //////////
+
+static Boolean testOneVector(unsigned testNum) {
+  unsigned const size = 1 + testRandom32()%24;
+  unsigned char* origData = new unsigned char[size];
+  unsigned char* newData = new unsigned char[size];
+  unsigned i;
+  for (i = 0; i < size; ++i) origData[i] = newData[i] = (testRandom32()%3 == 0) ? 0 : (unsigned char)testRandom32();
+  Boolean result = True;
+
+  unsigned const baseBitOffset = testRandom32()%(8*size + 1);
+  unsigned const totNumBits = testRandom32()%(8*size - baseBitOffset + 1);
+  OriginalBitVector origBV(origData, baseBitOffset, totNumBits);
+  BitVector newBV(newData, baseBitOffset, totNumBits);
+
+  for (unsigned op = 0; op < 12 && result; ++op) {
+    unsigned numBits = testRandom32()%34;
+    unsigned origResult = 0, newResult = 0;
+    int opType = testRandom32()%7;
+    if (opType == 0 && numBits >= 32 && origBV.numBitsRemaining() == 0) {
+      // The original "getBits()" shifts by 32 bits - which is undefined - in this case, so don't compare it:
+      continue;
+    } else if (opType == 4 || opType == 5) {
+      // The original "get_expGolomb()" overflows - giving an undefined result - if the code has 31 or more
+      // leading zero bits, so don't compare those:
+      OriginalBitVector tmp = origBV;
+      unsigned numLeadingZeroBits = 0;
+      while (tmp.numBitsRemaining() > 0 && tmp.get1Bit() == 0) ++numLeadingZeroBits;
+      if (numLeadingZeroBits >= 31) continue;
+    }
+
+    switch (opType) {
+      case 0: { origResult = origBV.getBits(numBits); newResult = newBV.getBits(numBits); break; }
+      case 1: { origResult = origBV.get1Bit(); newResult = newBV.get1Bit(); break; }
+      case 2: { unsigned value = testRandom32(); origBV.putBits(value, numBits); newBV.putBits(value, numBits); break; }
+      case 3: { unsigned bit = testRandom32()&1; origBV.put1Bit(bit); newBV.put1Bit(bit); break; }
+      case 4: { origResult = origBV.get_expGolomb(); newResult = newBV.get_expGolomb(); break; }
+      case 5: { origResult = origBV.get_expGolombSigned(); newResult = newBV.get_expGolombSigned(); break; }
+      default: { origBV.skipBits(numBits%8); newBV.skipBits(numBits%8); break; }
+    }
+    if (origResult != newResult || origBV.curBitIndex() != newBV.curBitIndex()
+	|| memcmp(origData, newData, size) != 0) {
+      fprintf(stderr, "Test %u: BitVector operation %d (numBits %u) differs\n", testNum, opType, numBits);
+      result = False;
+    }
+  }
+
+  // Then try an (in-place, possibly overlapping) "shiftBits()", and another into a separate buffer:
+  unsigned const numBits = testRandom32()%(8*size + 1);
+  unsigned fromBitOffset = testRandom32()%(8*size - numBits + 1);
+  unsigned toBitOffset = testRandom32()%(fromBitOffset + 1);
+  if (testRandom32()%2) { fromBitOffset &=~ 7; toBitOffset &=~ 7; } // byte-aligned
+  originalShiftBits(origData, toBitOffset, origData, fromBitOffset, numBits);
+  shiftBits(newData, toBitOffset, newData, fromBitOffset, numBits);
+  if (memcmp(origData, newData, size) != 0) {
+    fprintf(stderr, "Test %u: in-place shiftBits(%u, %u, %u) differs\n", testNum, toBitOffset, fromBitOffset, numBits);
+    result = False;
+  }
+
+  unsigned char* origTo = new unsigned char[size];
+  unsigned char* newTo = new unsigned char[size];
+  memset(origTo, 0x5A, size); memset(newTo, 0x5A, size);
+  toBitOffset = testRandom32()%(8*size - numBits + 1);
+  originalShiftBits(origTo, toBitOffset, origData, fromBitOffset, numBits);
+  shiftBits(newTo, toBitOffset, newData, fromBitOffset, numBits);
+  if (memcmp(origTo, newTo, size) != 0) {
+    fprintf(stderr, "Test %u: shiftBits(%u, %u, %u) differs\n", testNum, toBitOffset, fromBitOffset, numBits);
+    result = False;
+  }
+
+  delete[] origTo; delete[] newTo;
+  delete[] origData; delete[] newData;
+  return result;
+}
+
+////////// Micro-benchmark //////////
+
+#define BENCHMARK_BUFFER_SIZE 65536
+#define NUM_BENCHMARK_ITERATIONS 200
+
+static unsigned sink = 0; // to stop the compiler from optimizing away the operations that we're timing
+
+typedef void ShiftBitsFunc(unsigned char* toBasePtr, unsigned toBitOffset,
+			   unsigned char const* fromBasePtr, unsigned fromBitOffset, unsigned numBits);
+
+template <class BV>
+void timeBitVector(char const* name, ShiftBitsFunc* shiftBitsFunc,
+		   unsigned char* data, unsigned char* expGolombData, unsigned char* dest) {
+  unsigned const numBits = 8*BENCHMARK_BUFFER_SIZE;
+  unsigned long numCalls;
+  double start, seconds;
+  int iter;
+
+  numCalls = 0;
+  start = timeNow();
+  for (iter = 0; iter < NUM_BENCHMARK_ITERATIONS; ++iter) {
+    BV bv(data, 0, numBits);
+    unsigned n = 1;
+    while (bv.numBitsRemaining() >= 32) { sink += bv.getBits(n); n = n%23 + 1; ++numCalls; }
+  }
+  seconds = timeNow() - start;
+  printf("%s getBits(1..23):     %6.2f ns/call\n", name, seconds*1e9/numCalls);
+
+  numCalls = 0;
+  start = timeNow();
+  for (iter = 0; iter < NUM_BENCHMARK_ITERATIONS; ++iter) {
+    BV bv(dest, 0, numBits);
+    unsigned n = 1;
+    while (bv.numBitsRemaining() >= 32) { bv.putBits(n*0x9E3779B1u, n); n = n%23 + 1; ++numCalls; }
+  }
+  seconds = timeNow() - start;
+  printf("%s putBits(1..23):     %6.2f ns/call\n", name, seconds*1e9/numCalls);
+
+  numCalls = 0;
+  start = timeNow();
+  for (iter = 0; iter < NUM_BENCHMARK_ITERATIONS; ++iter) {
+    BV bv(expGolombData, 0, numBits);
+    while (bv.numBitsRemaining() > 40) { sink += bv.get_expGolomb(); ++numCalls; }
+  }
+  seconds = timeNow() - start;
+  printf("%s get_expGolomb():    %6.2f ns/call\n", name, seconds*1e9/numCalls);
+
+  start = timeNow();
+  for (iter = 0; iter < NUM_BENCHMARK_ITERATIONS; ++iter) {
+    BV bv(data, 0, numBits);
+    while (bv.numBitsRemaining() > 0) sink += bv.get1Bit();
+  }
+  seconds = timeNow() - start;
+  printf("%s get1Bit():          %6.2f ns/call\n", name, seconds*1e9/((double)NUM_BENCHMARK_ITERATIONS*numBits));
+
+  double const numBytesShifted = (double)NUM_BENCHMARK_ITERATIONS*BENCHMARK_BUFFER_SIZE;
+  start = timeNow();
+  for (iter = 0; iter < NUM_BENCHMARK_ITERATIONS; ++iter) (*shiftBitsFunc)(dest, 3, data, 5, numBits - 16);
+  seconds = timeNow() - start;
+  printf("%s shiftBits(), unaligned: %6.2f ns/byte\n", name, seconds*1e9/numBytesShifted);
+
+  start = timeNow();
+  for (iter = 0; iter < NUM_BENCHMARK_ITERATIONS; ++iter) (*shiftBitsFunc)(dest, 8, data, 16, numBits - 16);
+  seconds = timeNow() - start;
+  printf("%s shiftBits(), aligned:   %6.2f ns/byte\n", name, seconds*1e9/numBytesShifted);
+}
+
+int main(int argc, char** argv) {
+  Boolean checkOnly = checkOnlyOption(argc, argv);
+  seedTestRandom(argc > 1 ? atoi(argv[1]) : 1);
+
+  unsigned const numTests = 200000;
+  unsigned numFailures = 0;
+  for (unsigned t = 0; t < numTests && numFailures < 10; ++t) {
+    if (!testOneVector(t)) ++numFailures;
+  }
+  if (numFailures > 0) return 1;
+  printf("Differential test passed (%u random vectors)\n", numTests);
+  if (checkOnly) return 0;
+
+  unsigned char* data = new unsigned char[BENCHMARK_BUFFER_SIZE];
+  unsigned char* expGolombData = new unsigned char[BENCHMARK_BUFFER_SIZE];
+  unsigned char* dest = new unsigned char[BENCHMARK_BUFFER_SIZE];
+  unsigned i;
+  for (i = 0; i < BENCHMARK_BUFFER_SIZE; ++i) data[i] = (unsigned char)testRandom32();
+
+  // Fill "expGolombData" with Exp-Golomb codes for (random) values 0..63 (and then '1' bits - i.e., codes for 0):
+  memset(expGolombData, 0xFF, BENCHMARK_BUFFER_SIZE);
+  BitVector writer(expGolombData, 0, 8*BENCHMARK_BUFFER_SIZE);
+  while (writer.numBitsRemaining() > 40) {
+    unsigned value = testRandom32()%64 + 1; // the value to encode, plus 1
+    unsigned numLeadingZeroBits = 0;
+    while ((value>>numLeadingZeroBits) > 1) ++numLeadingZeroBits;
+    writer.putBits(0, numLeadingZeroBits);
+    writer.putBits(value, numLeadingZeroBits + 1);
+  }
+
+  timeBitVector<OriginalBitVector>("original", originalShiftBits, data, expGolombData, dest);
+  timeBitVector<BitVector>("current ", shiftBits, data, expGolombData, dest);
+  if (sink == 42) printf("\n"); // unlikely; just so that "sink" is used
+
+  delete[] dest; delete[] expGolombData; delete[] data;
+  return 0;
+}
@@ -0,0 +1,218 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that measures "triggerEvent()" - called from other threads - using an "EpollTaskScheduler"
+// (if available) and a (select()-based) "BasicTaskScheduler":
+//   - latency: Another thread triggers one event at a time, at random intervals (so that the event loop is usually
+//     waiting - idle - for something to happen).  We report (percentiles of) the time from each "triggerEvent()"
+//     call until its handler is called.
+//   - throughput: Several threads trigger events - as fast as they can - using many different triggers.  We report
+//     the number of events handled per second, and check that every event was handled exactly once.
+// The program's exit status is 0 iff every event was handled exactly once.
+//
+// Usage: testEventTriggerSpeed [<num-sender-threads>]
+//     (the default is 4)
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+#include <pthread.h>
+#include <unistd.h>
+#include <atomic>
+
+#define NUM_LATENCY_EVENTS 2000
+#define MAX_USECS_BETWEEN_LATENCY_EVENTS 2000
+#define NUM_THROUGHPUT_TRIGGERS 100
+#define NUM_THROUGHPUT_EVENTS_PER_THREAD 200000
+
+static char doneFlag;
+
+////////// Latency //////////
+
+struct LatencyTest {
+  TaskScheduler* scheduler;
+  EventTriggerId trigger;
+  double sendTime;
+  std::atomic<bool> wasHandled;
+  double latencies[NUM_LATENCY_EVENTS]; // in seconds
+  unsigned numHandled;
+};
+
+static void handleLatencyEvent(void* clientData) {
+  LatencyTest* test = (LatencyTest*)clientData;
+  test->latencies[test->numHandled] = timeNow() - test->sendTime;
+  if (++test->numHandled == NUM_LATENCY_EVENTS) doneFlag = ~0;
+  test->wasHandled = true;
+}
+
+static void* latencySender(void* clientData) {
+  LatencyTest* test = (LatencyTest*)clientData;
+  for (unsigned i = 0; i < NUM_LATENCY_EVENTS; ++i) {
+    usleep(testRandom32()%MAX_USECS_BETWEEN_LATENCY_EVENTS);
+    test->wasHandled = false;
+    test->sendTime = timeNow();
+    test->scheduler->triggerEvent(test->trigger, test);
+    while (!test->wasHandled) usleep(10); // wait until this event has been handled, before sending the next one
+  }
+  return NULL;
+}
+
+static int compareDoubles(void const* a, void const* b) {
+  double x = *(double const*)a, y = *(double const*)b;
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static void measureLatency(char const* schedulerName, TaskScheduler& scheduler) {
+  LatencyTest* test = new LatencyTest;
+  test->scheduler = &scheduler;
+  test->trigger = scheduler.createEventTrigger(handleLatencyEvent);
+  test->numHandled = 0;
+  test->wasHandled = false;
+
+  doneFlag = 0;
+  pthread_t senderThread;
+  if (pthread_create(&senderThread, NULL, latencySender, test) != 0) {
+    fprintf(stderr, "pthread_create() failed\n");
+    exit(1);
+  }
+  scheduler.doEventLoop(&doneFlag);
+  pthread_join(senderThread, NULL);
+
+  qsort(test->latencies, NUM_LATENCY_EVENTS, sizeof test->latencies[0], compareDoubles);
+  printf("%-6s: latency (microseconds): median %.1f, 90%% %.1f, 99%% %.1f, max %.1f\n", schedulerName,
+	 test->latencies[NUM_LATENCY_EVENTS/2]*1000000.0, test->latencies[NUM_LATENCY_EVENTS*9/10]*1000000.0,
+	 test->latencies[NUM_LATENCY_EVENTS*99/100]*1000000.0, test->latencies[NUM_LATENCY_EVENTS-1]*1000000.0);
+  fflush(stdout);
+
+  scheduler.deleteEventTrigger(test->trigger);
+  delete test;
+}
+
+////////// Throughput //////////
+
+static unsigned numSenderThreads = 4;
+
+struct ThroughputTest {
+  TaskScheduler* scheduler;
+  EventTriggerId triggers[NUM_THROUGHPUT_TRIGGERS];
+  u_int8_t* numTimesHandled; // for each event
+  unsigned numEvents, numHandled;
+};
+
+struct ThroughputSender {
+  ThroughputTest* test;
+  unsigned threadNum;
+};
+
+static ThroughputTest* throughputTest;
+
+static void handleThroughputEvent(void* clientData) {
+  // Each event's "clientData" is its event number (+1, so that it's never NULL):
+  unsigned eventNum = (unsigned)((uintptr_t)clientData - 1);
+  if (eventNum < throughputTest->numEvents) ++throughputTest->numTimesHandled[eventNum];
+  if (++throughputTest->numHandled == throughputTest->numEvents) doneFlag = ~0;
+}
+
+static void* throughputSender(void* clientData) {
+  ThroughputSender* sender = (ThroughputSender*)clientData;
+  ThroughputTest* test = sender->test;
+  unsigned const firstEventNum = sender->threadNum*NUM_THROUGHPUT_EVENTS_PER_THREAD;
+  for (unsigned i = 0; i < NUM_THROUGHPUT_EVENTS_PER_THREAD; ++i) {
+    unsigned eventNum = firstEventNum + i;
+    test->scheduler->triggerEvent(test->triggers[eventNum%NUM_THROUGHPUT_TRIGGERS], (void*)(uintptr_t)(eventNum + 1));
+  }
+  return NULL;
+}
+
+static void checkForTimeout(void* /*clientData*/) {
+  doneFlag = ~0; // some events were lost
+}
+
+static Boolean measureThroughput(char const* schedulerName, TaskScheduler& scheduler) {
+  ThroughputTest* test = throughputTest = new ThroughputTest;
+  test->scheduler = &scheduler;
+  unsigned i;
+  for (i = 0; i < NUM_THROUGHPUT_TRIGGERS; ++i) test->triggers[i] = scheduler.createEventTrigger(handleThroughputEvent);
+  test->numEvents = numSenderThreads*NUM_THROUGHPUT_EVENTS_PER_THREAD;
+  test->numTimesHandled = new u_int8_t[test->numEvents];
+  memset(test->numTimesHandled, 0, test->numEvents);
+  test->numHandled = 0;
+
+  doneFlag = 0;
+  ThroughputSender* senders = new ThroughputSender[numSenderThreads];
+  pthread_t* senderThreads = new pthread_t[numSenderThreads];
+  double startTime = timeNow();
+  for (i = 0; i < numSenderThreads; ++i) {
+    senders[i].test = test;
+    senders[i].threadNum = i;
+    if (pthread_create(&senderThreads[i], NULL, throughputSender, &senders[i]) != 0) {
+      fprintf(stderr, "pthread_create() failed\n");
+      exit(1);
+    }
+  }
+  TaskToken timeoutTask = scheduler.scheduleDelayedTask(60*1000000, checkForTimeout, NULL);
+  scheduler.doEventLoop(&doneFlag);
+  double seconds = timeNow() - startTime;
+  scheduler.unscheduleDelayedTask(timeoutTask);
+  for (i = 0; i < numSenderThreads; ++i) pthread_join(senderThreads[i], NULL);
+
+  unsigned numLost = 0, numDuplicated = 0;
+  for (i = 0; i < test->numEvents; ++i) {
+    if (test->numTimesHandled[i] == 0) ++numLost;
+    else if (test->numTimesHandled[i] > 1) ++numDuplicated;
+  }
+  printf("%-6s: throughput: %u threads, %u triggers: %u events handled in %.2f seconds: %.0f events/second%s\n",
+	 schedulerName, numSenderThreads, NUM_THROUGHPUT_TRIGGERS, test->numHandled, seconds, test->numHandled/seconds,
+	 numLost == 0 && numDuplicated == 0 ? "" : " (ERROR: some events were lost or handled more than once)");
+  fflush(stdout);
+
+  for (i = 0; i < NUM_THROUGHPUT_TRIGGERS; ++i) scheduler.deleteEventTrigger(test->triggers[i]);
+  delete[] senderThreads; delete[] senders;
+  delete[] test->numTimesHandled;
+  delete test;
+  return numLost == 0 && numDuplicated == 0;
+}
+
+static Boolean testScheduler(char const* schedulerName, TaskScheduler* scheduler) {
+  if (scheduler == NULL) {
+    printf("%-6s: (not available)\n", schedulerName);
+    return True;
+  }
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+
+  measureLatency(schedulerName, *scheduler);
+  Boolean result = measureThroughput(schedulerName, *scheduler);
+
+  env->reclaim();
+  delete scheduler;
+  return result;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 2 || (argc == 2 && (numSenderThreads = (unsigned)atoi(argv[1])) == 0)) {
+    fprintf(stderr, "Usage: %s [<num-sender-threads>]\n", argv[0]);
+    return 1;
+  }
+
+  Boolean ok = True;
+#if defined(__linux__)
+  ok &= testScheduler("epoll", EpollTaskScheduler::createNew());
+#endif
+  ok &= testScheduler("select", BasicTaskScheduler::createNew());
+
+  return ok ? 0 : 1;
+}
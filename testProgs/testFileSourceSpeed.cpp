@@ -0,0 +1,129 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that measures the cost of streaming a file - as a server does - from <num-streams> concurrent
+// "ByteStreamFileSource"s (each delivering 1316-byte (i.e., 7 Transport Stream packet) frames, as fast as it can),
+// first without, and then with, a "FileBlockCache" (see "GenericMediaServer::setFileBlockCacheSize()").
+// For each mode, we report the total throughput, and check that every stream delivered the same data.  We also
+// report the cache's statistics.
+// (Unless the file is larger than the OS's own file cache, this measures the CPU cost of reading the file, rather
+// than the cost of reading the disk.)
+//
+// Usage: testFileSourceSpeed [-n <num-streams>] [-s <cache-size-in-MBytes>] <file-name>
+//     -n: the number of concurrent streams (default: 4)
+//     -s: the size of the cache (default: 64)
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+
+#define FRAME_SIZE 1316 // 7 Transport Stream packets
+
+// A sink that hashes just the start of each frame, so that the hashing doesn't hide the cost of the reading itself:
+class FrameStartHashingSink: public SpeedTestSink {
+public:
+  FrameStartHashingSink(UsageEnvironment& env)
+    : SpeedTestSink(env, FRAME_SIZE, 0) {
+  }
+
+private: // redefined virtual functions
+  virtual void hashFrame(unsigned char const* frame, unsigned frameSize, unsigned /*numTruncatedBytes*/) {
+    hashBytes((unsigned char const*)&frameSize, sizeof frameSize);
+    hashBytes(frame, frameSize < 8 ? frameSize : 8);
+  }
+};
+
+static unsigned numStreamsDone;
+static unsigned numStreams = 4;
+static char doneFlag;
+
+static void afterPlaying(void* /*clientData*/) {
+  if (++numStreamsDone == numStreams) doneFlag = ~0;
+}
+
+static Boolean streamFile(UsageEnvironment& env, char const* fileName, Boolean useCache) {
+  ByteStreamFileSource** sources = new ByteStreamFileSource*[numStreams];
+  SpeedTestSink** sinks = new SpeedTestSink*[numStreams];
+  unsigned i;
+  for (i = 0; i < numStreams; ++i) {
+    sources[i] = ByteStreamFileSource::createNew(env, fileName, FRAME_SIZE);
+    if (sources[i] == NULL) {
+      env << "Unable to open file \"" << fileName << "\" as a byte-stream file source\n";
+      return False;
+    }
+    sinks[i] = new FrameStartHashingSink(env);
+  }
+
+  numStreamsDone = 0;
+  doneFlag = 0;
+  double startTime = timeNow();
+  for (i = 0; i < numStreams; ++i) sinks[i]->startPlaying(*sources[i], afterPlaying, NULL);
+  env.taskScheduler().doEventLoop(&doneFlag);
+  double seconds = timeNow() - startTime;
+
+  u_int64_t numBytes = 0;
+  Boolean hashesMatch = True;
+  for (i = 0; i < numStreams; ++i) {
+    numBytes += sinks[i]->numBytes();
+    if (sinks[i]->numBytes() != sinks[0]->numBytes() || sinks[i]->hash() != sinks[0]->hash()) hashesMatch = False;
+  }
+  printf("cache %-3s: %u streams, %llu bytes (%llu frames) in all: %.1f MBytes/second (hash %016llx%s)\n",
+	 useCache ? "on" : "off", numStreams, (unsigned long long)numBytes,
+	 (unsigned long long)(numStreams*sinks[0]->numFrames()), numBytes/seconds/1000000.0,
+	 (unsigned long long)sinks[0]->hash(), hashesMatch ? "" : "; MISMATCH between streams");
+  fflush(stdout);
+
+  for (i = 0; i < numStreams; ++i) {
+    Medium::close(sinks[i]);
+    Medium::close(sources[i]);
+  }
+  delete[] sinks; delete[] sources;
+  return hashesMatch;
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+  char const* progName = argv[0];
+
+  unsigned cacheMBytes = 64;
+  while (argc > 3 && argv[1][0] == '-') {
+    if (strcmp(argv[1], "-n") == 0) {
+      numStreams = (unsigned)atoi(argv[2]);
+    } else if (strcmp(argv[1], "-s") == 0) {
+      cacheMBytes = (unsigned)atoi(argv[2]);
+    } else {
+      break;
+    }
+    argc -= 2; argv += 2;
+  }
+  if (argc != 2 || numStreams == 0 || cacheMBytes == 0) {
+    *env << "Usage: " << progName << " [-n <num-streams>] [-s <cache-size-in-MBytes>] <file-name>\n";
+    return 1;
+  }
+  char const* fileName = argv[1];
+
+  Boolean ok = streamFile(*env, fileName, False);
+
+  FileBlockCache* cache = FileBlockCache::reference(*env); // so that the file sources will use it
+  cache->setMaxSize((u_int64_t)cacheMBytes*1024*1024);
+  ok &= streamFile(*env, fileName, True);
+  cache->printStatistics(*env);
+  cache->release();
+
+  return ok ? 0 : 1;
+}
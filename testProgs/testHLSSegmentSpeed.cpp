@@ -0,0 +1,230 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that measures how fast a "RTSPServerSupportingHTTPStreaming" serves HTTP Live Streaming segments of an
+// indexed Transport Stream file: A child process runs the server; we fetch the file's playlist over HTTP, and then
+// each of its segments - <num-rounds> times - and report the throughput.
+// We do this twice: first with segments sent directly from the file (using "TCPFileSender", where available), and
+// then with segments copied through the stream's source objects (by hiding the segments' file ranges - see
+// "ServerMediaSubsession::getStreamFileRange()" - from the server).  We also check that both give the same data.
+// (The file - and its index file - should be in the OS's file cache, so that this doesn't measure the disk.)
+//
+// Usage: testHLSSegmentSpeed [-r <num-rounds>] <transport-stream-file-name>
+//     -r: the number of times to fetch each segment (default: 10)
+//     (The index file - produced by "MPEG2TransportStreamIndexer" - must also be present.)
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define FIRST_HTTP_PORT 18000
+#define MAX_NUM_SEGMENTS 1000
+#define RECEIVE_BUFFER_SIZE (1024*1024)
+
+// A subsession that doesn't tell the server the file ranges of its segments, so that they're copied through the
+// stream's source objects:
+class CopyingMPEG2TransportFileServerMediaSubsession: public MPEG2TransportFileServerMediaSubsession {
+public:
+  static CopyingMPEG2TransportFileServerMediaSubsession*
+  createNew(UsageEnvironment& env, char const* dataFileName, char const* indexFileName) {
+    MPEG2TransportStreamIndexFile* indexFile = MPEG2TransportStreamIndexFile::createNew(env, indexFileName);
+    if (indexFile == NULL) return NULL;
+    return new CopyingMPEG2TransportFileServerMediaSubsession(env, dataFileName, indexFile);
+  }
+
+protected:
+  CopyingMPEG2TransportFileServerMediaSubsession(UsageEnvironment& env, char const* fileName,
+						 MPEG2TransportStreamIndexFile* indexFile)
+    : MPEG2TransportFileServerMediaSubsession(env, fileName, indexFile, False) {
+  }
+
+private: // redefined virtual functions
+  virtual Boolean getStreamFileRange(unsigned /*clientSessionId*/, void* /*streamToken*/,
+				     char const*& /*fileName*/, u_int64_t& /*startByte*/, u_int64_t& /*numBytes*/) {
+    return False;
+  }
+};
+
+////////// The HTTP client //////////
+
+static portNumBits httpPort;
+static unsigned char receiveBuffer[RECEIVE_BUFFER_SIZE];
+
+// Fetches "/<urlSuffix>" from the server.  If "hash" is non-NULL, we also hash the data (which would otherwise
+// distort the timing).  If "body" is non-NULL, we also return the (first "maxBodySize"-1 bytes of the) data in it.
+// Returns the size of the data, or 0 on failure:
+static u_int64_t httpGet(char const* urlSuffix, u_int64_t* hash, char* body = NULL, unsigned maxBodySize = 0) {
+  int sock = socket(AF_INET, SOCK_STREAM, 0);
+  if (sock < 0) return 0;
+  MAKE_SOCKADDR_IN(serverAddr, htonl(INADDR_LOOPBACK), htons(httpPort));
+  if (connect(sock, (struct sockaddr*)&serverAddr, sizeof serverAddr) != 0) {
+    close(sock);
+    return 0;
+  }
+
+  char request[1000];
+  snprintf(request, sizeof request, "GET /%s HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n", urlSuffix);
+  if (send(sock, request, strlen(request), 0) != (ssize_t)strlen(request)) {
+    close(sock);
+    return 0;
+  }
+
+  // Read the response header, to get the size of the data (then read the data):
+  u_int64_t contentLength = 0, numBodyBytes = 0;
+  unsigned numHeaderBytes = 0;
+  Boolean haveReadHeader = False;
+  while (!haveReadHeader || numBodyBytes < contentLength) {
+    ssize_t numBytesRead = recv(sock, receiveBuffer, sizeof receiveBuffer, 0);
+    if (numBytesRead <= 0) break;
+
+    unsigned char const* data = receiveBuffer;
+    unsigned dataSize = (unsigned)numBytesRead;
+    if (!haveReadHeader) {
+      // (We assume that the whole header arrives in the first read.)
+      receiveBuffer[numBytesRead < (ssize_t)sizeof receiveBuffer ? numBytesRead : numBytesRead-1] = '\0';
+      char const* endOfHeader = strstr((char const*)receiveBuffer, "\r\n\r\n");
+      char const* contentLengthHeader = strstr((char const*)receiveBuffer, "Content-Length: ");
+      if (endOfHeader == NULL || contentLengthHeader == NULL
+	  || strncmp((char const*)receiveBuffer, "HTTP/1.1 200", 12) != 0) break;
+      contentLength = strtoull(contentLengthHeader + 16, NULL, 10);
+      numHeaderBytes = (unsigned)(endOfHeader + 4 - (char const*)receiveBuffer);
+      data += numHeaderBytes; dataSize -= numHeaderBytes;
+      haveReadHeader = True;
+    }
+
+    if (body != NULL && numBodyBytes < maxBodySize - 1) {
+      unsigned numToCopy = dataSize < maxBodySize - 1 - numBodyBytes ? dataSize : (unsigned)(maxBodySize - 1 - numBodyBytes);
+      memcpy(&body[numBodyBytes], data, numToCopy);
+      body[numBodyBytes + numToCopy] = '\0';
+    }
+    if (hash != NULL) {
+      for (unsigned i = 0; i < dataSize; ++i) *hash = (*hash^data[i])*1099511628211ULL; // FNV-1a
+    }
+    numBodyBytes += dataSize;
+  }
+
+  close(sock);
+  return haveReadHeader && numBodyBytes == contentLength ? contentLength : 0;
+}
+
+static Boolean fetchSegments(char const* label, char const* streamName, unsigned numRounds, u_int64_t& hash) {
+  // Get the playlist, and the segments that it lists:
+  static char playlist[20000];
+  if (httpGet(streamName, NULL, playlist, sizeof playlist) == 0) {
+    fprintf(stderr, "Failed to get the playlist for \"%s\"\n", streamName);
+    return False;
+  }
+  char* segments[MAX_NUM_SEGMENTS];
+  unsigned numSegments = 0;
+  for (char* line = strtok(playlist, "\r\n"); line != NULL && numSegments < MAX_NUM_SEGMENTS; line = strtok(NULL, "\r\n")) {
+    if (line[0] != '#') segments[numSegments++] = line;
+  }
+
+  // First, fetch each segment once, checking and hashing its data.  Then time fetching them all "numRounds" times:
+  hash = 14695981039346656037ULL;
+  u_int64_t numBytesPerRound = 0;
+  unsigned i;
+  for (i = 0; i < numSegments; ++i) {
+    u_int64_t numBytes = httpGet(segments[i], &hash);
+    if (numBytes == 0) {
+      fprintf(stderr, "Failed to get segment \"%s\"\n", segments[i]);
+      return False;
+    }
+    numBytesPerRound += numBytes;
+  }
+
+  double startTime = timeNow();
+  for (unsigned round = 0; round < numRounds; ++round) {
+    for (i = 0; i < numSegments; ++i) httpGet(segments[i], NULL);
+  }
+  double seconds = timeNow() - startTime;
+
+  printf("%-24s: %u segments (%llu bytes) x %u: %.1f MBytes/second (hash %016llx)\n", label, numSegments,
+	 (unsigned long long)numBytesPerRound, numRounds, numBytesPerRound*numRounds/seconds/1000000.0,
+	 (unsigned long long)hash);
+  fflush(stdout);
+  return True;
+}
+
+////////// main //////////
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+  char const* progName = argv[0];
+
+  unsigned numRounds = 10;
+  if (argc == 4 && strcmp(argv[1], "-r") == 0) {
+    numRounds = (unsigned)atoi(argv[2]);
+    argc -= 2; argv += 2;
+  }
+  if (argc != 2 || numRounds == 0) {
+    *env << "Usage: " << progName << " [-r <num-rounds>] <transport-stream-file-name>\n";
+    return 1;
+  }
+  char const* fileName = argv[1];
+  char* indexFileName = new char[strlen(fileName) + 2];
+  sprintf(indexFileName, "%sx", fileName); // e.g., "foo.ts" => "foo.tsx"
+
+  // Create the server (with its HTTP port), with two streams: the file (served normally), and a copy of it
+  // (served without using its file ranges):
+  RTSPServer* rtspServer = RTSPServerSupportingHTTPStreaming::createNew(*env, 0);
+  if (rtspServer == NULL) {
+    *env << "Failed to create the server: " << env->getResultMsg() << "\n";
+    return 1;
+  }
+  for (httpPort = FIRST_HTTP_PORT; !rtspServer->setUpTunnelingOverHTTP(httpPort); ++httpPort) {}
+
+  ServerMediaSession* sms = ServerMediaSession::createNew(*env, "direct.ts");
+  sms->addSubsession(MPEG2TransportFileServerMediaSubsession::createNew(*env, fileName, indexFileName, False));
+  rtspServer->addServerMediaSession(sms);
+  ServerMediaSubsession* copyingSubsession
+    = CopyingMPEG2TransportFileServerMediaSubsession::createNew(*env, fileName, indexFileName);
+  if (copyingSubsession == NULL) {
+    *env << "Unable to open index file \"" << indexFileName << "\"\n";
+    return 1;
+  }
+  sms = ServerMediaSession::createNew(*env, "copied.ts");
+  sms->addSubsession(copyingSubsession);
+  rtspServer->addServerMediaSession(sms);
+
+  pid_t serverPid = fork();
+  if (serverPid < 0) {
+    *env << "fork() failed\n";
+    return 1;
+  } else if (serverPid == 0) {
+    // We're the child (server) process:
+    env->taskScheduler().doEventLoop(); // does not return
+  }
+
+  u_int64_t directHash = 0, copiedHash = 0;
+  Boolean ok = fetchSegments("direct from file", "direct.ts", numRounds, directHash)
+    && fetchSegments("copied through sources", "copied.ts", numRounds, copiedHash);
+  if (ok && directHash != copiedHash) {
+    printf("MISMATCH: the segments' data differs\n");
+    ok = False;
+  }
+
+  kill(serverPid, SIGTERM);
+  waitpid(serverPid, NULL, 0);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that compares the "OpenHashTable" implementation (returned by "HashTable::create()")
+// with the original (chained) "BasicHashTable": first checking that both give the same results
+// for a random sequence of operations, then timing insert, lookup (hit and miss), iteration and
+// removal, for string, one-word and 3-word keys, and for small, medium and large tables.
+//
+// Usage: testHashTableSpeed [-c]
+//     -c: only do the consistency check; don't time anything
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicHashTable.hh"
+#include "OpenHashTable.hh"
+#include <stdio.h>
+
+// A set of keys of a given type.  Each key is stored in its own fixed-size slot:
+#define MAX_KEY_SIZE 64
+
+class KeySet {
+public:
+  KeySet(int keyType, unsigned numKeys, u_int32_t tag)
+    : fKeyType(keyType), fNumKeys(numKeys) {
+    fKeyData = new char[numKeys*MAX_KEY_SIZE];
+    fKeys = new char const*[numKeys];
+    for (unsigned i = 0; i < numKeys; ++i) {
+      // Use different key values for each "tag", so that key sets with different tags don't overlap:
+      setKey(i, (tag<<28) | (testRandom32()&0x07FFFFFF)<<1 | (i&1));
+    }
+  }
+  virtual ~KeySet() { delete[] fKeys; delete[] fKeyData; }
+
+  unsigned numKeys() const { return fNumKeys; }
+  char const* key(unsigned i) const { return fKeys[i]; }
+
+  void setKey(unsigned i, u_int32_t value) {
+    char* data = &fKeyData[i*MAX_KEY_SIZE];
+    if (fKeyType == STRING_HASH_KEYS) {
+      // Use a mix of short and long strings (some of which don't fit within an 'open' table slot):
+      snprintf(data, MAX_KEY_SIZE, (value&1) ? "stream-%u" : "a-rather-long-stream-name/number-%u", value>>1);
+      fKeys[i] = data;
+    } else if (fKeyType == ONE_WORD_HASH_KEYS) {
+      fKeys[i] = (char const*)((uintptr_t)value*16); // like a pointer
+    } else {
+      u_int32_t* words = (u_int32_t*)data;
+      for (int j = 0; j < fKeyType; ++j) words[j] = value*(j+1) + j;
+      fKeys[i] = data;
+    }
+  }
+
+private:
+  int fKeyType;
+  unsigned fNumKeys;
+  char* fKeyData;
+  char const** fKeys;
+};
+
+static char const* keyTypeName(int keyType) {
+  return keyType == STRING_HASH_KEYS ? "string" : keyType == ONE_WORD_HASH_KEYS ? "one-word" : "3-word";
+}
+
+////////// Consistency check //////////
+
+static Boolean checkConsistency(int keyType) {
+  HashTable* basic = new BasicHashTable(keyType);
+  HashTable* open = new OpenHashTable(keyType);
+  Boolean result = True;
+
+  // Perform a random sequence of "Add()"s, "Remove()"s and "Lookup()"s (on a small key range, so
+  // that each of these often finds an existing entry), and check that both tables agree:
+  unsigned const numKeys = 3000;
+  KeySet keys(keyType, numKeys, 0);
+  for (unsigned op = 0; op < 200000 && result; ++op) {
+    char const* key = keys.key(testRandom32()%(op < 100000 ? numKeys : 50));
+    switch (testRandom32()%3) {
+      case 0: {
+	void* value = (void*)(uintptr_t)(testRandom32()%4 + 1);
+	if (basic->Add(key, value) != open->Add(key, value)) result = False;
+	break;
+      }
+      case 1: {
+	if (basic->Remove(key) != open->Remove(key)) result = False;
+	break;
+      }
+      default: {
+	if (basic->Lookup(key) != open->Lookup(key)) result = False;
+	break;
+      }
+    }
+    if (basic->numEntries() != open->numEntries()) result = False;
+  }
+
+  // Then fill the tables, and iterate through the 'open' table, removing (about) half of its entries
+  // as we go.  Each entry should be returned exactly once:
+  for (unsigned i = 0; i < numKeys; ++i) {
+    basic->Add(keys.key(i), (void*)1);
+    open->Add(keys.key(i), (void*)1);
+  }
+  unsigned numEntries = open->numEntries();
+  unsigned numSeen = 0;
+  HashTable::Iterator* iter = HashTable::Iterator::create(*open);
+  char const* key;
+  while (iter->next(key) != NULL && result) {
+    ++numSeen;
+    if (basic->Lookup(key) != (void*)1) result = False; // not found, or already seen
+    basic->Add(key, (void*)2);
+    if (testRandom32()&1) open->Remove(key);
+  }
+  delete iter;
+  if (numSeen != numEntries) result = False;
+
+  // Finally, empty both tables using "RemoveNext()" (which uses "HashTable::Iterator::create()"):
+  while (open->RemoveNext() != NULL) {}
+  while (basic->RemoveNext() != NULL) {}
+  if (open->numEntries() != 0 || basic->numEntries() != 0) result = False;
+
+  delete open; delete basic;
+  if (!result) fprintf(stderr, "Consistency check failed for %s keys!\n", keyTypeName(keyType));
+  return result;
+}
+
+////////// Timing //////////
+
+static uintptr_t sink = 0; // to stop the compiler from optimizing away the operations that we're timing
+
+template <class Table>
+void timeTable(char const* tableName, int keyType, KeySet const& keys, KeySet const& otherKeys, unsigned numReps) {
+  unsigned const numKeys = keys.numKeys();
+
+  // Look up the keys in a different order from the one in which they were added:
+  char const** lookupOrder = new char const*[numKeys];
+  for (unsigned i = 0; i < numKeys; ++i) lookupOrder[i] = keys.key((i*7919u)%numKeys);
+
+  double insertTime = 0.0, hitTime = 0.0, missTime = 0.0, iterateTime = 0.0, removeTime = 0.0;
+  for (unsigned rep = 0; rep < numReps; ++rep) {
+    HashTable* table = new Table(keyType); // (the table operations are accessed via the base class)
+    unsigned i;
+
+    double start = timeNow();
+    for (i = 0; i < numKeys; ++i) table->Add(keys.key(i), (void*)1);
+    double end = timeNow(); insertTime += end - start;
+
+    start = end;
+    for (i = 0; i < numKeys; ++i) sink += (uintptr_t)table->Lookup(lookupOrder[i]);
+    end = timeNow(); hitTime += end - start;
+
+    start = end;
+    for (i = 0; i < numKeys; ++i) sink += (uintptr_t)table->Lookup(otherKeys.key(i));
+    end = timeNow(); missTime += end - start;
+
+    start = end;
+    {
+      HashTable::Iterator* iter = HashTable::Iterator::create(*table);
+      char const* key;
+      while (iter->next(key) != NULL) ++sink;
+      delete iter;
+    }
+    end = timeNow(); iterateTime += end - start;
+
+    start = end;
+    for (i = 0; i < numKeys; ++i) table->Remove(lookupOrder[i]);
+    end = timeNow(); removeTime += end - start;
+
+    delete table;
+  }
+  delete[] lookupOrder;
+
+  double numOps = (double)numKeys*numReps/1e9; // so that the times are in nanoseconds per operation
+  printf("%-7s %-9s %7u entries: insert %6.1f, hit %6.1f, miss %6.1f, iterate %5.1f, remove %6.1f ns/op\n",
+	 tableName, keyTypeName(keyType), numKeys,
+	 insertTime/numOps, hitTime/numOps, missTime/numOps, iterateTime/numOps, removeTime/numOps);
+}
+
+int main(int argc, char** argv) {
+  Boolean checkOnly = checkOnlyOption(argc, argv);
+  int const keyTypes[] = { STRING_HASH_KEYS, ONE_WORD_HASH_KEYS, 3 };
+  unsigned const numKeyTypes = sizeof keyTypes/sizeof keyTypes[0];
+
+  unsigned k;
+  for (k = 0; k < numKeyTypes; ++k) {
+    if (!checkConsistency(keyTypes[k])) return 1;
+  }
+  printf("Consistency check passed\n");
+  if (checkOnly) return 0;
+
+  unsigned const tableSizes[] = { 16, 1000, 100000 };
+  for (k = 0; k < numKeyTypes; ++k) {
+    for (unsigned s = 0; s < sizeof tableSizes/sizeof tableSizes[0]; ++s) {
+      unsigned numKeys = tableSizes[s];
+      unsigned numReps = numKeys < 1000 ? 20000 : numKeys < 100000 ? 200 : 5;
+      KeySet keys(keyTypes[k], numKeys, 1), otherKeys(keyTypes[k], numKeys, 2);
+
+      timeTable<BasicHashTable>("chained", keyTypes[k], keys, otherKeys, numReps);
+      timeTable<OpenHashTable>("open", keyTypes[k], keys, otherKeys, numReps);
+    }
+  }
+  if (sink == 42) printf("\n"); // unlikely; just so that "sink" is used
+
+  return 0;
+}
@@ -0,0 +1,175 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that measures what idle connections cost an event loop - as in a server with many connected, but
+// inactive, clients - using an "EpollTaskScheduler" (if available) and a (select()-based) "BasicTaskScheduler".
+// For each number of idle connections, we register a read handler for each one, and report:
+//   - the (heap) memory used per idle connection (not counting memory used by the kernel), and
+//   - the time taken by each turn of the event loop, while a single other connection is active.
+//     (That connection is a socket pair that 'ping-pongs' a byte between its ends, so each turn of the event loop
+//     handles one read.)
+// (The task scheduler doesn't care what kind of socket it's watching, so we use unconnected UDP sockets - which need
+// just one descriptor each - as the idle connections.)
+// "BasicTaskScheduler" can't handle socket numbers >= FD_SETSIZE, so it's not tested with that many sockets.
+//
+// Usage: testIdleConnectionSpeed [<num-idle-connections> ...]
+//     (the defaults are 100, 1000 and 10000)
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <unistd.h>
+#include <new>
+
+#define NUM_LOOP_TURNS 100000 // for each test
+
+static unsigned numIdleHandlerCalls;
+static void idleHandler(void* /*clientData*/, int /*mask*/) {
+  ++numIdleHandlerCalls; // shouldn't happen
+}
+
+static int activeSockets[2];
+static unsigned numActiveHandlerCalls;
+static char doneFlag;
+
+static void activeHandler(void* clientData, int /*mask*/) {
+  // Read the byte from our end, and send it (back) to the other end:
+  int end = (int)(long)clientData;
+  char c;
+  if (read(activeSockets[end], &c, 1) != 1 || write(activeSockets[1-end], &c, 1) != 1) {
+    doneFlag = ~0;
+    return;
+  }
+  if (++numActiveHandlerCalls == NUM_LOOP_TURNS) doneFlag = ~0;
+}
+
+// We count the heap memory in use, by redefining the global "operator new" and "operator delete".  (Each allocation
+// records its size just before the memory that it returns, so that "operator delete" knows how much is being freed.)
+#define ALLOCATION_HEADER_SIZE 16 // keeps the returned memory suitably aligned
+static u_int64_t numHeapBytesInUse = 0;
+
+void* operator new(size_t size) {
+  char* p = (char*)malloc(size + ALLOCATION_HEADER_SIZE);
+  if (p == NULL) throw std::bad_alloc();
+  *(size_t*)p = size;
+  numHeapBytesInUse += size;
+  return p + ALLOCATION_HEADER_SIZE;
+}
+
+void operator delete(void* ptr) throw() {
+  if (ptr == NULL) return;
+  char* p = (char*)ptr - ALLOCATION_HEADER_SIZE;
+  numHeapBytesInUse -= *(size_t*)p;
+  free(p);
+}
+
+static void testScheduler(char const* schedulerName, TaskScheduler* scheduler, unsigned numIdleConnections) {
+  if (scheduler == NULL) {
+    printf("%-6s: %5u idle connections: (not available)\n", schedulerName, numIdleConnections);
+    return;
+  }
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+
+  // Create the active socket pair first, so that it gets low socket numbers:
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, activeSockets) != 0) {
+    *env << "socketpair() failed: " << env->getErrno() << "\n";
+    exit(1);
+  }
+
+  int* idleSockets = new int[numIdleConnections];
+  unsigned i;
+  for (i = 0; i < numIdleConnections; ++i) {
+    idleSockets[i] = socket(AF_INET, SOCK_DGRAM, 0);
+    if (idleSockets[i] < 0) {
+      *env << "Failed to create socket " << i << ": " << env->getErrno() << " (is the descriptor limit too low?)\n";
+      exit(1);
+    }
+  }
+
+  Boolean const isSelect = strcmp(schedulerName, "select") == 0;
+  if (isSelect && numIdleConnections > 0 && idleSockets[numIdleConnections-1] >= (int)FD_SETSIZE) {
+    printf("%-6s: %5u idle connections: (not tested: socket numbers would exceed FD_SETSIZE (%d))\n",
+	   schedulerName, numIdleConnections, FD_SETSIZE);
+  } else {
+    // Register a handler for each idle connection, and measure how much memory this took:
+    u_int64_t heapBytesBefore = numHeapBytesInUse;
+    for (i = 0; i < numIdleConnections; ++i) {
+      scheduler->turnOnBackgroundReadHandling(idleSockets[i], idleHandler, NULL);
+    }
+    u_int64_t heapBytesAfter = numHeapBytesInUse;
+
+    // Then time the event loop, while the socket pair is active:
+    scheduler->turnOnBackgroundReadHandling(activeSockets[0], activeHandler, (void*)0);
+    scheduler->turnOnBackgroundReadHandling(activeSockets[1], activeHandler, (void*)1);
+    numActiveHandlerCalls = numIdleHandlerCalls = 0;
+    doneFlag = 0;
+    char c = 0;
+    double startTime = timeNow();
+    if (write(activeSockets[1], &c, 1) == 1) scheduler->doEventLoop(&doneFlag);
+    double seconds = timeNow() - startTime;
+
+    printf("%-6s: %5u idle connections: %6.1f bytes/connection; %7.3f microseconds per event loop turn%s\n",
+	   schedulerName, numIdleConnections,
+	   numIdleConnections == 0 ? 0.0 : (double)(heapBytesAfter - heapBytesBefore)/numIdleConnections,
+	   seconds*1000000.0/NUM_LOOP_TURNS,
+	   numIdleHandlerCalls == 0 && numActiveHandlerCalls == NUM_LOOP_TURNS ? "" : " (ERROR: wrong handlers called)");
+    fflush(stdout);
+
+    scheduler->turnOffBackgroundReadHandling(activeSockets[0]);
+    scheduler->turnOffBackgroundReadHandling(activeSockets[1]);
+    for (i = 0; i < numIdleConnections; ++i) scheduler->turnOffBackgroundReadHandling(idleSockets[i]);
+  }
+
+  for (i = 0; i < numIdleConnections; ++i) close(idleSockets[i]);
+  delete[] idleSockets;
+  close(activeSockets[0]); close(activeSockets[1]);
+
+  env->reclaim();
+  delete scheduler;
+}
+
+int main(int argc, char** argv) {
+  unsigned const defaultNumsIdleConnections[] = { 100, 1000, 10000 };
+  unsigned numTests = argc > 1 ? argc-1 : sizeof defaultNumsIdleConnections/sizeof defaultNumsIdleConnections[0];
+  unsigned* numsIdleConnections = new unsigned[numTests];
+  unsigned maxNumIdleConnections = 0;
+  for (unsigned i = 0; i < numTests; ++i) {
+    numsIdleConnections[i] = argc > 1 ? (unsigned)atoi(argv[i+1]) : defaultNumsIdleConnections[i];
+    if (numsIdleConnections[i] > maxNumIdleConnections) maxNumIdleConnections = numsIdleConnections[i];
+  }
+
+  // Make sure that we can have enough sockets open:
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < maxNumIdleConnections + 100) {
+    limit.rlim_cur = limit.rlim_max == RLIM_INFINITY || limit.rlim_max > maxNumIdleConnections + 100
+      ? maxNumIdleConnections + 100 : limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  for (unsigned i = 0; i < numTests; ++i) {
+#if defined(__linux__)
+    testScheduler("epoll", EpollTaskScheduler::createNew(), numsIdleConnections[i]);
+#endif
+    testScheduler("select", BasicTaskScheduler::createNew(), numsIdleConnections[i]);
+  }
+
+  delete[] numsIdleConnections;
+  return 0;
+}
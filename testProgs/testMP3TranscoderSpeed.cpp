@@ -0,0 +1,213 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that measures the speed of MP3 Huffman decoding:
+// - First, it times "MP3HuffmanDecode()" on a fixed set of random granules.
+// - Then (if a MP3 file is given), it times "MP3Transcoder" on that file, at the given output bitrate.
+// Each also outputs a hash of its results, which can be used to check that a change to the
+// decoder doesn't change them.
+// Optionally, it first creates a synthetic 128 kbps (mono or stereo) MP3 file: valid headers and
+// side info, with random main data.
+//
+// Usage: testMP3TranscoderSpeed [-g mono|stereo <num-frames>] [<mp3-file> <output-bitrate-in-kbps> [<num-iterations>]]
+//     -g: (re)create <mp3-file> as a synthetic stream with this many frames, before reading it
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+#include "MP3InternalsHuffman.hh"
+
+static unsigned randomHuffmanTable() {
+  // Tables 4 and 14 are not used:
+  unsigned table;
+  do table = testRandom32()%32; while (table == 4 || table == 14);
+  return table;
+}
+
+////////// "MP3HuffmanDecode()" timing //////////
+
+#define NUM_GRANULES 2000
+#define GRANULE_DATA_SIZE 512
+#define NUM_DECODE_ITERATIONS 20
+
+static void timeHuffmanDecoding() {
+  unsigned char* data = new unsigned char[NUM_GRANULES*GRANULE_DATA_SIZE];
+  MP3SideInfo::gr_info_s_t* granules = new MP3SideInfo::gr_info_s_t[NUM_GRANULES];
+  unsigned i;
+  for (i = 0; i < NUM_GRANULES*GRANULE_DATA_SIZE; ++i) data[i] = (unsigned char)testRandom32();
+  for (i = 0; i < NUM_GRANULES; ++i) {
+    MP3SideInfo::gr_info_s_t& gr = granules[i];
+    memset(&gr, 0, sizeof gr);
+    gr.part2_3_length = 1500 + testRandom32()%1500;
+    gr.big_values = 50 + testRandom32()%239;
+    gr.scalefac_compress = testRandom32()%16;
+    gr.scfsi = -1;
+    for (unsigned r = 0; r < 3; ++r) gr.table_select[r] = randomHuffmanTable();
+    gr.region1start = testRandom32()%(gr.big_values/2 + 1);
+    gr.region2start = gr.region1start + testRandom32()%(gr.big_values/2 + 1);
+    gr.count1table_select = testRandom32()%2;
+  }
+
+  MP3HuffmanEncodingInfo hei(True/*includeDecodedValues*/);
+  u_int64_t hash = 0;
+  double startTime = timeNow();
+  for (unsigned iter = 0; iter < NUM_DECODE_ITERATIONS; ++iter) {
+    for (i = 0; i < NUM_GRANULES; ++i) {
+      MP3SideInfo::gr_info_s_t gr = granules[i]; // a copy, because it gets modified
+      unsigned scaleFactorsLength;
+      MP3HuffmanDecode(&gr, False, &data[i*GRANULE_DATA_SIZE], 0, gr.part2_3_length, scaleFactorsLength, hei);
+
+      unsigned k;
+      for (k = 0; k <= hei.numSamples; ++k) hash = hash*31 + hei.allBitOffsets[k];
+      for (k = 0; k < 4*hei.numSamples; ++k) hash = hash*31 + hei.decodedValues[k];
+    }
+  }
+  double seconds = timeNow() - startTime;
+
+  unsigned numDecodes = NUM_DECODE_ITERATIONS*NUM_GRANULES;
+  printf("MP3HuffmanDecode(): hash %016llx: %.2f microseconds/granule\n",
+	 (unsigned long long)hash, seconds*1000000.0/numDecodes);
+
+  delete[] granules; delete[] data;
+}
+
+////////// Synthetic input //////////
+
+#define SYNTHETIC_FRAME_SIZE (144*128000/44100) /* 128 kbps, 44.1 kHz, no padding */
+
+static Boolean createSyntheticStream(char const* fileName, Boolean isStereo, unsigned numFrames) {
+  FILE* fid = fopen(fileName, "wb");
+  if (fid == NULL) return False;
+
+  unsigned const numChannels = isStereo ? 2 : 1;
+  unsigned const sideInfoSize = isStereo ? 32 : 17;
+  unsigned const mainDataBitsPerGranuleChannel = (SYNTHETIC_FRAME_SIZE - 4 - sideInfoSize)*8/(2*numChannels);
+  unsigned char frame[SYNTHETIC_FRAME_SIZE];
+
+  for (unsigned f = 0; f < numFrames; ++f) {
+    BitVector bv(frame, 0, (4 + sideInfoSize)*8);
+
+    // The header: MPEG-1 Layer III, no CRC, 128 kbps, 44.1 kHz:
+    bv.putBits(0xFFFB, 16); bv.putBits(9, 4); bv.putBits(0, 2); bv.putBits(0, 1); bv.putBits(0, 1);
+    bv.putBits(isStereo ? 0 : 3, 2); bv.putBits(0, 2); bv.putBits(0, 1); bv.putBits(0, 1); bv.putBits(0, 2);
+
+    // The side info:
+    bv.putBits(0, 9); // main_data_begin
+    bv.putBits(0, isStereo ? 3 : 5); // private_bits
+    unsigned ch;
+    for (ch = 0; ch < numChannels; ++ch) bv.putBits(0, 4); // scfsi
+    for (unsigned gr = 0; gr < 2; ++gr) {
+      for (ch = 0; ch < numChannels; ++ch) {
+	unsigned const budget = mainDataBitsPerGranuleChannel;
+	bv.putBits(budget/2 + testRandom32()%(budget - budget/2), 12); // part2_3_length
+	bv.putBits(50 + testRandom32()%239, 9); // big_values
+	bv.putBits(testRandom32()%256, 8); // global_gain
+	bv.putBits(testRandom32()%16, 4); // scalefac_compress
+	bv.putBits(0, 1); // window_switching_flag
+	for (unsigned r = 0; r < 3; ++r) bv.putBits(randomHuffmanTable(), 5); // table_select
+	bv.putBits(testRandom32()%16, 4); // region0_count
+	bv.putBits(testRandom32()%8, 3); // region1_count
+	bv.putBits(testRandom32()%2, 1); // preflag
+	bv.putBits(testRandom32()%2, 1); // scalefac_scale
+	bv.putBits(testRandom32()%2, 1); // count1table_select
+      }
+    }
+
+    // The main data:
+    for (unsigned i = 4 + sideInfoSize; i < SYNTHETIC_FRAME_SIZE; ++i) frame[i] = (unsigned char)testRandom32();
+
+    fwrite(frame, 1, SYNTHETIC_FRAME_SIZE, fid);
+  }
+
+  fclose(fid);
+  return True;
+}
+
+////////// "MP3Transcoder" timing //////////
+
+#define SINK_BUFFER_SIZE 100000
+
+static Boolean timeTranscoder(UsageEnvironment& env, char const* fileName, unsigned outBitrate, int numIterations) {
+  double totalSeconds = 0.0;
+  u_int64_t totalNumFrames = 0;
+  SpeedTestSink* sink = SpeedTestSink::createNew(env, SINK_BUFFER_SIZE);
+  for (int i = 0; i < numIterations; ++i) {
+    MP3FileSource* fileSource = MP3FileSource::createNew(env, fileName);
+    if (fileSource == NULL) {
+      env << "Unable to open file \"" << fileName << "\" as a MP3 file source\n";
+      Medium::close(sink);
+      return False;
+    }
+    FramedSource* transcoder = MP3Transcoder::createNew(env, outBitrate, fileSource);
+
+    totalSeconds += sink->playFrom(*transcoder);
+    totalNumFrames += sink->numFrames();
+    Medium::close(transcoder); // also closes "fileSource"
+  }
+
+  printf("MP3Transcoder (%s -> %u kbps): %llu frames, %llu bytes, hash %016llx: %.0f frames/second\n",
+	 fileName, outBitrate, (unsigned long long)sink->numFrames(), (unsigned long long)sink->numBytes(),
+	 (unsigned long long)sink->hash(), totalNumFrames/totalSeconds);
+  Medium::close(sink);
+  return True;
+}
+
+////////// main //////////
+
+static void usage(UsageEnvironment& env, char const* progName) {
+  env << "Usage: " << progName
+      << " [-g mono|stereo <num-frames>] [<mp3-file> <output-bitrate-in-kbps> [<num-iterations>]]\n";
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+  char const* progName = argv[0];
+
+  Boolean createSynthetic = False, syntheticIsStereo = False;
+  unsigned numSyntheticFrames = 0;
+  if (argc > 3 && strcmp(argv[1], "-g") == 0) {
+    createSynthetic = True;
+    syntheticIsStereo = strcmp(argv[2], "stereo") == 0;
+    numSyntheticFrames = (unsigned)atoi(argv[3]);
+    argc -= 3; argv += 3;
+  }
+  if (argc == 2 || argc > 4 || (createSynthetic && argc == 1)) {
+    usage(*env, progName);
+    return 1;
+  }
+
+  timeHuffmanDecoding();
+
+  if (argc > 1) {
+    char const* fileName = argv[1];
+    unsigned outBitrate = (unsigned)atoi(argv[2]);
+    int numIterations = argc > 3 ? atoi(argv[3]) : 1;
+    if (outBitrate == 0 || numIterations <= 0) {
+      usage(*env, progName);
+      return 1;
+    }
+
+    if (createSynthetic && !createSyntheticStream(fileName, syntheticIsStereo, numSyntheticFrames)) {
+      *env << "Unable to create \"" << fileName << "\"\n";
+      return 1;
+    }
+    if (!timeTranscoder(*env, fileName, outBitrate, numIterations)) return 1;
+  }
+
+  return 0;
+}
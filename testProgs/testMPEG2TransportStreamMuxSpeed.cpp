@@ -0,0 +1,121 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that measures the throughput of "MPEG2TransportStreamFromESSource" (i.e., of
+// "MPEG2TransportStreamMultiplexor"): It multiplexes 400 MBytes of (in-memory, dummy) video
+// Elementary Stream data - in 40000-byte frames - into a Transport Stream, delivered into a sink
+// that just counts the data (and hashes its Transport packet headers), for each of several sink
+// buffer sizes.
+//
+// Usage: testMPEG2TransportStreamMuxSpeed [<sink-buffer-size> ...]
+//     (the default sink buffer sizes are 188, 1316 and 65536 bytes)
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+
+#define ES_FRAME_SIZE 40000
+#define NUM_ES_FRAMES 10000
+
+// A source that delivers dummy ES frames from memory:
+class DummyESSource: public FramedSource {
+public:
+  DummyESSource(UsageEnvironment& env, unsigned frameSize, unsigned numFrames)
+    : FramedSource(env), fFrameSizeToDeliver(frameSize), fNumFramesLeft(numFrames) {
+    fPresentationTime.tv_sec = 1000; fPresentationTime.tv_usec = 0;
+  }
+
+private: // redefined virtual functions
+  virtual void doGetNextFrame() {
+    if (fNumFramesLeft == 0) {
+      handleClosure();
+      return;
+    }
+    --fNumFramesLeft;
+
+    fFrameSize = fFrameSizeToDeliver;
+    if (fFrameSize > fMaxSize) {
+      fNumTruncatedBytes = fFrameSize - fMaxSize;
+      fFrameSize = fMaxSize;
+    }
+    memset(fTo, 0x55, fFrameSize);
+
+    fPresentationTime.tv_usec += 33333; // ~30 frames per second
+    if (fPresentationTime.tv_usec >= 1000000) {
+      ++fPresentationTime.tv_sec;
+      fPresentationTime.tv_usec -= 1000000;
+    }
+
+    // Deliver via the event loop, to avoid unbounded recursion:
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)FramedSource::afterGetting, this);
+  }
+
+private:
+  unsigned fFrameSizeToDeliver, fNumFramesLeft;
+};
+
+// A sink that hashes just the Transport packets' headers (which include the continuity counters), to save time:
+class TSHeaderHashingSink: public SpeedTestSink {
+public:
+  TSHeaderHashingSink(UsageEnvironment& env, unsigned bufferSize)
+    : SpeedTestSink(env, bufferSize, 0) {
+  }
+
+private: // redefined virtual functions
+  virtual void hashFrame(unsigned char const* frame, unsigned frameSize, unsigned /*numTruncatedBytes*/) {
+    // (We don't hash the frame size, so that the hash doesn't depend on the sink buffer size.)
+    for (unsigned i = 0; i + 4 <= frameSize; i += 188) hashBytes(&frame[i], 4);
+  }
+};
+
+static void timeMultiplexor(UsageEnvironment& env, unsigned sinkBufferSize) {
+  DummyESSource* esSource = new DummyESSource(env, ES_FRAME_SIZE, NUM_ES_FRAMES);
+  MPEG2TransportStreamFromESSource* tsSource = MPEG2TransportStreamFromESSource::createNew(env);
+  tsSource->addNewVideoSource(esSource, 5/*H.264*/);
+  SpeedTestSink* sink = new TSHeaderHashingSink(env, sinkBufferSize);
+
+  double seconds = sink->playFrom(*tsSource);
+  printf("sink buffer %6u bytes: %llu bytes in %llu deliveries, %.0f MBytes/second (hash %016llx)\n",
+	 sinkBufferSize, (unsigned long long)sink->numBytes(), (unsigned long long)sink->numFrames(),
+	 sink->numBytes()/seconds/1000000.0, (unsigned long long)sink->hash());
+
+  Medium::close(sink);
+  Medium::close(tsSource); // also closes "esSource"
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+
+  if (argc > 1) {
+    for (int i = 1; i < argc; ++i) {
+      unsigned sinkBufferSize = (unsigned)atoi(argv[i]);
+      if (sinkBufferSize == 0) {
+	*env << "Usage: " << argv[0] << " [<sink-buffer-size> ...]\n";
+	return 1;
+      }
+      timeMultiplexor(*env, sinkBufferSize);
+    }
+  } else {
+    unsigned const defaultSinkBufferSizes[] = { 188, 1316, 65536 };
+    for (unsigned i = 0; i < sizeof defaultSinkBufferSizes/sizeof defaultSinkBufferSizes[0]; ++i) {
+      timeMultiplexor(*env, defaultSinkBufferSizes[i]);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,355 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that checks that indexing a Transport Stream file in parallel (as "MPEG2TransportStreamIndexer -j" does)
+// gives the same index file - byte for byte - as indexing it sequentially.  It does this for each of several numbers
+// of threads, for a given Transport Stream file or (by default) for synthetic H.264 and H.265 Transport Streams.
+// (The synthetic streams use both 3-byte and 4-byte start codes, have PCRs at arbitrary times - in some, but not all,
+// of the packets that begin a PES packet - and have another (non-video) stream interleaved with the video.)
+// The program's exit status is 0 iff every index file matched.
+//
+// Usage: testMPEG2TransportStreamParallelIndexing [<transport-stream-file-name>]
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "parallelIndexer.hh"
+#include "BasicUsageEnvironment.hh"
+
+#define SYNTHETIC_STREAM_SIZE (20*1000*1000) // bytes (approximately)
+#define PMT_PID 0x100
+#define VIDEO_PID 0x101
+#define OTHER_PID 0x102
+#define TABLES_INTERVAL 500 // packets
+#define PCR_INTERVAL 37 // packets
+#define PACKETS_PER_SECOND 9000.0
+#define FRAMES_PER_SECOND 30
+
+static UsageEnvironment* env;
+
+////////// Generating a synthetic Transport Stream //////////
+
+class TransportStreamWriter {
+public:
+  TransportStreamWriter(FILE* fid, Boolean isH264);
+
+  void writeAccessUnit(unsigned frameNum);
+  u_int64_t numBytesWritten() const { return fNumPackets*TRANSPORT_PACKET_SIZE; }
+
+private:
+  void writeTables();
+  void writePESPacket(unsigned char const* data, unsigned size);
+  void writePacket(u_int16_t PID, Boolean payloadUnitStart, Boolean withPCR,
+		   unsigned char const* payload, unsigned& payloadSize);
+      // writes up to "payloadSize" bytes from "payload", and sets "payloadSize" to the number written
+  void addNALUnit(u_int8_t nalUnitType, unsigned minSize, unsigned maxSize, Boolean longStartCode);
+
+private:
+  FILE* fFid;
+  Boolean fIsH264;
+  u_int64_t fNumPackets;
+  u_int64_t fNextPCRPacketNum;
+  u_int8_t fContinuityCounter[4]; // for the PAT, PMT, video, and other PIDs
+  unsigned char* fAccessUnit;
+  unsigned fAccessUnitSize;
+};
+
+static u_int32_t crc32(unsigned char const* data, unsigned size) { // as used for MPEG-2 tables
+  u_int32_t crc = 0xFFFFFFFF;
+  for (unsigned i = 0; i < size; ++i) {
+    crc ^= data[i]<<24;
+    for (unsigned j = 0; j < 8; ++j) crc = (crc&0x80000000) != 0 ? (crc<<1)^0x04C11DB7 : crc<<1;
+  }
+  return crc;
+}
+
+TransportStreamWriter::TransportStreamWriter(FILE* fid, Boolean isH264)
+  : fFid(fid), fIsH264(isH264), fNumPackets(0), fNextPCRPacketNum(0) {
+  memset(fContinuityCounter, 0, sizeof fContinuityCounter);
+  fAccessUnit = new unsigned char[200000];
+}
+
+void TransportStreamWriter::writeTables() {
+  unsigned char section[TRANSPORT_PACKET_SIZE];
+  unsigned size;
+
+  // The PAT (program 1 => the PMT):
+  unsigned char const pat[] = { 0, 0x00, 0xB0, 13, 0x00, 0x01, 0xC1, 0, 0, 0x00, 0x01, 0xE0|(PMT_PID>>8), PMT_PID&0xFF };
+  memcpy(section, pat, sizeof pat);
+  size = sizeof pat;
+  u_int32_t crc = crc32(&section[1], size-1);
+  section[size++] = crc>>24; section[size++] = crc>>16; section[size++] = crc>>8; section[size++] = crc;
+  unsigned numBytes = size;
+  writePacket(0, True, False, section, numBytes);
+
+  // The PMT (the video stream, and another stream):
+  u_int8_t const videoStreamType = fIsH264 ? 0x1B : 0x24;
+  unsigned char const pmt[] = { 0, 0x02, 0xB0, 23, 0x00, 0x01, 0xC1, 0, 0, 0xE0|(VIDEO_PID>>8), VIDEO_PID&0xFF, 0xF0, 0,
+				videoStreamType, 0xE0|(VIDEO_PID>>8), VIDEO_PID&0xFF, 0xF0, 0,
+				0x0F/*AAC audio*/, 0xE0|(OTHER_PID>>8), OTHER_PID&0xFF, 0xF0, 0 };
+  memcpy(section, pmt, sizeof pmt);
+  size = sizeof pmt;
+  crc = crc32(&section[1], size-1);
+  section[size++] = crc>>24; section[size++] = crc>>16; section[size++] = crc>>8; section[size++] = crc;
+  numBytes = size;
+  writePacket(PMT_PID, True, False, section, numBytes);
+}
+
+void TransportStreamWriter::writePacket(u_int16_t PID, Boolean payloadUnitStart, Boolean withPCR,
+					unsigned char const* payload, unsigned& payloadSize) {
+  unsigned char pkt[TRANSPORT_PACKET_SIZE];
+  unsigned headerSize = 4;
+  unsigned adaptationFieldSize = withPCR ? 8 : 0; // including its length byte
+  unsigned maxPayloadSize = TRANSPORT_PACKET_SIZE - headerSize - adaptationFieldSize;
+  if (payloadSize > maxPayloadSize) payloadSize = maxPayloadSize;
+  if (payloadSize < maxPayloadSize) {
+    // Pad the packet with 'stuffing' bytes in its adaptation field:
+    adaptationFieldSize = TRANSPORT_PACKET_SIZE - headerSize - payloadSize;
+  }
+
+  unsigned ccIndex = PID == PMT_PID ? 1 : PID == VIDEO_PID ? 2 : PID == OTHER_PID ? 3 : 0;
+  pkt[0] = 0x47;
+  pkt[1] = (payloadUnitStart ? 0x40 : 0) | (PID>>8);
+  pkt[2] = PID&0xFF;
+  pkt[3] = (adaptationFieldSize > 0 ? 0x30 : 0x10) | fContinuityCounter[ccIndex];
+  fContinuityCounter[ccIndex] = (fContinuityCounter[ccIndex]+1)&0x0F;
+
+  if (adaptationFieldSize > 0) {
+    pkt[4] = adaptationFieldSize - 1;
+    unsigned i = 5;
+    if (adaptationFieldSize > 1) {
+      pkt[i++] = withPCR ? 0x10 : 0x00;
+      if (withPCR) {
+	// The PCR is the (arbitrary) start time, plus the time at which we'd send this packet:
+	double const pcr = 1000.1234 + fNumPackets/PACKETS_PER_SECOND;
+	u_int64_t const pcr27MHz = (u_int64_t)(pcr*27000000.0);
+	u_int64_t const pcrBase = pcr27MHz/300;
+	unsigned const pcrExt = (unsigned)(pcr27MHz%300);
+	pkt[i++] = (unsigned char)(pcrBase>>25); pkt[i++] = (unsigned char)(pcrBase>>17);
+	pkt[i++] = (unsigned char)(pcrBase>>9); pkt[i++] = (unsigned char)(pcrBase>>1);
+	pkt[i++] = (unsigned char)(((pcrBase&1)<<7) | 0x7E | (pcrExt>>8)); pkt[i++] = (unsigned char)pcrExt;
+      }
+    }
+    while (i < headerSize + adaptationFieldSize) pkt[i++] = 0xFF;
+  }
+  memcpy(&pkt[headerSize + adaptationFieldSize], payload, payloadSize);
+
+  fwrite(pkt, TRANSPORT_PACKET_SIZE, 1, fFid);
+  ++fNumPackets;
+}
+
+void TransportStreamWriter::writePESPacket(unsigned char const* data, unsigned size) {
+  // Begin with a PES header (with a PTS):
+  static unsigned char pesPacket[200000 + 14];
+  u_int64_t const pts = 900000 + (u_int64_t)(fNumPackets/PACKETS_PER_SECOND*90000);
+  unsigned char const header[] = { 0, 0, 1, 0xE0, 0, 0, 0x80, 0x80, 5,
+				   (unsigned char)(0x21 | ((pts>>29)&0x0E)), (unsigned char)(pts>>22),
+				   (unsigned char)(0x01 | (pts>>14)), (unsigned char)(pts>>7),
+				   (unsigned char)(0x01 | (pts<<1)) };
+  memcpy(pesPacket, header, sizeof header);
+  memcpy(&pesPacket[sizeof header], data, size);
+  size += sizeof header;
+
+  unsigned char const* p = pesPacket;
+  Boolean payloadUnitStart = True;
+  while (size > 0) {
+    if (fNumPackets%TABLES_INTERVAL == 0) writeTables();
+    if (testRandom32()%4 == 0) {
+      // Send a packet for the other (non-video) stream:
+      unsigned char other[TRANSPORT_PACKET_SIZE];
+      for (unsigned i = 0; i < sizeof other; ++i) other[i] = (unsigned char)testRandom32();
+      unsigned numBytes = testRandom32()%2 == 0 ? 184 : 1 + testRandom32()%183;
+      writePacket(OTHER_PID, False, False, other, numBytes);
+    }
+
+    // Include a PCR if it's time to - except (sometimes) in a packet that begins a PES packet, so that some parts
+    // (for parallel indexing) will begin without one:
+    Boolean withPCR = fNumPackets >= fNextPCRPacketNum && !(payloadUnitStart && testRandom32()%2 == 0);
+    if (withPCR) fNextPCRPacketNum = fNumPackets + PCR_INTERVAL;
+
+    unsigned numBytes = size;
+    writePacket(VIDEO_PID, payloadUnitStart, withPCR, p, numBytes);
+    p += numBytes; size -= numBytes;
+    payloadUnitStart = False;
+  }
+}
+
+void TransportStreamWriter
+::addNALUnit(u_int8_t nalUnitType, unsigned minSize, unsigned maxSize, Boolean longStartCode) {
+  unsigned char* p = &fAccessUnit[fAccessUnitSize];
+  if (longStartCode) *p++ = 0;
+  *p++ = 0; *p++ = 0; *p++ = 1;
+  if (fIsH264) {
+    *p++ = 0x60 | nalUnitType;
+  } else {
+    *p++ = nalUnitType<<1; *p++ = 1;
+  }
+
+  // The rest of the NAL unit is random (non-zero, so that it contains no start codes):
+  unsigned size = minSize + testRandom32()%(maxSize - minSize + 1);
+  for (unsigned i = 0; i < size; ++i) *p++ = 1 + testRandom32()%255;
+  fAccessUnitSize = p - fAccessUnit;
+}
+
+void TransportStreamWriter::writeAccessUnit(unsigned frameNum) {
+  fAccessUnitSize = 0;
+  Boolean const isKeyFrame = frameNum%FRAMES_PER_SECOND == 0;
+  if (isKeyFrame) {
+    if (!fIsH264) addNALUnit(32/*VPS*/, 10, 20, True);
+    addNALUnit(fIsH264 ? 7/*SPS*/ : 33/*SPS*/, 10, 30, fIsH264);
+    addNALUnit(fIsH264 ? 8/*PPS*/ : 34/*PPS*/, 3, 8, testRandom32()%2 == 0);
+  }
+  if (testRandom32()%3 == 0) addNALUnit(fIsH264 ? 6/*SEI*/ : 39/*SEI*/, 5, 100, fAccessUnitSize == 0);
+  if (isKeyFrame) {
+    addNALUnit(fIsH264 ? 5/*IDR*/ : 19/*IDR*/, 5000, 100000, testRandom32()%2 == 0);
+  } else {
+    unsigned numSlices = 1 + testRandom32()%3;
+    for (unsigned i = 0; i < numSlices; ++i) {
+      addNALUnit(1/*non-IDR slice*/, 20, 20000, fAccessUnitSize == 0 || testRandom32()%2 == 0);
+    }
+  }
+
+  writePESPacket(fAccessUnit, fAccessUnitSize);
+}
+
+static Boolean writeSyntheticStream(char const* fileName, Boolean isH264) {
+  FILE* fid = fopen(fileName, "wb");
+  if (fid == NULL) return False;
+
+  TransportStreamWriter writer(fid, isH264);
+  for (unsigned frameNum = 0; writer.numBytesWritten() < SYNTHETIC_STREAM_SIZE; ++frameNum) {
+    writer.writeAccessUnit(frameNum);
+  }
+
+  fclose(fid);
+  return True;
+}
+
+////////// Indexing //////////
+
+static char doneFlag;
+static void afterPlaying(void* /*clientData*/) {
+  doneFlag = ~0;
+}
+
+static Boolean indexSequentially(char const* inputFileName, char const* outputFileName) {
+  ByteStreamFileSource* input = ByteStreamFileSource::createNew(*env, inputFileName, TRANSPORT_PACKET_SIZE);
+  if (input == NULL) return False;
+  FramedSource* indexer = MPEG2IFrameIndexFromTransportStream::createNew(*env, input);
+  MediaSink* output = FileSink::createNew(*env, outputFileName);
+  if (output == NULL) {
+    Medium::close(indexer);
+    return False;
+  }
+
+  doneFlag = 0;
+  output->startPlaying(*indexer, afterPlaying, NULL);
+  env->taskScheduler().doEventLoop(&doneFlag);
+
+  Medium::close(output);
+  Medium::close(indexer);
+  return True;
+}
+
+static unsigned char* readFile(char const* fileName, unsigned& size) {
+  size = 0;
+  FILE* fid = fopen(fileName, "rb");
+  if (fid == NULL) return NULL;
+
+  fseek(fid, 0, SEEK_END);
+  size = (unsigned)ftell(fid);
+  fseek(fid, 0, SEEK_SET);
+  unsigned char* data = new unsigned char[size + 1];
+  if (fread(data, 1, size, fid) != size) size = 0;
+  fclose(fid);
+  return data;
+}
+
+static Boolean checkParallelIndexing(char const* inputFileName) {
+  char* sequentialIndexFileName = new char[strlen(inputFileName) + 20];
+  sprintf(sequentialIndexFileName, "%s.sequential.tsx", inputFileName);
+  char* parallelIndexFileName = new char[strlen(inputFileName) + 20];
+  sprintf(parallelIndexFileName, "%s.parallel.tsx", inputFileName);
+
+  Boolean allMatched = True;
+  if (!indexSequentially(inputFileName, sequentialIndexFileName)) {
+    *env << "Failed to index \"" << inputFileName << "\"\n";
+    allMatched = False;
+  } else {
+    unsigned sequentialSize;
+    unsigned char* sequentialIndex = readFile(sequentialIndexFileName, sequentialSize);
+
+    static unsigned const numThreadsToTest[] = { 2, 3, 4, 7, 16, 64 };
+    for (unsigned t = 0; t < sizeof numThreadsToTest/sizeof numThreadsToTest[0]; ++t) {
+      unsigned const numThreads = numThreadsToTest[t];
+      unsigned parallelSize = 0;
+      unsigned char* parallelIndex = NULL;
+      if (indexInParallel(*env, inputFileName, parallelIndexFileName, numThreads)) {
+	parallelIndex = readFile(parallelIndexFileName, parallelSize);
+      }
+
+      unsigned numMatchingBytes = 0;
+      while (numMatchingBytes < sequentialSize && numMatchingBytes < parallelSize
+	     && parallelIndex[numMatchingBytes] == sequentialIndex[numMatchingBytes]) {
+	++numMatchingBytes;
+      }
+      Boolean const matched = parallelIndex != NULL && parallelSize == sequentialSize && numMatchingBytes == sequentialSize;
+      printf("\"%s\", %2u threads: %u index records (sequentially: %u): %s",
+	     inputFileName, numThreads, parallelSize/INDEX_RECORD_SIZE, sequentialSize/INDEX_RECORD_SIZE,
+	     matched ? "same" : "DIFFERENT");
+      if (!matched) printf(" (from record %u)", numMatchingBytes/INDEX_RECORD_SIZE);
+      printf("\n");
+      fflush(stdout);
+      if (!matched) allMatched = False;
+
+      delete[] parallelIndex;
+      remove(parallelIndexFileName);
+    }
+
+    delete[] sequentialIndex;
+  }
+
+  remove(sequentialIndexFileName);
+  delete[] sequentialIndexFileName; delete[] parallelIndexFileName;
+  return allMatched;
+}
+
+////////// main //////////
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  if (argc > 2) {
+    *env << "Usage: " << argv[0] << " [<transport-stream-file-name>]\n";
+    return 1;
+  }
+  if (argc == 2) return checkParallelIndexing(argv[1]) ? 0 : 1;
+
+  Boolean allMatched = True;
+  for (unsigned i = 0; i < 2; ++i) {
+    Boolean const isH264 = i == 0;
+    char const* fileName = isH264 ? "testParallelIndexing-h264.ts" : "testParallelIndexing-h265.ts";
+    if (!writeSyntheticStream(fileName, isH264)) {
+      *env << "Failed to write \"" << fileName << "\"\n";
+      return 1;
+    }
+    if (!checkParallelIndexing(fileName)) allMatched = False;
+    remove(fileName);
+  }
+
+  return allMatched ? 0 : 1;
+}
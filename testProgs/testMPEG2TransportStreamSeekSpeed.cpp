@@ -0,0 +1,114 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that measures the latency of the index file lookups that a server does when a client seeks (or starts
+// 'trick play') within an indexed Transport Stream file, using a "MPEG2TransportStreamIndexFile":
+//   - 'open': a new client opening the index file (while another client already has it open),
+//   - 'seek by time': looking up the Transport Stream packet for a (random) NPT, and
+//   - 'seek by packet': looking up the PCR for a (random) Transport Stream packet, after moving back to the previous
+//     'clean point' (as is done when trick play starts).
+// We also report a hash of the lookups' results, so that different implementations can be checked against each other.
+// (The index file - produced by "MPEG2TransportStreamIndexer" - should be in the OS's file cache, so that this
+// measures the lookups, rather than the disk.)
+//
+// Usage: testMPEG2TransportStreamSeekSpeed <index-file-name>
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+
+#define NUM_OPENS 10000
+#define NUM_SEEKS 100000 // of each kind
+
+static u_int64_t resultHash;
+static void hashResult(u_int64_t value) {
+  // FNV-1a, over the value's 8 bytes:
+  if (resultHash == 0) resultHash = 14695981039346656037ULL;
+  for (unsigned i = 0; i < 8; ++i) {
+    resultHash = (resultHash^(value&0xFF))*1099511628211ULL;
+    value >>= 8;
+  }
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+
+  if (argc != 2) {
+    *env << "Usage: " << argv[0] << " <index-file-name>\n";
+    return 1;
+  }
+  char const* indexFileName = argv[1];
+
+  MPEG2TransportStreamIndexFile* indexFile = MPEG2TransportStreamIndexFile::createNew(*env, indexFileName);
+  if (indexFile == NULL) {
+    *env << "Unable to open index file \"" << indexFileName << "\"\n";
+    return 1;
+  }
+  float const duration = indexFile->getPlayingDuration();
+  unsigned long lastTSPacketNum, lastIndexRecordNum;
+  float endNPT = duration;
+  indexFile->lookupTSPacketNumFromNPT(endNPT, lastTSPacketNum, lastIndexRecordNum);
+  printf("\"%s\": %.1f seconds, %lu Transport Stream packets\n", indexFileName, duration, lastTSPacketNum);
+  if (duration <= 0.0 || lastTSPacketNum == 0) {
+    *env << "The index file is empty\n";
+    return 1;
+  }
+
+  // 'open':
+  double startTime = timeNow();
+  for (unsigned i = 0; i < NUM_OPENS; ++i) {
+    MPEG2TransportStreamIndexFile* clientIndexFile = MPEG2TransportStreamIndexFile::createNew(*env, indexFileName);
+    if (clientIndexFile == NULL) {
+      *env << "Unable to open index file \"" << indexFileName << "\"\n";
+      return 1;
+    }
+    hashResult((u_int64_t)(clientIndexFile->getPlayingDuration()*1000.0f));
+    Medium::close(clientIndexFile);
+  }
+  double seconds = timeNow() - startTime;
+  printf("open:           %8.2f microseconds each\n", seconds*1000000.0/NUM_OPENS);
+
+  // 'seek by time':
+  seedTestRandom(1);
+  startTime = timeNow();
+  for (unsigned i = 0; i < NUM_SEEKS; ++i) {
+    float npt = duration*(testRandom32()%1000000)/1000000.0f;
+    unsigned long tsPacketNum, indexRecordNum;
+    indexFile->lookupTSPacketNumFromNPT(npt, tsPacketNum, indexRecordNum);
+    hashResult(tsPacketNum); hashResult(indexRecordNum); hashResult((u_int64_t)(npt*1000.0f));
+  }
+  seconds = timeNow() - startTime;
+  printf("seek by time:   %8.2f microseconds each\n", seconds*1000000.0/NUM_SEEKS);
+
+  // 'seek by packet':
+  startTime = timeNow();
+  for (unsigned i = 0; i < NUM_SEEKS; ++i) {
+    unsigned long tsPacketNum = testRandom32()%lastTSPacketNum;
+    float pcr;
+    unsigned long indexRecordNum;
+    indexFile->lookupPCRFromTSPacketNum(tsPacketNum, True, pcr, indexRecordNum);
+    hashResult(tsPacketNum); hashResult(indexRecordNum); hashResult((u_int64_t)(pcr*1000.0f));
+  }
+  seconds = timeNow() - startTime;
+  printf("seek by packet: %8.2f microseconds each\n", seconds*1000000.0/NUM_SEEKS);
+
+  printf("(hash of the results: %016llx)\n", (unsigned long long)resultHash);
+
+  Medium::close(indexFile);
+  return 0;
+}
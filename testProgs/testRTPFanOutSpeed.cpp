@@ -0,0 +1,148 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that measures the cost of sending a RTP stream to many unicast destinations (as a server does
+// for a stream that's shared by several clients - i.e., with "reuseFirstSource"): A "SimpleRTPSink" sends
+// packets - as fast as it can - from a 'groupsock' that has <num-destinations> destinations (each a local
+// UDP socket, that we never read).  This is done first with the groupsock's batched output turned off
+// (one "sendto()" per datagram), and then with it turned on.
+//
+// Usage: testRTPFanOutSpeed [<num-destinations> ...]
+//     (the default numbers of destinations are 1, 10, 100 and 500)
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#define TOTAL_NUM_DATAGRAMS 2000000 // for each number of destinations, and each mode
+#define PAYLOAD_SIZE 1316 // 7 Transport Stream packets
+#define RTP_PAYLOAD_TYPE 33
+
+// A source that delivers (the same) fixed-size frames, as fast as it can, until it's delivered a given number:
+class FixedFrameSource: public FramedSource {
+public:
+  FixedFrameSource(UsageEnvironment& env, unsigned numFrames)
+    : FramedSource(env), fNumFramesLeft(numFrames) {
+    for (unsigned i = 0; i < sizeof fFrame; ++i) fFrame[i] = (unsigned char)testRandom32();
+  }
+
+private: // redefined virtual functions
+  virtual void doGetNextFrame() {
+    if (fNumFramesLeft == 0) {
+      handleClosure();
+      return;
+    }
+    --fNumFramesLeft;
+
+    fFrameSize = sizeof fFrame;
+    if (fFrameSize > fMaxSize) {
+      fNumTruncatedBytes = fFrameSize - fMaxSize;
+      fFrameSize = fMaxSize;
+    } else {
+      fNumTruncatedBytes = 0;
+    }
+    memmove(fTo, fFrame, fFrameSize);
+    gettimeofday(&fPresentationTime, NULL);
+    fDurationInMicroseconds = 0;
+
+    FramedSource::afterGetting(this); // we deliver immediately
+  }
+
+private:
+  unsigned fNumFramesLeft;
+  unsigned char fFrame[PAYLOAD_SIZE];
+};
+
+static char doneFlag;
+static void afterPlaying(void* /*clientData*/) {
+  doneFlag = ~0;
+}
+
+// Sends TOTAL_NUM_DATAGRAMS datagrams (in all) to the destinations, returning the time taken:
+static double sendToDestinations(UsageEnvironment& env, Groupsock& groupsock, unsigned numDestinations) {
+  FixedFrameSource* source = new FixedFrameSource(env, TOTAL_NUM_DATAGRAMS/numDestinations);
+  RTPSink* sink = SimpleRTPSink::createNew(env, &groupsock, RTP_PAYLOAD_TYPE, 90000, "video", "MP2T",
+					   1, False/*one frame per packet*/);
+
+  doneFlag = 0;
+  double startTime = timeNow();
+  sink->startPlaying(*source, afterPlaying, NULL);
+  env.taskScheduler().doEventLoop(&doneFlag);
+  groupsock.flushOutputBatch();
+  double seconds = timeNow() - startTime;
+
+  Medium::close(sink);
+  Medium::close(source);
+  return seconds;
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+
+  static unsigned const defaultNumDestinations[] = { 1, 10, 100, 500 };
+  unsigned const numDefaults = sizeof defaultNumDestinations/sizeof defaultNumDestinations[0];
+  unsigned const numConfigs = argc > 1 ? (unsigned)(argc-1) : numDefaults;
+
+  for (unsigned c = 0; c < numConfigs; ++c) {
+    unsigned const numDestinations = argc > 1 ? (unsigned)atoi(argv[c+1]) : defaultNumDestinations[c];
+    if (numDestinations == 0 || numDestinations > TOTAL_NUM_DATAGRAMS) {
+      *env << "Usage: " << argv[0] << " [<num-destinations> ...]\n";
+      return 1;
+    }
+
+    // Create the receiving sockets (which we never read; the kernel drops whatever doesn't fit in their buffers):
+    int* receivers = new int[numDestinations];
+    struct in_addr loopbackAddr; loopbackAddr.s_addr = htonl(INADDR_LOOPBACK);
+    struct in_addr dummyAddr; dummyAddr.s_addr = 0;
+    Groupsock groupsock(*env, dummyAddr, 0, 255);
+    groupsock.removeAllDestinations();
+    unsigned i;
+    for (i = 0; i < numDestinations; ++i) {
+      receivers[i] = socket(AF_INET, SOCK_DGRAM, 0);
+      MAKE_SOCKADDR_IN(name, loopbackAddr.s_addr, 0);
+      SOCKLEN_T nameLen = sizeof name;
+      if (receivers[i] < 0 || bind(receivers[i], (struct sockaddr*)&name, sizeof name) != 0
+	  || getsockname(receivers[i], (struct sockaddr*)&name, &nameLen) != 0) {
+	*env << "Failed to create a receiving socket: " << strerror(errno) << "\n";
+	return 1;
+      }
+      groupsock.addDestination(loopbackAddr, Port(ntohs(name.sin_port)), i+1);
+    }
+    increaseSendBufferTo(*env, groupsock.socketNum(), 1024*1024);
+
+    double unbatchedSeconds = sendToDestinations(*env, groupsock, numDestinations);
+
+    groupsock.setOutputBatching(True);
+    double batchedSeconds = sendToDestinations(*env, groupsock, numDestinations);
+    unsigned const numDatagramsSent = (TOTAL_NUM_DATAGRAMS/numDestinations)*numDestinations;
+
+    printf("%u destinations: unbatched: %u send calls, %.0f datagrams/second; batched: %u send calls (up to %u datagrams each), %.0f datagrams/second\n",
+	   numDestinations, numDatagramsSent, numDatagramsSent/unbatchedSeconds,
+	   groupsock.numBatchSendCalls(), groupsock.maxBatchSize(), numDatagramsSent/batchedSeconds);
+
+    groupsock.setOutputBatching(False);
+    for (i = 0; i < numDestinations; ++i) close(receivers[i]);
+    delete[] receivers;
+  }
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that measures the throughput of receiving RTP-over-TCP (i.e., 'interleaved') data:
+// A child process writes '$'-framed RTP packets (of a given payload size) into one end of a
+// socket pair, as fast as it can.  We receive them - using a "SimpleRTPSource" that reads from the
+// other end (as a RTSP client would, after "setStreamSocket()") - into a sink that counts (and
+// hashes) the payload data.
+//
+// Usage: testRTPOverTCPSpeed [<payload-size> ...]
+//     (the default payload sizes are 1316, 8000 and 60000 bytes; the maximum is 65523 bytes)
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define TOTAL_PAYLOAD_BYTES 400000000 // per payload size
+#define RTP_HEADER_SIZE 12
+#define STREAM_CHANNEL_ID 0
+#define RTP_PAYLOAD_TYPE 33 // MPEG-2 Transport Stream (although we don't care what the payload is)
+
+// A sink that hashes just the start (the sequence number) and the last byte of each payload, to save time:
+class PayloadHashingSink: public SpeedTestSink {
+public:
+  PayloadHashingSink(UsageEnvironment& env, u_int64_t numBytesExpected)
+    : SpeedTestSink(env, 65536, numBytesExpected) {
+  }
+
+private: // redefined virtual functions
+  virtual void hashFrame(unsigned char const* frame, unsigned frameSize, unsigned /*numTruncatedBytes*/) {
+    if (frameSize < 4) return;
+    hashBytes(frame, 4);
+    hashBytes(&frame[frameSize-1], 1);
+  }
+};
+
+// Writes "numPackets" '$'-framed RTP packets - each with "payloadSize" bytes of payload - to "socketNum":
+static void writePackets(int socketNum, unsigned payloadSize, unsigned numPackets) {
+  // Assemble (and then write) as many packets as fit in a 256 KByte buffer at a time:
+  unsigned const framedPacketSize = 4 + RTP_HEADER_SIZE + payloadSize;
+  unsigned const packetsPerWrite = framedPacketSize > 256*1024 ? 1 : 256*1024/framedPacketSize;
+  unsigned char* buffer = new unsigned char[packetsPerWrite*framedPacketSize];
+  u_int32_t seqNum = 0;
+
+  while (seqNum < numPackets) {
+    unsigned char* ptr = buffer;
+    unsigned i;
+    for (i = 0; i < packetsPerWrite && seqNum < numPackets; ++i, ++seqNum) {
+      unsigned const packetSize = RTP_HEADER_SIZE + payloadSize;
+      *ptr++ = '$'; *ptr++ = STREAM_CHANNEL_ID; *ptr++ = packetSize>>8; *ptr++ = (unsigned char)packetSize;
+
+      // The RTP header:
+      u_int32_t const timestamp = seqNum*3000;
+      *ptr++ = 0x80; *ptr++ = RTP_PAYLOAD_TYPE; *ptr++ = (unsigned char)(seqNum>>8); *ptr++ = (unsigned char)seqNum;
+      *ptr++ = timestamp>>24; *ptr++ = timestamp>>16; *ptr++ = timestamp>>8; *ptr++ = (unsigned char)timestamp;
+      *ptr++ = 0x12; *ptr++ = 0x34; *ptr++ = 0x56; *ptr++ = 0x78; // SSRC
+
+      // The payload: the sequence number, then filler:
+      *ptr++ = seqNum>>24; *ptr++ = seqNum>>16; *ptr++ = seqNum>>8; *ptr++ = (unsigned char)seqNum;
+      memset(ptr, (unsigned char)seqNum, payloadSize - 4);
+      ptr += payloadSize - 4;
+    }
+
+    unsigned char const* from = buffer;
+    while (from < ptr) {
+      ssize_t numWritten = write(socketNum, from, ptr - from);
+      if (numWritten <= 0) { delete[] buffer; return; } // the reader has gone away
+      from += numWritten;
+    }
+  }
+  delete[] buffer;
+}
+
+static void timeRTPOverTCP(UsageEnvironment& env, unsigned payloadSize) {
+  unsigned const numPackets = TOTAL_PAYLOAD_BYTES/payloadSize;
+
+  int sockets[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0) {
+    env << "socketpair() failed: " << env.getResultMsg() << "\n";
+    exit(1);
+  }
+  pid_t writerPid = fork();
+  if (writerPid < 0) {
+    env << "fork() failed\n";
+    exit(1);
+  } else if (writerPid == 0) {
+    // We're the child (writer) process:
+    close(sockets[0]);
+    writePackets(sockets[1], payloadSize, numPackets);
+    close(sockets[1]);
+    _exit(0);
+  }
+  close(sockets[1]);
+  makeSocketNonBlocking(sockets[0]);
+
+  // Receive the packets (ignoring the datagram socket that every "RTPSource" also has):
+  struct in_addr localAddress;
+  localAddress.s_addr = our_inet_addr("127.0.0.1");
+  Groupsock* rtpGroupsock = new Groupsock(env, localAddress, Port(0), 255);
+  RTPSource* rtpSource = SimpleRTPSource::createNew(env, rtpGroupsock, RTP_PAYLOAD_TYPE, 90000, "video/MP2T", 0, False);
+    // (each packet is a complete frame)
+  rtpSource->setStreamSocket(sockets[0], STREAM_CHANNEL_ID);
+  SpeedTestSink* sink = new PayloadHashingSink(env, (u_int64_t)numPackets*payloadSize);
+
+  double seconds = sink->playFrom(*rtpSource);
+  printf("payload size %5u bytes: %llu packets, %llu bytes, %.0f MBytes/second, %.0f packets/second (hash %016llx)\n",
+	 payloadSize, (unsigned long long)sink->numFrames(), (unsigned long long)sink->numBytes(),
+	 sink->numBytes()/seconds/1000000.0, sink->numFrames()/seconds, (unsigned long long)sink->hash());
+
+  Medium::close(sink);
+  Medium::close(rtpSource);
+  delete rtpGroupsock;
+  close(sockets[0]);
+  waitpid(writerPid, NULL, 0);
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+  signal(SIGPIPE, SIG_IGN);
+
+  if (argc > 1) {
+    for (int i = 1; i < argc; ++i) {
+      unsigned payloadSize = (unsigned)atoi(argv[i]);
+      if (payloadSize < 4 || payloadSize > 65535 - RTP_HEADER_SIZE) {
+	*env << "Usage: " << argv[0] << " [<payload-size> ...]\n";
+	return 1;
+      }
+      timeRTPOverTCP(*env, payloadSize);
+    }
+  } else {
+    unsigned const defaultPayloadSizes[] = { 1316, 8000, 60000 };
+    for (unsigned i = 0; i < sizeof defaultPayloadSizes/sizeof defaultPayloadSizes[0]; ++i) {
+      timeRTPOverTCP(*env, defaultPayloadSizes[i]);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,247 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that measures the cost of packetizing - and sending - H.264 or H.265 video, with and without
+// 'zero-copy' packetization (see "MultiFramedRTPSink::setZeroCopyPacketization()"): Synthetic NAL units
+// (of random sizes, many of them too large for a single packet) are delivered from memory - through a
+// "H264VideoStreamDiscreteFramer" (or "H265VideoStreamDiscreteFramer") - to a "H264VideoRTPSink" (or
+// "H265VideoRTPSink"), which sends them - as fast as it can - to a local UDP socket.  For each mode, we report
+// how many of the payload bytes the sink copied into its output buffer, and the throughput.  We also read
+// (and hash) the packets that were sent, to check that both modes send the same data.
+//
+// Usage: testRTPPacketizationSpeed [-s <size-in-MBytes>] [h264|h265]
+//     -s: the total size of the NAL units that are sent in each mode (default: 200)
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#define MAX_NAL_UNIT_SIZE 100000
+#define RTP_HEADER_SIZE 12
+#define RTP_PAYLOAD_TYPE 96
+#define RECEIVE_BUFFER_SIZE (4*1024*1024)
+
+////////// Synthetic input //////////
+
+// A set of NAL units (without start codes), held in memory:
+class NALUnits {
+public:
+  NALUnits(Boolean isH264, unsigned numMBytes);
+  ~NALUnits();
+
+  unsigned numNALUnits() const { return fNumNALUnits; }
+  unsigned char const* nalUnit(unsigned i) const { return &fData[fOffsets[i]]; }
+  unsigned nalUnitSize(unsigned i) const { return fOffsets[i+1] - fOffsets[i]; }
+
+private:
+  unsigned char* fData;
+  unsigned* fOffsets; // "fNumNALUnits"+1 of them
+  unsigned fNumNALUnits;
+};
+
+NALUnits::NALUnits(Boolean isH264, unsigned numMBytes) {
+  unsigned const totalSize = numMBytes*1000000;
+  fData = new unsigned char[totalSize + MAX_NAL_UNIT_SIZE];
+  fOffsets = new unsigned[totalSize/2 + 2]; // enough, because each NAL unit has at least 2 bytes
+
+  unsigned size = 0;
+  for (fNumNALUnits = 0; size < totalSize; ++fNumNALUnits) {
+    fOffsets[fNumNALUnits] = size;
+
+    // Mostly small or medium NAL units; sometimes large ones (that get fragmented):
+    unsigned nalUnitSize;
+    switch (testRandom32()%4) {
+      case 0: { nalUnitSize = 2 + testRandom32()%38; break; }
+      case 1: { nalUnitSize = 100 + testRandom32()%2900; break; }
+      case 2: { nalUnitSize = 5000 + testRandom32()%(MAX_NAL_UNIT_SIZE - 5000); break; }
+      default: { nalUnitSize = 1000; break; }
+    }
+
+    unsigned char* nalUnit = &fData[size];
+    for (unsigned i = 0; i < nalUnitSize; ++i) nalUnit[i] = (unsigned char)testRandom32();
+    // Use only 'slice' NAL unit types, so that the framer doesn't try to parse any (random) parameter sets:
+    if (isH264) {
+      nalUnit[0] = 0x60|(testRandom32()%2 == 0 ? 1 : 5);
+    } else {
+      nalUnit[0] = (testRandom32()%2 == 0 ? 1 : 19)<<1;
+      nalUnit[1] = 1;
+    }
+
+    size += nalUnitSize;
+  }
+  fOffsets[fNumNALUnits] = size;
+}
+
+NALUnits::~NALUnits() {
+  delete[] fOffsets;
+  delete[] fData;
+}
+
+// A source that delivers each of a set of NAL units, as fast as it can:
+class NALUnitSource: public FramedSource {
+public:
+  NALUnitSource(UsageEnvironment& env, NALUnits const& nalUnits)
+    : FramedSource(env), fNALUnits(nalUnits), fNextNALUnit(0) {
+  }
+
+private: // redefined virtual functions
+  virtual void doGetNextFrame() {
+    if (fNextNALUnit == fNALUnits.numNALUnits()) {
+      handleClosure();
+      return;
+    }
+
+    fFrameSize = fNALUnits.nalUnitSize(fNextNALUnit);
+    if (fFrameSize > fMaxSize) {
+      fNumTruncatedBytes = fFrameSize - fMaxSize;
+      fFrameSize = fMaxSize;
+    } else {
+      fNumTruncatedBytes = 0;
+    }
+    memmove(fTo, fNALUnits.nalUnit(fNextNALUnit), fFrameSize);
+    ++fNextNALUnit;
+    gettimeofday(&fPresentationTime, NULL);
+    fDurationInMicroseconds = 0;
+
+    FramedSource::afterGetting(this); // we deliver immediately
+  }
+
+private:
+  NALUnits const& fNALUnits;
+  unsigned fNextNALUnit;
+};
+
+////////// Receiving (and hashing) the packets //////////
+
+struct Receiver {
+  int socketNum;
+  u_int64_t numPackets, numPayloadBytes;
+  u_int64_t hash;
+};
+
+static void readPackets(void* clientData, int /*mask*/) {
+  Receiver* receiver = (Receiver*)clientData;
+  unsigned char packet[65536];
+  int packetSize;
+  while ((packetSize = recv(receiver->socketNum, packet, sizeof packet, MSG_DONTWAIT)) >= 0) {
+    ++receiver->numPackets;
+    if (packetSize > RTP_HEADER_SIZE) receiver->numPayloadBytes += packetSize - RTP_HEADER_SIZE;
+    // Hash the packet's size, its RTP marker bit, and the start and end of its payload.  (The rest of the RTP
+    // header - e.g., its sequence number and timestamp - is different each time.  We don't hash all of the
+    // payload, because that would take longer than the packetization that we're trying to measure.)
+    u_int64_t hash = (receiver->hash ^ packetSize)*1099511628211ULL;
+    if (packetSize > 1) hash = (hash ^ (packet[1]&0x80))*1099511628211ULL;
+    for (int i = RTP_HEADER_SIZE; i < packetSize; ++i) {
+      if (i == RTP_HEADER_SIZE + 8 && packetSize > RTP_HEADER_SIZE + 16) i = packetSize - 8; // skip the middle
+      hash = (hash ^ packet[i])*1099511628211ULL;
+    }
+    receiver->hash = hash;
+  }
+}
+
+////////// main //////////
+
+static char doneFlag;
+static void afterPlaying(void* /*clientData*/) {
+  doneFlag = ~0;
+}
+
+static void sendNALUnits(UsageEnvironment& env, Groupsock& groupsock, Boolean isH264, NALUnits const& nalUnits,
+			 Receiver& receiver, Boolean zeroCopy) {
+  FramedSource* source = new NALUnitSource(env, nalUnits);
+  FramedSource* framer;
+  MultiFramedRTPSink* sink;
+  if (isH264) {
+    framer = H264VideoStreamDiscreteFramer::createNew(env, source);
+    sink = H264VideoRTPSink::createNew(env, &groupsock, RTP_PAYLOAD_TYPE);
+  } else {
+    framer = H265VideoStreamDiscreteFramer::createNew(env, source);
+    sink = H265VideoRTPSink::createNew(env, &groupsock, RTP_PAYLOAD_TYPE);
+  }
+  sink->setZeroCopyPacketization(zeroCopy);
+
+  receiver.numPackets = receiver.numPayloadBytes = 0;
+  receiver.hash = 14695981039346656037ULL;
+  doneFlag = 0;
+  double startTime = timeNow();
+  sink->startPlaying(*framer, afterPlaying, NULL);
+  env.taskScheduler().doEventLoop(&doneFlag);
+  double seconds = timeNow() - startTime;
+  readPackets(&receiver, 0); // in case any packets are still waiting to be read
+
+  // (We count the packets - and payload bytes - that we received.  There's no loss, because we read the packets
+  // as they're sent, in the same event loop.)
+  u_int64_t const numPayloadBytes = receiver.numPayloadBytes;
+  u_int64_t const numBytesCopied = numPayloadBytes - sink->numPayloadBytesSentInPlace();
+  printf("zero-copy %-3s: %llu packets, %llu payload bytes, %llu (%.1f%%) of them copied into the sink's buffer: %.1f MBytes/second (hash %016llx)\n",
+	 zeroCopy ? "on" : "off", (unsigned long long)receiver.numPackets, (unsigned long long)numPayloadBytes,
+	 (unsigned long long)numBytesCopied, numPayloadBytes == 0 ? 0.0 : numBytesCopied*100.0/numPayloadBytes,
+	 numPayloadBytes/seconds/1000000.0, (unsigned long long)receiver.hash);
+
+  Medium::close(sink);
+  Medium::close(framer); // also closes "source"
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+  char const* progName = argv[0];
+
+  unsigned numMBytes = 200;
+  if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+    numMBytes = (unsigned)atoi(argv[2]);
+    argc -= 2; argv += 2;
+  }
+  if (argc > 2 || numMBytes == 0 || numMBytes > 1000
+      || (argc == 2 && strcmp(argv[1], "h264") != 0 && strcmp(argv[1], "h265") != 0)) {
+    *env << "Usage: " << progName << " [-s <size-in-MBytes>] [h264|h265]\n";
+    return 1;
+  }
+  Boolean const isH264 = argc < 2 || strcmp(argv[1], "h264") == 0;
+  NALUnits nalUnits(isH264, numMBytes);
+
+  // Create the receiving socket:
+  Receiver receiver;
+  receiver.socketNum = socket(AF_INET, SOCK_DGRAM, 0);
+  struct in_addr loopbackAddr; loopbackAddr.s_addr = htonl(INADDR_LOOPBACK);
+  MAKE_SOCKADDR_IN(name, loopbackAddr.s_addr, 0);
+  SOCKLEN_T nameLen = sizeof name;
+  if (receiver.socketNum < 0 || bind(receiver.socketNum, (struct sockaddr*)&name, sizeof name) != 0
+      || getsockname(receiver.socketNum, (struct sockaddr*)&name, &nameLen) != 0) {
+    *env << "Failed to create the receiving socket: " << strerror(errno) << "\n";
+    return 1;
+  }
+  setReceiveBufferTo(*env, receiver.socketNum, RECEIVE_BUFFER_SIZE);
+  env->taskScheduler().setBackgroundHandling(receiver.socketNum, SOCKET_READABLE, readPackets, &receiver);
+
+  // Create the 'groupsock' that sends to it:
+  struct in_addr dummyAddr; dummyAddr.s_addr = 0;
+  Groupsock groupsock(*env, dummyAddr, 0, 255);
+  groupsock.removeAllDestinations();
+  groupsock.addDestination(loopbackAddr, Port(ntohs(name.sin_port)), 1);
+
+  sendNALUnits(*env, groupsock, isH264, nalUnits, receiver, False);
+  sendNALUnits(*env, groupsock, isH264, nalUnits, receiver, True);
+
+  env->taskScheduler().turnOffBackgroundReadHandling(receiver.socketNum);
+  close(receiver.socketNum);
+  return 0;
+}
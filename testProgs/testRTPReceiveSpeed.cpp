@@ -0,0 +1,187 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that measures the CPU cost of receiving RTP over UDP: A child process sends RTP packets to a
+// local UDP port - in bursts, with pauses between them to keep the rate below what we can handle.  We receive them - using a
+// "SimpleRTPSource" - into a sink that counts them, and report the CPU time that we used per packet.
+// This is done for each given 'maximum number of packets per read' (see "setMaxPacketsPerRead()").
+// We also report the use of the (shared) "PacketBufferPool" that incoming packets are read into.
+//
+// Usage: testRTPReceiveSpeed [<max-packets-per-read> ...]
+//     (the defaults are 1, 8 and 64)
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define NUM_PACKETS 500000 // for each test
+#define PAYLOAD_SIZE 1316 // 7 Transport Stream packets
+#define PACKETS_PER_BURST 32
+#define USECS_BETWEEN_BURSTS 300 // (so at most about 100000 packets/second)
+#define RTP_HEADER_SIZE 12
+#define RTP_PAYLOAD_TYPE 33
+#define FIRST_RECEIVER_PORT 56000
+#define RECEIVE_BUFFER_SIZE (4*1024*1024)
+
+// A sink that hashes just the start of each payload, so that the hashing doesn't hide the cost of the reception itself:
+class PayloadStartHashingSink: public SpeedTestSink {
+public:
+  PayloadStartHashingSink(UsageEnvironment& env, u_int64_t numBytesExpected)
+    : SpeedTestSink(env, 65536, numBytesExpected) {
+  }
+
+private: // redefined virtual functions
+  virtual void hashFrame(unsigned char const* frame, unsigned frameSize, unsigned /*numTruncatedBytes*/) {
+    hashBytes(frame, frameSize < 4 ? frameSize : 4);
+  }
+};
+
+// Sends "numPackets" RTP packets to "port" on the local host.  (Each burst is sent using a single system call, where
+// possible, so that - even on a single core - the packets in a burst all arrive before we get to read any of them.)
+static void sendPackets(UsageEnvironment& env, portNumBits port, unsigned numPackets) {
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if (sock < 0) return;
+
+  unsigned char packets[PACKETS_PER_BURST][RTP_HEADER_SIZE + PAYLOAD_SIZE];
+  unsigned char* buffers[PACKETS_PER_BURST];
+  unsigned bufferSizes[PACKETS_PER_BURST];
+  struct sockaddr_in destAddresses[PACKETS_PER_BURST];
+  MAKE_SOCKADDR_IN(destAddr, htonl(INADDR_LOOPBACK), htons(port));
+  unsigned i;
+  for (i = 0; i < PACKETS_PER_BURST; ++i) {
+    memset(packets[i], 0, sizeof packets[i]);
+    packets[i][0] = 0x80; packets[i][1] = RTP_PAYLOAD_TYPE;
+    packets[i][8] = 0x12; packets[i][9] = 0x34; packets[i][10] = 0x56; packets[i][11] = 0x78; // SSRC
+    buffers[i] = packets[i];
+    bufferSizes[i] = sizeof packets[i];
+    destAddresses[i] = destAddr;
+  }
+
+  u_int32_t seqNum = 0;
+  while (seqNum < numPackets) {
+    for (i = 0; i < PACKETS_PER_BURST && seqNum < numPackets; ++i, ++seqNum) {
+      u_int32_t const timestamp = seqNum*3000;
+      unsigned char* packet = packets[i];
+      packet[2] = (unsigned char)(seqNum>>8); packet[3] = (unsigned char)seqNum;
+      packet[4] = timestamp>>24; packet[5] = timestamp>>16; packet[6] = timestamp>>8; packet[7] = (unsigned char)timestamp;
+    }
+
+    unsigned numSendCalls;
+    writeSocketBatch(env, sock, destAddresses, buffers, bufferSizes, i, numSendCalls);
+    usleep(USECS_BETWEEN_BURSTS);
+  }
+  close(sock);
+}
+
+static double cpuSecondsUsed() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec/1000000.0
+    + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec/1000000.0;
+}
+
+// A 'watchdog' that stops the sink once the sender has exited, and no more packets have arrived for a while:
+struct Watchdog {
+  SpeedTestSink* sink;
+  pid_t senderPid;
+  Boolean senderHasExited;
+  u_int64_t numFramesLastTime;
+};
+
+static void checkWatchdog(void* clientData) {
+  Watchdog* watchdog = (Watchdog*)clientData;
+  if (!watchdog->senderHasExited) {
+    watchdog->senderHasExited = waitpid(watchdog->senderPid, NULL, WNOHANG) == watchdog->senderPid;
+  }
+  if (watchdog->senderHasExited && watchdog->sink->numFrames() == watchdog->numFramesLastTime) {
+    watchdog->sink->stop();
+    return;
+  }
+
+  watchdog->numFramesLastTime = watchdog->sink->numFrames();
+  watchdog->sink->envir().taskScheduler().scheduleDelayedTask(200000, checkWatchdog, watchdog);
+}
+
+static void timeRTPReception(UsageEnvironment& env, unsigned maxPacketsPerRead) {
+  // Create a socket to receive on:
+  struct in_addr dummyAddr; dummyAddr.s_addr = 0;
+  Groupsock* rtpGroupsock = NULL;
+  portNumBits port;
+  {
+    NoReuse dummy(env); // ensures that we skip over ports that are already in use
+    for (port = FIRST_RECEIVER_PORT; ; ++port) {
+      rtpGroupsock = new Groupsock(env, dummyAddr, Port(port), 255);
+      if (rtpGroupsock->socketNum() >= 0) break;
+      delete rtpGroupsock;
+    }
+  }
+  setReceiveBufferTo(env, rtpGroupsock->socketNum(), RECEIVE_BUFFER_SIZE);
+  RTPSource* rtpSource = SimpleRTPSource::createNew(env, rtpGroupsock, RTP_PAYLOAD_TYPE, 90000, "video/MP2T", 0, False);
+    // (each packet is a complete frame)
+  rtpSource->setMaxPacketsPerRead(maxPacketsPerRead);
+  SpeedTestSink* sink = new PayloadStartHashingSink(env, (u_int64_t)NUM_PACKETS*PAYLOAD_SIZE);
+
+  pid_t senderPid = fork();
+  if (senderPid < 0) {
+    env << "fork() failed\n";
+    exit(1);
+  } else if (senderPid == 0) {
+    // We're the child (sender) process:
+    sendPackets(env, port, NUM_PACKETS);
+    _exit(0);
+  }
+
+  Watchdog watchdog = { sink, senderPid, False, 0 };
+  TaskToken watchdogTask = env.taskScheduler().scheduleDelayedTask(200000, checkWatchdog, &watchdog);
+  double startCPUSeconds = cpuSecondsUsed();
+  double seconds = sink->playFrom(*rtpSource);
+  double cpuSeconds = cpuSecondsUsed() - startCPUSeconds;
+  env.taskScheduler().unscheduleDelayedTask(watchdogTask);
+  if (!watchdog.senderHasExited) waitpid(senderPid, NULL, 0);
+
+  u_int64_t const numPackets = sink->numFrames();
+  printf("up to %2u packets per read: %llu packets received (%llu lost) in %.2f seconds, %.2f us of CPU time per packet\n",
+	 maxPacketsPerRead, (unsigned long long)numPackets, (unsigned long long)(NUM_PACKETS - numPackets),
+	 seconds, numPackets == 0 ? 0.0 : cpuSeconds*1000000.0/numPackets);
+  fflush(stdout);
+  PacketBufferPool* pool = PacketBufferPool::lookup(env);
+  if (pool != NULL) pool->printStatistics(env); // (the buffers that the received packets were read into)
+
+  Medium::close(sink);
+  Medium::close(rtpSource);
+  delete rtpGroupsock;
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+
+  if (argc > 1) {
+    for (int i = 1; i < argc; ++i) timeRTPReception(*env, (unsigned)atoi(argv[i]));
+  } else {
+    timeRTPReception(*env, 1);
+    timeRTPReception(*env, 8);
+    timeRTPReception(*env, 64);
+  }
+
+  return 0;
+}
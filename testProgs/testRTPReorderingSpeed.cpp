@@ -0,0 +1,311 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that measures the CPU cost of receiving RTP packets that arrive out of order (i.e., the cost of
+// putting them back in order), by replaying 'reordering traces': A child process sends RTP packets to a local UDP
+// port, in the order given by a trace.  We receive them - using a "SimpleRTPSource" - into a sink that checks
+// that they're delivered in order, and report the CPU time that we used per packet.
+// By default, we replay several synthetic traces (in which no packets are lost).  Alternatively, a trace file can be
+// given: This contains (whitespace-separated) packet numbers (starting from 0), in the order in which the packets
+// are to be sent; any packet numbers that are missing are lost.  The trace is repeated as often as necessary.
+// (Note that after a packet is lost, the packets that follow it are held back for up to the 'packet reordering threshold
+// time' (see "setPacketReorderingThresholdTime()").  Those still being held back when the sender finishes are never
+// delivered, so with such a trace, fewer packets are received than were sent.)
+//
+// Usage: testRTPReorderingSpeed [<trace-file-name>]
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define NUM_PACKETS 300000 // for each test (so the RTP sequence number wraps around several times)
+#define PAYLOAD_SIZE 1316 // 7 Transport Stream packets
+#define PACKETS_PER_BURST 32
+#define USECS_BETWEEN_BURSTS 300 // (so at most about 100000 packets/second)
+#define RTP_HEADER_SIZE 12
+#define RTP_PAYLOAD_TYPE 33
+#define FIRST_RECEIVER_PORT 56000
+#define RECEIVE_BUFFER_SIZE (4*1024*1024)
+
+// A sink that checks that packets are delivered in order.  (Each packet's payload begins with its (32-bit) packet
+// number.)  It hashes just the start of each payload, so that the hashing doesn't hide the cost of the reception itself:
+class OrderCheckingSink: public SpeedTestSink {
+public:
+  OrderCheckingSink(UsageEnvironment& env, u_int64_t numBytesExpected)
+    : SpeedTestSink(env, 65536, numBytesExpected), fHaveSeenPacket(False), fLastPacketNum(0), fNumOutOfOrder(0) {
+  }
+
+  u_int64_t numOutOfOrder() const { return fNumOutOfOrder; }
+
+private: // redefined virtual functions
+  virtual void hashFrame(unsigned char const* frame, unsigned frameSize, unsigned /*numTruncatedBytes*/) {
+    if (frameSize < 4) return;
+    u_int32_t packetNum = (frame[0]<<24)|(frame[1]<<16)|(frame[2]<<8)|frame[3];
+    if (fHaveSeenPacket && packetNum <= fLastPacketNum) ++fNumOutOfOrder;
+    fHaveSeenPacket = True;
+    fLastPacketNum = packetNum;
+    hashBytes(frame, 4);
+  }
+
+private:
+  Boolean fHaveSeenPacket;
+  u_int32_t fLastPacketNum;
+  u_int64_t fNumOutOfOrder;
+};
+
+////////// Reordering traces //////////
+
+// A trace is the order in which packet numbers are sent (perhaps with some missing):
+struct Trace {
+  char const* name;
+  u_int32_t* packetNums;
+  unsigned numEntries;
+};
+
+static Trace inOrderTrace() {
+  Trace trace = { "in order", new u_int32_t[NUM_PACKETS], NUM_PACKETS };
+  for (unsigned i = 0; i < NUM_PACKETS; ++i) trace.packetNums[i] = i;
+  return trace;
+}
+
+static Trace adjacentSwapsTrace() {
+  // 5% of the packets arrive just after the packet that follows them:
+  Trace trace = inOrderTrace();
+  trace.name = "5% adjacent swaps";
+  for (unsigned i = 0; i+1 < NUM_PACKETS; ++i) {
+    if (testRandom32()%20 == 0) {
+      u_int32_t tmp = trace.packetNums[i]; trace.packetNums[i] = trace.packetNums[i+1]; trace.packetNums[i+1] = tmp;
+      ++i;
+    }
+  }
+  return trace;
+}
+
+static int compareKeys(void const* a, void const* b) {
+  u_int64_t keyA = *(u_int64_t const*)a, keyB = *(u_int64_t const*)b;
+  return keyA < keyB ? -1 : keyA > keyB ? 1 : 0;
+}
+
+static Trace jitterTrace(char const* name, unsigned window) {
+  // Each packet (except the first, so that it's still sent first) is delayed by a random number of packet times,
+  // from 0 up to "window":
+  Trace trace = { name, new u_int32_t[NUM_PACKETS], NUM_PACKETS };
+  u_int64_t* keys = new u_int64_t[NUM_PACKETS];
+  unsigned i;
+  keys[0] = 0;
+  for (i = 1; i < NUM_PACKETS; ++i) keys[i] = ((u_int64_t)(i + testRandom32()%(window+1))<<32) | i;
+  qsort(keys, NUM_PACKETS, sizeof keys[0], compareKeys);
+  for (i = 0; i < NUM_PACKETS; ++i) trace.packetNums[i] = (u_int32_t)keys[i];
+  delete[] keys;
+  return trace;
+}
+
+static Boolean readTraceFile(UsageEnvironment& env, char const* fileName, Trace& trace) {
+  FILE* fid = fopen(fileName, "r");
+  if (fid == NULL) {
+    env << "Unable to open trace file \"" << fileName << "\"\n";
+    return False;
+  }
+
+  // Read the trace file's packet numbers:
+  unsigned size = 1000;
+  u_int32_t* fileNums = new u_int32_t[size];
+  unsigned numFileNums = 0, period = 0;
+  unsigned long num;
+  while (fscanf(fid, "%lu", &num) == 1) {
+    if (numFileNums == size) {
+      u_int32_t* newFileNums = new u_int32_t[2*size];
+      memcpy(newFileNums, fileNums, size*sizeof fileNums[0]);
+      delete[] fileNums; fileNums = newFileNums; size *= 2;
+    }
+    fileNums[numFileNums++] = (u_int32_t)num;
+    if (num >= period) period = (unsigned)num + 1;
+  }
+  fclose(fid);
+  if (numFileNums == 0) {
+    env << "Trace file \"" << fileName << "\" contains no packet numbers\n";
+    delete[] fileNums;
+    return False;
+  }
+
+  // Then repeat them (each time, for the next "period" packets), until we have enough:
+  trace.name = fileName;
+  trace.numEntries = 0;
+  unsigned const numRepeats = (NUM_PACKETS + period-1)/period;
+  trace.packetNums = new u_int32_t[numRepeats*numFileNums];
+  for (unsigned r = 0; r < numRepeats; ++r) {
+    for (unsigned i = 0; i < numFileNums; ++i) trace.packetNums[trace.numEntries++] = r*period + fileNums[i];
+  }
+
+  delete[] fileNums;
+  return True;
+}
+
+////////// Sending and receiving //////////
+
+// Sends the packets in "trace" to "port" on the local host.  (Each burst is sent using a single system call, where
+// possible, so that - even on a single core - the packets in a burst all arrive before we get to read any of them.)
+static void sendPackets(UsageEnvironment& env, portNumBits port, Trace const& trace) {
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if (sock < 0) return;
+
+  unsigned char packets[PACKETS_PER_BURST][RTP_HEADER_SIZE + PAYLOAD_SIZE];
+  unsigned char* buffers[PACKETS_PER_BURST];
+  unsigned bufferSizes[PACKETS_PER_BURST];
+  struct sockaddr_in destAddresses[PACKETS_PER_BURST];
+  MAKE_SOCKADDR_IN(destAddr, htonl(INADDR_LOOPBACK), htons(port));
+  unsigned i;
+  for (i = 0; i < PACKETS_PER_BURST; ++i) {
+    memset(packets[i], 0, sizeof packets[i]);
+    packets[i][0] = 0x80; packets[i][1] = RTP_PAYLOAD_TYPE;
+    packets[i][8] = 0x12; packets[i][9] = 0x34; packets[i][10] = 0x56; packets[i][11] = 0x78; // SSRC
+    buffers[i] = packets[i];
+    bufferSizes[i] = sizeof packets[i];
+    destAddresses[i] = destAddr;
+  }
+
+  unsigned entryNum = 0;
+  while (entryNum < trace.numEntries) {
+    for (i = 0; i < PACKETS_PER_BURST && entryNum < trace.numEntries; ++i, ++entryNum) {
+      u_int32_t const packetNum = trace.packetNums[entryNum];
+      u_int32_t const timestamp = packetNum*3000;
+      unsigned char* packet = packets[i];
+      packet[2] = (unsigned char)(packetNum>>8); packet[3] = (unsigned char)packetNum; // the RTP sequence number
+      packet[4] = timestamp>>24; packet[5] = timestamp>>16; packet[6] = timestamp>>8; packet[7] = (unsigned char)timestamp;
+      unsigned char* payload = &packet[RTP_HEADER_SIZE];
+      payload[0] = packetNum>>24; payload[1] = packetNum>>16; payload[2] = packetNum>>8; payload[3] = (unsigned char)packetNum;
+    }
+
+    unsigned numSendCalls;
+    writeSocketBatch(env, sock, destAddresses, buffers, bufferSizes, i, numSendCalls);
+    usleep(USECS_BETWEEN_BURSTS);
+  }
+  close(sock);
+}
+
+static double cpuSecondsUsed() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec/1000000.0
+    + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec/1000000.0;
+}
+
+// A 'watchdog' that stops the sink once the sender has exited, and no more packets have arrived for a while:
+struct Watchdog {
+  SpeedTestSink* sink;
+  pid_t senderPid;
+  Boolean senderHasExited;
+  u_int64_t numFramesLastTime;
+};
+
+static void checkWatchdog(void* clientData) {
+  Watchdog* watchdog = (Watchdog*)clientData;
+  if (!watchdog->senderHasExited) {
+    watchdog->senderHasExited = waitpid(watchdog->senderPid, NULL, WNOHANG) == watchdog->senderPid;
+  }
+  if (watchdog->senderHasExited && watchdog->sink->numFrames() == watchdog->numFramesLastTime) {
+    watchdog->sink->stop();
+    return;
+  }
+
+  watchdog->numFramesLastTime = watchdog->sink->numFrames();
+  watchdog->sink->envir().taskScheduler().scheduleDelayedTask(200000, checkWatchdog, watchdog);
+}
+
+static Boolean replayTrace(UsageEnvironment& env, Trace const& trace) {
+  // Create a socket to receive on:
+  struct in_addr dummyAddr; dummyAddr.s_addr = 0;
+  Groupsock* rtpGroupsock = NULL;
+  portNumBits port;
+  {
+    NoReuse dummy(env); // ensures that we skip over ports that are already in use
+    for (port = FIRST_RECEIVER_PORT; ; ++port) {
+      rtpGroupsock = new Groupsock(env, dummyAddr, Port(port), 255);
+      if (rtpGroupsock->socketNum() >= 0) break;
+      delete rtpGroupsock;
+    }
+  }
+  setReceiveBufferTo(env, rtpGroupsock->socketNum(), RECEIVE_BUFFER_SIZE);
+  RTPSource* rtpSource = SimpleRTPSource::createNew(env, rtpGroupsock, RTP_PAYLOAD_TYPE, 90000, "video/MP2T", 0, False);
+    // (each packet is a complete frame)
+  OrderCheckingSink* sink = new OrderCheckingSink(env, (u_int64_t)trace.numEntries*PAYLOAD_SIZE);
+
+  pid_t senderPid = fork();
+  if (senderPid < 0) {
+    env << "fork() failed\n";
+    exit(1);
+  } else if (senderPid == 0) {
+    // We're the child (sender) process:
+    sendPackets(env, port, trace);
+    _exit(0);
+  }
+
+  Watchdog watchdog = { sink, senderPid, False, 0 };
+  TaskToken watchdogTask = env.taskScheduler().scheduleDelayedTask(200000, checkWatchdog, &watchdog);
+  double startCPUSeconds = cpuSecondsUsed();
+  double seconds = sink->playFrom(*rtpSource);
+  double cpuSeconds = cpuSecondsUsed() - startCPUSeconds;
+  env.taskScheduler().unscheduleDelayedTask(watchdogTask);
+  if (!watchdog.senderHasExited) waitpid(senderPid, NULL, 0);
+
+  u_int64_t const numPackets = sink->numFrames();
+  printf("%-20s: %u packets sent, %llu received (%llu out of order) in %.2f seconds, %.2f us of CPU time per packet\n",
+	 trace.name, trace.numEntries, (unsigned long long)numPackets, (unsigned long long)sink->numOutOfOrder(),
+	 seconds, numPackets == 0 ? 0.0 : cpuSeconds*1000000.0/numPackets);
+  fflush(stdout);
+  Boolean const inOrder = sink->numOutOfOrder() == 0;
+
+  Medium::close(sink);
+  Medium::close(rtpSource);
+  delete rtpGroupsock;
+  return inOrder;
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+
+  if (argc > 2) {
+    *env << "Usage: " << argv[0] << " [<trace-file-name>]\n";
+    return 1;
+  }
+
+  Trace traces[4];
+  unsigned numTraces = 0;
+  if (argc == 2) {
+    if (!readTraceFile(*env, argv[1], traces[numTraces++])) return 1;
+  } else {
+    seedTestRandom(1);
+    traces[numTraces++] = inOrderTrace();
+    traces[numTraces++] = adjacentSwapsTrace();
+    traces[numTraces++] = jitterTrace("jitter (16 packets)", 16);
+    traces[numTraces++] = jitterTrace("jitter (64 packets)", 64);
+  }
+
+  Boolean allInOrder = True;
+  for (unsigned i = 0; i < numTraces; ++i) {
+    if (!replayTrace(*env, traces[i])) allInOrder = False;
+    delete[] traces[i].packetNums;
+  }
+
+  return allInOrder ? 0 : 1;
+}
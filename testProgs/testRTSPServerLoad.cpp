@@ -0,0 +1,320 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A load test for a RTSP server (e.g., "live555MediaServer", run with "-n <num-event-loops>"): It measures
+// how many RTSP sessions per second the server handles, by keeping <num-clients> clients busy.  Each client
+// repeatedly opens a new TCP connection to the server, and sends "DESCRIBE", "SETUP" (for each subsession,
+// with RTP/RTCP over UDP), "PLAY" and "TEARDOWN" for the stream.  The clients are spread across
+// <num-threads> threads, each with its own event loop, so that (given enough cores) the clients themselves
+// aren't the bottleneck.  (For a meaningful result, run the clients on a different host from the server.)
+//
+// Usage: testRTSPServerLoad [-t <num-threads>] [-d <seconds>] <rtsp-url> <num-clients>
+//     -t: the number of client threads (default: 1)
+//     -d: how long to run the test for (default: 10 seconds)
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+#include <pthread.h>
+
+#define RETRY_DELAY_USECS 100000 // after a failure, wait this long before trying again
+#define MAX_NUM_ERRORS_REPORTED 5 // per thread
+
+class LoadTestThread; // forward
+
+// A client that repeatedly sets up - and tears down - a session:
+class LoadTestClient: public RTSPClient {
+public:
+  static LoadTestClient* createNew(LoadTestThread& thread);
+
+protected:
+  LoadTestClient(LoadTestThread& thread, UsageEnvironment& env, char const* rtspURL);
+      // called only by "createNew()"
+  virtual ~LoadTestClient();
+
+private:
+  static void continueAfterDESCRIBE(RTSPClient* rtspClient, int resultCode, char* resultString);
+  static void continueAfterSETUP(RTSPClient* rtspClient, int resultCode, char* resultString);
+  static void continueAfterPLAY(RTSPClient* rtspClient, int resultCode, char* resultString);
+  static void continueAfterTEARDOWN(RTSPClient* rtspClient, int resultCode, char* resultString);
+  void setupNextSubsession();
+  void handleFailure(char const* commandName, int resultCode, char* resultString);
+  void finish(Boolean succeeded);
+
+private:
+  LoadTestThread& fThread;
+  double fStartTime;
+  MediaSession* fSession;
+  MediaSubsessionIterator* fIter;
+};
+
+// A thread, with its own event loop, that runs some of the clients:
+class LoadTestThread {
+public:
+  LoadTestThread(char const* rtspURL, unsigned numClients, double endTime);
+  ~LoadTestThread();
+
+  Boolean start();
+  void join();
+
+  u_int64_t numSessions() const { return fNumSessions; }
+  u_int64_t numFailures() const { return fNumFailures; }
+  double totalSessionSeconds() const { return fTotalSessionSeconds; }
+
+private:
+  friend class LoadTestClient;
+  static void* threadMain(void* arg);
+  void run();
+  static void startClient(void* clientData);
+  void startClient();
+  void clientFinished(double startTime, Boolean succeeded); // the client has closed itself
+
+private:
+  pthread_t fThread;
+  UsageEnvironment* fEnv;
+  char const* fRTSPURL;
+  unsigned fNumClients, fNumActiveClients;
+  double fEndTime;
+  char fDoneFlag;
+  u_int64_t fNumSessions, fNumFailures;
+  double fTotalSessionSeconds;
+};
+
+////////// LoadTestClient //////////
+
+LoadTestClient* LoadTestClient::createNew(LoadTestThread& thread) {
+  return new LoadTestClient(thread, *thread.fEnv, thread.fRTSPURL);
+}
+
+LoadTestClient::LoadTestClient(LoadTestThread& thread, UsageEnvironment& env, char const* rtspURL)
+  : RTSPClient(env, rtspURL, 0, "testRTSPServerLoad", 0, -1),
+    fThread(thread), fStartTime(timeNow()), fSession(NULL), fIter(NULL) {
+  sendDescribeCommand(continueAfterDESCRIBE);
+}
+
+LoadTestClient::~LoadTestClient() {
+  delete fIter;
+  Medium::close(fSession);
+}
+
+void LoadTestClient::continueAfterDESCRIBE(RTSPClient* rtspClient, int resultCode, char* resultString) {
+  LoadTestClient* client = (LoadTestClient*)rtspClient;
+  if (resultCode != 0) {
+    client->handleFailure("DESCRIBE", resultCode, resultString);
+    return;
+  }
+
+  client->fSession = MediaSession::createNew(client->envir(), resultString);
+  delete[] resultString;
+  if (client->fSession == NULL || !client->fSession->hasSubsessions()) {
+    client->handleFailure("DESCRIBE", -1, strDup("bad SDP description"));
+    return;
+  }
+
+  client->fIter = new MediaSubsessionIterator(*client->fSession);
+  client->setupNextSubsession();
+}
+
+void LoadTestClient::continueAfterSETUP(RTSPClient* rtspClient, int resultCode, char* resultString) {
+  LoadTestClient* client = (LoadTestClient*)rtspClient;
+  if (resultCode != 0) {
+    client->handleFailure("SETUP", resultCode, resultString);
+    return;
+  }
+
+  delete[] resultString;
+  client->setupNextSubsession();
+}
+
+void LoadTestClient::setupNextSubsession() {
+  MediaSubsession* subsession = fIter->next();
+  if (subsession != NULL) {
+    if (!subsession->initiate()) {
+      handleFailure("SETUP", -1, strDup(envir().getResultMsg()));
+      return;
+    }
+    sendSetupCommand(*subsession, continueAfterSETUP);
+    return;
+  }
+
+  // We've set up every subsession:
+  sendPlayCommand(*fSession, continueAfterPLAY);
+}
+
+void LoadTestClient::continueAfterPLAY(RTSPClient* rtspClient, int resultCode, char* resultString) {
+  LoadTestClient* client = (LoadTestClient*)rtspClient;
+  if (resultCode != 0) {
+    client->handleFailure("PLAY", resultCode, resultString);
+    return;
+  }
+
+  delete[] resultString;
+  client->sendTeardownCommand(*client->fSession, continueAfterTEARDOWN);
+}
+
+void LoadTestClient::continueAfterTEARDOWN(RTSPClient* rtspClient, int resultCode, char* resultString) {
+  LoadTestClient* client = (LoadTestClient*)rtspClient;
+  if (resultCode != 0) {
+    client->handleFailure("TEARDOWN", resultCode, resultString);
+    return;
+  }
+
+  delete[] resultString;
+  client->finish(True);
+}
+
+void LoadTestClient::handleFailure(char const* commandName, int resultCode, char* resultString) {
+  if (fThread.fNumFailures < MAX_NUM_ERRORS_REPORTED) {
+    envir() << "\"" << commandName << "\" failed (" << resultCode << "): "
+	    << (resultString == NULL ? "" : resultString) << "\n";
+  }
+  delete[] resultString;
+  finish(False);
+}
+
+void LoadTestClient::finish(Boolean succeeded) {
+  LoadTestThread& thread = fThread;
+  double startTime = fStartTime;
+  Medium::close(this);
+  thread.clientFinished(startTime, succeeded);
+}
+
+////////// LoadTestThread //////////
+
+LoadTestThread::LoadTestThread(char const* rtspURL, unsigned numClients, double endTime)
+  : fEnv(NULL), fRTSPURL(rtspURL), fNumClients(numClients), fNumActiveClients(0), fEndTime(endTime),
+    fDoneFlag(0), fNumSessions(0), fNumFailures(0), fTotalSessionSeconds(0.0) {
+}
+
+LoadTestThread::~LoadTestThread() {
+}
+
+Boolean LoadTestThread::start() {
+  return pthread_create(&fThread, NULL, threadMain, this) == 0;
+}
+
+void LoadTestThread::join() {
+  pthread_join(fThread, NULL);
+}
+
+void* LoadTestThread::threadMain(void* arg) {
+  ((LoadTestThread*)arg)->run();
+  return NULL;
+}
+
+void LoadTestThread::run() {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  fEnv = BasicUsageEnvironment::createNew(*scheduler);
+
+  for (fNumActiveClients = 0; fNumActiveClients < fNumClients; ++fNumActiveClients) startClient();
+  fEnv->taskScheduler().doEventLoop(&fDoneFlag);
+
+  fEnv->reclaim();
+  delete scheduler;
+}
+
+void LoadTestThread::startClient(void* clientData) {
+  ((LoadTestThread*)clientData)->startClient();
+}
+
+void LoadTestThread::startClient() {
+  (void)LoadTestClient::createNew(*this);
+}
+
+void LoadTestThread::clientFinished(double startTime, Boolean succeeded) {
+  double now = timeNow();
+  if (!succeeded) {
+    ++fNumFailures;
+  } else if (now <= fEndTime) {
+    ++fNumSessions;
+    fTotalSessionSeconds += now - startTime;
+  }
+
+  if (now < fEndTime) {
+    // Replace the client (after a delay, if it failed, so that we don't spin if the server is unavailable):
+    if (succeeded) {
+      startClient();
+    } else {
+      fEnv->taskScheduler().scheduleDelayedTask(RETRY_DELAY_USECS, startClient, this);
+    }
+  } else if (--fNumActiveClients == 0) {
+    fDoneFlag = ~0;
+  }
+}
+
+////////// main //////////
+
+static void usage(char const* progName) {
+  fprintf(stderr, "Usage: %s [-t <num-threads>] [-d <seconds>] <rtsp-url> <num-clients>\n", progName);
+}
+
+int main(int argc, char** argv) {
+  char const* progName = argv[0];
+  unsigned numThreads = 1;
+  unsigned numSeconds = 10;
+  while (argc > 2 && argv[1][0] == '-') {
+    if (strcmp(argv[1], "-t") == 0) {
+      numThreads = (unsigned)atoi(argv[2]);
+    } else if (strcmp(argv[1], "-d") == 0) {
+      numSeconds = (unsigned)atoi(argv[2]);
+    } else {
+      usage(progName);
+      return 1;
+    }
+    argc -= 2; argv += 2;
+  }
+  if (argc != 3 || numThreads == 0 || numSeconds == 0) {
+    usage(progName);
+    return 1;
+  }
+  char const* rtspURL = argv[1];
+  unsigned numClients = (unsigned)atoi(argv[2]);
+  if (numClients < numThreads) {
+    usage(progName);
+    return 1;
+  }
+
+  double endTime = timeNow() + numSeconds;
+  LoadTestThread** threads = new LoadTestThread*[numThreads];
+  unsigned i;
+  for (i = 0; i < numThreads; ++i) {
+    // Share the clients out among the threads (as evenly as possible):
+    unsigned numThreadClients = numClients/numThreads + (i < numClients%numThreads);
+    threads[i] = new LoadTestThread(rtspURL, numThreadClients, endTime);
+    if (!threads[i]->start()) {
+      fprintf(stderr, "Failed to create thread %u\n", i);
+      return 1;
+    }
+  }
+
+  u_int64_t numSessions = 0, numFailures = 0;
+  double totalSessionSeconds = 0.0;
+  for (i = 0; i < numThreads; ++i) {
+    threads[i]->join();
+    numSessions += threads[i]->numSessions();
+    numFailures += threads[i]->numFailures();
+    totalSessionSeconds += threads[i]->totalSessionSeconds();
+    delete threads[i];
+  }
+  delete[] threads;
+
+  printf("%u clients (%u threads), %u seconds: %llu sessions (%llu failures): %.1f sessions/second, %.2f ms per session\n",
+	 numClients, numThreads, numSeconds, (unsigned long long)numSessions, (unsigned long long)numFailures,
+	 numSessions/(double)numSeconds, numSessions == 0 ? 0.0 : totalSessionSeconds*1000.0/numSessions);
+
+  return numFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2018, Live Networks, Inc.  All rights reserved
+// A program that measures the throughput of the video 'framer' classes (i.e., of their start code
+// scanning): It reads a H.264, H.265, MPEG-4 or MPEG-1/2 video Elementary Stream file through a
+// "ByteStreamFileSource" and the corresponding framer, into a sink that hashes the resulting frames.
+// (The hash can be used to check that a change to the framer doesn't change its output.)
+// Optionally, it first creates a synthetic input file: random data, broken up by start codes,
+// with NAL units (or other units) of random sizes, and a sprinkling of 'near miss' start codes.
+//
+// Usage: testVideoFramerSpeed [-s <size-in-MBytes>] h264|h265|mpeg4|mpeg1or2 <file> [<num-iterations>]
+//     -s: (re)create <file> as a synthetic stream of (about) this size, before reading it
+//
+// main program
+
+#include "speedTestCommon.hh"
+#include "BasicUsageEnvironment.hh"
+
+#define SINK_BUFFER_SIZE 2000000
+
+////////// Synthetic input //////////
+
+static Boolean createSyntheticStream(char const* type, char const* fileName, unsigned numMBytes) {
+  FILE* fid = fopen(fileName, "wb");
+  if (fid == NULL) return False;
+
+  Boolean isH264or5 = strcmp(type, "h264") == 0 || strcmp(type, "h265") == 0;
+  unsigned const maxUnitSize = 100000;
+  unsigned char* unit = new unsigned char[5 + 2 + maxUnitSize];
+  u_int64_t const targetSize = (u_int64_t)numMBytes*1000000;
+  u_int64_t size = 0;
+  while (size < targetSize) {
+    unsigned unitSize = 0;
+
+    // Begin with a 3-, 4- (or, for H.264/5, 5-) byte start code:
+    unsigned numZeros = 2 + testRandom32()%(isH264or5 ? 3 : 2);
+    for (unsigned i = 0; i < numZeros; ++i) unit[unitSize++] = 0;
+    unit[unitSize++] = 1;
+
+    // Then a header:
+    if (strcmp(type, "h264") == 0) {
+      static unsigned char const nalUnitTypes[] = { 1, 1, 1, 5, 6, 7, 8, 9 };
+      unit[unitSize++] = 0x60|nalUnitTypes[testRandom32()%8];
+    } else if (strcmp(type, "h265") == 0) {
+      static unsigned char const nalUnitTypes[] = { 0, 1, 19, 20, 32, 33, 34, 35, 39 };
+      unit[unitSize++] = (nalUnitTypes[testRandom32()%9]<<1)&0x7E;
+      unit[unitSize++] = 1;
+    } else if (strcmp(type, "mpeg4") == 0) {
+      static unsigned char const codes[] = { 0xB0, 0xB5, 0x00, 0x20, 0xB3, 0xB6, 0xB6, 0xB6, 0xB2 };
+      unit[unitSize++] = codes[testRandom32()%9];
+    } else {
+      static unsigned char const codes[] = { 0xB3, 0xB8, 0x00, 0x01, 0x02, 0x05, 0xB5, 0x00, 0x01 };
+      unit[unitSize++] = codes[testRandom32()%9];
+    }
+
+    // Then a payload of random size (mostly small or medium; occasionally large):
+    unsigned payloadSize;
+    switch (testRandom32()%4) {
+      case 0: { payloadSize = 1 + testRandom32()%39; break; }
+      case 1: { payloadSize = 100 + testRandom32()%2900; break; }
+      case 2: {
+	payloadSize = testRandom32()%10 == 0 ? 5000 + testRandom32()%((isH264or5 ? maxUnitSize : 8000) - 5000) : 500;
+	break;
+      }
+      default: { payloadSize = 500; break; }
+    }
+    unsigned char* payload = &unit[unitSize];
+    unsigned i;
+    for (i = 0; i < payloadSize; ++i) payload[i] = (unsigned char)testRandom32();
+    // Sprinkle in some 0x00 and 0x01 bytes, and some 'near miss' start codes:
+    for (i = 0; i < payloadSize/50; ++i) payload[testRandom32()%payloadSize] = testRandom32()%3 == 2;
+    if (payloadSize > 3) {
+      static unsigned char const nearMisses[3][3] = { {0,0,2}, {0,0,0}, {0,1,0} };
+      for (i = 0; i < payloadSize/400; ++i) memcpy(&payload[testRandom32()%(payloadSize-3)], nearMisses[testRandom32()%3], 3);
+    }
+    unitSize += payloadSize;
+
+    // But don't let the header and payload contain any (accidental) real start codes.  (In particular,
+    // the framers don't handle 'empty' units - e.g., "00 00 01 00 00 01" - which would stall them.)
+    for (i = numZeros + 3; i < unitSize; ++i) {
+      if (unit[i] == 1 && unit[i-1] == 0 && unit[i-2] == 0) unit[i] = 2;
+    }
+
+    fwrite(unit, 1, unitSize, fid);
+    size += unitSize;
+  }
+  unsigned char const trailingZeros[2] = { 0, 0 };
+  fwrite(trailingZeros, 1, 2, fid);
+
+  delete[] unit;
+  fclose(fid);
+  return True;
+}
+
+////////// main //////////
+
+static void usage(UsageEnvironment& env, char const* progName) {
+  env << "Usage: " << progName << " [-s <size-in-MBytes>] h264|h265|mpeg4|mpeg1or2 <file> [<num-iterations>]\n";
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+  char const* progName = argv[0];
+
+  unsigned syntheticSizeInMBytes = 0;
+  if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+    syntheticSizeInMBytes = (unsigned)atoi(argv[2]);
+    argc -= 2; argv += 2;
+  }
+  if (argc < 3 || argc > 4) {
+    usage(*env, progName);
+    return 1;
+  }
+  char const* type = argv[1];
+  char const* fileName = argv[2];
+  int numIterations = argc > 3 ? atoi(argv[3]) : 1;
+  if (numIterations <= 0 || (strcmp(type, "h264") != 0 && strcmp(type, "h265") != 0
+			     && strcmp(type, "mpeg4") != 0 && strcmp(type, "mpeg1or2") != 0)) {
+    usage(*env, progName);
+    return 1;
+  }
+
+  if (syntheticSizeInMBytes > 0 && !createSyntheticStream(type, fileName, syntheticSizeInMBytes)) {
+    *env << "Unable to create \"" << fileName << "\"\n";
+    return 1;
+  }
+
+  double totalSeconds = 0.0;
+  u_int64_t fileSize = 0;
+  SpeedTestSink* sink = SpeedTestSink::createNew(*env, SINK_BUFFER_SIZE);
+  for (int i = 0; i < numIterations; ++i) {
+    ByteStreamFileSource* fileSource = ByteStreamFileSource::createNew(*env, fileName);
+    if (fileSource == NULL) {
+      *env << "Unable to open file \"" << fileName << "\" as a byte-stream file source\n";
+      return 1;
+    }
+    fileSize = fileSource->fileSize();
+
+    FramedSource* framer;
+    if (strcmp(type, "h264") == 0) {
+      framer = H264VideoStreamFramer::createNew(*env, fileSource);
+    } else if (strcmp(type, "h265") == 0) {
+      framer = H265VideoStreamFramer::createNew(*env, fileSource);
+    } else if (strcmp(type, "mpeg4") == 0) {
+      framer = MPEG4VideoStreamFramer::createNew(*env, fileSource);
+    } else {
+      framer = MPEG1or2VideoStreamFramer::createNew(*env, fileSource);
+    }
+
+    totalSeconds += sink->playFrom(*framer);
+    Medium::close(framer); // also closes "fileSource"
+  }
+
+  printf("%s: %llu frames, %llu bytes (%llu truncated), hash %016llx: %.1f MBytes/second\n", type,
+	 (unsigned long long)sink->numFrames(), (unsigned long long)sink->numBytes(),
+	 (unsigned long long)sink->numTruncatedBytes(), (unsigned long long)sink->hash(),
+	 fileSize*(double)numIterations/totalSeconds/1000000.0);
+  Medium::close(sink);
+
+  return 0;
+}